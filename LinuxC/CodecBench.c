@@ -0,0 +1,577 @@
+/* Microbenchmark for the binary codec. Every type in UA_TYPES is filled with a
+ * synthesized value (nested arrays, large variants, deep ExtensionObjects) and
+ * UA_encodeBinary, UA_decodeBinary, UA_calcSizeBinary, UA_copy and
+ * UA_deleteMembers are timed. Typical service messages with realistic payload
+ * sizes are benchmarked in addition. The results are written as JSON.
+ *
+ * Usage: CodecBench [-o results.json] [-m min-ms-per-measurement] [-f filter] */
+
+#define _POSIX_C_SOURCE 199309L
+
+#ifdef UA_NO_AMALGAMATION
+# include "ua_types.h"
+# include "ua_types_generated.h"
+#else
+# include "open62541.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The binary codec is internal to the library (ua_types_encoding_binary.h) */
+typedef UA_StatusCode (*UA_exchangeEncodeBuffer)(void *handle, UA_ByteString *buf, size_t offset);
+UA_StatusCode
+UA_encodeBinary(const void *src, const UA_DataType *type,
+                UA_exchangeEncodeBuffer exchangeCallback, void *exchangeHandle,
+                UA_ByteString *dst, size_t *offset);
+UA_StatusCode
+UA_decodeBinary(const UA_ByteString *src, size_t *offset, void *dst,
+                const UA_DataType *type);
+size_t UA_calcSizeBinary(void *p, const UA_DataType *type);
+
+#define MAX_DEPTH 3        /* nesting of ExtensionObjects, Variants, arrays */
+#define ARRAY_LENGTH 4     /* length of array members in structures */
+#define VARIANT_LENGTH 1024 /* length of the Double array in top-level variants */
+#define MAX_BATCH 1024     /* decoded/copied values kept in memory at once */
+
+static double minNs = 50.0 * 1000.0 * 1000.0;
+
+static double
+now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**********************/
+/* Value Synthesizing */
+/**********************/
+
+static void fill(void *p, const UA_DataType *type, size_t depth);
+
+static void
+fillString(UA_String *s, const char *chars) {
+    *s = UA_STRING_ALLOC(chars);
+}
+
+static void
+fillArray(void **p, size_t *length, const UA_DataType *type, size_t depth, size_t n) {
+    if(depth >= MAX_DEPTH)
+        n = 0;
+    *p = UA_Array_new(n, type);
+    *length = n;
+    uintptr_t ptr = (uintptr_t)*p;
+    for(size_t i = 0; i < n; ++i) {
+        fill((void*)ptr, type, depth + 1);
+        ptr += type->memSize;
+    }
+}
+
+static void
+fillVariant(UA_Variant *v, size_t depth) {
+    if(depth == 0) {
+        /* Large numeric array with dimensions */
+        UA_Double *d = (UA_Double*)UA_Array_new(VARIANT_LENGTH, &UA_TYPES[UA_TYPES_DOUBLE]);
+        for(size_t i = 0; i < VARIANT_LENGTH; ++i)
+            d[i] = (UA_Double)i * 0.25;
+        UA_Variant_setArray(v, d, VARIANT_LENGTH, &UA_TYPES[UA_TYPES_DOUBLE]);
+        v->arrayDimensions = (UA_UInt32*)UA_Array_new(2, &UA_TYPES[UA_TYPES_UINT32]);
+        v->arrayDimensionsSize = 2;
+        v->arrayDimensions[0] = 32;
+        v->arrayDimensions[1] = VARIANT_LENGTH / 32;
+    } else if(depth < MAX_DEPTH) {
+        /* Structure that is wrapped in an ExtensionObject on the wire */
+        const UA_DataType *type = &UA_TYPES[UA_TYPES_READVALUEID];
+        void *data = UA_new(type);
+        fill(data, type, depth + 1);
+        UA_Variant_setScalar(v, data, type);
+    } else {
+        UA_Int32 *i = UA_Int32_new();
+        *i = 42;
+        UA_Variant_setScalar(v, i, &UA_TYPES[UA_TYPES_INT32]);
+    }
+}
+
+static void
+fillExtensionObject(UA_ExtensionObject *eo, size_t depth) {
+    /* AddNodesItem contains an ExtensionObject itself. This nests down to
+     * MAX_DEPTH where VariableAttributes (with a variant) end the chain. */
+    const UA_DataType *type = (depth + 1 < MAX_DEPTH) ?
+        &UA_TYPES[UA_TYPES_ADDNODESITEM] : &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES];
+    eo->encoding = UA_EXTENSIONOBJECT_DECODED;
+    eo->content.decoded.type = type;
+    eo->content.decoded.data = UA_new(type);
+    fill(eo->content.decoded.data, type, depth + 1);
+}
+
+static void
+fillBuiltin(void *p, const UA_DataType *type, size_t depth) {
+    switch(type->typeIndex) {
+    case UA_TYPES_BOOLEAN: *(UA_Boolean*)p = true; break;
+    case UA_TYPES_SBYTE: *(UA_SByte*)p = -12; break;
+    case UA_TYPES_BYTE: *(UA_Byte*)p = 200; break;
+    case UA_TYPES_INT16: *(UA_Int16*)p = -1234; break;
+    case UA_TYPES_UINT16: *(UA_UInt16*)p = 54321; break;
+    case UA_TYPES_INT32: *(UA_Int32*)p = -123456; break;
+    case UA_TYPES_UINT32: *(UA_UInt32*)p = 3456789; break;
+    case UA_TYPES_INT64: *(UA_Int64*)p = -12345678901LL; break;
+    case UA_TYPES_UINT64: *(UA_UInt64*)p = 12345678901ULL; break;
+    case UA_TYPES_FLOAT: *(UA_Float*)p = 3.25f; break;
+    case UA_TYPES_DOUBLE: *(UA_Double*)p = 21.375; break;
+    case UA_TYPES_STRING: fillString((UA_String*)p, "eo.temperature.sensor"); break;
+    case UA_TYPES_DATETIME: *(UA_DateTime*)p = UA_DateTime_now(); break;
+    case UA_TYPES_GUID: *(UA_Guid*)p = UA_Guid_random(); break;
+    case UA_TYPES_BYTESTRING: fillString((UA_String*)p, "0123456789abcdef0123456789abcdef"); break;
+    case UA_TYPES_XMLELEMENT: fillString((UA_String*)p, "<Value>21.375</Value>"); break;
+    case UA_TYPES_NODEID:
+        *(UA_NodeId*)p = UA_NODEID_STRING_ALLOC(1, "eo.humidity");
+        break;
+    case UA_TYPES_EXPANDEDNODEID: {
+        UA_ExpandedNodeId *e = (UA_ExpandedNodeId*)p;
+        e->nodeId = UA_NODEID_NUMERIC(1, 51000);
+        fillString(&e->namespaceUri, "urn:enocean:bridge");
+        e->serverIndex = 1;
+        break; }
+    case UA_TYPES_STATUSCODE: *(UA_StatusCode*)p = UA_STATUSCODE_BADNOTCONNECTED; break;
+    case UA_TYPES_QUALIFIEDNAME:
+        *(UA_QualifiedName*)p = UA_QUALIFIEDNAME_ALLOC(1, "Temperature");
+        break;
+    case UA_TYPES_LOCALIZEDTEXT:
+        *(UA_LocalizedText*)p = UA_LOCALIZEDTEXT_ALLOC("en_US", "Room temperature");
+        break;
+    case UA_TYPES_EXTENSIONOBJECT:
+        fillExtensionObject((UA_ExtensionObject*)p, depth);
+        break;
+    case UA_TYPES_DATAVALUE: {
+        UA_DataValue *dv = (UA_DataValue*)p;
+        fillVariant(&dv->value, depth + 1);
+        dv->hasValue = true;
+        dv->hasStatus = true;
+        dv->status = UA_STATUSCODE_GOOD;
+        dv->hasSourceTimestamp = true;
+        dv->sourceTimestamp = UA_DateTime_now();
+        dv->hasServerTimestamp = true;
+        dv->serverTimestamp = dv->sourceTimestamp;
+        dv->hasSourcePicoseconds = true;
+        dv->sourcePicoseconds = 10;
+        break; }
+    case UA_TYPES_VARIANT:
+        fillVariant((UA_Variant*)p, depth);
+        break;
+    case UA_TYPES_DIAGNOSTICINFO: {
+        UA_DiagnosticInfo *di = (UA_DiagnosticInfo*)p;
+        di->hasSymbolicId = true;
+        di->symbolicId = 1;
+        di->hasLocalizedText = true;
+        di->localizedText = 2;
+        di->hasAdditionalInfo = true;
+        fillString(&di->additionalInfo, "sensor offline");
+        di->hasInnerStatusCode = true;
+        di->innerStatusCode = UA_STATUSCODE_BADTIMEOUT;
+        if(depth < MAX_DEPTH) {
+            di->hasInnerDiagnosticInfo = true;
+            di->innerDiagnosticInfo = UA_DiagnosticInfo_new();
+            fill(di->innerDiagnosticInfo, type, depth + 1);
+        }
+        break; }
+    default:
+        break;
+    }
+}
+
+static void
+fill(void *p, const UA_DataType *type, size_t depth) {
+    if(type->builtin) {
+        fillBuiltin(p, type, depth);
+        return;
+    }
+
+    /* Walk the structure members as UA_copy does */
+    uintptr_t ptr = (uintptr_t)p;
+    const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+    for(size_t i = 0; i < type->membersSize; ++i) {
+        const UA_DataTypeMember *m = &type->members[i];
+        const UA_DataType *mtype = &typelists[!m->namespaceZero][m->memberTypeIndex];
+        ptr += m->padding;
+        if(!m->isArray) {
+            fill((void*)ptr, mtype, depth);
+            ptr += mtype->memSize;
+        } else {
+            size_t *length = (size_t*)ptr;
+            ptr += sizeof(size_t);
+            fillArray((void**)ptr, length, mtype, depth, ARRAY_LENGTH);
+            ptr += sizeof(void*);
+        }
+    }
+}
+
+/********************/
+/* Service Messages */
+/********************/
+
+static void *
+readRequest(size_t n) {
+    UA_ReadRequest *r = UA_ReadRequest_new();
+    r->timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    r->nodesToRead = (UA_ReadValueId*)UA_Array_new(n, &UA_TYPES[UA_TYPES_READVALUEID]);
+    r->nodesToReadSize = n;
+    for(size_t i = 0; i < n; ++i) {
+        r->nodesToRead[i].nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)(51000 + i));
+        r->nodesToRead[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    return r;
+}
+
+static void *
+readResponse(size_t n) {
+    UA_ReadResponse *r = UA_ReadResponse_new();
+    r->results = (UA_DataValue*)UA_Array_new(n, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    r->resultsSize = n;
+    UA_DateTime now = UA_DateTime_now();
+    for(size_t i = 0; i < n; ++i) {
+        UA_Double d = 20.0 + (UA_Double)i * 0.01;
+        UA_Variant_setScalarCopy(&r->results[i].value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);
+        r->results[i].hasValue = true;
+        r->results[i].hasSourceTimestamp = true;
+        r->results[i].sourceTimestamp = now;
+        r->results[i].hasServerTimestamp = true;
+        r->results[i].serverTimestamp = now;
+    }
+    return r;
+}
+
+static void *
+writeRequest(size_t n) {
+    UA_WriteRequest *r = UA_WriteRequest_new();
+    r->nodesToWrite = (UA_WriteValue*)UA_Array_new(n, &UA_TYPES[UA_TYPES_WRITEVALUE]);
+    r->nodesToWriteSize = n;
+    for(size_t i = 0; i < n; ++i) {
+        UA_WriteValue *w = &r->nodesToWrite[i];
+        w->nodeId = UA_NODEID_STRING_ALLOC(1, "eo.temperature");
+        w->attributeId = UA_ATTRIBUTEID_VALUE;
+        UA_Int32 v = (UA_Int32)i;
+        UA_Variant_setScalarCopy(&w->value.value, &v, &UA_TYPES[UA_TYPES_INT32]);
+        w->value.hasValue = true;
+    }
+    return r;
+}
+
+static void *
+publishResponse(size_t n) {
+    UA_PublishResponse *r = UA_PublishResponse_new();
+    r->subscriptionId = 1;
+    r->notificationMessage.sequenceNumber = 1;
+    r->notificationMessage.publishTime = UA_DateTime_now();
+    UA_DataChangeNotification *dcn = UA_DataChangeNotification_new();
+    dcn->monitoredItems = (UA_MonitoredItemNotification*)
+        UA_Array_new(n, &UA_TYPES[UA_TYPES_MONITOREDITEMNOTIFICATION]);
+    dcn->monitoredItemsSize = n;
+    for(size_t i = 0; i < n; ++i) {
+        UA_MonitoredItemNotification *min = &dcn->monitoredItems[i];
+        min->clientHandle = (UA_UInt32)i;
+        UA_Double d = (UA_Double)i;
+        UA_Variant_setScalarCopy(&min->value.value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);
+        min->value.hasValue = true;
+        min->value.hasSourceTimestamp = true;
+        min->value.sourceTimestamp = r->notificationMessage.publishTime;
+    }
+    r->notificationMessage.notificationData = UA_ExtensionObject_new();
+    r->notificationMessage.notificationDataSize = 1;
+    r->notificationMessage.notificationData->encoding = UA_EXTENSIONOBJECT_DECODED;
+    r->notificationMessage.notificationData->content.decoded.type =
+        &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION];
+    r->notificationMessage.notificationData->content.decoded.data = dcn;
+    return r;
+}
+
+static void *
+browseResponse(size_t n) {
+    UA_BrowseResponse *r = UA_BrowseResponse_new();
+    r->results = UA_BrowseResult_new();
+    r->resultsSize = 1;
+    UA_BrowseResult *br = r->results;
+    br->references = (UA_ReferenceDescription*)
+        UA_Array_new(n, &UA_TYPES[UA_TYPES_REFERENCEDESCRIPTION]);
+    br->referencesSize = n;
+    for(size_t i = 0; i < n; ++i) {
+        UA_ReferenceDescription *rd = &br->references[i];
+        rd->referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+        rd->isForward = true;
+        rd->nodeId.nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)(51000 + i));
+        rd->browseName = UA_QUALIFIEDNAME_ALLOC(1, "Temperature");
+        rd->displayName = UA_LOCALIZEDTEXT_ALLOC("en_US", "Temperature");
+        rd->nodeClass = UA_NODECLASS_VARIABLE;
+        rd->typeDefinition.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE);
+    }
+    return r;
+}
+
+static void *
+createMonitoredItemsRequest(size_t n) {
+    UA_CreateMonitoredItemsRequest *r = UA_CreateMonitoredItemsRequest_new();
+    r->subscriptionId = 1;
+    r->timestampsToReturn = UA_TIMESTAMPSTORETURN_SOURCE;
+    r->itemsToCreate = (UA_MonitoredItemCreateRequest*)
+        UA_Array_new(n, &UA_TYPES[UA_TYPES_MONITOREDITEMCREATEREQUEST]);
+    r->itemsToCreateSize = n;
+    for(size_t i = 0; i < n; ++i) {
+        UA_MonitoredItemCreateRequest *c = &r->itemsToCreate[i];
+        c->itemToMonitor.nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)(51000 + i));
+        c->itemToMonitor.attributeId = UA_ATTRIBUTEID_VALUE;
+        c->monitoringMode = UA_MONITORINGMODE_REPORTING;
+        c->requestedParameters.clientHandle = (UA_UInt32)i;
+        c->requestedParameters.samplingInterval = 250.0;
+        c->requestedParameters.queueSize = 1;
+        c->requestedParameters.discardOldest = true;
+    }
+    return r;
+}
+
+static void *
+waveformVariant(size_t n) {
+    UA_Variant *v = UA_Variant_new();
+    UA_Double *d = (UA_Double*)UA_Array_new(n, &UA_TYPES[UA_TYPES_DOUBLE]);
+    for(size_t i = 0; i < n; ++i)
+        d[i] = (UA_Double)i * 0.001;
+    UA_Variant_setArray(v, d, n, &UA_TYPES[UA_TYPES_DOUBLE]);
+    return v;
+}
+
+typedef struct {
+    const char *name;
+    const UA_DataType *type;
+    void * (*create)(size_t n);
+    size_t n;
+} Scenario;
+
+static Scenario scenarios[] = {
+    {"ReadRequest[100]", &UA_TYPES[UA_TYPES_READREQUEST], readRequest, 100},
+    {"ReadRequest[1000]", &UA_TYPES[UA_TYPES_READREQUEST], readRequest, 1000},
+    {"ReadResponse[100]", &UA_TYPES[UA_TYPES_READRESPONSE], readResponse, 100},
+    {"ReadResponse[1000]", &UA_TYPES[UA_TYPES_READRESPONSE], readResponse, 1000},
+    {"WriteRequest[100]", &UA_TYPES[UA_TYPES_WRITEREQUEST], writeRequest, 100},
+    {"PublishResponse[100]", &UA_TYPES[UA_TYPES_PUBLISHRESPONSE], publishResponse, 100},
+    {"PublishResponse[1000]", &UA_TYPES[UA_TYPES_PUBLISHRESPONSE], publishResponse, 1000},
+    {"BrowseResponse[100]", &UA_TYPES[UA_TYPES_BROWSERESPONSE], browseResponse, 100},
+    {"CreateMonitoredItemsRequest[100]", &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST],
+     createMonitoredItemsRequest, 100},
+    {"Variant(Double[100000])", &UA_TYPES[UA_TYPES_VARIANT], waveformVariant, 100000}
+};
+
+/*************/
+/* Measuring */
+/*************/
+
+typedef struct {
+    double nsPerOp;
+    double bytesPerSec;
+} Result;
+
+static void
+setResult(Result *r, double ns, size_t ops, size_t bytes) {
+    r->nsPerOp = ops > 0 ? ns / (double)ops : 0.0;
+    r->bytesPerSec = r->nsPerOp > 0.0 ? (double)bytes * 1e9 / r->nsPerOp : 0.0;
+}
+
+static UA_StatusCode
+benchValue(const void *src, const UA_DataType *type, size_t *encodedSize,
+           Result *encode, Result *decode, Result *calcSize,
+           Result *copy, Result *deleteMembers) {
+    /* Encode once to validate the value */
+    size_t size = UA_calcSizeBinary((void*)(uintptr_t)src, type);
+    UA_ByteString buf;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(&buf, size);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t offset = 0;
+    retval = UA_encodeBinary(src, type, NULL, NULL, &buf, &offset);
+    if(retval != UA_STATUSCODE_GOOD || offset != size) {
+        UA_ByteString_deleteMembers(&buf);
+        return retval != UA_STATUSCODE_GOOD ? retval : UA_STATUSCODE_BADENCODINGERROR;
+    }
+    *encodedSize = size;
+
+    /* Decode once to validate the roundtrip */
+    void *decoded = UA_new(type);
+    size_t decodedOffset = 0;
+    retval = UA_decodeBinary(&buf, &decodedOffset, decoded, type);
+    UA_delete(decoded, type);
+    if(retval != UA_STATUSCODE_GOOD || decodedOffset != size) {
+        UA_ByteString_deleteMembers(&buf);
+        return retval != UA_STATUSCODE_GOOD ? retval : UA_STATUSCODE_BADDECODINGERROR;
+    }
+
+    /* calcSize */
+    size_t ops = 0, reps = 1;
+    double start = now_ns(), elapsed = 0.0;
+    volatile size_t sink = 0;
+    while(elapsed < minNs) {
+        for(size_t i = 0; i < reps; ++i)
+            sink += UA_calcSizeBinary((void*)(uintptr_t)src, type);
+        ops += reps;
+        reps *= 2;
+        elapsed = now_ns() - start;
+    }
+    setResult(calcSize, elapsed, ops, size);
+
+    /* encode */
+    ops = 0; reps = 1;
+    start = now_ns(); elapsed = 0.0;
+    while(elapsed < minNs) {
+        for(size_t i = 0; i < reps; ++i) {
+            offset = 0;
+            retval |= UA_encodeBinary(src, type, NULL, NULL, &buf, &offset);
+        }
+        ops += reps;
+        reps *= 2;
+        elapsed = now_ns() - start;
+    }
+    setResult(encode, elapsed, ops, size);
+
+    /* decode, copy and deleteMembers are measured in batches. The decoded and
+     * copied values are deleted and measured afterwards. */
+    size_t batch = MAX_BATCH;
+    if(batch * (size + type->memSize) > 64 * 1024 * 1024)
+        batch = 1 + 64 * 1024 * 1024 / (size + type->memSize);
+    void *values = UA_calloc(batch, type->memSize);
+    if(!values) {
+        UA_ByteString_deleteMembers(&buf);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    double decodeNs = 0.0, copyNs = 0.0, deleteNs = 0.0;
+    size_t decodeOps = 0, copyOps = 0, deleteOps = 0;
+    for(size_t round = 0; decodeNs < minNs || copyNs < minNs; ++round) {
+        /* Alternate between decoding and copying */
+        UA_Boolean doDecode = (round % 2 == 0);
+        uintptr_t ptr = (uintptr_t)values;
+        start = now_ns();
+        for(size_t i = 0; i < batch; ++i) {
+            if(doDecode) {
+                offset = 0;
+                retval |= UA_decodeBinary(&buf, &offset, (void*)ptr, type);
+            } else {
+                retval |= UA_copy(src, (void*)ptr, type);
+            }
+            ptr += type->memSize;
+        }
+        if(doDecode) {
+            decodeNs += now_ns() - start;
+            decodeOps += batch;
+        } else {
+            copyNs += now_ns() - start;
+            copyOps += batch;
+        }
+
+        ptr = (uintptr_t)values;
+        start = now_ns();
+        for(size_t i = 0; i < batch; ++i) {
+            UA_deleteMembers((void*)ptr, type);
+            ptr += type->memSize;
+        }
+        deleteNs += now_ns() - start;
+        deleteOps += batch;
+    }
+    setResult(decode, decodeNs, decodeOps, size);
+    setResult(copy, copyNs, copyOps, size);
+    setResult(deleteMembers, deleteNs, deleteOps, size);
+
+    UA_free(values);
+    UA_ByteString_deleteMembers(&buf);
+    (void)sink;
+    return retval;
+}
+
+static void
+printResult(FILE *out, const char *name, const Result *r, UA_Boolean last) {
+    fprintf(out, "      \"%s\": {\"nsPerOp\": %.2f, \"bytesPerSec\": %.0f}%s\n",
+            name, r->nsPerOp, r->bytesPerSec, last ? "" : ",");
+}
+
+static void
+benchAndPrint(FILE *out, UA_Boolean *first, const char *name,
+              const void *src, const UA_DataType *type) {
+    Result encode, decode, calcSize, copy, deleteMembers;
+    memset(&encode, 0, sizeof(Result));
+    decode = calcSize = copy = deleteMembers = encode;
+    size_t size = 0;
+    fprintf(stderr, "%-40s", name);
+    UA_StatusCode retval = benchValue(src, type, &size, &encode, &decode,
+                                      &calcSize, &copy, &deleteMembers);
+    fprintf(out, "%s    {\n      \"name\": \"%s\",\n      \"type\": \"%s\",\n",
+            *first ? "" : ",\n", name, type->typeName);
+    *first = false;
+    if(retval != UA_STATUSCODE_GOOD) {
+        fprintf(stderr, " failed: %s\n", UA_StatusCode_name(retval));
+        fprintf(out, "      \"error\": \"%s\"\n    }", UA_StatusCode_name(retval));
+        return;
+    }
+    fprintf(stderr, " %8zu bytes  enc %10.1f ns  dec %10.1f ns\n",
+            size, encode.nsPerOp, decode.nsPerOp);
+    fprintf(out, "      \"encodedBytes\": %zu,\n", size);
+    printResult(out, "encode", &encode, false);
+    printResult(out, "decode", &decode, false);
+    printResult(out, "calcSize", &calcSize, false);
+    printResult(out, "copy", &copy, false);
+    printResult(out, "deleteMembers", &deleteMembers, true);
+    fprintf(out, "    }");
+}
+
+int main(int argc, char **argv) {
+    const char *outfile = NULL;
+    const char *filter = NULL;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outfile = argv[++i];
+        } else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            minNs = atof(argv[++i]) * 1000.0 * 1000.0;
+        } else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-o results.json] [-m min-ms] [-f filter]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if(outfile) {
+        out = fopen(outfile, "w");
+        if(!out) {
+            fprintf(stderr, "Could not open %s\n", outfile);
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\n  \"version\": \"%d.%d.%d%s\",\n  \"minMsPerMeasurement\": %.1f,\n",
+            UA_OPEN62541_VER_MAJOR, UA_OPEN62541_VER_MINOR, UA_OPEN62541_VER_PATCH,
+            UA_OPEN62541_VER_LABEL, minNs / 1e6);
+    fprintf(out, "  \"results\": [\n");
+    UA_Boolean first = true;
+
+    /* All types with synthesized values */
+    for(size_t i = 0; i < UA_TYPES_COUNT; ++i) {
+        const UA_DataType *type = &UA_TYPES[i];
+        if(filter && !strstr(type->typeName, filter))
+            continue;
+        void *value = UA_new(type);
+        fill(value, type, 0);
+        benchAndPrint(out, &first, type->typeName, value, type);
+        UA_delete(value, type);
+    }
+
+    /* Service messages */
+    for(size_t i = 0; i < sizeof(scenarios) / sizeof(Scenario); ++i) {
+        if(filter && !strstr(scenarios[i].name, filter))
+            continue;
+        void *value = scenarios[i].create(scenarios[i].n);
+        benchAndPrint(out, &first, scenarios[i].name, value, scenarios[i].type);
+        UA_delete(value, scenarios[i].type);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if(outfile)
+        fclose(out);
+    return 0;
+}
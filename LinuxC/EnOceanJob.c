@@ -34,8 +34,14 @@ typedef int BOOL;
 UA_Boolean running = true;
 UA_Logger logger = UA_Log_Stdout;
 
-static void
-writeVariable(UA_Server *server, int data, char *name);
+/* Interned NodeIds of the EnOcean variables (written on every poll) */
+static const UA_InternedNodeId *eoTempId;
+static const UA_InternedNodeId *eoHumiId;
+static const UA_InternedNodeId *eoCo2Id;
+static const UA_InternedNodeId *eoSwId;
+
+static size_t
+writeVariable(UA_WriteValue *wv, UA_Int32 *data, const UA_InternedNodeId *nodeId);
 
 static int getTemperature();
 
@@ -113,10 +119,15 @@ enoceanCallback(UA_Server *server, void *data) {
 
 	UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, (char *)text);
 
-	writeVariable(server, temp, EO_TEMP_ID);
-	writeVariable(server, humi, EO_HUMI_ID);
-	writeVariable(server, co2, EO_CO2_ID);
-	writeVariable(server, sw, EO_SW_ID);
+	/* All writes are applied in one pass. Every node is edited once. */
+	UA_Int32 values[4] = { temp, humi, co2, sw };
+	UA_WriteValue wv[12];
+	size_t wvSize = 0;
+	wvSize += writeVariable(&wv[wvSize], &values[0], eoTempId);
+	wvSize += writeVariable(&wv[wvSize], &values[1], eoHumiId);
+	wvSize += writeVariable(&wv[wvSize], &values[2], eoCo2Id);
+	wvSize += writeVariable(&wv[wvSize], &values[3], eoSwId);
+	UA_Server_writeMany(server, wvSize, wv, NULL);
 }
 
 static void stopHandler(int sign) {
@@ -149,34 +160,31 @@ readTimeData(void *handle, const UA_NodeId nodeId, UA_Boolean sourceTimeStamp,
 * implementation that can also be reached over the network by an OPC UA client.
 */
 
-static void
-writeVariable(UA_Server *server, int data, char *idName) {
-	UA_NodeId myIntegerNodeId = UA_NODEID_STRING(1, idName);
+/* Adds the writes of one variable to wv (at most three) and returns their
+* number. The data is not copied and must stay until the writes are done. */
+static size_t
+writeVariable(UA_WriteValue *wv, UA_Int32 *data, const UA_InternedNodeId *nodeId) {
+	if (!nodeId)
+		return 0;
 
 	/* Write a different integer value */
-	UA_Int32 myInteger = data; //43
-	UA_Variant myVar;
-	UA_Variant_init(&myVar);
-	UA_Variant_setScalar(&myVar, &myInteger, &UA_TYPES[UA_TYPES_INT32]);
-	UA_Server_writeValue(server, myIntegerNodeId, myVar);
-
-	/* Set the status code of the value to an error code. The function
-	* UA_Server_write provides access to the raw service. The above
-	* UA_Server_writeValue is syntactic sugar for writing a specific node
-	* attribute with the write service. */
-	UA_WriteValue wv;
-	UA_WriteValue_init(&wv);
-	wv.nodeId = myIntegerNodeId;
-	wv.attributeId = UA_ATTRIBUTEID_VALUE;
-	wv.value.status = UA_STATUSCODE_BADNOTCONNECTED;
-	wv.value.hasStatus = true;
-	UA_Server_write(server, &wv);
+	UA_WriteValue_init(&wv[0]);
+	wv[0].nodeId = nodeId->nodeId;
+	wv[0].attributeId = UA_ATTRIBUTEID_VALUE;
+	UA_Variant_setScalar(&wv[0].value.value, data, &UA_TYPES[UA_TYPES_INT32]);
+	wv[0].value.hasValue = true;
+
+	/* Set the status code of the value to an error code. A WriteValue
+	* provides access to the raw service. */
+	UA_WriteValue_init(&wv[1]);
+	wv[1].nodeId = nodeId->nodeId;
+	wv[1].attributeId = UA_ATTRIBUTEID_VALUE;
+	wv[1].value.status = UA_STATUSCODE_BADNOTCONNECTED;
+	wv[1].value.hasStatus = true;
 
 	/* Reset the variable to a good statuscode with a value */
-	wv.value.hasStatus = false;
-	wv.value.value = myVar;
-	wv.value.hasValue = true;
-	UA_Server_write(server, &wv);
+	wv[2] = wv[0];
+	return 3;
 }
 
 static void
@@ -217,6 +225,11 @@ int main(int argc, char** argv) {
 	addVariable(server, EO_CO2_NAME, EO_CO2_ID, 0);
 	addVariable(server, EO_SW_NAME, EO_SW_ID, 0);
 
+	eoTempId = UA_Server_internNodeId(server, UA_NODEID_STRING(1, EO_TEMP_ID));
+	eoHumiId = UA_Server_internNodeId(server, UA_NODEID_STRING(1, EO_HUMI_ID));
+	eoCo2Id = UA_Server_internNodeId(server, UA_NODEID_STRING(1, EO_CO2_ID));
+	eoSwId = UA_Server_internNodeId(server, UA_NODEID_STRING(1, EO_SW_ID));
+
 	/* add a variable with the datetime data source */
 	//UA_DataSource dateDataSource = (UA_DataSource) { .handle = NULL, .read = readTimeData, .write = NULL };
 	UA_DataSource dateDataSource;
@@ -336,6 +349,10 @@ int main(int argc, char** argv) {
 
 															/* deallocate certificate's memory */
 															//UA_ByteString_deleteMembers(&config.serverCertificate);
+	UA_Server_releaseInternedNodeId(server, eoTempId);
+	UA_Server_releaseInternedNodeId(server, eoHumiId);
+	UA_Server_releaseInternedNodeId(server, eoCo2Id);
+	UA_Server_releaseInternedNodeId(server, eoSwId);
 	UA_Server_delete(server);
 	nl.deleteMembers(&nl);
 	return (int)retval;
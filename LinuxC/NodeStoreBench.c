@@ -0,0 +1,144 @@
+/* Microbenchmark for the nodestore. A table with n numeric NodeIds (dense ids
+ * in ns=1 from 51000 upward, as in EnOceanJob.c) and a table with n string
+ * NodeIds are filled. Then insertion and lookups in sequential order, in
+ * random order and of missing NodeIds are timed. The slowest single insertion
+ * shows the stalls while the hash table is resized.
+ *
+ * Usage: NodeStoreBench [-n nodes] */
+
+#define _POSIX_C_SOURCE 199309L
+
+#ifdef UA_NO_AMALGAMATION
+# include "ua_types.h"
+#else
+# include "open62541.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The nodestore is internal to the library (ua_nodestore.h). The nodes are
+ * handled as opaque pointers. Every node starts with its NodeId. */
+typedef struct UA_NodeStore UA_NodeStore;
+UA_NodeStore * UA_NodeStore_new(void);
+void UA_NodeStore_delete(UA_NodeStore *ns);
+void * UA_NodeStore_newNode(UA_NodeClass nodeClass);
+UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, void *node);
+const void * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid);
+
+#define FIRST_ID 51000
+
+static double
+now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void
+shuffle(UA_NodeId *ids, size_t n) {
+    srand(42);
+    for(size_t i = n - 1; i > 0; --i) {
+        size_t j = ((size_t)rand() * ((size_t)RAND_MAX + 1) + (size_t)rand()) % (i + 1);
+        UA_NodeId tmp = ids[i];
+        ids[i] = ids[j];
+        ids[j] = tmp;
+    }
+}
+
+static double
+timeLookups(UA_NodeStore *ns, const UA_NodeId *ids, size_t n, UA_Boolean hit) {
+    size_t found = 0;
+    double start = now_ns();
+    for(size_t i = 0; i < n; ++i)
+        found += (UA_NodeStore_get(ns, &ids[i]) != NULL);
+    double end = now_ns();
+    if(found != (hit ? n : 0))
+        fprintf(stderr, "Unexpected lookup result (%zu of %zu found)\n", found, n);
+    return (end - start) / (double)n;
+}
+
+static void
+bench(const char *name, UA_NodeId *ids, UA_NodeId *missing, size_t n) {
+    UA_NodeStore *ns = UA_NodeStore_new();
+    if(!ns) {
+        fprintf(stderr, "Could not create the nodestore\n");
+        return;
+    }
+
+    double insert = 0.0, worst = 0.0;
+    for(size_t i = 0; i < n; ++i) {
+        void *node = UA_NodeStore_newNode(UA_NODECLASS_OBJECT);
+        if(!node || UA_NodeId_copy(&ids[i], (UA_NodeId*)node) != UA_STATUSCODE_GOOD) {
+            fprintf(stderr, "Could not create node %zu\n", i);
+            UA_NodeStore_delete(ns);
+            return;
+        }
+        double start = now_ns();
+        UA_StatusCode retval = UA_NodeStore_insert(ns, node);
+        double duration = now_ns() - start;
+        if(retval != UA_STATUSCODE_GOOD) {
+            fprintf(stderr, "Could not insert node %zu\n", i);
+            UA_NodeStore_delete(ns);
+            return;
+        }
+        insert += duration;
+        if(duration > worst)
+            worst = duration;
+    }
+    insert /= (double)n;
+
+    double sequential = timeLookups(ns, ids, n, true);
+    shuffle(ids, n);
+    double random = timeLookups(ns, ids, n, true);
+    double miss = timeLookups(ns, missing, n, false);
+    printf("%-8s %9zu nodes  insert %7.1f ns (max %7.3f ms)  get seq %6.1f ns  "
+           "get rand %6.1f ns  get miss %6.1f ns\n",
+           name, n, insert, worst / 1e6, sequential, random, miss);
+    UA_NodeStore_delete(ns);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1000000;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = (size_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [-n nodes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(n == 0)
+        return 0;
+
+    UA_NodeId *ids = (UA_NodeId*)UA_Array_new(n, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_NodeId *missing = (UA_NodeId*)UA_Array_new(n, &UA_TYPES[UA_TYPES_NODEID]);
+    if(!ids || !missing)
+        return 1;
+
+    for(size_t i = 0; i < n; ++i) {
+        ids[i] = UA_NODEID_NUMERIC(1, (UA_UInt32)(FIRST_ID + i));
+        missing[i] = UA_NODEID_NUMERIC(2, (UA_UInt32)(FIRST_ID + i));
+    }
+    bench("numeric", ids, missing, n);
+    UA_Array_delete(ids, n, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_Array_delete(missing, n, &UA_TYPES[UA_TYPES_NODEID]);
+
+    ids = (UA_NodeId*)UA_Array_new(n, &UA_TYPES[UA_TYPES_NODEID]);
+    missing = (UA_NodeId*)UA_Array_new(n, &UA_TYPES[UA_TYPES_NODEID]);
+    if(!ids || !missing)
+        return 1;
+    char buf[32];
+    for(size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), "Sensor.%zu.Value", i);
+        ids[i] = UA_NODEID_STRING_ALLOC(1, buf);
+        snprintf(buf, sizeof(buf), "Sensor.%zu.Other", i);
+        missing[i] = UA_NODEID_STRING_ALLOC(1, buf);
+    }
+    bench("string", ids, missing, n);
+    UA_Array_delete(ids, n, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_Array_delete(missing, n, &UA_TYPES[UA_TYPES_NODEID]);
+    return 0;
+}
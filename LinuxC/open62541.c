@@ -826,6 +826,37 @@ UA_atomic_add(volatile uint32_t *addr, uint32_t increase) {
 #endif
 }
 
+/* Spin Lock
+ * ---------
+ * Guards the few structures that are shared by all servers of the process.
+ * Servers can run in different threads also without multithreading enabled.
+ * So the lock operations are atomic in every build. The lock is only held for
+ * short sections and while the first server builds the shared nodes. */
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+typedef volatile long UA_SpinLock;
+#define UA_SPINLOCK_INIT 0
+
+static UA_INLINE void
+UA_SpinLock_lock(UA_SpinLock *lock) {
+#ifdef _MSC_VER /* Visual Studio */
+    while(_InterlockedExchange(lock, 1) != 0) {}
+#else /* GCC/Clang */
+    while(__sync_lock_test_and_set(lock, 1) != 0) {}
+#endif
+}
+
+static UA_INLINE void
+UA_SpinLock_unlock(UA_SpinLock *lock) {
+#ifdef _MSC_VER /* Visual Studio */
+    _InterlockedExchange(lock, 0);
+#else /* GCC/Clang */
+    __sync_lock_release(lock);
+#endif
+}
+
 
 /*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/ua_types_encoding_binary.h" ***********************************/
 
@@ -846,6 +877,20 @@ UA_StatusCode
 UA_decodeBinary(const UA_ByteString *src, size_t *offset, void *dst,
                 const UA_DataType *type) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
 
+/* Decode without looking into ExtensionObjects. Their bodies are kept as
+ * UA_EXTENSIONOBJECT_ENCODED_BYTESTRING (also inside variants) and are
+ * re-encoded by a raw copy. Use UA_ExtensionObject_decodeBody and
+ * UA_Variant_decodeBody to unpack them on demand. */
+UA_StatusCode
+UA_decodeBinaryLazy(const UA_ByteString *src, size_t *offset, void *dst,
+                    const UA_DataType *type) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
+
+/* Returns the (ns0) datatype of the encoded ExtensionObject bodies in the
+ * variant. NULL if the variant holds no encoded bodies, the type is unknown or
+ * the array elements are of different types. */
+const UA_DataType *
+UA_Variant_encodedBodyType(const UA_Variant *v);
+
 size_t UA_calcSizeBinary(void *p, const UA_DataType *type);
 
 
@@ -3333,7 +3378,30 @@ extern "C" {
  *
  * Internally, open62541 uses ``UA_Node`` in places where the exact node type is
  * not known or not important. The ``nodeClass`` attribute is used to ensure the
- * correctness of casting from ``UA_Node`` to a specific node type. */
+ * correctness of casting from ``UA_Node`` to a specific node type.
+ *
+ * The references of a node are grouped by their ReferenceType and direction.
+ * Every group (the reference "kind") stores the targets of its references in
+ * a contiguous array. So the services that follow only some ReferenceTypes
+ * (e.g. Browse with a filter or TranslateBrowsePathsToNodeIds) skip over the
+ * non-matching references group by group. The target array grows
+ * geometrically, so that adding many children to a folder is amortized.
+ *
+ * Targets in the same server are stored as NodeIds, without the namespaceUri
+ * and serverIndex of an ExpandedNodeId. That halves the size of the target
+ * arrays. The rare targets with a namespaceUri or on another server are kept
+ * as ExpandedNodeIds in a second array. Positions in a kind count the local
+ * targets first and then the remote targets. */
+typedef struct {
+    UA_NodeId referenceTypeId;
+    UA_Boolean isInverse;
+    size_t targetIdsSize;
+    size_t targetIdsCapacity;
+    UA_NodeId *targetIds;
+    size_t remoteTargetIdsSize;
+    UA_ExpandedNodeId *remoteTargetIds;
+} UA_NodeReferenceKind;
+
 #define UA_NODE_BASEATTRIBUTES                  \
     UA_NodeId nodeId;                           \
     UA_NodeClass nodeClass;                     \
@@ -3343,7 +3411,7 @@ extern "C" {
     UA_UInt32 writeMask;                        \
     UA_UInt32 userWriteMask;                    \
     size_t referencesSize;                      \
-    UA_ReferenceNode *references;
+    UA_NodeReferenceKind *references;
 
 typedef struct {
     UA_NODE_BASEATTRIBUTES
@@ -3421,6 +3489,25 @@ typedef enum {
     UA_VALUESOURCE_DATASOURCE
 } UA_ValueSource;
 
+/* With multithreading, the value is moved into a value slot on the first
+ * write. The slot is shared between all versions of the node and publishes
+ * an immutable DataValue with RCU. So writing the value replaces a pointer
+ * instead of the entire node (see ua_server_internal.h). */
+#ifdef UA_ENABLE_MULTITHREADING
+typedef struct UA_ValueSlot UA_ValueSlot;
+# define UA_NODE_VALUESLOT UA_ValueSlot *slot; /* NULL before the first write */
+#else
+# define UA_NODE_VALUESLOT
+#endif
+
+/* The data source of a node with the callbacks that are set separately. So
+ * the public UA_DataSource keeps its layout. */
+typedef struct {
+    UA_DataSource source;
+    UA_DataSourceReadAsync readAsync;
+    const UA_DataSourceProvider *provider;
+} UA_NodeDataSource;
+
 #define UA_NODE_VARIABLEATTRIBUTES                                      \
     /* Constraints on possible values */                                \
     UA_NodeId dataType;                                                 \
@@ -3434,8 +3521,9 @@ typedef enum {
         struct {                                                        \
             UA_DataValue value;                                         \
             UA_ValueCallback callback;                                  \
+            UA_NODE_VALUESLOT                                           \
         } data;                                                         \
-        UA_DataSource dataSource;                                       \
+        UA_NodeDataSource dataSource;                                   \
     } value;
 
 typedef struct {
@@ -3688,7 +3776,11 @@ struct ContinuationPointEntry {
     LIST_ENTRY(ContinuationPointEntry) pointers;
     UA_ByteString        identifier;
     UA_BrowseDescription browseDescription;
-    UA_UInt32            continuationIndex;
+    size_t               referenceKindIndex; /* position of the next reference */
+    size_t               targetIndex;
+    UA_NodeId            referenceTypeId; /* the next reference, to detect */
+    UA_Boolean           isInverse;       /* changes of the node */
+    UA_NodeId            targetId;
     UA_UInt32            maxReferences;
 };
 
@@ -3818,6 +3910,28 @@ typedef struct MonitoredItem_queuedValue {
     UA_DataValue value;
 } MonitoredItem_queuedValue;
 
+/* The last sample for the change detection. Only the parts of the DataValue
+ * that are compared under the trigger are kept. Scalars of the fixed-size
+ * builtin types are stored as they are. Other values are compared by their
+ * structural hash. */
+#define UA_SAMPLE_HASVALUE 0x01
+#define UA_SAMPLE_HASSTATUS 0x02
+#define UA_SAMPLE_HASSOURCETIMESTAMP 0x04
+#define UA_SAMPLE_HASSOURCEPICOSECONDS 0x08
+
+typedef struct {
+    UA_Boolean valid; /* a sample was taken */
+    UA_Byte mask;
+    UA_StatusCode status;
+    UA_DateTime sourceTimestamp;
+    UA_UInt16 sourcePicoseconds;
+    const UA_DataType *scalarType; /* the value is in scalar (else the hash) */
+    union {
+        UA_Byte scalar[sizeof(UA_Guid)]; /* largest fixed-size builtin type */
+        UA_UInt64 hash;
+    } value;
+} MonitoredItem_lastSample;
+
 typedef struct UA_MonitoredItem {
     LIST_ENTRY(UA_MonitoredItem) listEntry;
 
@@ -3828,28 +3942,70 @@ typedef struct UA_MonitoredItem {
     UA_TimestampsToReturn timestampsToReturn;
     UA_MonitoringMode monitoringMode;
     UA_NodeId monitoredNodeId;
+    const UA_InternedNodeId *monitoredNode; /* interned monitoredNodeId (or NULL) */
     UA_UInt32 attributeID;
     UA_UInt32 clientHandle;
     UA_Double samplingInterval; // [ms]
+    UA_Boolean sampleOnWrite; /* samplingInterval zero, no sample job */
     UA_UInt32 currentQueueSize;
     UA_UInt32 maxQueueSize;
     UA_Boolean discardOldest;
     UA_String indexRange;
+    UA_NumericRange range; /* parsed indexRange (dimensionsSize == 0 if none) */
     // TODO: dataEncoding is hardcoded to UA binary
     UA_DataChangeTrigger trigger;
 
     /* Sample Job */
     UA_Guid sampleJobGuid;
     UA_Boolean sampleJobIsRegistered;
+    struct UA_AsyncRead *asyncSample; /* waiting for an asynchronous DataSource */
+    LIST_ENTRY(UA_MonitoredItem) sampleBatchEntry;
+    UA_Boolean inSampleBatch; /* waiting for the batch read of the provider */
+    LIST_ENTRY(UA_MonitoredItem) watcherEntry;
+    UA_Boolean isWatcher; /* sampled when the value is written */
 
     /* Sample Queue */
-    UA_ByteString lastSampledValue;
+    MonitoredItem_lastSample lastSample;
     TAILQ_HEAD(QueueOfQueueDataValues, MonitoredItem_queuedValue) queue;
 } UA_MonitoredItem;
 
 UA_MonitoredItem *UA_MonitoredItem_new(void);
 void MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem);
 void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem);
+
+/* Queues the sampled value if it has changed. Takes ownership of the value
+ * content. */
+void MonitoredItem_processSample(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                 UA_DataValue *value);
+
+/* Starts an asynchronous sample if the monitored value comes from an
+ * asynchronous DataSource. Returns false if the item must be sampled
+ * synchronously. */
+UA_Boolean MonitoredItem_sampleAsync(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                     const UA_Node *node, const UA_ReadValueId *rvid,
+                                     const UA_NumericRange *range);
+
+#ifndef UA_ENABLE_MULTITHREADING
+/* Defers the sample to the batch read at the end of the main loop iteration if
+ * the monitored value comes from a batch provider. Returns false if the item
+ * must be sampled right away. */
+UA_Boolean MonitoredItem_sampleBatched(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                       const UA_Node *node);
+#endif
+
+#ifndef UA_ENABLE_MULTITHREADING
+/* Samples the MonitoredItems watching the node right after its value was
+ * written. The interned NodeId is optional. */
+void MonitoredItem_sampleWatchers(UA_Server *server, const UA_NodeId *nodeId,
+                                  const UA_InternedNodeId *interned);
+
+/* The value of the node is no longer stored in the node or it is updated in
+ * the onRead callback. The watchers of the node are polled from now on. */
+void MonitoredItem_pollWatchers(UA_Server *server, const UA_NodeId *nodeId);
+#endif
+
+/* A MonitoredItem that samples on write is registered as a watcher of the
+ * node. Otherwise, a repeated job samples the value. */
 UA_StatusCode MonitoredItem_registerSampleJob(UA_Server *server, UA_MonitoredItem *mon);
 UA_StatusCode MonitoredItem_unregisterSampleJob(UA_Server *server, UA_MonitoredItem *mon);
 
@@ -4000,6 +4156,14 @@ const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid);
    function or inserted / replaced into the nodestore). */
 UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid);
 
+/* Get / getCopy with an interned NodeId. The precomputed hash is used and the
+ * node remembers the handle, so that later lookups compare only pointers. */
+const UA_Node * UA_NodeStore_getInterned(UA_NodeStore *ns, const UA_InternedNodeId *id);
+UA_Node * UA_NodeStore_getCopyInterned(UA_NodeStore *ns, const UA_InternedNodeId *id);
+
+/* The node forgets the handle before the handle is freed */
+void UA_NodeStore_releaseInterned(UA_NodeStore *ns, const UA_InternedNodeId *id);
+
 /* To replace a node, get an editable copy of the node, edit and replace with
  * this function. If the node was already replaced since the copy was made,
  * UA_STATUSCODE_BADINTERNALERROR is returned. If the nodeid is not found,
@@ -4010,13 +4174,57 @@ UA_StatusCode UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node);
 /* Remove a node in the nodestore. */
 UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid);
 
+/* Set the range of the dense array for numeric nodeids of the namespace to
+ * the identifiers [first, first+count). Nodes added in that range are found by
+ * indexing instead of the hash table. Nodes outside the range are moved to the
+ * hash table. */
+UA_StatusCode UA_NodeStore_reserveDense(UA_NodeStore *ns, UA_UInt16 nsIndex,
+                                        UA_UInt32 first, UA_UInt32 count);
+
+/* Grow the hash table so that count more nodes are inserted without a
+ * resize. The nodes in a dense range do not need the reservation. */
+UA_StatusCode UA_NodeStore_reserve(UA_NodeStore *ns, size_t count);
+
+/**
+ * Shared Nodes
+ * ^^^^^^^^^^^^
+ * Nodes can be shared read-only between nodestores. A shared node is never
+ * modified or freed by a nodestore. Replacing a shared node puts the edited
+ * copy into the nodestore and leaves the shared node untouched
+ * (copy-on-write). Not supported with multithreading. */
+/* Mark all nodes of the nodestore as shared and return them in an array */
+UA_StatusCode UA_NodeStore_share(UA_NodeStore *ns, UA_Node ***nodes, size_t *nodesSize);
+
+/* Insert a shared node into another nodestore */
+UA_StatusCode UA_NodeStore_insertShared(UA_NodeStore *ns, const UA_Node *node);
+
+/* Shared nodes must not be edited in place */
+UA_Boolean UA_NodeStore_isShared(const UA_Node *node);
+
+/* Free the shared nodes once they are no longer used by any nodestore */
+void UA_NodeStore_deleteShared(UA_Node **nodes, size_t nodesSize);
+
+/**
+ * Memory Usage
+ * ^^^^^^^^^^^^ */
+/* Bytes used by the nodestore itself (without the nodes) */
+size_t UA_NodeStore_memoryUsage(UA_NodeStore *ns);
+
+/* Bytes allocated for the node structure (without the dynamic content) */
+size_t UA_NodeStore_nodeMemoryUsage(const UA_Node *node);
+
+/* Occupancy and probe lengths of the hash table. Not supported by the
+ * lock-free hash table. */
+UA_StatusCode UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeStoreStatistics *stats);
+
 /**
  * Iteration
  * ^^^^^^^^^
  * The following definitions are used to call a callback for every node in the
- * nodestore. */
-typedef void (*UA_NodeStore_nodeVisitor)(const UA_Node *node);
-void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor);
+ * nodestore. The context pointer is handed to every call. */
+typedef void (*UA_NodeStore_nodeVisitor)(void *context, const UA_Node *node);
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor,
+                          void *context);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -4187,6 +4395,106 @@ typedef struct {
 extern UA_THREAD_LOCAL UA_Session* methodCallSession;
 #endif
 
+/* Cached subtype closures of the type hierarchies (ReferenceTypes, DataTypes,
+ * ObjectTypes and VariableTypes). Every type has a handle (the index in
+ * types). The first supertype of every type forms a forest. The types are
+ * numbered in preorder, so the subtypes of a type in the forest are the types
+ * with a number in [pre, last]. Further supertypes (multiple inheritance) are
+ * kept as extra edges and followed during the query. */
+typedef struct {
+    UA_NodeId typeId;
+    UA_UInt32 hash;
+    UA_NodeClass nodeClass;
+    size_t parent; /* supertype in the forest or UA_TYPECLOSURES_NONE */
+    size_t firstChild;
+    size_t nextSibling;
+    size_t pre; /* preorder number */
+    size_t last; /* largest preorder number in the subtree */
+} UA_TypeClosureEntry;
+
+typedef struct {
+    size_t superType;
+    size_t subType;
+    UA_Boolean visited; /* used during the query */
+    size_t next; /* used during the query */
+} UA_TypeClosureEdge;
+
+typedef struct {
+    UA_Boolean valid; /* rebuilt on the next query if false */
+    UA_Boolean numbered; /* pre and last are up to date */
+    size_t capacity; /* max number of types, a power of two >= 64 */
+    size_t typesSize;
+    UA_TypeClosureEntry *types;
+    UA_UInt32 *index; /* handle + 1 of the types by hash, size 2 * capacity */
+    UA_TypeClosureEdge *extraEdges; /* HasSubtype references not in the forest */
+    size_t extraEdgesSize;
+} UA_TypeClosures;
+
+/* A Read request or MonitoredItem sample that waits for asynchronous
+ * DataSource reads. Pending operations have the status
+ * UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY in their result. */
+typedef struct UA_AsyncRead {
+    LIST_ENTRY(UA_AsyncRead) pointers;
+    UA_UInt32 id;
+    size_t pending; /* outstanding operations (+1 while they are started) */
+    UA_DateTime timeout; /* monotonic */
+    UA_TimestampsToReturn timestamps;
+    UA_ReadResponse response;
+
+    /* Where to send the response */
+    UA_UInt32 channelId;
+    UA_UInt32 requestId;
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* The sampled MonitoredItem (NULL for requests or if the MonitoredItem was
+     * deleted in the meantime) */
+    UA_Boolean isSample;
+    UA_MonitoredItem *mon;
+#endif
+} UA_AsyncRead;
+
+/* The entry of an interned NodeId. The public handle is the first member. */
+typedef struct {
+    UA_InternedNodeId id;
+    size_t refCount; /* interns minus releases */
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    /* MonitoredItems sampled when the value of the node is written */
+    LIST_HEAD(UA_Watchers, UA_MonitoredItem) watchers;
+#endif
+} UA_InternedNode;
+
+/* A node added during a bulk load. The reference to the parent is checked
+ * when the bulk load is committed. */
+typedef struct {
+    UA_NodeId nodeId;
+    UA_NodeId parentNodeId;
+    UA_NodeId referenceTypeId;
+} UA_BulkLoadNode;
+
+/* The last value read from a DataSource. Reads with a maxAge are answered
+ * from the cache if the value is recent enough. */
+typedef struct UA_CachedValue {
+    TAILQ_ENTRY(UA_CachedValue) lru;
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+    UA_DateTime readTime; /* monotonic */
+    size_t memory;
+    UA_DataValue value; /* shared, with the source and server timestamp */
+} UA_CachedValue;
+
+typedef struct {
+    /* Open addressing with linear probing. The size is zero or a power of
+     * two. Entries are removed with backward shifting (no tombstones). */
+    UA_CachedValue **entries;
+    size_t entriesSize;
+    size_t entriesCount;
+    TAILQ_HEAD(UA_CachedValues, UA_CachedValue) lru; /* least recently used first */
+    size_t memory;
+    UA_UInt64 hits;
+    UA_UInt64 misses;
+    UA_UInt64 evictions;
+} UA_ValueCache;
+
 struct UA_Server {
     /* Meta */
     UA_DateTime startTime;
@@ -4199,10 +4507,54 @@ struct UA_Server {
 
     /* Address Space */
     UA_NodeStore *nodestore;
+    UA_Boolean sharedNs0; /* uses the type hierarchy of ns0 shared in the process */
 
     size_t namespacesSize;
     UA_String *namespaces;
 
+    /* Interned NodeIds. Open addressing with linear probing. The size is zero
+     * or a power of two. The entries are UA_InternedNode. */
+    UA_InternedNodeId **internedNodeIds;
+    size_t internedNodeIdsSize;
+    size_t internedNodeIdsCount;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t internedNodeIds_mutex;
+#endif
+
+    /* Subtype closures for the type checks */
+    UA_TypeClosures typeClosures;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t typeClosures_mutex;
+#endif
+
+    /* Reads waiting for asynchronous DataSources */
+    LIST_HEAD(UA_AsyncReads, UA_AsyncRead) asyncReads;
+    UA_UInt32 lastAsyncReadId;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t asyncReads_mutex;
+#endif
+
+    /* Values of DataSources for reads with a maxAge */
+    UA_ValueCache valueCache;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t valueCache_mutex;
+#endif
+
+    /* Nodes added since UA_Server_beginBulkLoad */
+    UA_Boolean bulkLoad;
+    UA_BulkLoadNode *bulkLoadNodes;
+    size_t bulkLoadNodesSize;
+    size_t bulkLoadNodesCapacity;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t bulkLoad_mutex;
+#endif
+
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    /* MonitoredItems waiting for the batch read of their provider */
+    LIST_HEAD(UA_SampleBatch, UA_MonitoredItem) sampleBatch;
+    size_t watchersCount; /* MonitoredItems sampled on write */
+#endif
+
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
     size_t externalNamespacesSize;
     UA_ExternalNamespace *externalNamespaces;
@@ -4237,11 +4589,144 @@ struct UA_Server {
 void UA_Node_deleteMembersAnyNodeClass(UA_Node *node);
 UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst);
 
+/* Node texts. The locales are interned and the displayName text shares the
+ * buffer with the browseName if both are equal. Texts of a node in the
+ * nodestore are only replaced with the following functions. */
+void UA_Node_internTexts(UA_Node *node);
+UA_StatusCode UA_Node_setBrowseName(UA_Node *node, const UA_QualifiedName *name);
+UA_StatusCode UA_Node_setText(UA_Node *node, UA_LocalizedText *text,
+                              const UA_LocalizedText *value);
+
+/* Interned locales are not owned by the node */
+UA_Boolean UA_Node_isInternedLocale(const UA_String *locale);
+
+/* Bytes used for the interned locales */
+size_t UA_Node_internedLocalesSize(void);
+
+/* Node references. The references are grouped by ReferenceType and direction
+ * in the UA_NodeReferenceKind entries. The targets of a kind keep the order in
+ * which the references were added. */
+UA_StatusCode UA_Node_addReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                                   UA_Boolean isInverse, const UA_ExpandedNodeId *targetId);
+
+/* Returns UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED if no such reference exists */
+UA_StatusCode UA_Node_deleteReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                                      UA_Boolean isInverse, const UA_NodeId *targetId);
+
+void UA_Node_deleteReferences(UA_Node *node);
+
+/* Copies only the references. The references of dst are overwritten. */
+UA_StatusCode UA_Node_copyReferences(const UA_Node *src, UA_Node *dst);
+
+/* Returns NULL if the node has no references of that type and direction */
+const UA_NodeReferenceKind *
+UA_Node_findReferenceKind(const UA_Node *node, const UA_NodeId *referenceTypeId,
+                          UA_Boolean isInverse);
+
+/* Total number of references over all kinds */
+size_t UA_Node_referencesCount(const UA_Node *node);
+
 /* Calls callback on the node. In the multithreaded case, the node is copied before and replaced in
    the nodestore. */
 typedef UA_StatusCode (*UA_EditNodeCallback)(UA_Server*, UA_Session*, UA_Node*, const void*);
 UA_StatusCode UA_Server_editNode(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
                                  UA_EditNodeCallback callback, const void *data);
+UA_StatusCode UA_Server_editNodeInterned(UA_Server *server, UA_Session *session,
+                                         const UA_InternedNodeId *nodeId,
+                                         UA_EditNodeCallback callback, const void *data);
+
+/* Deletes all interned NodeIds. The handles must no longer be in use. */
+void UA_Server_deleteInternedNodeIds(UA_Server *server);
+
+/* Returns the interned NodeId or NULL if the NodeId was never interned */
+const UA_InternedNodeId *
+UA_Server_findInternedNodeId(UA_Server *server, const UA_NodeId *nodeId);
+
+/* The subtype closures are updated in place when a HasSubtype reference is
+ * added. Removing HasSubtype references or type nodes invalidates the closures.
+ * They are then rebuilt from the nodestore on the next query. */
+void UA_Server_addSubtypeReference(UA_Server *server, const UA_Node *node,
+                                   const UA_NodeId *targetId, UA_Boolean isForward);
+void UA_Server_invalidateTypeClosures(UA_Server *server);
+
+/* Answers the asynchronous reads that have timed out. Returns the earlier of
+ * next and the next timeout. */
+UA_DateTime UA_Server_processAsyncReads(UA_Server *server, UA_DateTime nowMonotonic,
+                                        UA_DateTime next);
+
+/* Drops the pending asynchronous reads without answering them */
+void UA_Server_deleteAsyncReads(UA_Server *server);
+
+/* Ends a bulk load without validating the nodes added so far */
+void UA_Server_deleteBulkLoad(UA_Server *server);
+
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+/* Reads the deferred samples of the MonitoredItems with one call per batch
+ * provider */
+void UA_Server_processSampleBatch(UA_Server *server);
+#endif
+
+/***************/
+/* Value Slots */
+/***************/
+
+#ifdef UA_ENABLE_MULTITHREADING
+/* The published value is immutable. Writers build a new one and exchange the
+ * pointer in the slot. The old value is freed with call_rcu. */
+typedef struct {
+    struct rcu_head rcu_head;
+    UA_DataValue value;
+} UA_PublishedValue;
+
+struct UA_ValueSlot {
+    UA_PublishedValue *current;
+    uint32_t refCount; /* number of node versions sharing the slot */
+};
+
+void UA_PublishedValue_delete(UA_PublishedValue *pv);
+void UA_ValueSlot_release(UA_ValueSlot *slot);
+#endif
+
+/* The current value of a variable with UA_VALUESOURCE_DATA. With
+ * multithreading, the returned value must only be used inside the RCU read
+ * lock. */
+static UA_INLINE const UA_DataValue *
+getVariableValue(const UA_VariableNode *vn) {
+#ifdef UA_ENABLE_MULTITHREADING
+    if(vn->value.data.slot)
+        return &rcu_dereference(vn->value.data.slot->current)->value;
+#endif
+    return &vn->value.data.value;
+}
+
+/*************/
+/* Tick Time */
+/*************/
+
+/* The current time, sampled with the coarse clock once per processed job. Use
+ * this for timestamps that don't need microsecond precision, such as response
+ * headers and internal bookkeeping. The timestamps of DataValues use
+ * UA_DateTime_now, so that consecutive changes within a job stay
+ * distinguishable and the server timestamp does not precede the source
+ * timestamp. Outside of a job, the clock is read directly. */
+UA_DateTime UA_Server_tickTime(void);
+
+/****************/
+/* Parallel For */
+/****************/
+
+/* Calls callback for every index in [0, count). With multithreading, a range
+ * of at least config.parallelOperationsThreshold indices is split into chunks
+ * that the worker threads process in parallel. The calling thread processes
+ * chunks as well and returns when all chunks are done. So the callbacks can
+ * use memory of the caller. They must write only to the results of their
+ * index. Otherwise the loop runs inline. */
+typedef void (*UA_ParallelForCallback)(UA_Server *server, void *context, size_t index);
+void UA_Server_parallelFor(UA_Server *server, size_t count,
+                           UA_ParallelForCallback callback, void *context);
+
+/* Whether UA_Server_parallelFor splits a range of count indices */
+UA_Boolean UA_Server_isParallel(const UA_Server *server, size_t count);
 
 /********************/
 /* Event Processing */
@@ -4297,6 +4782,11 @@ isNodeInTree(UA_NodeStore *ns, const UA_NodeId *leafNode,
              const UA_NodeId *nodeToFind, const UA_NodeId *referenceTypeIds,
              size_t referenceTypeIdsSize);
 
+/* Is type equal to superType or (recursively) a subtype via HasSubtype? Uses
+ * the cached subtype closures of the server. */
+UA_Boolean
+isSubtypeOf(UA_Server *server, const UA_NodeId *type, const UA_NodeId *superType);
+
 const UA_Node *
 getNodeType(UA_Server *server, const UA_Node *node);
 
@@ -4347,6 +4837,17 @@ void Service_Read_single(UA_Server *server, UA_Session *session,
                          UA_TimestampsToReturn timestamps,
                          const UA_ReadValueId *id, UA_DataValue *v);
 
+/* Read from a node that was looked up before (NULL if the node is unknown).
+ * If range is set, it is used instead of parsing the indexRange string. Values
+ * of DataSources are served from the cache if they are younger than maxAge (in
+ * ms). If async is set, asynchronous DataSources may return the status
+ * UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY in v. */
+void Service_Read_node(UA_Server *server, UA_Session *session,
+                       UA_TimestampsToReturn timestamps, const UA_Node *node,
+                       const UA_ReadValueId *id, const UA_NumericRange *range,
+                       UA_Double maxAge, const UA_AsyncOperationId *async,
+                       UA_DataValue *v);
+
 void Service_Call_single(UA_Server *server, UA_Session *session,
                          const UA_CallMethodRequest *request,
                          UA_CallMethodResult *result);
@@ -4545,6 +5046,13 @@ void Service_Read(UA_Server *server, UA_Session *session,
                   const UA_ReadRequest *request,
                   UA_ReadResponse *response);
 
+/* Read with asynchronous DataSources. Returns true if the response is sent
+ * later over the channel. Then the response is reset. */
+UA_Boolean Service_Read_async(UA_Server *server, UA_Session *session,
+                              UA_SecureChannel *channel, UA_UInt32 requestId,
+                              const UA_ReadRequest *request,
+                              UA_ReadResponse *response);
+
 /* Used to write one or more Attributes of one or more Nodes. For constructed
  * Attribute values whose elements are indexed, such as an array, this Service
  * allows Clients to write the entire set of indexed values as a composite, to
@@ -4865,31 +5373,40 @@ printNumber(UA_UInt16 n, UA_Byte *pos, size_t digits) {
     }
 }
 
+UA_StatusCode
+UA_DateTime_toBuffer(UA_DateTime t, char *buf, size_t bufSize) {
+    if(bufSize < UA_DATETIME_STRINGLENGTH + 1)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_Byte *data = (UA_Byte*)buf;
+    UA_DateTimeStruct tSt = UA_DateTime_toStruct(t);
+    printNumber(tSt.month, data, 2);
+    data[2] = '/';
+    printNumber(tSt.day, &data[3], 2);
+    data[5] = '/';
+    printNumber(tSt.year, &data[6], 4);
+    data[10] = ' ';
+    printNumber(tSt.hour, &data[11], 2);
+    data[13] = ':';
+    printNumber(tSt.min, &data[14], 2);
+    data[16] = ':';
+    printNumber(tSt.sec, &data[17], 2);
+    data[19] = '.';
+    printNumber(tSt.milliSec, &data[20], 3);
+    data[23] = '.';
+    printNumber(tSt.microSec, &data[24], 3);
+    data[27] = '.';
+    printNumber(tSt.nanoSec, &data[28], 3);
+    data[UA_DATETIME_STRINGLENGTH] = '\0';
+    return UA_STATUSCODE_GOOD;
+}
+
 UA_String
 UA_DateTime_toString(UA_DateTime t) {
     UA_String str = UA_STRING_NULL;
-    // length of the string is 31 (plus \0 at the end)
-    if(!(str.data = (UA_Byte*)UA_malloc(32)))
+    if(!(str.data = (UA_Byte*)UA_malloc(UA_DATETIME_STRINGLENGTH + 1)))
         return str;
-    str.length = 31;
-    UA_DateTimeStruct tSt = UA_DateTime_toStruct(t);
-    printNumber(tSt.month, str.data, 2);
-    str.data[2] = '/';
-    printNumber(tSt.day, &str.data[3], 2);
-    str.data[5] = '/';
-    printNumber(tSt.year, &str.data[6], 4);
-    str.data[10] = ' ';
-    printNumber(tSt.hour, &str.data[11], 2);
-    str.data[13] = ':';
-    printNumber(tSt.min, &str.data[14], 2);
-    str.data[16] = ':';
-    printNumber(tSt.sec, &str.data[17], 2);
-    str.data[19] = '.';
-    printNumber(tSt.milliSec, &str.data[20], 3);
-    str.data[23] = '.';
-    printNumber(tSt.microSec, &str.data[24], 3);
-    str.data[27] = '.';
-    printNumber(tSt.nanoSec, &str.data[28], 3);
+    str.length = UA_DATETIME_STRINGLENGTH;
+    UA_DateTime_toBuffer(t, (char*)str.data, UA_DATETIME_STRINGLENGTH + 1);
     return str;
 }
 
@@ -5111,8 +5628,23 @@ ExtensionObject_copy(UA_ExtensionObject const *src, UA_ExtensionObject *dst,
 }
 
 /* Variant */
+static void Variant_releaseShared(UA_Variant *v);
+
 static void
 Variant_deletemembers(UA_Variant *p, const UA_DataType *_) {
+    if(p->storageType == UA_VARIANT_DATA_FLAT) {
+        /* The content is a single block that starts with the data array (or
+         * with the array dimensions for empty arrays). See UA_Variant_copyFlat */
+        if(p->data > UA_EMPTY_ARRAY_SENTINEL)
+            UA_free(p->data);
+        else if((void*)p->arrayDimensions > UA_EMPTY_ARRAY_SENTINEL)
+            UA_free(p->arrayDimensions);
+        return;
+    }
+    if(p->storageType == UA_VARIANT_DATA_SHARED) {
+        Variant_releaseShared(p);
+        return;
+    }
     if(p->storageType != UA_VARIANT_DATA)
         return;
     if(p->type && p->data > UA_EMPTY_ARRAY_SENTINEL) {
@@ -5256,6 +5788,36 @@ computeStrides(const UA_Variant *v, const UA_NumericRange range,
     return UA_STATUSCODE_GOOD;
 }
 
+/* Copy blockCount blocks of blockSize bytes. The blocks are srcStride bytes
+ * apart in the source and dstStride bytes apart in the destination. Small
+ * blocks (e.g. a single column of a matrix) are moved with fixed-size copies
+ * that compile to plain loads and stores instead of a memcpy call per block. */
+#define COPY_STRIDED_FIXED(SIZE)                                        \
+    for(size_t i = 0; i < blockCount; ++i) {                           \
+        memcpy((void*)dst, (const void*)src, SIZE);                    \
+        dst += dstStride;                                               \
+        src += srcStride;                                               \
+    }                                                                   \
+    break;
+
+static void
+copyStrided(uintptr_t dst, size_t dstStride, uintptr_t src, size_t srcStride,
+            size_t blockCount, size_t blockSize) {
+    switch(blockSize) {
+    case 1: COPY_STRIDED_FIXED(1)
+    case 2: COPY_STRIDED_FIXED(2)
+    case 4: COPY_STRIDED_FIXED(4)
+    case 8: COPY_STRIDED_FIXED(8)
+    case 16: COPY_STRIDED_FIXED(16)
+    default:
+        for(size_t i = 0; i < blockCount; ++i) {
+            memcpy((void*)dst, (const void*)src, blockSize);
+            dst += dstStride;
+            src += srcStride;
+        }
+    }
+}
+
 /* Is the type string-like? */
 static UA_Boolean
 isStringLike(const UA_DataType *type) {
@@ -5338,11 +5900,8 @@ UA_Variant_copyRange(const UA_Variant *src, UA_Variant *dst,
     if(nextrange.dimensionsSize == 0) {
         /* no nextrange */
         if(src->type->fixedSize) {
-            for(size_t i = 0; i < block_count; ++i) {
-                memcpy((void*)nextdst, (void*)nextsrc, elem_size * block);
-                nextdst += block * elem_size;
-                nextsrc += stride * elem_size;
-            }
+            copyStrided(nextdst, block * elem_size, nextsrc, stride * elem_size,
+                        block_count, block * elem_size);
         } else {
             for(size_t i = 0; i < block_count; ++i) {
                 for(size_t j = 0; j < block; ++j) {
@@ -5411,6 +5970,28 @@ UA_Variant_copyRange(const UA_Variant *src, UA_Variant *dst,
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+UA_Variant_viewRange(const UA_Variant *src, UA_Variant *dst,
+                     const UA_NumericRange range) {
+    /* A range always selects a contiguous block of a one-dimensional array */
+    if(UA_Variant_isScalar(src) || src->arrayDimensionsSize > 0 ||
+       range.dimensionsSize != 1)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    size_t count, block, stride, first;
+    UA_StatusCode retval = computeStrides(src, range, &count,
+                                          &block, &stride, &first);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_Variant_init(dst);
+    dst->type = src->type;
+    dst->data = (void*)((uintptr_t)src->data + (first * src->type->memSize));
+    dst->arrayLength = count;
+    dst->storageType = UA_VARIANT_DATA_NODELETE;
+    return UA_STATUSCODE_GOOD;
+}
+
 /* TODO: Allow ranges to reach inside a scalars that are array-like, e.g.
  * variant and strings. This is already possible for reading... */
 static UA_StatusCode
@@ -5425,17 +6006,19 @@ Variant_setRange(UA_Variant *v, void *array, size_t arraySize,
     if(count != arraySize)
         return UA_STATUSCODE_BADINDEXRANGEINVALID;
 
+    /* Shared and flat content is read-only. Copy on write. */
+    retval = UA_Variant_makeWritable(v);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
     /* Move/copy the elements */
     size_t block_count = count / block;
     size_t elem_size = v->type->memSize;
     uintptr_t nextdst = (uintptr_t)v->data + (first * elem_size);
     uintptr_t nextsrc = (uintptr_t)array;
     if(v->type->fixedSize || !copy) {
-        for(size_t i = 0; i < block_count; ++i) {
-            memcpy((void*)nextdst, (void*)nextsrc, elem_size * block);
-            nextsrc += block * elem_size;
-            nextdst += stride * elem_size;
-        }
+        copyStrided(nextdst, stride * elem_size, nextsrc, block * elem_size,
+                    block_count, block * elem_size);
     } else {
         for(size_t i = 0; i < block_count; ++i) {
             for(size_t j = 0; j < block; ++j) {
@@ -5719,73 +6302,646 @@ UA_delete(void *p, const UA_DataType *type) {
     UA_free(p);
 }
 
-/******************/
-/* Array Handling */
-/******************/
-
-void *
-UA_Array_new(size_t size, const UA_DataType *type) {
-    if(size == 0)
-        return UA_EMPTY_ARRAY_SENTINEL;
-    return UA_calloc(size, type->memSize);
-}
+/*************/
+/* Flat Copy */
+/*************/
 
-UA_StatusCode
-UA_Array_copy(const void *src, size_t size,
-              void **dst, const UA_DataType *type) {
-    if(size == 0) {
-        if(src == NULL)
-            *dst = NULL;
-        else
-            *dst= UA_EMPTY_ARRAY_SENTINEL;
-        return UA_STATUSCODE_GOOD;
-    }
+/* A flat copy places all dynamically allocated content in a single block. The
+ * required size is computed first. Then the content is copied by advancing a
+ * pointer into the block. Every chunk is aligned to 8 bytes, the largest
+ * alignment of the builtin types. Variants and ExtensionObjects inside the
+ * block do not own their content and are marked as such. */
 
-    if(!type)
-        return UA_STATUSCODE_BADINTERNALERROR;
+#define UA_FLAT_ALIGN(s) (((s) + 7) & ~(size_t)7)
 
-    /* calloc, so we don't have to check retval in every iteration of copying */
-    *dst = UA_calloc(size, type->memSize);
-    if(!*dst)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
+static size_t calcSizeFlat(const void *p, const UA_DataType *type);
+static void copyFlat(const void *src, void *dst, const UA_DataType *type,
+                     uintptr_t *next);
 
-    if(type->fixedSize) {
-        memcpy(*dst, src, type->memSize * size);
-        return UA_STATUSCODE_GOOD;
+static size_t
+calcSizeFlatArray(const void *p, size_t length, const UA_DataType *type) {
+    if(length == 0 || !p)
+        return 0;
+    size_t s = UA_FLAT_ALIGN(length * type->memSize);
+    if(type->fixedSize)
+        return s;
+    uintptr_t ptr = (uintptr_t)p;
+    for(size_t i = 0; i < length; ++i) {
+        s += calcSizeFlat((const void*)ptr, type);
+        ptr += type->memSize;
     }
+    return s;
+}
 
-    uintptr_t ptrs = (uintptr_t)src;
-    uintptr_t ptrd = (uintptr_t)*dst;
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    for(size_t i = 0; i < size; ++i) {
-        retval |= UA_copy((void*)ptrs, (void*)ptrd, type);
-        ptrs += type->memSize;
-        ptrd += type->memSize;
-    }
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_Array_delete(*dst, size, type);
-        *dst = NULL;
+static size_t
+calcSizeFlatMembers(const void *p, const UA_DataType *type) {
+    size_t s = 0;
+    uintptr_t ptr = (uintptr_t)p;
+    UA_Byte membersSize = type->membersSize;
+    for(size_t i = 0; i < membersSize; ++i) {
+        const UA_DataTypeMember *m= &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *mt = &typelists[!m->namespaceZero][m->memberTypeIndex];
+        ptr += m->padding;
+        if(!m->isArray) {
+            s += calcSizeFlat((const void*)ptr, mt);
+            ptr += mt->memSize;
+        } else {
+            size_t length = *(const size_t*)ptr;
+            ptr += sizeof(size_t);
+            s += calcSizeFlatArray(*(void* const*)ptr, length, mt);
+            ptr += sizeof(void*);
+        }
     }
-    return retval;
+    return s;
 }
 
-void
-UA_Array_delete(void *p, size_t size, const UA_DataType *type) {
-    if(!type->fixedSize) {
-        uintptr_t ptr = (uintptr_t)p;
-        for(size_t i = 0; i < size; ++i) {
-            UA_deleteMembers((void*)ptr, type);
-            ptr += type->memSize;
+static size_t
+calcSizeFlat(const void *p, const UA_DataType *type) {
+    if(type->fixedSize)
+        return 0;
+    if(!type->builtin)
+        return calcSizeFlatMembers(p, type);
+    switch(type->typeIndex) {
+    case UA_TYPES_NODEID: {
+        const UA_NodeId *n = (const UA_NodeId*)p;
+        if(n->identifierType != UA_NODEIDTYPE_STRING &&
+           n->identifierType != UA_NODEIDTYPE_BYTESTRING)
+            return 0;
+        return calcSizeFlatMembers(&n->identifier.string, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    case UA_TYPES_EXPANDEDNODEID: {
+        const UA_ExpandedNodeId *en = (const UA_ExpandedNodeId*)p;
+        return calcSizeFlat(&en->nodeId, &UA_TYPES[UA_TYPES_NODEID]) +
+            calcSizeFlatMembers(&en->namespaceUri, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    case UA_TYPES_LOCALIZEDTEXT: {
+        const UA_LocalizedText *lt = (const UA_LocalizedText*)p;
+        return calcSizeFlatMembers(&lt->locale, &UA_TYPES[UA_TYPES_STRING]) +
+            calcSizeFlatMembers(&lt->text, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    case UA_TYPES_EXTENSIONOBJECT: {
+        const UA_ExtensionObject *eo = (const UA_ExtensionObject*)p;
+        if(eo->encoding >= UA_EXTENSIONOBJECT_DECODED) {
+            if(!eo->content.decoded.type)
+                return 0;
+            return calcSizeFlatArray(eo->content.decoded.data, 1,
+                                     eo->content.decoded.type);
         }
+        return calcSizeFlat(&eo->content.encoded.typeId, &UA_TYPES[UA_TYPES_NODEID]) +
+            calcSizeFlatMembers(&eo->content.encoded.body, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    }
+    case UA_TYPES_DATAVALUE:
+        return calcSizeFlat(&((const UA_DataValue*)p)->value, &UA_TYPES[UA_TYPES_VARIANT]);
+    case UA_TYPES_VARIANT: {
+        const UA_Variant *v = (const UA_Variant*)p;
+        if(!v->type)
+            return 0;
+        size_t length = UA_Variant_isScalar(v) ? 1 : v->arrayLength;
+        return calcSizeFlatArray(v->data, length, v->type) +
+            calcSizeFlatArray(v->arrayDimensions, v->arrayDimensionsSize,
+                              &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    case UA_TYPES_DIAGNOSTICINFO: {
+        const UA_DiagnosticInfo *di = (const UA_DiagnosticInfo*)p;
+        size_t s = 0;
+        if(di->hasAdditionalInfo)
+            s += calcSizeFlatMembers(&di->additionalInfo, &UA_TYPES[UA_TYPES_STRING]);
+        if(di->hasInnerDiagnosticInfo && di->innerDiagnosticInfo)
+            s += calcSizeFlatArray(di->innerDiagnosticInfo, 1, type);
+        return s;
+    }
+    default:
+        return calcSizeFlatMembers(p, type); /* String, QualifiedName, ... */
     }
-    UA_free((void*)((uintptr_t)p & ~(uintptr_t)UA_EMPTY_ARRAY_SENTINEL));
 }
 
-/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/ua_types_encoding_binary.c" ***********************************/
+size_t
+UA_calcSizeFlat(const void *p, const UA_DataType *type) {
+    return calcSizeFlat(p, type);
+}
 
-/* This Source Code Form is subject to the terms of the Mozilla Public
-*  License, v. 2.0. If a copy of the MPL was not distributed with this 
-*  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+/* The shallow content of src is already in dst. Move the array to the block
+ * and continue with the array members. */
+static void
+copyFlatArray(const void *src, size_t length, void **dst,
+              const UA_DataType *type, uintptr_t *next) {
+    if(length == 0 || !src) {
+        *dst = src ? UA_EMPTY_ARRAY_SENTINEL : NULL;
+        return;
+    }
+    void *a = (void*)*next;
+    *next += UA_FLAT_ALIGN(length * type->memSize);
+    memcpy(a, src, length * type->memSize);
+    *dst = a;
+    if(type->fixedSize)
+        return;
+    uintptr_t ptrs = (uintptr_t)src;
+    uintptr_t ptrd = (uintptr_t)a;
+    for(size_t i = 0; i < length; ++i) {
+        copyFlat((const void*)ptrs, (void*)ptrd, type, next);
+        ptrs += type->memSize;
+        ptrd += type->memSize;
+    }
+}
+
+static void
+copyFlatMembers(const void *src, void *dst, const UA_DataType *type,
+                uintptr_t *next) {
+    uintptr_t ptrs = (uintptr_t)src;
+    uintptr_t ptrd = (uintptr_t)dst;
+    UA_Byte membersSize = type->membersSize;
+    for(size_t i = 0; i < membersSize; ++i) {
+        const UA_DataTypeMember *m= &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *mt = &typelists[!m->namespaceZero][m->memberTypeIndex];
+        ptrs += m->padding;
+        ptrd += m->padding;
+        if(!m->isArray) {
+            copyFlat((const void*)ptrs, (void*)ptrd, mt, next);
+            ptrs += mt->memSize;
+            ptrd += mt->memSize;
+        } else {
+            size_t length = *(const size_t*)ptrs;
+            ptrs += sizeof(size_t);
+            ptrd += sizeof(size_t);
+            copyFlatArray(*(void* const*)ptrs, length, (void**)ptrd, mt, next);
+            ptrs += sizeof(void*);
+            ptrd += sizeof(void*);
+        }
+    }
+}
+
+static void
+copyFlat(const void *src, void *dst, const UA_DataType *type, uintptr_t *next) {
+    if(type->fixedSize)
+        return;
+    if(!type->builtin) {
+        copyFlatMembers(src, dst, type, next);
+        return;
+    }
+    switch(type->typeIndex) {
+    case UA_TYPES_NODEID: {
+        const UA_NodeId *n = (const UA_NodeId*)src;
+        if(n->identifierType == UA_NODEIDTYPE_STRING ||
+           n->identifierType == UA_NODEIDTYPE_BYTESTRING)
+            copyFlatMembers(&n->identifier.string,
+                            &((UA_NodeId*)dst)->identifier.string,
+                            &UA_TYPES[UA_TYPES_STRING], next);
+        break;
+    }
+    case UA_TYPES_EXPANDEDNODEID: {
+        const UA_ExpandedNodeId *en = (const UA_ExpandedNodeId*)src;
+        UA_ExpandedNodeId *den = (UA_ExpandedNodeId*)dst;
+        copyFlat(&en->nodeId, &den->nodeId, &UA_TYPES[UA_TYPES_NODEID], next);
+        copyFlatMembers(&en->namespaceUri, &den->namespaceUri,
+                        &UA_TYPES[UA_TYPES_STRING], next);
+        break;
+    }
+    case UA_TYPES_LOCALIZEDTEXT: {
+        const UA_LocalizedText *lt = (const UA_LocalizedText*)src;
+        UA_LocalizedText *dlt = (UA_LocalizedText*)dst;
+        copyFlatMembers(&lt->locale, &dlt->locale, &UA_TYPES[UA_TYPES_STRING], next);
+        copyFlatMembers(&lt->text, &dlt->text, &UA_TYPES[UA_TYPES_STRING], next);
+        break;
+    }
+    case UA_TYPES_EXTENSIONOBJECT: {
+        const UA_ExtensionObject *eo = (const UA_ExtensionObject*)src;
+        UA_ExtensionObject *deo = (UA_ExtensionObject*)dst;
+        if(eo->encoding >= UA_EXTENSIONOBJECT_DECODED) {
+            if(!eo->content.decoded.type)
+                deo->content.decoded.data = NULL;
+            else
+                copyFlatArray(eo->content.decoded.data, 1, &deo->content.decoded.data,
+                              eo->content.decoded.type, next);
+            deo->encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+            break;
+        }
+        copyFlat(&eo->content.encoded.typeId, &deo->content.encoded.typeId,
+                 &UA_TYPES[UA_TYPES_NODEID], next);
+        copyFlatMembers(&eo->content.encoded.body, &deo->content.encoded.body,
+                        &UA_TYPES[UA_TYPES_BYTESTRING], next);
+        break;
+    }
+    case UA_TYPES_DATAVALUE:
+        copyFlat(&((const UA_DataValue*)src)->value, &((UA_DataValue*)dst)->value,
+                 &UA_TYPES[UA_TYPES_VARIANT], next);
+        break;
+    case UA_TYPES_VARIANT: {
+        const UA_Variant *v = (const UA_Variant*)src;
+        UA_Variant *dv = (UA_Variant*)dst;
+        dv->storageType = UA_VARIANT_DATA_NODELETE;
+        if(!v->type) {
+            dv->data = NULL;
+            dv->arrayLength = 0;
+            break;
+        }
+        size_t length = UA_Variant_isScalar(v) ? 1 : v->arrayLength;
+        copyFlatArray(v->data, length, &dv->data, v->type, next);
+        copyFlatArray(v->arrayDimensions, v->arrayDimensionsSize,
+                      (void**)&dv->arrayDimensions, &UA_TYPES[UA_TYPES_UINT32], next);
+        break;
+    }
+    case UA_TYPES_DIAGNOSTICINFO: {
+        const UA_DiagnosticInfo *di = (const UA_DiagnosticInfo*)src;
+        UA_DiagnosticInfo *ddi = (UA_DiagnosticInfo*)dst;
+        if(di->hasAdditionalInfo)
+            copyFlatMembers(&di->additionalInfo, &ddi->additionalInfo,
+                            &UA_TYPES[UA_TYPES_STRING], next);
+        else
+            UA_String_init(&ddi->additionalInfo);
+        if(di->hasInnerDiagnosticInfo && di->innerDiagnosticInfo)
+            copyFlatArray(di->innerDiagnosticInfo, 1,
+                          (void**)&ddi->innerDiagnosticInfo, type, next);
+        else
+            ddi->innerDiagnosticInfo = NULL;
+        break;
+    }
+    default:
+        copyFlatMembers(src, dst, type, next);
+        break;
+    }
+}
+
+UA_StatusCode
+UA_copyFlat(const void *src, void **dst, const UA_DataType *type) {
+    size_t size = UA_FLAT_ALIGN(type->memSize) + calcSizeFlat(src, type);
+    void *p = UA_malloc(size);
+    if(!p)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(p, src, type->memSize);
+    uintptr_t next = (uintptr_t)p + UA_FLAT_ALIGN(type->memSize);
+    copyFlat(src, p, type, &next);
+    *dst = p;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Variant_copyFlat(const UA_Variant *src, UA_Variant *dst) {
+    *dst = *src;
+    size_t size = calcSizeFlat(src, &UA_TYPES[UA_TYPES_VARIANT]);
+    uintptr_t next = 0;
+    if(size > 0) {
+        next = (uintptr_t)UA_malloc(size);
+        if(!next) {
+            UA_Variant_init(dst);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+    }
+    /* The block starts with the data array. Or with the array dimensions if
+     * the array is empty. */
+    copyFlat(src, dst, &UA_TYPES[UA_TYPES_VARIANT], &next);
+    dst->storageType = UA_VARIANT_DATA_FLAT;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_DataValue_copyFlat(const UA_DataValue *src, UA_DataValue *dst) {
+    *dst = *src;
+    UA_StatusCode retval = UA_Variant_copyFlat(&src->value, &dst->value);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_DataValue_init(dst);
+    return retval;
+}
+
+/* Shared variant content is a flat copy behind a reference counter. The counter
+ * is found in front of the data array (or of the array dimensions for empty
+ * arrays). */
+#define UA_SHARED_HEADERSIZE UA_FLAT_ALIGN(sizeof(UA_UInt32))
+
+static UA_UInt32 *
+sharedRefCount(const UA_Variant *v) {
+    uintptr_t p = (uintptr_t)v->arrayDimensions;
+    if(v->data > UA_EMPTY_ARRAY_SENTINEL)
+        p = (uintptr_t)v->data;
+    return (UA_UInt32*)(p - UA_SHARED_HEADERSIZE);
+}
+
+static void
+Variant_releaseShared(UA_Variant *v) {
+    UA_UInt32 *refCount = sharedRefCount(v);
+    if(UA_atomic_add(refCount, (UA_UInt32)-1) == 0)
+        UA_free(refCount);
+}
+
+UA_StatusCode
+UA_Variant_copyShared(const UA_Variant *src, UA_Variant *dst) {
+    *dst = *src;
+    if(src->storageType == UA_VARIANT_DATA_SHARED) {
+        UA_atomic_add(sharedRefCount(src), 1);
+        return UA_STATUSCODE_GOOD;
+    }
+    size_t size = calcSizeFlat(src, &UA_TYPES[UA_TYPES_VARIANT]);
+    uintptr_t next = 0;
+    if(size > 0) {
+        next = (uintptr_t)UA_malloc(UA_SHARED_HEADERSIZE + size);
+        if(!next) {
+            UA_Variant_init(dst);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        *(UA_UInt32*)next = 1;
+        next += UA_SHARED_HEADERSIZE;
+    }
+    copyFlat(src, dst, &UA_TYPES[UA_TYPES_VARIANT], &next);
+    /* Without content there is nothing to share */
+    dst->storageType = (size > 0) ? UA_VARIANT_DATA_SHARED : UA_VARIANT_DATA;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_DataValue_copyShared(const UA_DataValue *src, UA_DataValue *dst) {
+    *dst = *src;
+    UA_StatusCode retval = UA_Variant_copyShared(&src->value, &dst->value);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_DataValue_init(dst);
+    return retval;
+}
+
+/*******************/
+/* Structural Hash */
+/*******************/
+
+/* The content is hashed in 64-bit words. Every mixing step is a bijection of
+ * the state. So a change of a single word always changes the hash. Arrays of
+ * fixed-size types without padding are hashed as one block of memory. Long
+ * blocks are hashed in four independent lanes that are combined at the end.
+ * The other types are walked member by member. The lengths of strings and
+ * arrays are mixed in (null and empty arrays differ). */
+
+#define UA_HASH_PRIME ((UA_UInt64)0x100000001b3)
+#define UA_HASH_NULLARRAY ((UA_UInt64)-1)
+
+static UA_UInt64
+hashMix(UA_UInt64 h, UA_UInt64 w) {
+    h = (h ^ w) * UA_HASH_PRIME;
+    return h ^ (h >> 32);
+}
+
+static UA_UInt64
+hashBytes(UA_UInt64 h, const void *p, size_t size) {
+    const UA_Byte *b = (const UA_Byte*)p;
+    if(size >= 32) {
+        UA_UInt64 l[4] = {h, h + 1, h + 2, h + 3};
+        UA_UInt64 lw[4];
+        for(; size >= 32; b += 32, size -= 32) {
+            memcpy(lw, b, 32);
+            l[0] = (l[0] ^ lw[0]) * UA_HASH_PRIME;
+            l[1] = (l[1] ^ lw[1]) * UA_HASH_PRIME;
+            l[2] = (l[2] ^ lw[2]) * UA_HASH_PRIME;
+            l[3] = (l[3] ^ lw[3]) * UA_HASH_PRIME;
+        }
+        h = hashMix(hashMix(hashMix(hashMix(h, l[0]), l[1]), l[2]), l[3]);
+    }
+    UA_UInt64 w;
+    for(; size >= 8; b += 8, size -= 8) {
+        memcpy(&w, b, 8);
+        h = hashMix(h, w);
+    }
+    if(size > 0) {
+        w = 0;
+        memcpy(&w, b, size);
+        h = hashMix(h, w);
+    }
+    return h;
+}
+
+static UA_UInt64 hashStructure(UA_UInt64 h, const void *p, const UA_DataType *type);
+
+/* The memory of the type has no padding */
+static UA_Boolean
+isDenseType(const UA_DataType *type) {
+    return type->fixedSize && (type->builtin || type->overlayable);
+}
+
+static UA_UInt64
+hashArray(UA_UInt64 h, const void *p, size_t length, const UA_DataType *type) {
+    if(!p)
+        return hashMix(h, UA_HASH_NULLARRAY);
+    h = hashMix(h, length);
+    if(length == 0)
+        return h;
+    if(isDenseType(type))
+        return hashBytes(h, p, length * type->memSize);
+    uintptr_t ptr = (uintptr_t)p;
+    for(size_t i = 0; i < length; ++i) {
+        h = hashStructure(h, (const void*)ptr, type);
+        ptr += type->memSize;
+    }
+    return h;
+}
+
+static UA_UInt64
+hashMembers(UA_UInt64 h, const void *p, const UA_DataType *type) {
+    uintptr_t ptr = (uintptr_t)p;
+    UA_Byte membersSize = type->membersSize;
+    for(size_t i = 0; i < membersSize; ++i) {
+        const UA_DataTypeMember *m= &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *mt = &typelists[!m->namespaceZero][m->memberTypeIndex];
+        ptr += m->padding;
+        if(!m->isArray) {
+            h = hashStructure(h, (const void*)ptr, mt);
+            ptr += mt->memSize;
+        } else {
+            size_t length = *(const size_t*)ptr;
+            ptr += sizeof(size_t);
+            h = hashArray(h, *(void* const*)ptr, length, mt);
+            ptr += sizeof(void*);
+        }
+    }
+    return h;
+}
+
+static UA_UInt64
+hashStructure(UA_UInt64 h, const void *p, const UA_DataType *type) {
+    if(isDenseType(type))
+        return hashBytes(h, p, type->memSize);
+    if(!type->builtin)
+        return hashMembers(h, p, type);
+    switch(type->typeIndex) {
+    case UA_TYPES_NODEID: {
+        const UA_NodeId *n = (const UA_NodeId*)p;
+        h = hashMix(h, ((UA_UInt64)n->identifierType << 16) | n->namespaceIndex);
+        switch(n->identifierType) {
+        case UA_NODEIDTYPE_NUMERIC:
+            return hashMix(h, n->identifier.numeric);
+        case UA_NODEIDTYPE_GUID:
+            return hashBytes(h, &n->identifier.guid, sizeof(UA_Guid));
+        default:
+            return hashMembers(h, &n->identifier.string, &UA_TYPES[UA_TYPES_STRING]);
+        }
+    }
+    case UA_TYPES_EXPANDEDNODEID: {
+        const UA_ExpandedNodeId *en = (const UA_ExpandedNodeId*)p;
+        h = hashStructure(h, &en->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+        h = hashMembers(h, &en->namespaceUri, &UA_TYPES[UA_TYPES_STRING]);
+        return hashMix(h, en->serverIndex);
+    }
+    case UA_TYPES_LOCALIZEDTEXT: {
+        const UA_LocalizedText *lt = (const UA_LocalizedText*)p;
+        h = hashMembers(h, &lt->locale, &UA_TYPES[UA_TYPES_STRING]);
+        return hashMembers(h, &lt->text, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    case UA_TYPES_EXTENSIONOBJECT: {
+        const UA_ExtensionObject *eo = (const UA_ExtensionObject*)p;
+        h = hashMix(h, eo->encoding);
+        if(eo->encoding >= UA_EXTENSIONOBJECT_DECODED) {
+            if(!eo->content.decoded.type)
+                return h;
+            h = hashStructure(h, &eo->content.decoded.type->typeId,
+                              &UA_TYPES[UA_TYPES_NODEID]);
+            return hashArray(h, eo->content.decoded.data, 1, eo->content.decoded.type);
+        }
+        h = hashStructure(h, &eo->content.encoded.typeId, &UA_TYPES[UA_TYPES_NODEID]);
+        return hashMembers(h, &eo->content.encoded.body, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    }
+    case UA_TYPES_DATAVALUE: {
+        const UA_DataValue *dv = (const UA_DataValue*)p;
+        h = hashMix(h, (UA_UInt64)(dv->hasValue | dv->hasStatus << 1 |
+                                   dv->hasSourceTimestamp << 2 |
+                                   dv->hasServerTimestamp << 3 |
+                                   dv->hasSourcePicoseconds << 4 |
+                                   dv->hasServerPicoseconds << 5));
+        if(dv->hasValue)
+            h = hashStructure(h, &dv->value, &UA_TYPES[UA_TYPES_VARIANT]);
+        if(dv->hasStatus)
+            h = hashMix(h, dv->status);
+        if(dv->hasSourceTimestamp)
+            h = hashMix(h, (UA_UInt64)dv->sourceTimestamp);
+        if(dv->hasServerTimestamp)
+            h = hashMix(h, (UA_UInt64)dv->serverTimestamp);
+        if(dv->hasSourcePicoseconds)
+            h = hashMix(h, dv->sourcePicoseconds);
+        if(dv->hasServerPicoseconds)
+            h = hashMix(h, dv->serverPicoseconds);
+        return h;
+    }
+    case UA_TYPES_VARIANT: {
+        const UA_Variant *v = (const UA_Variant*)p;
+        if(!v->type)
+            return hashMix(h, 0);
+        h = hashStructure(h, &v->type->typeId, &UA_TYPES[UA_TYPES_NODEID]);
+        if(UA_Variant_isScalar(v))
+            h = hashStructure(hashMix(h, 1), v->data, v->type);
+        else
+            h = hashArray(hashMix(h, 2), v->data, v->arrayLength, v->type);
+        return hashArray(h, v->arrayDimensions, v->arrayDimensionsSize,
+                         &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    case UA_TYPES_DIAGNOSTICINFO: {
+        const UA_DiagnosticInfo *di = (const UA_DiagnosticInfo*)p;
+        h = hashMix(h, (UA_UInt64)(di->hasSymbolicId | di->hasNamespaceUri << 1 |
+                                   di->hasLocalizedText << 2 | di->hasLocale << 3 |
+                                   di->hasAdditionalInfo << 4 |
+                                   di->hasInnerStatusCode << 5 |
+                                   di->hasInnerDiagnosticInfo << 6));
+        if(di->hasSymbolicId)
+            h = hashMix(h, (UA_UInt32)di->symbolicId);
+        if(di->hasNamespaceUri)
+            h = hashMix(h, (UA_UInt32)di->namespaceUri);
+        if(di->hasLocalizedText)
+            h = hashMix(h, (UA_UInt32)di->localizedText);
+        if(di->hasLocale)
+            h = hashMix(h, (UA_UInt32)di->locale);
+        if(di->hasInnerStatusCode)
+            h = hashMix(h, di->innerStatusCode);
+        if(di->hasAdditionalInfo)
+            h = hashMembers(h, &di->additionalInfo, &UA_TYPES[UA_TYPES_STRING]);
+        if(di->hasInnerDiagnosticInfo && di->innerDiagnosticInfo)
+            h = hashStructure(h, di->innerDiagnosticInfo, type);
+        return h;
+    }
+    default:
+        return hashMembers(h, p, type); /* String, QualifiedName, ... */
+    }
+}
+
+UA_UInt64
+UA_hash(const void *p, const UA_DataType *type) {
+    return hashStructure(0, p, type);
+}
+
+UA_StatusCode
+UA_Variant_makeWritable(UA_Variant *v) {
+    if(v->storageType != UA_VARIANT_DATA_SHARED &&
+       v->storageType != UA_VARIANT_DATA_FLAT)
+        return UA_STATUSCODE_GOOD;
+    UA_Variant copy;
+    UA_StatusCode retval = UA_Variant_copy(v, &copy);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Variant_deleteMembers(v);
+    *v = copy;
+    return UA_STATUSCODE_GOOD;
+}
+
+/******************/
+/* Array Handling */
+/******************/
+
+void *
+UA_Array_new(size_t size, const UA_DataType *type) {
+    if(size == 0)
+        return UA_EMPTY_ARRAY_SENTINEL;
+    return UA_calloc(size, type->memSize);
+}
+
+UA_StatusCode
+UA_Array_copy(const void *src, size_t size,
+              void **dst, const UA_DataType *type) {
+    if(size == 0) {
+        if(src == NULL)
+            *dst = NULL;
+        else
+            *dst= UA_EMPTY_ARRAY_SENTINEL;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    if(!type)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* calloc, so we don't have to check retval in every iteration of copying */
+    *dst = UA_calloc(size, type->memSize);
+    if(!*dst)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    if(type->fixedSize) {
+        memcpy(*dst, src, type->memSize * size);
+        return UA_STATUSCODE_GOOD;
+    }
+
+    uintptr_t ptrs = (uintptr_t)src;
+    uintptr_t ptrd = (uintptr_t)*dst;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < size; ++i) {
+        retval |= UA_copy((void*)ptrs, (void*)ptrd, type);
+        ptrs += type->memSize;
+        ptrd += type->memSize;
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_Array_delete(*dst, size, type);
+        *dst = NULL;
+    }
+    return retval;
+}
+
+void
+UA_Array_delete(void *p, size_t size, const UA_DataType *type) {
+    if(!type->fixedSize) {
+        uintptr_t ptr = (uintptr_t)p;
+        for(size_t i = 0; i < size; ++i) {
+            UA_deleteMembers((void*)ptr, type);
+            ptr += type->memSize;
+        }
+    }
+    UA_free((void*)((uintptr_t)p & ~(uintptr_t)UA_EMPTY_ARRAY_SENTINEL));
+}
+
+/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/ua_types_encoding_binary.c" ***********************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+*  License, v. 2.0. If a copy of the MPL was not distributed with this 
+*  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
 
 /* Type Encoding
@@ -5837,6 +6993,9 @@ extern const UA_calcSizeBinarySignature calcSizeBinaryJumpTable[UA_BUILTIN_TYPES
 UA_THREAD_LOCAL UA_Byte * pos;
 UA_THREAD_LOCAL UA_Byte * end;
 
+/* Keep the body of ExtensionObjects encoded (see UA_decodeBinaryLazy) */
+UA_THREAD_LOCAL UA_Boolean lazyDecoding;
+
 /* The code UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED is returned only when the end of the
  * buffer is reached. When this StatusCode is received, we try to send the current chunk,
  * replace the buffer and continue encoding. That way, memory-constrained servers need to
@@ -6108,7 +7267,18 @@ DateTime_decodeBinary(UA_DateTime *dst) {
 /* Floating Point Types */
 /************************/
 
-#if UA_BINARY_OVERLAYABLE_FLOAT
+/* IEEE 754 floats stored in the same byte order as the integers (e.g. on
+ * big-endian hosts) are converted to the wire format just like integers of the
+ * same width. Then the slow pack754/unpack754 conversion is not required. */
+#if !UA_BINARY_OVERLAYABLE_FLOAT && defined(__GCC_IEC_559) && __GCC_IEC_559 > 0 && \
+    defined(__FLOAT_WORD_ORDER__) && defined(__BYTE_ORDER__) && \
+    (__FLOAT_WORD_ORDER__ == __BYTE_ORDER__)
+# define UA_BINARY_SWAPPABLE_FLOAT true
+#else
+# define UA_BINARY_SWAPPABLE_FLOAT false
+#endif
+
+#if UA_BINARY_OVERLAYABLE_FLOAT || UA_BINARY_SWAPPABLE_FLOAT
 # define Float_encodeBinary UInt32_encodeBinary
 # define Float_decodeBinary UInt32_decodeBinary
 # define Double_encodeBinary UInt64_encodeBinary
@@ -6278,29 +7448,119 @@ Array_encodeBinaryComplex(uintptr_t ptr, size_t length, const UA_DataType *type)
     return UA_STATUSCODE_GOOD;
 }
 
-static UA_StatusCode
-Array_encodeBinary(const void *src, size_t length, const UA_DataType *type) {
-    /* Check and convert the array length to int32 */
-    UA_Int32 signed_length = -1;
-    if(length > UA_INT32_MAX)
-        return UA_STATUSCODE_BADINTERNALERROR;
-    if(length > 0)
-        signed_length = (UA_Int32)length;
-    else if(src == UA_EMPTY_ARRAY_SENTINEL)
-        signed_length = 0;
+#if !UA_BINARY_OVERLAYABLE_INTEGER
 
-    /* Encode the array length */
-    UA_StatusCode retval = Int32_encodeBinary(&signed_length);
-    if(retval != UA_STATUSCODE_GOOD || length == 0)
-        return retval;
+/* Arrays of numeric types are converted between the host and the wire byte
+ * order in bulk. The loops contain neither bounds checks nor indirect calls, so
+ * the compiler can reduce them to (vectorized) byte-swap instructions. */
+static UA_Boolean
+isNumericArrayType(const UA_DataType *type) {
+    if(!type->builtin)
+        return false;
+    switch(type->typeIndex) {
+    case UA_TYPES_INT16:
+    case UA_TYPES_UINT16:
+    case UA_TYPES_INT32:
+    case UA_TYPES_UINT32:
+    case UA_TYPES_INT64:
+    case UA_TYPES_UINT64:
+    case UA_TYPES_DATETIME:
+    case UA_TYPES_STATUSCODE:
+        return true;
+#if UA_BINARY_SWAPPABLE_FLOAT
+    case UA_TYPES_FLOAT:
+    case UA_TYPES_DOUBLE:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
 
-    /* Encode the content */
-    if(!type->overlayable)
-        return Array_encodeBinaryComplex((uintptr_t)src, length, type);
-    return Array_encodeBinaryOverlayable((uintptr_t)src, length, type->memSize);
+static void
+Array_encodeNumeric(UA_Byte *UA_RESTRICT dst, uintptr_t src,
+                    size_t length, size_t elementMemSize) {
+    if(elementMemSize == 2) {
+        const UA_UInt16 *s = (const UA_UInt16*)src;
+        for(size_t i = 0; i < length; ++i)
+            UA_encode16(s[i], &dst[i*2]);
+    } else if(elementMemSize == 4) {
+        const UA_UInt32 *s = (const UA_UInt32*)src;
+        for(size_t i = 0; i < length; ++i)
+            UA_encode32(s[i], &dst[i*4]);
+    } else {
+        const UA_UInt64 *s = (const UA_UInt64*)src;
+        for(size_t i = 0; i < length; ++i)
+            UA_encode64(s[i], &dst[i*8]);
+    }
 }
 
-static UA_StatusCode
+static void
+Array_decodeNumeric(uintptr_t dst, const UA_Byte *UA_RESTRICT src,
+                    size_t length, size_t elementMemSize) {
+    if(elementMemSize == 2) {
+        UA_UInt16 *d = (UA_UInt16*)dst;
+        for(size_t i = 0; i < length; ++i)
+            UA_decode16(&src[i*2], &d[i]);
+    } else if(elementMemSize == 4) {
+        UA_UInt32 *d = (UA_UInt32*)dst;
+        for(size_t i = 0; i < length; ++i)
+            UA_decode32(&src[i*4], &d[i]);
+    } else {
+        UA_UInt64 *d = (UA_UInt64*)dst;
+        for(size_t i = 0; i < length; ++i)
+            UA_decode64(&src[i*8], &d[i]);
+    }
+}
+
+/* Same segmentation at the chunk boundaries as Array_encodeBinaryOverlayable */
+static UA_StatusCode
+Array_encodeBinaryNumeric(uintptr_t ptr, size_t length, size_t elementMemSize) {
+    size_t finished = 0;
+    while(end < pos + (elementMemSize * (length-finished))) {
+        size_t possible = ((uintptr_t)end - (uintptr_t)pos) / elementMemSize;
+        Array_encodeNumeric(pos, ptr, possible, elementMemSize);
+        pos += possible * elementMemSize;
+        ptr += possible * elementMemSize;
+        finished += possible;
+        UA_StatusCode retval = exchangeBuffer();
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    Array_encodeNumeric(pos, ptr, length-finished, elementMemSize);
+    pos += elementMemSize * (length-finished);
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif /* !UA_BINARY_OVERLAYABLE_INTEGER */
+
+static UA_StatusCode
+Array_encodeBinary(const void *src, size_t length, const UA_DataType *type) {
+    /* Check and convert the array length to int32 */
+    UA_Int32 signed_length = -1;
+    if(length > UA_INT32_MAX)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    if(length > 0)
+        signed_length = (UA_Int32)length;
+    else if(src == UA_EMPTY_ARRAY_SENTINEL)
+        signed_length = 0;
+
+    /* Encode the array length */
+    UA_StatusCode retval = Int32_encodeBinary(&signed_length);
+    if(retval != UA_STATUSCODE_GOOD || length == 0)
+        return retval;
+
+    /* Encode the content */
+    if(type->overlayable)
+        return Array_encodeBinaryOverlayable((uintptr_t)src, length, type->memSize);
+#if !UA_BINARY_OVERLAYABLE_INTEGER
+    if(isNumericArrayType(type))
+        return Array_encodeBinaryNumeric((uintptr_t)src, length, type->memSize);
+#endif
+    return Array_encodeBinaryComplex((uintptr_t)src, length, type);
+}
+
+static UA_StatusCode
 Array_decodeBinary(void *UA_RESTRICT *UA_RESTRICT dst,
                    size_t *out_length, const UA_DataType *type) {
     /* Decode the length */
@@ -6326,21 +7586,39 @@ Array_decodeBinary(void *UA_RESTRICT *UA_RESTRICT dst,
     if(pos + ((type->memSize * length) / 32) > end)
         return UA_STATUSCODE_BADDECODINGERROR;
 
-    /* Allocate memory */
-    *dst = UA_calloc(length, type->memSize);
-    if(!*dst)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
+#if !UA_BINARY_OVERLAYABLE_INTEGER
+    UA_Boolean numeric = isNumericArrayType(type);
+#else
+    const UA_Boolean numeric = false;
+#endif
 
-    if(type->overlayable) {
-        /* memcpy overlayable array */
-        if(end < pos + (type->memSize * length)) {
-            UA_free(*dst);
-            *dst = NULL;
+    if(type->overlayable || numeric) {
+        /* The array is overwritten entirely. No need to zero the memory. */
+        if(end < pos + (type->memSize * length))
             return UA_STATUSCODE_BADDECODINGERROR;
-        }
-        memcpy(*dst, pos, type->memSize * length);
+        *dst = UA_malloc(type->memSize * length);
+        if(!*dst)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+#if !UA_BINARY_OVERLAYABLE_INTEGER
+        if(numeric)
+            Array_decodeNumeric((uintptr_t)*dst, pos, length, type->memSize);
+        else
+#endif
+            memcpy(*dst, pos, type->memSize * length);
         pos += type->memSize * length;
+
+        /* Normalize Booleans to true/false as Boolean_decodeBinary does */
+        if(type->builtin && type->typeIndex == UA_TYPES_BOOLEAN) {
+            UA_Byte *b = (UA_Byte*)*dst;
+            for(size_t i = 0; i < length; ++i)
+                b[i] = (b[i] != 0);
+        }
     } else {
+        /* Allocate memory */
+        *dst = UA_calloc(length, type->memSize);
+        if(!*dst)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+
         /* Decode array members */
         uintptr_t ptr = (uintptr_t)*dst;
         size_t decode_index = type->builtin ? type->typeIndex : UA_BUILTIN_TYPES_COUNT;
@@ -6467,12 +7745,10 @@ NodeId_encodeBinary(UA_NodeId const *src, const UA_DataType *_) {
 }
 
 static UA_StatusCode
-NodeId_decodeBinary(UA_NodeId *dst, const UA_DataType *_) {
-    UA_Byte dstByte = 0, encodingByte = 0;
+NodeId_decodeBinaryWithEncodingMask(UA_NodeId *dst, UA_Byte encodingByte) {
+    UA_Byte dstByte = 0;
     UA_UInt16 dstUInt16 = 0;
-    UA_StatusCode retval = Byte_decodeBinary(&encodingByte, NULL);
-    if(retval != UA_STATUSCODE_GOOD)
-        return retval;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
     switch (encodingByte) {
     case UA_NODEIDTYPE_NUMERIC_TWOBYTE:
         dst->identifierType = UA_NODEIDTYPE_NUMERIC;
@@ -6514,6 +7790,15 @@ NodeId_decodeBinary(UA_NodeId *dst, const UA_DataType *_) {
     return retval;
 }
 
+static UA_StatusCode
+NodeId_decodeBinary(UA_NodeId *dst, const UA_DataType *_) {
+    UA_Byte encodingByte = 0;
+    UA_StatusCode retval = Byte_decodeBinary(&encodingByte, NULL);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    return NodeId_decodeBinaryWithEncodingMask(dst, encodingByte);
+}
+
 /* ExpandedNodeId */
 #define UA_EXPANDEDNODEID_NAMESPACEURI_FLAG 0x80
 #define UA_EXPANDEDNODEID_SERVERINDEX_FLAG 0x40
@@ -6539,14 +7824,16 @@ ExpandedNodeId_encodeBinary(UA_ExpandedNodeId const *src, const UA_DataType *_)
 static UA_StatusCode
 ExpandedNodeId_decodeBinary(UA_ExpandedNodeId *dst, const UA_DataType *_) {
     /* Decode the encoding mask */
-    if(pos >= end)
-        return UA_STATUSCODE_BADDECODINGERROR;
-    UA_Byte encoding = *pos;
+    UA_Byte encoding = 0;
+    UA_StatusCode retval = Byte_decodeBinary(&encoding, NULL);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
 
-    /* Mask out the encoding byte on the stream to decode the NodeId only */
-    *pos = encoding & (UA_Byte)~(UA_EXPANDEDNODEID_NAMESPACEURI_FLAG |
-                                 UA_EXPANDEDNODEID_SERVERINDEX_FLAG);
-    UA_StatusCode retval = NodeId_decodeBinary(&dst->nodeId, NULL);
+    /* Decode the NodeId without the flags of the ExpandedNodeId. The source
+     * buffer is not modified and may be read-only. */
+    retval = NodeId_decodeBinaryWithEncodingMask(&dst->nodeId, encoding & (UA_Byte)
+                                                 ~(UA_EXPANDEDNODEID_NAMESPACEURI_FLAG |
+                                                   UA_EXPANDEDNODEID_SERVERINDEX_FLAG));
 
     /* Decode the NamespaceUri */
     if(encoding & UA_EXPANDEDNODEID_NAMESPACEURI_FLAG) {
@@ -6660,9 +7947,10 @@ ExtensionObject_encodeBinary(UA_ExtensionObject const *src, const UA_DataType *_
 
 static UA_StatusCode
 ExtensionObject_decodeBinaryContent(UA_ExtensionObject *dst, const UA_NodeId *typeId) {
-    /* Lookup the datatype */
+    /* Lookup the datatype (not in the lazy mode) */
     const UA_DataType *type = NULL;
-    findDataTypeByBinary(typeId, &type);
+    if(!lazyDecoding)
+        findDataTypeByBinary(typeId, &type);
 
     /* Unknown type, just take the binary content */
     if(!type) {
@@ -6879,7 +8167,8 @@ Variant_decodeBinary(UA_Variant *dst, const UA_DataType *_) {
     /* Decode the content */
     if(isArray) {
         retval = Array_decodeBinary(&dst->data, &dst->arrayLength, dst->type);
-    } else if(typeIndex != UA_TYPES_EXTENSIONOBJECT) {
+    } else if(typeIndex != UA_TYPES_EXTENSIONOBJECT || lazyDecoding) {
+        /* In the lazy mode, ExtensionObjects are not unwrapped */
         dst->data = UA_new(dst->type);
         if(!dst->data)
             return UA_STATUSCODE_BADOUTOFMEMORY;
@@ -6970,7 +8259,8 @@ DiagnosticInfo_encodeBinary(const UA_DiagnosticInfo *src, const UA_DataType *_)
     UA_Byte encodingMask = (UA_Byte)
         (src->hasSymbolicId | (src->hasNamespaceUri << 1) |
          (src->hasLocalizedText << 2) | (src->hasLocale << 3) |
-         (src->hasAdditionalInfo << 4) | (src->hasInnerDiagnosticInfo << 5));
+         (src->hasAdditionalInfo << 4) | (src->hasInnerStatusCode << 5) |
+         (src->hasInnerDiagnosticInfo << 6));
 
     /* Encode the content */
     UA_StatusCode retval = Byte_encodeBinary(&encodingMask, NULL);
@@ -7207,6 +8497,123 @@ UA_decodeBinary(const UA_ByteString *src, size_t *offset,
     return retval;
 }
 
+UA_StatusCode
+UA_decodeBinaryLazy(const UA_ByteString *src, size_t *offset,
+                    void *dst, const UA_DataType *type) {
+    lazyDecoding = true;
+    UA_StatusCode retval = UA_decodeBinary(src, offset, dst, type);
+    lazyDecoding = false;
+    return retval;
+}
+
+/********************/
+/* Decode on Demand */
+/********************/
+
+UA_StatusCode
+UA_ExtensionObject_decodeBody(UA_ExtensionObject *eo) {
+    if(eo->encoding != UA_EXTENSIONOBJECT_ENCODED_BYTESTRING)
+        return UA_STATUSCODE_GOOD;
+
+    /* Unknown type, keep the binary content */
+    const UA_DataType *type = NULL;
+    if(eo->content.encoded.typeId.identifierType != UA_NODEIDTYPE_NUMERIC ||
+       findDataTypeByBinary(&eo->content.encoded.typeId, &type) != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_GOOD;
+
+    /* Decode the body (the length field was consumed with the ByteString) */
+    void *data = UA_new(type);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t offset = 0;
+    UA_StatusCode retval = UA_decodeBinary(&eo->content.encoded.body, &offset, data, type);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_free(data);
+        return retval;
+    }
+    /* The body must not contain trailing bytes */
+    if(offset != eo->content.encoded.body.length) {
+        UA_delete(data, type);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+
+    /* Replace the encoded content */
+    UA_NodeId_deleteMembers(&eo->content.encoded.typeId);
+    UA_ByteString_deleteMembers(&eo->content.encoded.body);
+    eo->encoding = UA_EXTENSIONOBJECT_DECODED;
+    eo->content.decoded.type = type;
+    eo->content.decoded.data = data;
+    return UA_STATUSCODE_GOOD;
+}
+
+const UA_DataType *
+UA_Variant_encodedBodyType(const UA_Variant *v) {
+    if(v->type != &UA_TYPES[UA_TYPES_EXTENSIONOBJECT] ||
+       v->data <= UA_EMPTY_ARRAY_SENTINEL)
+        return NULL;
+
+    /* Only ns0 types are unwrapped from variants (as in Variant_decodeBinary) */
+    const UA_ExtensionObject *eo = (const UA_ExtensionObject*)v->data;
+    const UA_NodeId *typeId = &eo->content.encoded.typeId;
+    if(eo->encoding != UA_EXTENSIONOBJECT_ENCODED_BYTESTRING ||
+       typeId->identifierType != UA_NODEIDTYPE_NUMERIC || typeId->namespaceIndex != 0)
+        return NULL;
+    const UA_DataType *type = NULL;
+    if(findDataTypeByBinary(typeId, &type) != UA_STATUSCODE_GOOD)
+        return NULL;
+
+    /* All array elements need to have the same type */
+    size_t length = UA_Variant_isScalar(v) ? 1 : v->arrayLength;
+    for(size_t i = 1; i < length; ++i) {
+        if(eo[i].encoding != UA_EXTENSIONOBJECT_ENCODED_BYTESTRING ||
+           !UA_NodeId_equal(&eo[i].content.encoded.typeId, typeId))
+            return NULL;
+    }
+    return type;
+}
+
+UA_StatusCode
+UA_Variant_decodeBody(UA_Variant *v) {
+    /* Flat and shared copies are read-only. They keep the encoded bodies. */
+    if(v->storageType == UA_VARIANT_DATA_FLAT ||
+       v->storageType == UA_VARIANT_DATA_SHARED)
+        return UA_STATUSCODE_GOOD;
+    const UA_DataType *type = UA_Variant_encodedBodyType(v);
+    if(!type)
+        return UA_STATUSCODE_GOOD;
+
+    /* Decode the bodies into a new array */
+    const UA_ExtensionObject *eo = (const UA_ExtensionObject*)v->data;
+    size_t length = UA_Variant_isScalar(v) ? 1 : v->arrayLength;
+    void *data = UA_calloc(length, type->memSize);
+    if(!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    uintptr_t ptr = (uintptr_t)data;
+    for(size_t i = 0; i < length; ++i) {
+        size_t offset = 0;
+        retval = UA_decodeBinary(&eo[i].content.encoded.body, &offset, (void*)ptr, type);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(data, i, type);
+            return retval;
+        }
+        /* The body must not contain trailing bytes */
+        if(offset != eo[i].content.encoded.body.length) {
+            UA_Array_delete(data, i + 1, type);
+            return UA_STATUSCODE_BADDECODINGERROR;
+        }
+        ptr += type->memSize;
+    }
+
+    /* Replace the ExtensionObjects. The variant owns the decoded content. */
+    if(v->storageType == UA_VARIANT_DATA)
+        UA_Array_delete(v->data, length, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    v->data = data;
+    v->type = type;
+    v->storageType = UA_VARIANT_DATA;
+    return UA_STATUSCODE_GOOD;
+}
+
 /******************/
 /* CalcSizeBinary */
 /******************/
@@ -7214,7 +8621,7 @@ UA_decodeBinary(const UA_ByteString *src, size_t *offset,
 static size_t
 Array_calcSizeBinary(const void *src, size_t length, const UA_DataType *type) {
     size_t s = 4; // length
-    if(type->overlayable) {
+    if(type->overlayable || (type->builtin && type->fixedSize)) {
         s += type->memSize * length;
         return s;
     }
@@ -7344,8 +8751,13 @@ Variant_calcSizeBinary(UA_Variant const *src, UA_DataType *_) {
     else
         length = 1;
 
+    /* Builtin types of fixed size are encoded with their memory size */
     uintptr_t ptr = (uintptr_t)src->data;
     size_t memSize = src->type->memSize;
+    if(isBuiltin && src->type->fixedSize) {
+        s += memSize * length;
+        length = 0;
+    }
     for(size_t i = 0; i < length; ++i) {
         if(!isBuiltin) {
             /* The type is wrapped inside an extensionobject */
@@ -15523,6 +16935,8 @@ void UA_Session_deleteMembersCleanup(UA_Session *session, UA_Server* server) {
         LIST_REMOVE(cp, pointers);
         UA_ByteString_deleteMembers(&cp->identifier);
         UA_BrowseDescription_deleteMembers(&cp->browseDescription);
+        UA_NodeId_deleteMembers(&cp->referenceTypeId);
+        UA_NodeId_deleteMembers(&cp->targetId);
         UA_free(cp);
     }
     if(session->channel)
@@ -15708,23 +17122,26 @@ UA_Server_forEachChildNodeCall(UA_Server *server, UA_NodeId parentNodeId,
      * delete references from within the callback. In single-threaded mode this
      * changes the same node we point at here. In multi-threaded mode, this
      * creates a new copy as nodes are truly immutable. */
-    UA_ReferenceNode *refs = NULL;
-    size_t refssize = parent->referencesSize;
-    UA_StatusCode retval = UA_Array_copy(parent->references, parent->referencesSize,
-                                         (void**)&refs, &UA_TYPES[UA_TYPES_REFERENCENODE]);
+    UA_Node refs;
+    memset(&refs, 0, sizeof(UA_Node));
+    UA_StatusCode retval = UA_Node_copyReferences(parent, &refs);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_RCU_UNLOCK();
         return retval;
     }
 
-    for(size_t i = parent->referencesSize; i > 0; --i) {
-        UA_ReferenceNode *ref = &refs[i-1];
-        retval |= callback(ref->targetId.nodeId, ref->isInverse,
-                           ref->referenceTypeId, handle);
+    for(size_t i = refs.referencesSize; i > 0; --i) {
+        UA_NodeReferenceKind *rk = &refs.references[i-1];
+        for(size_t j = rk->remoteTargetIdsSize; j > 0; --j)
+            retval |= callback(rk->remoteTargetIds[j-1].nodeId, rk->isInverse,
+                               rk->referenceTypeId, handle);
+        for(size_t j = rk->targetIdsSize; j > 0; --j)
+            retval |= callback(rk->targetIds[j-1], rk->isInverse,
+                               rk->referenceTypeId, handle);
     }
     UA_RCU_UNLOCK();
 
-    UA_Array_delete(refs, refssize, &UA_TYPES[UA_TYPES_REFERENCENODE]);
+    UA_Node_deleteReferences(&refs);
     return retval;
 }
 
@@ -15784,10 +17201,42 @@ deleteInstanceChildren(UA_Server *server, UA_NodeId *objectNodeId) {
 /* Server */
 /**********/
 
+#ifndef UA_ENABLE_GENERATE_NAMESPACE0
+
+/* The type hierarchy of ns0 does not depend on the server configuration. It is
+ * built by the first server and then shared read-only by all servers of the
+ * process. Nodes that are modified later (e.g. folders that get references to
+ * the server object) are copied into the nodestore of the server. The shared
+ * nodes and their count of servers are process-wide state. They are guarded
+ * by a spin lock in every build, so servers can be created and deleted from
+ * several threads. */
+static UA_Node **sharedNs0Nodes;
+static size_t sharedNs0NodesSize;
+static size_t sharedNs0Servers;
+static UA_SpinLock sharedNs0Lock = UA_SPINLOCK_INIT;
+
+static void
+releaseNs0TypeHierarchy(UA_Server *server) {
+    if(!server->sharedNs0)
+        return;
+    UA_SpinLock_lock(&sharedNs0Lock);
+    --sharedNs0Servers;
+    if(sharedNs0Servers == 0) {
+        UA_NodeStore_deleteShared(sharedNs0Nodes, sharedNs0NodesSize);
+        sharedNs0Nodes = NULL;
+        sharedNs0NodesSize = 0;
+    }
+    UA_SpinLock_unlock(&sharedNs0Lock);
+}
+
+#endif
+
 /* The server needs to be stopped before it can be deleted */
 void UA_Server_delete(UA_Server *server) {
     // Delete the timed work
     UA_Server_deleteAllRepeatedJobs(server);
+    UA_Server_deleteAsyncReads(server);
+    UA_Server_deleteBulkLoad(server);
 
     // Delete all internal data
     UA_SecureChannelManager_deleteMembers(&server->secureChannelManager);
@@ -15795,16 +17244,27 @@ void UA_Server_delete(UA_Server *server) {
     UA_RCU_LOCK();
     UA_NodeStore_delete(server->nodestore);
     UA_RCU_UNLOCK();
+#ifndef UA_ENABLE_GENERATE_NAMESPACE0
+    releaseNs0TypeHierarchy(server);
+#endif
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
     UA_Server_deleteExternalNamespaces(server);
 #endif
     UA_Array_delete(server->namespaces, server->namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
     UA_Array_delete(server->endpointDescriptions, server->endpointDescriptionsSize,
                     &UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION]);
+    UA_Server_deleteInternedNodeIds(server);
+    UA_Server_invalidateTypeClosures(server);
+    UA_Server_invalidateCachedValue(server, NULL);
 
 #ifdef UA_ENABLE_MULTITHREADING
     pthread_cond_destroy(&server->dispatchQueue_condition);
     pthread_mutex_destroy(&server->dispatchQueue_mutex);
+    pthread_mutex_destroy(&server->internedNodeIds_mutex);
+    pthread_mutex_destroy(&server->typeClosures_mutex);
+    pthread_mutex_destroy(&server->asyncReads_mutex);
+    pthread_mutex_destroy(&server->bulkLoad_mutex);
+    pthread_mutex_destroy(&server->valueCache_mutex);
 #endif
     UA_free(server);
 }
@@ -16012,119 +17472,12 @@ createVariableTypeNode(UA_Server *server, char* name, UA_UInt32 variabletypeid,
     return variabletype;
 }
 
-#if defined(UA_ENABLE_METHODCALLS) && defined(UA_ENABLE_SUBSCRIPTIONS)
-static UA_StatusCode
-GetMonitoredItems(void *handle, const UA_NodeId objectId, size_t inputSize,
-                  const UA_Variant *input, size_t outputSize, UA_Variant *output) {
-    UA_UInt32 subscriptionId = *((UA_UInt32*)(input[0].data));
-    UA_Session* session = methodCallSession;
-    UA_Subscription* subscription = UA_Session_getSubscriptionByID(session, subscriptionId);
-    if(!subscription)
-        return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
-
-    UA_UInt32 sizeOfOutput = 0;
-    UA_MonitoredItem* monitoredItem;
-    LIST_FOREACH(monitoredItem, &subscription->monitoredItems, listEntry) {
-        ++sizeOfOutput;
-    }
-    if(sizeOfOutput==0)
-        return UA_STATUSCODE_GOOD;
-
-    UA_UInt32* clientHandles = UA_Array_new(sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
-    UA_UInt32* serverHandles = UA_Array_new(sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
-    UA_UInt32 i = 0;
-    LIST_FOREACH(monitoredItem, &subscription->monitoredItems, listEntry) {
-        clientHandles[i] = monitoredItem->clientHandle;
-        serverHandles[i] = monitoredItem->itemId;
-        ++i;
-    }
-    UA_Variant_setArray(&output[0], clientHandles, sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
-    UA_Variant_setArray(&output[1], serverHandles, sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
-    return UA_STATUSCODE_GOOD;
-}
-#endif
-
-UA_Server * UA_Server_new(const UA_ServerConfig config) {
-    UA_Server *server = UA_calloc(1, sizeof(UA_Server));
-    if(!server)
-        return NULL;
-
-    server->config = config;
-    server->nodestore = UA_NodeStore_new();
-    LIST_INIT(&server->repeatedJobs);
-
-#ifdef UA_ENABLE_MULTITHREADING
-    rcu_init();
-    cds_wfcq_init(&server->dispatchQueue_head, &server->dispatchQueue_tail);
-    cds_lfs_init(&server->mainLoopJobs);
-#else
-    SLIST_INIT(&server->delayedCallbacks);
-#endif
-
-#ifndef UA_ENABLE_DETERMINISTIC_RNG
-    UA_random_seed((UA_UInt64)UA_DateTime_now());
-#endif
-
-    /* ns0 and ns1 */
-    server->namespaces = UA_Array_new(2, &UA_TYPES[UA_TYPES_STRING]);
-    server->namespaces[0] = UA_STRING_ALLOC("http://opcfoundation.org/UA/");
-    UA_String_copy(&server->config.applicationDescription.applicationUri, &server->namespaces[1]);
-    server->namespacesSize = 2;
-
-    /* Create endpoints w/o endpointurl. It is added from the networklayers at startup */
-    server->endpointDescriptions = UA_Array_new(server->config.networkLayersSize,
-                                                &UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION]);
-    server->endpointDescriptionsSize = server->config.networkLayersSize;
-    for(size_t i = 0; i < server->config.networkLayersSize; ++i) {
-        UA_EndpointDescription *endpoint = &server->endpointDescriptions[i];
-        endpoint->securityMode = UA_MESSAGESECURITYMODE_NONE;
-        endpoint->securityPolicyUri =
-            UA_STRING_ALLOC("http://opcfoundation.org/UA/SecurityPolicy#None");
-        endpoint->transportProfileUri =
-            UA_STRING_ALLOC("http://opcfoundation.org/UA-Profile/Transport/uatcp-uasc-uabinary");
-
-        size_t policies = 0;
-        if(server->config.enableAnonymousLogin)
-            ++policies;
-        if(server->config.enableUsernamePasswordLogin)
-            ++policies;
-        endpoint->userIdentityTokensSize = policies;
-        endpoint->userIdentityTokens = UA_Array_new(policies, &UA_TYPES[UA_TYPES_USERTOKENPOLICY]);
-
-        size_t currentIndex = 0;
-        if(server->config.enableAnonymousLogin) {
-            UA_UserTokenPolicy_init(&endpoint->userIdentityTokens[currentIndex]);
-            endpoint->userIdentityTokens[currentIndex].tokenType = UA_USERTOKENTYPE_ANONYMOUS;
-            endpoint->userIdentityTokens[currentIndex].policyId = UA_STRING_ALLOC(ANONYMOUS_POLICY);
-            ++currentIndex;
-        }
-        if(server->config.enableUsernamePasswordLogin) {
-            UA_UserTokenPolicy_init(&endpoint->userIdentityTokens[currentIndex]);
-            endpoint->userIdentityTokens[currentIndex].tokenType = UA_USERTOKENTYPE_USERNAME;
-            endpoint->userIdentityTokens[currentIndex].policyId = UA_STRING_ALLOC(USERNAME_POLICY);
-        }
-
-        /* The standard says "the HostName specified in the Server Certificate is the
-           same as the HostName contained in the endpointUrl provided in the
-           EndpointDescription */
-        UA_String_copy(&server->config.serverCertificate, &endpoint->serverCertificate);
-        UA_ApplicationDescription_copy(&server->config.applicationDescription, &endpoint->server);
-
-        /* copy the discovery url only once the networlayer has been started */
-        // UA_String_copy(&server->config.networkLayers[i].discoveryUrl, &endpoint->endpointUrl);
-    }
-
-    UA_SecureChannelManager_init(&server->secureChannelManager, server);
-    UA_SessionManager_init(&server->sessionManager, server);
-
-    UA_Job cleanup = {.type = UA_JOBTYPE_METHODCALL,
-                      .job.methodCall = {.method = UA_Server_cleanup, .data = NULL} };
-    UA_Server_addRepeatedJob(server, cleanup, 10000, NULL);
-
-    server->startTime = UA_DateTime_now();
-
 #ifndef UA_ENABLE_GENERATE_NAMESPACE0
 
+/* Reference types, data types, variable types, object types, the standard
+ * folders and the modelling rules of ns0 */
+static void
+addNs0TypeHierarchy(UA_Server *server) {
     /*********************************/
     /* Bootstrap reference hierarchy */
     /*********************************/
@@ -16524,7 +17877,162 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     optional->nodeId.identifier.numeric = UA_NS0ID_MODELLINGRULE_OPTIONAL;
     addNodeInternalWithType(server, (UA_Node*)optional, UA_NODEID_NULL,
                             UA_NODEID_NULL, UA_NODEID_NUMERIC(0, UA_NS0ID_MODELLINGRULETYPE));
+}
 
+/* The lock is held while the first server builds the hierarchy. So the
+ * servers created at the same time wait and then share it. */
+static void
+setupNs0TypeHierarchy(UA_Server *server) {
+    UA_SpinLock_lock(&sharedNs0Lock);
+    if(sharedNs0Servers > 0) {
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        for(size_t i = 0; i < sharedNs0NodesSize && retval == UA_STATUSCODE_GOOD; ++i)
+            retval = UA_NodeStore_insertShared(server->nodestore, sharedNs0Nodes[i]);
+        if(retval == UA_STATUSCODE_GOOD) {
+            server->sharedNs0 = true;
+            ++sharedNs0Servers;
+        } else {
+            /* Build a private copy in an empty nodestore */
+            UA_NodeStore_delete(server->nodestore);
+            server->nodestore = UA_NodeStore_new();
+            addNs0TypeHierarchy(server);
+        }
+    } else {
+        addNs0TypeHierarchy(server);
+        if(UA_NodeStore_share(server->nodestore, &sharedNs0Nodes,
+                              &sharedNs0NodesSize) == UA_STATUSCODE_GOOD) {
+            server->sharedNs0 = true;
+            sharedNs0Servers = 1;
+        }
+    }
+    UA_SpinLock_unlock(&sharedNs0Lock);
+}
+
+#endif
+
+#if defined(UA_ENABLE_METHODCALLS) && defined(UA_ENABLE_SUBSCRIPTIONS)
+static UA_StatusCode
+GetMonitoredItems(void *handle, const UA_NodeId objectId, size_t inputSize,
+                  const UA_Variant *input, size_t outputSize, UA_Variant *output) {
+    UA_UInt32 subscriptionId = *((UA_UInt32*)(input[0].data));
+    UA_Session* session = methodCallSession;
+    UA_Subscription* subscription = UA_Session_getSubscriptionByID(session, subscriptionId);
+    if(!subscription)
+        return UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
+
+    UA_UInt32 sizeOfOutput = 0;
+    UA_MonitoredItem* monitoredItem;
+    LIST_FOREACH(monitoredItem, &subscription->monitoredItems, listEntry) {
+        ++sizeOfOutput;
+    }
+    if(sizeOfOutput==0)
+        return UA_STATUSCODE_GOOD;
+
+    UA_UInt32* clientHandles = UA_Array_new(sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_UInt32* serverHandles = UA_Array_new(sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_UInt32 i = 0;
+    LIST_FOREACH(monitoredItem, &subscription->monitoredItems, listEntry) {
+        clientHandles[i] = monitoredItem->clientHandle;
+        serverHandles[i] = monitoredItem->itemId;
+        ++i;
+    }
+    UA_Variant_setArray(&output[0], clientHandles, sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_Variant_setArray(&output[1], serverHandles, sizeOfOutput, &UA_TYPES[UA_TYPES_UINT32]);
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
+UA_Server * UA_Server_new(const UA_ServerConfig config) {
+    UA_Server *server = UA_calloc(1, sizeof(UA_Server));
+    if(!server)
+        return NULL;
+
+    server->config = config;
+    server->nodestore = UA_NodeStore_new();
+    LIST_INIT(&server->repeatedJobs);
+    LIST_INIT(&server->asyncReads);
+    TAILQ_INIT(&server->valueCache.lru);
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    LIST_INIT(&server->sampleBatch);
+#endif
+
+#ifdef UA_ENABLE_MULTITHREADING
+    rcu_init();
+    cds_wfcq_init(&server->dispatchQueue_head, &server->dispatchQueue_tail);
+    cds_lfs_init(&server->mainLoopJobs);
+    pthread_mutex_init(&server->internedNodeIds_mutex, NULL);
+    pthread_mutex_init(&server->typeClosures_mutex, NULL);
+    pthread_mutex_init(&server->asyncReads_mutex, NULL);
+    pthread_mutex_init(&server->bulkLoad_mutex, NULL);
+    pthread_mutex_init(&server->valueCache_mutex, NULL);
+#else
+    SLIST_INIT(&server->delayedCallbacks);
+#endif
+
+#ifndef UA_ENABLE_DETERMINISTIC_RNG
+    UA_random_seed((UA_UInt64)UA_DateTime_now());
+#endif
+
+    /* ns0 and ns1 */
+    server->namespaces = UA_Array_new(2, &UA_TYPES[UA_TYPES_STRING]);
+    server->namespaces[0] = UA_STRING_ALLOC("http://opcfoundation.org/UA/");
+    UA_String_copy(&server->config.applicationDescription.applicationUri, &server->namespaces[1]);
+    server->namespacesSize = 2;
+
+    /* Create endpoints w/o endpointurl. It is added from the networklayers at startup */
+    server->endpointDescriptions = UA_Array_new(server->config.networkLayersSize,
+                                                &UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION]);
+    server->endpointDescriptionsSize = server->config.networkLayersSize;
+    for(size_t i = 0; i < server->config.networkLayersSize; ++i) {
+        UA_EndpointDescription *endpoint = &server->endpointDescriptions[i];
+        endpoint->securityMode = UA_MESSAGESECURITYMODE_NONE;
+        endpoint->securityPolicyUri =
+            UA_STRING_ALLOC("http://opcfoundation.org/UA/SecurityPolicy#None");
+        endpoint->transportProfileUri =
+            UA_STRING_ALLOC("http://opcfoundation.org/UA-Profile/Transport/uatcp-uasc-uabinary");
+
+        size_t policies = 0;
+        if(server->config.enableAnonymousLogin)
+            ++policies;
+        if(server->config.enableUsernamePasswordLogin)
+            ++policies;
+        endpoint->userIdentityTokensSize = policies;
+        endpoint->userIdentityTokens = UA_Array_new(policies, &UA_TYPES[UA_TYPES_USERTOKENPOLICY]);
+
+        size_t currentIndex = 0;
+        if(server->config.enableAnonymousLogin) {
+            UA_UserTokenPolicy_init(&endpoint->userIdentityTokens[currentIndex]);
+            endpoint->userIdentityTokens[currentIndex].tokenType = UA_USERTOKENTYPE_ANONYMOUS;
+            endpoint->userIdentityTokens[currentIndex].policyId = UA_STRING_ALLOC(ANONYMOUS_POLICY);
+            ++currentIndex;
+        }
+        if(server->config.enableUsernamePasswordLogin) {
+            UA_UserTokenPolicy_init(&endpoint->userIdentityTokens[currentIndex]);
+            endpoint->userIdentityTokens[currentIndex].tokenType = UA_USERTOKENTYPE_USERNAME;
+            endpoint->userIdentityTokens[currentIndex].policyId = UA_STRING_ALLOC(USERNAME_POLICY);
+        }
+
+        /* The standard says "the HostName specified in the Server Certificate is the
+           same as the HostName contained in the endpointUrl provided in the
+           EndpointDescription */
+        UA_String_copy(&server->config.serverCertificate, &endpoint->serverCertificate);
+        UA_ApplicationDescription_copy(&server->config.applicationDescription, &endpoint->server);
+
+        /* copy the discovery url only once the networlayer has been started */
+        // UA_String_copy(&server->config.networkLayers[i].discoveryUrl, &endpoint->endpointUrl);
+    }
+
+    UA_SecureChannelManager_init(&server->secureChannelManager, server);
+    UA_SessionManager_init(&server->sessionManager, server);
+
+    UA_Job cleanup = {.type = UA_JOBTYPE_METHODCALL,
+                      .job.methodCall = {.method = UA_Server_cleanup, .data = NULL} };
+    UA_Server_addRepeatedJob(server, cleanup, 10000, NULL);
+
+    server->startTime = UA_DateTime_now();
+
+#ifndef UA_ENABLE_GENERATE_NAMESPACE0
+    setupNs0TypeHierarchy(server);
 #else
     /* load the generated namespace externally */
     ua_namespaceinit_generated(server);
@@ -16551,8 +18059,8 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     copyNames((UA_Node*)namespaceArray, "NamespaceArray");
     namespaceArray->nodeId.identifier.numeric = UA_NS0ID_SERVER_NAMESPACEARRAY;
     namespaceArray->valueSource = UA_VALUESOURCE_DATASOURCE;
-    namespaceArray->value.dataSource = (UA_DataSource) {.handle = server, .read = readNamespaces,
-                                                        .write = writeNamespaces};
+    namespaceArray->value.dataSource.source =
+        (UA_DataSource) {.handle = server, .read = readNamespaces, .write = writeNamespaces};
     namespaceArray->dataType = UA_TYPES[UA_TYPES_STRING].typeId;
     namespaceArray->valueRank = 1;
     namespaceArray->minimumSamplingInterval = 1.0;
@@ -16713,8 +18221,8 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     copyNames((UA_Node*)serverstatus, "ServerStatus");
     serverstatus->nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS);
     serverstatus->valueSource = UA_VALUESOURCE_DATASOURCE;
-    serverstatus->value.dataSource = (UA_DataSource) {.handle = server, .read = readStatus,
-                                                      .write = NULL};
+    serverstatus->value.dataSource.source =
+        (UA_DataSource) {.handle = server, .read = readStatus, .write = NULL};
     addNodeInternalWithType(server, (UA_Node*)serverstatus, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
                             nodeIdHasComponent, UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE));
 
@@ -16732,8 +18240,8 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     copyNames((UA_Node*)currenttime, "CurrentTime");
     currenttime->nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME);
     currenttime->valueSource = UA_VALUESOURCE_DATASOURCE;
-    currenttime->value.dataSource = (UA_DataSource) {.handle = NULL, .read = readCurrentTime,
-                                                     .write = NULL};
+    currenttime->value.dataSource.source =
+        (UA_DataSource) {.handle = NULL, .read = readCurrentTime, .write = NULL};
     addNodeInternalWithType(server, (UA_Node*)currenttime,
                             UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS),
                             nodeIdHasComponent, UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE));
@@ -16843,8 +18351,8 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     copyNames((UA_Node*)servicelevel, "ServiceLevel");
     servicelevel->nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVICELEVEL);
     servicelevel->valueSource = UA_VALUESOURCE_DATASOURCE;
-    servicelevel->value.dataSource = (UA_DataSource) {.handle = server, .read = readServiceLevel,
-                                                      .write = NULL};
+    servicelevel->value.dataSource.source =
+        (UA_DataSource) {.handle = server, .read = readServiceLevel, .write = NULL};
     addNodeInternalWithType(server, (UA_Node*)servicelevel,
                             UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), nodeIdHasComponent,
                             UA_NODEID_NUMERIC(0, UA_NS0ID_PROPERTYTYPE));
@@ -16853,7 +18361,8 @@ UA_Server * UA_Server_new(const UA_ServerConfig config) {
     copyNames((UA_Node*)auditing, "Auditing");
     auditing->nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_AUDITING);
     auditing->valueSource = UA_VALUESOURCE_DATASOURCE;
-    auditing->value.dataSource = (UA_DataSource) {.handle = server, .read = readAuditing, .write = NULL};
+    auditing->value.dataSource.source =
+        (UA_DataSource) {.handle = server, .read = readAuditing, .write = NULL};
     addNodeInternalWithType(server, (UA_Node*)auditing,
                             UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER), nodeIdHasComponent,
                             UA_NODEID_NUMERIC(0, UA_NS0ID_PROPERTYTYPE));
@@ -16953,7 +18462,7 @@ sendError(UA_SecureChannel *channel, const UA_ByteString *msg,
     UA_init(response, responseType);
     UA_ResponseHeader *responseHeader = (UA_ResponseHeader*)response;
     responseHeader->requestHandle = requestHeader.requestHandle;
-    responseHeader->timestamp = UA_DateTime_now();
+    responseHeader->timestamp = UA_Server_tickTime();
     responseHeader->serviceResult = error;
     UA_SecureChannel_sendBinaryMessage(channel, requestId, response, responseType);
     UA_RequestHeader_deleteMembers(&requestHeader);
@@ -17266,6 +18775,38 @@ processOPN(UA_Server *server, UA_Connection *connection,
     UA_AsymmetricAlgorithmSecurityHeader_deleteMembers(&asymHeader);
 }
 
+/* In the lazy decoding mode, the ExtensionObjects and variants whose content
+ * is used by the server itself (or handed to method callbacks) are unpacked
+ * right away. All others remain encoded. */
+static UA_StatusCode
+decodeRequestBodies(void *request, const UA_DataType *requestType) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(requestType == &UA_TYPES[UA_TYPES_ACTIVATESESSIONREQUEST]) {
+        UA_ActivateSessionRequest *req = (UA_ActivateSessionRequest*)request;
+        retval = UA_ExtensionObject_decodeBody(&req->userIdentityToken);
+    } else if(requestType == &UA_TYPES[UA_TYPES_ADDNODESREQUEST]) {
+        UA_AddNodesRequest *req = (UA_AddNodesRequest*)request;
+        for(size_t i = 0; i < req->nodesToAddSize; ++i)
+            retval |= UA_ExtensionObject_decodeBody(&req->nodesToAdd[i].nodeAttributes);
+    } else if(requestType == &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST]) {
+        UA_CreateMonitoredItemsRequest *req = (UA_CreateMonitoredItemsRequest*)request;
+        for(size_t i = 0; i < req->itemsToCreateSize; ++i)
+            retval |= UA_ExtensionObject_decodeBody(&req->itemsToCreate[i].requestedParameters.filter);
+    } else if(requestType == &UA_TYPES[UA_TYPES_MODIFYMONITOREDITEMSREQUEST]) {
+        UA_ModifyMonitoredItemsRequest *req = (UA_ModifyMonitoredItemsRequest*)request;
+        for(size_t i = 0; i < req->itemsToModifySize; ++i)
+            retval |= UA_ExtensionObject_decodeBody(&req->itemsToModify[i].requestedParameters.filter);
+    } else if(requestType == &UA_TYPES[UA_TYPES_CALLREQUEST]) {
+        UA_CallRequest *req = (UA_CallRequest*)request;
+        for(size_t i = 0; i < req->methodsToCallSize; ++i) {
+            UA_CallMethodRequest *call = &req->methodsToCall[i];
+            for(size_t j = 0; j < call->inputArgumentsSize; ++j)
+                retval |= UA_Variant_decodeBody(&call->inputArguments[j]);
+        }
+    }
+    return retval;
+}
+
 static void
 processMSG(UA_Server *server, UA_SecureChannel *channel,
            UA_UInt32 requestId, const UA_ByteString *msg) {
@@ -17315,7 +18856,16 @@ processMSG(UA_Server *server, UA_SecureChannel *channel,
     /* Decode the request */
     void *request = UA_alloca(requestType->memSize);
     UA_RequestHeader *requestHeader = (UA_RequestHeader*)request;
-    retval = UA_decodeBinary(msg, offset, request, requestType);
+    if(server->config.lazyDecoding) {
+        retval = UA_decodeBinaryLazy(msg, offset, request, requestType);
+        if(retval == UA_STATUSCODE_GOOD) {
+            retval = decodeRequestBodies(request, requestType);
+            if(retval != UA_STATUSCODE_GOOD)
+                UA_deleteMembers(request, requestType);
+        }
+    } else {
+        retval = UA_decodeBinary(msg, offset, request, requestType);
+    }
     if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_DEBUG_CHANNEL(server->config.logger, channel,
                              "Could not decode the request");
@@ -17407,6 +18957,16 @@ processMSG(UA_Server *server, UA_SecureChannel *channel,
     }
 #endif
 
+    /* Reads from asynchronous DataSources are answered when all operations
+     * have completed */
+    if(requestType == &UA_TYPES[UA_TYPES_READREQUEST]) {
+        if(Service_Read_async(server, session, channel, requestId, request, response)) {
+            UA_deleteMembers(request, requestType);
+            return;
+        }
+        goto send_response;
+    }
+
     /* Call the service */
     UA_assert(service); /* For all services besides publish, the service pointer is non-NULL*/
     service(server, session, request, response);
@@ -17414,7 +18974,7 @@ processMSG(UA_Server *server, UA_SecureChannel *channel,
  send_response:
     /* Send the response */
     ((UA_ResponseHeader*)response)->requestHandle = requestHeader->requestHandle;
-    ((UA_ResponseHeader*)response)->timestamp = UA_DateTime_now();
+    ((UA_ResponseHeader*)response)->timestamp = UA_Server_tickTime();
     retval = UA_SecureChannel_sendBinaryMessage(channel, requestId, response, responseType);
 
     if(retval != UA_STATUSCODE_GOOD)
@@ -17632,6 +19192,11 @@ parse_numericrange(const UA_String *str, UA_NumericRange *range) {
     return retval;
 }
 
+UA_StatusCode
+UA_NumericRange_parseFromString(UA_NumericRange *range, const UA_String *str) {
+    return parse_numericrange(str, range);
+}
+
 /********************************/
 /* Information Model Operations */
 /********************************/
@@ -17655,16 +19220,14 @@ getTypeHierarchy(UA_NodeStore *ns, const UA_Node *rootRef, UA_Boolean inverse,
     size_t last = 0; /* Index of the last element in the array */
     const UA_NodeId hasSubtypeNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
     while(true) {
-        for(size_t i = 0; i < node->referencesSize; ++i) {
-            /* is the reference relevant? */
-            if(node->references[i].isInverse != inverse ||
-               !UA_NodeId_equal(&hasSubtypeNodeId, &node->references[i].referenceTypeId))
-                continue;
-
+        /* Only the hasSubtype references in the direction are relevant */
+        const UA_NodeReferenceKind *rk =
+            UA_Node_findReferenceKind(node, &hasSubtypeNodeId, inverse);
+        for(size_t i = 0; rk && i < rk->targetIdsSize; ++i) {
             /* is the target already considered? (multi-inheritance) */
             UA_Boolean duplicate = false;
             for(size_t j = 0; j <= last; ++j) {
-                if(UA_NodeId_equal(&node->references[i].targetId.nodeId, &results[j])) {
+                if(UA_NodeId_equal(&rk->targetIds[i], &results[j])) {
                     duplicate = true;
                     break;
                 }
@@ -17685,7 +19248,7 @@ getTypeHierarchy(UA_NodeStore *ns, const UA_Node *rootRef, UA_Boolean inverse,
             }
 
             /* copy new nodeid to the end of the list */
-            retval = UA_NodeId_copy(&node->references[i].targetId.nodeId, &results[++last]);
+            retval = UA_NodeId_copy(&rk->targetIds[i], &results[++last]);
             if(retval != UA_STATUSCODE_GOOD)
                 break;
         }
@@ -17720,17 +19283,20 @@ isNodeInTree(UA_NodeStore *ns, const UA_NodeId *leafNode, const UA_NodeId *nodeT
     if(!node)
         return false;
 
-    /* Search upwards in the tree */
+    /* Search upwards in the tree. Recurse only for valid reference types. */
     for(size_t i = 0; i < node->referencesSize; ++i) {
-        if(!node->references[i].isInverse)
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(!rk->isInverse)
             continue;
-
-        /* Recurse only for valid reference types */
         for(size_t j = 0; j < referenceTypeIdsSize; ++j) {
-            if(UA_NodeId_equal(&node->references[i].referenceTypeId, &referenceTypeIds[j]) &&
-               isNodeInTree(ns, &node->references[i].targetId.nodeId, nodeToFind,
-                            referenceTypeIds, referenceTypeIdsSize))
-                return true;
+            if(!UA_NodeId_equal(&rk->referenceTypeId, &referenceTypeIds[j]))
+                continue;
+            for(size_t k = 0; k < rk->targetIdsSize; ++k) {
+                if(isNodeInTree(ns, &rk->targetIds[k], nodeToFind,
+                                referenceTypeIds, referenceTypeIdsSize))
+                    return true;
+            }
+            break;
         }
     }
     return false;
@@ -17756,18 +19322,10 @@ getNodeType(UA_Server *server, const UA_Node *node) {
     }
 
     /* stop at the first matching candidate */
-    UA_NodeId *parentId = NULL;
-    for(size_t i = 0; i < node->referencesSize; ++i) {
-        if(node->references[i].isInverse == inverse &&
-           UA_NodeId_equal(&node->references[i].referenceTypeId, &parentRef)) {
-            parentId = &node->references[i].targetId.nodeId;
-            break;
-        }
-    }
-
-    if(!parentId)
+    const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind(node, &parentRef, inverse);
+    if(!rk || rk->targetIdsSize == 0)
         return NULL;
-    return UA_NodeStore_get(server->nodestore, parentId);
+    return UA_NodeStore_get(server->nodestore, &rk->targetIds[0]);
 }
 
 const UA_VariableTypeNode *
@@ -17790,33 +19348,46 @@ UA_Boolean
 UA_Node_hasSubTypeOrInstances(const UA_Node *node) {
     const UA_NodeId hasSubType = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
     const UA_NodeId hasTypeDefinition = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
-    for(size_t i = 0; i < node->referencesSize; ++i) {
-        if(node->references[i].isInverse == false &&
-           UA_NodeId_equal(&node->references[i].referenceTypeId, &hasSubType))
-            return true;
-        if(node->references[i].isInverse == true &&
-           UA_NodeId_equal(&node->references[i].referenceTypeId, &hasTypeDefinition))
-            return true;
-    }
-    return false;
+    return UA_Node_findReferenceKind(node, &hasSubType, false) ||
+        UA_Node_findReferenceKind(node, &hasTypeDefinition, true);
 }
 
 /* For mulithreading: make a copy of the node, edit and replace.
- * For singletrheading: edit the original */
-UA_StatusCode
-UA_Server_editNode(UA_Server *server, UA_Session *session,
-                   const UA_NodeId *nodeId, UA_EditNodeCallback callback,
-                   const void *data) {
+ * For singletrheading: edit the original. Shared nodes are copied and
+ * replaced. The node is looked up with the interned nodeid if one is given. */
+static UA_StatusCode
+editNode(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
+         const UA_InternedNodeId *interned, UA_EditNodeCallback callback,
+         const void *data) {
 #ifndef UA_ENABLE_MULTITHREADING
-    const UA_Node *node = UA_NodeStore_get(server->nodestore, nodeId);
+    const UA_Node *node;
+    if(interned)
+        node = UA_NodeStore_getInterned(server->nodestore, interned);
+    else
+        node = UA_NodeStore_get(server->nodestore, nodeId);
     if(!node)
         return UA_STATUSCODE_BADNODEIDUNKNOWN;
-    UA_Node *editNode = (UA_Node*)(uintptr_t)node; // dirty cast
-    return callback(server, session, editNode, data);
+    if(!UA_NodeStore_isShared(node)) {
+        UA_Node *editNode = (UA_Node*)(uintptr_t)node; // dirty cast
+        return callback(server, session, editNode, data);
+    }
+    UA_Node *copy = UA_NodeStore_getCopy(server->nodestore, &node->nodeId);
+    if(!copy)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = callback(server, session, copy, data);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeStore_deleteNode(copy);
+        return retval;
+    }
+    return UA_NodeStore_replace(server->nodestore, copy);
 #else
     UA_StatusCode retval;
     do {
-        UA_Node *copy = UA_NodeStore_getCopy(server->nodestore, nodeId);
+        UA_Node *copy;
+        if(interned)
+            copy = UA_NodeStore_getCopyInterned(server->nodestore, interned);
+        else
+            copy = UA_NodeStore_getCopy(server->nodestore, nodeId);
         if(!copy)
             return UA_STATUSCODE_BADOUTOFMEMORY;
         retval = callback(server, session, copy, data);
@@ -17830,81 +19401,697 @@ UA_Server_editNode(UA_Server *server, UA_Session *session,
 #endif
 }
 
-/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/server/ua_server_worker.c" ***********************************/
-
-/* This Source Code Form is subject to the terms of the Mozilla Public
-*  License, v. 2.0. If a copy of the MPL was not distributed with this
-*  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+UA_StatusCode
+UA_Server_editNode(UA_Server *server, UA_Session *session,
+                   const UA_NodeId *nodeId, UA_EditNodeCallback callback,
+                   const void *data) {
+    return editNode(server, session, nodeId, NULL, callback, data);
+}
 
+UA_StatusCode
+UA_Server_editNodeInterned(UA_Server *server, UA_Session *session,
+                           const UA_InternedNodeId *nodeId,
+                           UA_EditNodeCallback callback, const void *data) {
+    return editNode(server, session, &nodeId->nodeId, nodeId, callback, data);
+}
 
-/**
- * There are four types of job execution:
- *
- * 1. Normal jobs (dispatched to worker threads if multithreading is activated)
- *
- * 2. Repeated jobs with a repetition interval (dispatched to worker threads)
- *
- * 3. Mainloop jobs are executed (once) from the mainloop and not in the worker threads. The server
- * contains a stack structure where all threads can add mainloop jobs for the next mainloop
- * iteration. This is used e.g. to trigger adding and removing repeated jobs without blocking the
- * mainloop.
- *
- * 4. Delayed jobs are executed once in a worker thread. But only when all normal jobs that were
- * dispatched earlier have been executed. This is achieved by a counter in the worker threads. We
- * compute from the counter if all previous jobs have finished. The delay can be very long, since we
- * try to not interfere too much with normal execution. A use case is to eventually free obsolete
- * structures that _could_ still be accessed from concurrent threads.
- *
- * - Remove the entry from the list
- * - mark it as "dead" with an atomic operation
- * - add a delayed job that frees the memory when all concurrent operations have completed
- *
- * This approach to concurrently accessible memory is known as epoch based reclamation [1]. According to
- * [2], it performs competitively well on many-core systems. Our version of EBR does however not require
- * a global epoch. Instead, every worker thread has its own epoch counter that we observe for changes.
- *
- * [1] Fraser, K. 2003. Practical lock freedom. Ph.D. thesis. Computer Laboratory, University of Cambridge.
- * [2] Hart, T. E., McKenney, P. E., Brown, A. D., & Walpole, J. (2007). Performance of memory reclamation
- *     for lockless synchronization. Journal of Parallel and Distributed Computing, 67(12), 1270-1285.
- *
- * Future Plans: Use work-stealing to load-balance between cores.
- * [3] Le, Nhat Minh, et al. "Correct and efficient work-stealing for weak
- *     memory models." ACM SIGPLAN Notices. Vol. 48. No. 8. ACM, 2013.
- */
+/*****************/
+/* Type Closures */
+/*****************/
 
-#define MAXTIMEOUT 50 // max timeout in millisec until the next main loop iteration
+#define UA_TYPECLOSURES_MINSIZE 64
+#define UA_TYPECLOSURES_NONE ((size_t)-1)
 
-static void
-processJob(UA_Server *server, UA_Job *job) {
-    UA_ASSERT_RCU_UNLOCKED();
-    UA_RCU_LOCK();
-    switch(job->type) {
-    case UA_JOBTYPE_NOTHING:
-        break;
-    case UA_JOBTYPE_DETACHCONNECTION:
-        UA_Connection_detachSecureChannel(job->job.closeConnection);
-        break;
-    case UA_JOBTYPE_BINARYMESSAGE_NETWORKLAYER:
-        UA_Server_processBinaryMessage(server, job->job.binaryMessage.connection,
-                                       &job->job.binaryMessage.message);
-        UA_Connection *connection = job->job.binaryMessage.connection;
-        connection->releaseRecvBuffer(connection, &job->job.binaryMessage.message);
-        break;
-    case UA_JOBTYPE_BINARYMESSAGE_ALLOCATED:
-        UA_Server_processBinaryMessage(server, job->job.binaryMessage.connection,
-                                       &job->job.binaryMessage.message);
-        UA_ByteString_deleteMembers(&job->job.binaryMessage.message);
-        break;
-    case UA_JOBTYPE_METHODCALL:
-    case UA_JOBTYPE_METHODCALL_DELAYED:
-        job->job.methodCall.method(server, job->job.methodCall.data);
-        break;
-    default:
-        UA_LOG_WARNING(server->config.logger, UA_LOGCATEGORY_SERVER,
-                       "Trying to execute a job of unknown type");
-        break;
+static UA_Boolean
+isTypeNodeClass(UA_NodeClass nodeClass) {
+    return nodeClass == UA_NODECLASS_REFERENCETYPE || nodeClass == UA_NODECLASS_DATATYPE ||
+        nodeClass == UA_NODECLASS_OBJECTTYPE || nodeClass == UA_NODECLASS_VARIABLETYPE;
+}
+
+static UA_UInt32 *
+findTypeSlot(const UA_TypeClosures *tc, const UA_NodeId *typeId, UA_UInt32 hash) {
+    size_t size = tc->capacity * 2;
+    size_t idx = hash & (size - 1);
+    while(tc->index[idx]) {
+        const UA_TypeClosureEntry *entry = &tc->types[tc->index[idx] - 1];
+        if(entry->hash == hash && UA_NodeId_equal(&entry->typeId, typeId))
+            break;
+        idx = (idx + 1) & (size - 1);
     }
-    UA_RCU_UNLOCK();
+    return &tc->index[idx];
+}
+
+static size_t
+typeHandle(const UA_TypeClosures *tc, const UA_NodeId *typeId) {
+    UA_UInt32 handle = *findTypeSlot(tc, typeId, UA_NodeId_hash(typeId));
+    if(handle == 0)
+        return UA_TYPECLOSURES_NONE;
+    return (size_t)handle - 1;
+}
+
+/* Returns UA_TYPECLOSURES_NONE if the table is full */
+static size_t
+addType(UA_TypeClosures *tc, const UA_Node *node) {
+    UA_UInt32 hash = UA_NodeId_hash(&node->nodeId);
+    UA_UInt32 *slot = findTypeSlot(tc, &node->nodeId, hash);
+    if(*slot)
+        return (size_t)*slot - 1;
+    if(tc->typesSize >= tc->capacity)
+        return UA_TYPECLOSURES_NONE;
+    size_t handle = tc->typesSize;
+    UA_TypeClosureEntry *entry = &tc->types[handle];
+    if(UA_NodeId_copy(&node->nodeId, &entry->typeId) != UA_STATUSCODE_GOOD)
+        return UA_TYPECLOSURES_NONE;
+    entry->hash = hash;
+    entry->nodeClass = node->nodeClass;
+    entry->parent = UA_TYPECLOSURES_NONE;
+    entry->firstChild = UA_TYPECLOSURES_NONE;
+    entry->nextSibling = UA_TYPECLOSURES_NONE;
+    *slot = (UA_UInt32)handle + 1;
+    ++tc->typesSize;
+    tc->numbered = false;
+    return handle;
+}
+
+/* The first supertype of a type becomes its parent in the forest. Edges that
+ * would close a cycle are ignored. Returns false if out of memory. */
+static UA_Boolean
+addSubtypeEdge(UA_TypeClosures *tc, size_t superType, size_t subType) {
+    UA_TypeClosureEntry *sub = &tc->types[subType];
+    if(sub->parent == superType)
+        return true; /* seen from the other direction */
+    for(size_t t = superType; t != UA_TYPECLOSURES_NONE; t = tc->types[t].parent) {
+        if(t == subType)
+            return true;
+    }
+
+    if(sub->parent == UA_TYPECLOSURES_NONE) {
+        sub->parent = superType;
+        sub->nextSibling = tc->types[superType].firstChild;
+        tc->types[superType].firstChild = subType;
+        tc->numbered = false;
+        return true;
+    }
+
+    for(size_t i = 0; i < tc->extraEdgesSize; ++i) {
+        if(tc->extraEdges[i].superType == superType &&
+           tc->extraEdges[i].subType == subType)
+            return true;
+    }
+    UA_TypeClosureEdge *edges =
+        UA_realloc(tc->extraEdges, sizeof(UA_TypeClosureEdge) * (tc->extraEdgesSize + 1));
+    if(!edges)
+        return false;
+    edges[tc->extraEdgesSize].superType = superType;
+    edges[tc->extraEdgesSize].subType = subType;
+    tc->extraEdges = edges;
+    ++tc->extraEdgesSize;
+    return true;
+}
+
+/* Number the forest in preorder without recursion. Called lazily before the
+ * first query after types or edges were added. */
+static void
+numberTypes(UA_TypeClosures *tc) {
+    size_t next = 0;
+    for(size_t root = 0; root < tc->typesSize; ++root) {
+        if(tc->types[root].parent != UA_TYPECLOSURES_NONE)
+            continue;
+        size_t t = root;
+        UA_Boolean done = false;
+        while(!done) {
+            tc->types[t].pre = next++;
+            if(tc->types[t].firstChild != UA_TYPECLOSURES_NONE) {
+                t = tc->types[t].firstChild;
+                continue;
+            }
+            /* Close the subtrees until a sibling is found */
+            while(true) {
+                tc->types[t].last = next - 1;
+                if(t == root) {
+                    done = true;
+                    break;
+                }
+                if(tc->types[t].nextSibling != UA_TYPECLOSURES_NONE) {
+                    t = tc->types[t].nextSibling;
+                    break;
+                }
+                t = tc->types[t].parent;
+            }
+        }
+    }
+    tc->numbered = true;
+}
+
+static UA_Boolean
+inSubtree(const UA_TypeClosures *tc, size_t type, size_t superType) {
+    const UA_TypeClosureEntry *super = &tc->types[superType];
+    size_t pre = tc->types[type].pre;
+    return pre >= super->pre && pre <= super->last;
+}
+
+static void
+pushExtraEdges(UA_TypeClosures *tc, size_t type, size_t *stack) {
+    for(size_t i = 0; i < tc->extraEdgesSize; ++i) {
+        UA_TypeClosureEdge *e = &tc->extraEdges[i];
+        if(e->visited || !inSubtree(tc, type, e->subType))
+            continue;
+        e->visited = true;
+        e->next = *stack;
+        *stack = i;
+    }
+}
+
+/* A path from the supertype down to the type either stays in the forest or
+ * its last extra edge ends in a type that has the type in its subtree. So the
+ * extra edges are followed upwards from the type. Every edge is taken once. */
+static UA_Boolean
+inClosure(UA_TypeClosures *tc, size_t type, size_t superType) {
+    if(inSubtree(tc, type, superType))
+        return true;
+    for(size_t i = 0; i < tc->extraEdgesSize; ++i)
+        tc->extraEdges[i].visited = false;
+    size_t stack = UA_TYPECLOSURES_NONE;
+    pushExtraEdges(tc, type, &stack);
+    while(stack != UA_TYPECLOSURES_NONE) {
+        const UA_TypeClosureEdge *e = &tc->extraEdges[stack];
+        stack = e->next;
+        if(inSubtree(tc, e->superType, superType))
+            return true;
+        pushExtraEdges(tc, e->superType, &stack);
+    }
+    return false;
+}
+
+static void
+clearTypeClosures(UA_TypeClosures *tc) {
+    for(size_t i = 0; i < tc->typesSize; ++i)
+        UA_NodeId_deleteMembers(&tc->types[i].typeId);
+    UA_free(tc->types);
+    UA_free(tc->index);
+    UA_free(tc->extraEdges);
+    memset(tc, 0, sizeof(UA_TypeClosures));
+}
+
+static void
+countType(void *context, const UA_Node *node) {
+    if(isTypeNodeClass(node->nodeClass))
+        ++*(size_t*)context;
+}
+
+static void
+collectType(void *context, const UA_Node *node) {
+    if(isTypeNodeClass(node->nodeClass))
+        addType((UA_TypeClosures*)context, node);
+}
+
+/* Subtypes need to have the same nodeClass as the supertype. References in
+ * both directions are considered. */
+static void
+collectSubtypes(void *context, const UA_Node *node) {
+    UA_TypeClosures *tc = (UA_TypeClosures*)context;
+    if(!tc->valid || !isTypeNodeClass(node->nodeClass))
+        return;
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    size_t handle = typeHandle(tc, &node->nodeId);
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(!UA_NodeId_equal(&rk->referenceTypeId, &hasSubtype))
+            continue;
+        for(size_t j = 0; j < rk->targetIdsSize; ++j) {
+            size_t target = typeHandle(tc, &rk->targetIds[j]);
+            if(target == UA_TYPECLOSURES_NONE ||
+               tc->types[target].nodeClass != node->nodeClass)
+                continue;
+            UA_Boolean added;
+            if(rk->isInverse)
+                added = addSubtypeEdge(tc, target, handle);
+            else
+                added = addSubtypeEdge(tc, handle, target);
+            if(!added)
+                tc->valid = false;
+        }
+    }
+}
+
+static UA_StatusCode
+buildTypeClosures(UA_Server *server, UA_TypeClosures *tc) {
+    size_t count = 0;
+    UA_NodeStore_iterate(server->nodestore, countType, &count);
+
+    /* Leave room for the types added later on */
+    size_t capacity = UA_TYPECLOSURES_MINSIZE;
+    while(capacity < count * 2)
+        capacity *= 2;
+    tc->capacity = capacity;
+    tc->types = UA_calloc(capacity, sizeof(UA_TypeClosureEntry));
+    tc->index = UA_calloc(capacity * 2, sizeof(UA_UInt32));
+    if(!tc->types || !tc->index) {
+        clearTypeClosures(tc);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    UA_NodeStore_iterate(server->nodestore, collectType, tc);
+    if(tc->typesSize != count) {
+        clearTypeClosures(tc);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    tc->valid = true;
+    UA_NodeStore_iterate(server->nodestore, collectSubtypes, tc);
+    if(!tc->valid) {
+        clearTypeClosures(tc);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean
+isSubtypeOf(UA_Server *server, const UA_NodeId *type, const UA_NodeId *superType) {
+    if(UA_NodeId_equal(type, superType))
+        return true;
+
+    UA_TypeClosures *tc = &server->typeClosures;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->typeClosures_mutex);
+#endif
+    UA_Boolean valid = tc->valid ||
+        buildTypeClosures(server, tc) == UA_STATUSCODE_GOOD;
+    UA_Boolean found = false;
+    if(valid) {
+        size_t sub = typeHandle(tc, type);
+        size_t super = typeHandle(tc, superType);
+        if(sub != UA_TYPECLOSURES_NONE && super != UA_TYPECLOSURES_NONE) {
+            if(!tc->numbered)
+                numberTypes(tc);
+            found = inClosure(tc, sub, super);
+        }
+    }
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->typeClosures_mutex);
+#endif
+    if(valid)
+        return found;
+
+    /* Walk the references if the closures cannot be built */
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    return isNodeInTree(server->nodestore, type, superType, &hasSubtype, 1);
+}
+
+/* Returns false if the closures cannot be updated in place */
+static UA_Boolean
+updateTypeClosures(UA_Server *server, UA_TypeClosures *tc, const UA_Node *node,
+                   const UA_NodeId *targetId, UA_Boolean isForward) {
+    const UA_Node *target = UA_NodeStore_get(server->nodestore, targetId);
+    if(!target)
+        return false;
+    if(!isTypeNodeClass(node->nodeClass) || node->nodeClass != target->nodeClass)
+        return true; /* not part of a type hierarchy */
+    size_t source = addType(tc, node);
+    size_t dest = addType(tc, target);
+    if(source == UA_TYPECLOSURES_NONE || dest == UA_TYPECLOSURES_NONE)
+        return false;
+    if(isForward)
+        return addSubtypeEdge(tc, source, dest);
+    return addSubtypeEdge(tc, dest, source);
+}
+
+void
+UA_Server_addSubtypeReference(UA_Server *server, const UA_Node *node,
+                              const UA_NodeId *targetId, UA_Boolean isForward) {
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->typeClosures_mutex);
+#endif
+    UA_TypeClosures *tc = &server->typeClosures;
+    if(tc->valid && !updateTypeClosures(server, tc, node, targetId, isForward))
+        clearTypeClosures(tc);
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->typeClosures_mutex);
+#endif
+}
+
+void
+UA_Server_invalidateTypeClosures(UA_Server *server) {
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->typeClosures_mutex);
+#endif
+    clearTypeClosures(&server->typeClosures);
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->typeClosures_mutex);
+#endif
+}
+
+/********************/
+/* Interned NodeIds */
+/********************/
+
+#define UA_INTERNEDNODEIDS_MINSIZE 64
+
+static UA_InternedNodeId **
+findInternedSlot(UA_InternedNodeId **entries, size_t size,
+                 const UA_NodeId *nodeId, UA_UInt32 hash) {
+    size_t idx = hash & (size - 1);
+    while(entries[idx]) {
+        if(entries[idx]->hash == hash &&
+           UA_NodeId_equal(&entries[idx]->nodeId, nodeId))
+            break;
+        idx = (idx + 1) & (size - 1);
+    }
+    return &entries[idx];
+}
+
+/* Keep the occupancy below 50% */
+static UA_StatusCode
+growInternedNodeIds(UA_Server *server) {
+    size_t nsize = server->internedNodeIdsSize * 2;
+    if(nsize == 0)
+        nsize = UA_INTERNEDNODEIDS_MINSIZE;
+    UA_InternedNodeId **nentries = UA_calloc(nsize, sizeof(UA_InternedNodeId*));
+    if(!nentries)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < server->internedNodeIdsSize; ++i) {
+        UA_InternedNodeId *id = server->internedNodeIds[i];
+        if(id)
+            *findInternedSlot(nentries, nsize, &id->nodeId, id->hash) = id;
+    }
+    UA_free(server->internedNodeIds);
+    server->internedNodeIds = nentries;
+    server->internedNodeIdsSize = nsize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static const UA_InternedNodeId *
+internNodeId(UA_Server *server, const UA_NodeId *nodeId) {
+    if((server->internedNodeIdsCount + 1) * 2 > server->internedNodeIdsSize &&
+       growInternedNodeIds(server) != UA_STATUSCODE_GOOD)
+        return NULL;
+
+    UA_UInt32 hash = UA_NodeId_hash(nodeId);
+    UA_InternedNodeId **slot = findInternedSlot(server->internedNodeIds,
+                                                server->internedNodeIdsSize,
+                                                nodeId, hash);
+    if(*slot) {
+        ++((UA_InternedNode*)*slot)->refCount;
+        return *slot;
+    }
+
+    UA_InternedNode *entry = UA_malloc(sizeof(UA_InternedNode));
+    if(!entry)
+        return NULL;
+    UA_InternedNodeId *id = &entry->id;
+    if(UA_NodeId_copy(nodeId, &id->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_free(entry);
+        return NULL;
+    }
+    id->hash = hash;
+    entry->refCount = 1;
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    LIST_INIT(&entry->watchers);
+#endif
+    *slot = id;
+    ++server->internedNodeIdsCount;
+    return id;
+}
+
+const UA_InternedNodeId *
+UA_Server_findInternedNodeId(UA_Server *server, const UA_NodeId *nodeId) {
+    const UA_InternedNodeId *id = NULL;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->internedNodeIds_mutex);
+#endif
+    if(server->internedNodeIdsCount > 0)
+        id = *findInternedSlot(server->internedNodeIds, server->internedNodeIdsSize,
+                               nodeId, UA_NodeId_hash(nodeId));
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->internedNodeIds_mutex);
+#endif
+    return id;
+}
+
+const UA_InternedNodeId *
+UA_Server_internNodeId(UA_Server *server, const UA_NodeId nodeId) {
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->internedNodeIds_mutex);
+#endif
+    const UA_InternedNodeId *id = internNodeId(server, &nodeId);
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->internedNodeIds_mutex);
+#endif
+    return id;
+}
+
+/* Removes the entry from the table. The following entries of the probe
+ * sequence are shifted back, so no tombstones are needed. */
+static void
+removeInternedSlot(UA_InternedNodeId **entries, size_t size, size_t idx) {
+    size_t next = idx;
+    while(true) {
+        next = (next + 1) & (size - 1);
+        UA_InternedNodeId *id = entries[next];
+        if(!id)
+            break;
+        /* Move the entry unless its home slot lies cyclically in (idx, next] */
+        size_t home = id->hash & (size - 1);
+        if((next > idx && (home <= idx || home > next)) ||
+           (next < idx && home <= idx && home > next)) {
+            entries[idx] = id;
+            idx = next;
+        }
+    }
+    entries[idx] = NULL;
+}
+
+void
+UA_Server_releaseInternedNodeId(UA_Server *server, const UA_InternedNodeId *nodeId) {
+    if(!nodeId)
+        return;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->internedNodeIds_mutex);
+#endif
+    UA_InternedNode *entry = (UA_InternedNode*)(uintptr_t)nodeId;
+    if(--entry->refCount == 0) {
+        UA_InternedNodeId **slot =
+            findInternedSlot(server->internedNodeIds, server->internedNodeIdsSize,
+                             &nodeId->nodeId, nodeId->hash);
+        removeInternedSlot(server->internedNodeIds, server->internedNodeIdsSize,
+                           (size_t)(slot - server->internedNodeIds));
+        --server->internedNodeIdsCount;
+        UA_NodeStore_releaseInterned(server->nodestore, nodeId);
+        UA_NodeId_deleteMembers(&entry->id.nodeId);
+        UA_free(entry);
+    }
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->internedNodeIds_mutex);
+#endif
+}
+
+UA_StatusCode
+UA_Server_reserveNumericNodeIds(UA_Server *server, UA_UInt16 namespaceIndex,
+                                UA_UInt32 first, UA_UInt32 count) {
+    return UA_NodeStore_reserveDense(server->nodestore, namespaceIndex, first, count);
+}
+
+void
+UA_Server_deleteInternedNodeIds(UA_Server *server) {
+    for(size_t i = 0; i < server->internedNodeIdsSize; ++i) {
+        UA_InternedNodeId *id = server->internedNodeIds[i];
+        if(!id)
+            continue;
+        UA_NodeId_deleteMembers(&id->nodeId);
+        UA_free(id);
+    }
+    UA_free(server->internedNodeIds);
+    server->internedNodeIds = NULL;
+    server->internedNodeIdsSize = 0;
+    server->internedNodeIdsCount = 0;
+}
+
+/*********************/
+/* Memory Statistics */
+/*********************/
+
+/* Interned locales and texts shared with the browseName are not counted */
+static size_t
+textSize(const UA_LocalizedText *text, const UA_String *sharedName) {
+    size_t s = 0;
+    if(!UA_Node_isInternedLocale(&text->locale))
+        s += UA_calcSizeFlat(&text->locale, &UA_TYPES[UA_TYPES_STRING]);
+    if(!sharedName || text->text.data != sharedName->data)
+        s += UA_calcSizeFlat(&text->text, &UA_TYPES[UA_TYPES_STRING]);
+    return s;
+}
+
+static void
+countNode(void *context, const UA_Node *node) {
+    UA_MemoryStatistics *stats = (UA_MemoryStatistics*)context;
+    size_t index = 0;
+    while(index < 7 && !(node->nodeClass & (1u << index)))
+        ++index;
+    UA_NodeClassStatistics *s = &stats->nodeClasses[index];
+    ++s->nodes;
+    s->nodeBytes += UA_NodeStore_nodeMemoryUsage(node) +
+        UA_calcSizeFlat(&node->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    s->textBytes += UA_calcSizeFlat(&node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]) +
+        textSize(&node->displayName, &node->browseName.name) +
+        textSize(&node->description, NULL);
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE)
+        s->textBytes += textSize(&((const UA_ReferenceTypeNode*)node)->inverseName, NULL);
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        s->referenceBytes += sizeof(UA_NodeReferenceKind) +
+            UA_calcSizeFlat(&rk->referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]) +
+            rk->targetIdsCapacity * sizeof(UA_NodeId) +
+            rk->remoteTargetIdsSize * sizeof(UA_ExpandedNodeId);
+        for(size_t j = 0; j < rk->targetIdsSize; ++j)
+            s->referenceBytes += UA_calcSizeFlat(&rk->targetIds[j],
+                                                 &UA_TYPES[UA_TYPES_NODEID]);
+        for(size_t j = 0; j < rk->remoteTargetIdsSize; ++j)
+            s->referenceBytes += UA_calcSizeFlat(&rk->remoteTargetIds[j],
+                                                 &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    }
+    if(node->nodeClass == UA_NODECLASS_VARIABLE ||
+       node->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        s->valueBytes += UA_calcSizeFlat(&vn->dataType, &UA_TYPES[UA_TYPES_NODEID]) +
+            vn->arrayDimensionsSize * sizeof(UA_Int32);
+        if(vn->valueSource == UA_VALUESOURCE_DATA)
+            s->valueBytes += UA_calcSizeFlat(getVariableValue(vn),
+                                             &UA_TYPES[UA_TYPES_DATAVALUE]);
+    }
+}
+
+UA_StatusCode
+UA_Server_getMemoryStatistics(UA_Server *server, UA_MemoryStatistics *stats) {
+    memset(stats, 0, sizeof(UA_MemoryStatistics));
+    UA_RCU_LOCK();
+    UA_NodeStore_iterate(server->nodestore, countNode, stats);
+    stats->nodestoreBytes = UA_NodeStore_memoryUsage(server->nodestore);
+    UA_RCU_UNLOCK();
+
+    for(size_t i = 0; i < 8; ++i) {
+        const UA_NodeClassStatistics *s = &stats->nodeClasses[i];
+        stats->total.nodes += s->nodes;
+        stats->total.nodeBytes += s->nodeBytes;
+        stats->total.textBytes += s->textBytes;
+        stats->total.referenceBytes += s->referenceBytes;
+        stats->total.valueBytes += s->valueBytes;
+    }
+
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->internedNodeIds_mutex);
+#endif
+    stats->internedBytes = server->internedNodeIdsSize * sizeof(UA_InternedNodeId*) +
+        UA_Node_internedLocalesSize();
+    for(size_t i = 0; i < server->internedNodeIdsSize; ++i) {
+        const UA_InternedNodeId *id = server->internedNodeIds[i];
+        if(id)
+            stats->internedBytes += sizeof(UA_InternedNode) +
+                UA_calcSizeFlat(&id->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    }
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->internedNodeIds_mutex);
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_getNodeStoreStatistics(UA_Server *server, UA_NodeStoreStatistics *stats) {
+    UA_RCU_LOCK();
+    UA_StatusCode retval = UA_NodeStore_getStatistics(server->nodestore, stats);
+    UA_RCU_UNLOCK();
+    return retval;
+}
+
+/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/server/ua_server_worker.c" ***********************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+*  License, v. 2.0. If a copy of the MPL was not distributed with this
+*  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+
+/**
+ * There are four types of job execution:
+ *
+ * 1. Normal jobs (dispatched to worker threads if multithreading is activated)
+ *
+ * 2. Repeated jobs with a repetition interval (dispatched to worker threads)
+ *
+ * 3. Mainloop jobs are executed (once) from the mainloop and not in the worker threads. The server
+ * contains a stack structure where all threads can add mainloop jobs for the next mainloop
+ * iteration. This is used e.g. to trigger adding and removing repeated jobs without blocking the
+ * mainloop.
+ *
+ * 4. Delayed jobs are executed once in a worker thread. But only when all normal jobs that were
+ * dispatched earlier have been executed. This is achieved by a counter in the worker threads. We
+ * compute from the counter if all previous jobs have finished. The delay can be very long, since we
+ * try to not interfere too much with normal execution. A use case is to eventually free obsolete
+ * structures that _could_ still be accessed from concurrent threads.
+ *
+ * - Remove the entry from the list
+ * - mark it as "dead" with an atomic operation
+ * - add a delayed job that frees the memory when all concurrent operations have completed
+ *
+ * This approach to concurrently accessible memory is known as epoch based reclamation [1]. According to
+ * [2], it performs competitively well on many-core systems. Our version of EBR does however not require
+ * a global epoch. Instead, every worker thread has its own epoch counter that we observe for changes.
+ *
+ * [1] Fraser, K. 2003. Practical lock freedom. Ph.D. thesis. Computer Laboratory, University of Cambridge.
+ * [2] Hart, T. E., McKenney, P. E., Brown, A. D., & Walpole, J. (2007). Performance of memory reclamation
+ *     for lockless synchronization. Journal of Parallel and Distributed Computing, 67(12), 1270-1285.
+ *
+ * Future Plans: Use work-stealing to load-balance between cores.
+ * [3] Le, Nhat Minh, et al. "Correct and efficient work-stealing for weak
+ *     memory models." ACM SIGPLAN Notices. Vol. 48. No. 8. ACM, 2013.
+ */
+
+#define MAXTIMEOUT 50 // max timeout in millisec until the next main loop iteration
+
+/* The tick time is sampled lazily on the first use within a job (per thread) */
+static UA_THREAD_LOCAL UA_Boolean tickTimeActive = false;
+static UA_THREAD_LOCAL UA_DateTime tickTime = 0;
+
+UA_DateTime
+UA_Server_tickTime(void) {
+    if(!tickTimeActive)
+        return UA_DateTime_now();
+    if(tickTime == 0)
+        tickTime = UA_DateTime_nowCoarse();
+    return tickTime;
+}
+
+static void
+processJob(UA_Server *server, UA_Job *job) {
+    UA_ASSERT_RCU_UNLOCKED();
+    UA_RCU_LOCK();
+    tickTimeActive = true;
+    tickTime = 0;
+    switch(job->type) {
+    case UA_JOBTYPE_NOTHING:
+        break;
+    case UA_JOBTYPE_DETACHCONNECTION:
+        UA_Connection_detachSecureChannel(job->job.closeConnection);
+        break;
+    case UA_JOBTYPE_BINARYMESSAGE_NETWORKLAYER:
+        UA_Server_processBinaryMessage(server, job->job.binaryMessage.connection,
+                                       &job->job.binaryMessage.message);
+        UA_Connection *connection = job->job.binaryMessage.connection;
+        connection->releaseRecvBuffer(connection, &job->job.binaryMessage.message);
+        break;
+    case UA_JOBTYPE_BINARYMESSAGE_ALLOCATED:
+        UA_Server_processBinaryMessage(server, job->job.binaryMessage.connection,
+                                       &job->job.binaryMessage.message);
+        UA_ByteString_deleteMembers(&job->job.binaryMessage.message);
+        break;
+    case UA_JOBTYPE_METHODCALL:
+    case UA_JOBTYPE_METHODCALL_DELAYED:
+        job->job.methodCall.method(server, job->job.methodCall.data);
+        break;
+    default:
+        UA_LOG_WARNING(server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Trying to execute a job of unknown type");
+        break;
+    }
+    tickTimeActive = false;
+    UA_RCU_UNLOCK();
 }
 
 /*******************************/
@@ -17975,6 +20162,138 @@ emptyDispatchQueue(UA_Server *server) {
 
 #endif
 
+/****************/
+/* Parallel For */
+/****************/
+
+#define UA_PARALLELFOR_MINCHUNK 64
+
+UA_Boolean
+UA_Server_isParallel(const UA_Server *server, size_t count) {
+#ifdef UA_ENABLE_MULTITHREADING
+    return server->workers && server->config.nThreads > 1 &&
+        server->config.parallelOperationsThreshold > 0 &&
+        count >= server->config.parallelOperationsThreshold &&
+        count >= 2 * UA_PARALLELFOR_MINCHUNK;
+#else
+    return false;
+#endif
+}
+
+#ifdef UA_ENABLE_MULTITHREADING
+
+/* The chunks are claimed from a shared counter by the caller and the jobs
+ * dispatched to the workers. A job that starts after all chunks were claimed
+ * returns right away. The thread that finishes the last chunk wakes up the
+ * caller. The structure is freed by the last of them. */
+typedef struct {
+    UA_ParallelForCallback callback;
+    void *context;
+    size_t count;
+    size_t chunkSize;
+    UA_UInt32 chunks;
+    volatile UA_UInt32 claimed;
+    volatile UA_UInt32 done;
+    volatile UA_UInt32 refCount;
+    pthread_mutex_t finishedMutex;
+    pthread_cond_t finishedCondition;
+    UA_Boolean finished;
+} UA_ParallelFor;
+
+/* Returns false when all chunks are claimed */
+static UA_Boolean
+processChunk(UA_Server *server, UA_ParallelFor *pf) {
+    UA_UInt32 chunk = UA_atomic_add(&pf->claimed, 1) - 1;
+    if(chunk >= pf->chunks)
+        return false;
+    size_t end = ((size_t)chunk + 1) * pf->chunkSize;
+    if(end > pf->count)
+        end = pf->count;
+    for(size_t i = (size_t)chunk * pf->chunkSize; i < end; ++i)
+        pf->callback(server, pf->context, i);
+    if(UA_atomic_add(&pf->done, 1) == pf->chunks) {
+        pthread_mutex_lock(&pf->finishedMutex);
+        pf->finished = true;
+        pthread_cond_signal(&pf->finishedCondition);
+        pthread_mutex_unlock(&pf->finishedMutex);
+    }
+    return true;
+}
+
+static void
+releaseParallelFor(UA_ParallelFor *pf) {
+    if(UA_atomic_add(&pf->refCount, (UA_UInt32)-1) != 0)
+        return;
+    pthread_cond_destroy(&pf->finishedCondition);
+    pthread_mutex_destroy(&pf->finishedMutex);
+    UA_free(pf);
+}
+
+static void
+parallelForJob(UA_Server *server, UA_ParallelFor *pf) {
+    while(processChunk(server, pf)) {}
+    releaseParallelFor(pf);
+}
+
+static UA_StatusCode
+parallelFor(UA_Server *server, size_t count,
+            UA_ParallelForCallback callback, void *context) {
+    UA_ParallelFor *pf = UA_malloc(sizeof(UA_ParallelFor));
+    if(!pf)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    /* About four chunks per thread for the load balancing */
+    size_t threads = (size_t)server->config.nThreads + 1;
+    size_t chunkSize = (count + 4 * threads - 1) / (4 * threads);
+    if(chunkSize < UA_PARALLELFOR_MINCHUNK)
+        chunkSize = UA_PARALLELFOR_MINCHUNK;
+    pf->callback = callback;
+    pf->context = context;
+    pf->count = count;
+    pf->chunkSize = chunkSize;
+    pf->chunks = (UA_UInt32)((count + chunkSize - 1) / chunkSize);
+    pf->claimed = 0;
+    pf->done = 0;
+    pf->finished = false;
+    pthread_mutex_init(&pf->finishedMutex, NULL);
+    pthread_cond_init(&pf->finishedCondition, NULL);
+
+    /* Every job holds a reference. The caller holds one more. */
+    UA_UInt32 jobs = pf->chunks - 1;
+    if(jobs > server->config.nThreads)
+        jobs = server->config.nThreads;
+    pf->refCount = jobs + 1;
+    UA_Job job = {.type = UA_JOBTYPE_METHODCALL,
+                  .job.methodCall = {.method = (UA_ServerCallback)parallelForJob,
+                                     .data = pf} };
+    for(UA_UInt32 i = 0; i < jobs; ++i)
+        dispatchJob(server, &job);
+    pthread_cond_broadcast(&server->dispatchQueue_condition);
+
+    /* Work along and sleep until the workers have finished their chunks */
+    while(processChunk(server, pf)) {}
+    pthread_mutex_lock(&pf->finishedMutex);
+    while(!pf->finished)
+        pthread_cond_wait(&pf->finishedCondition, &pf->finishedMutex);
+    pthread_mutex_unlock(&pf->finishedMutex);
+    releaseParallelFor(pf);
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif
+
+void
+UA_Server_parallelFor(UA_Server *server, size_t count,
+                      UA_ParallelForCallback callback, void *context) {
+#ifdef UA_ENABLE_MULTITHREADING
+    if(UA_Server_isParallel(server, count) &&
+       parallelFor(server, count, callback, context) == UA_STATUSCODE_GOOD)
+        return;
+#endif
+    for(size_t i = 0; i < count; ++i)
+        callback(server, context, i);
+}
+
 /*****************/
 /* Repeated Jobs */
 /*****************/
@@ -18433,6 +20752,7 @@ UA_UInt16 UA_Server_run_iterate(UA_Server *server, UA_Boolean waitInternal) {
     UA_DateTime now = UA_DateTime_nowMonotonic();
     UA_Boolean dispatched = false; /* to wake up worker threads */
     UA_DateTime nextRepeated = processRepeatedJobs(server, now, &dispatched);
+    nextRepeated = UA_Server_processAsyncReads(server, now, nextRepeated);
 
     UA_UInt16 timeout = 0;
     if(waitInternal)
@@ -18483,6 +20803,9 @@ UA_UInt16 UA_Server_run_iterate(UA_Server *server, UA_Boolean waitInternal) {
     if(dispatched)
         pthread_cond_broadcast(&server->dispatchQueue_condition);
 #else
+# ifdef UA_ENABLE_SUBSCRIPTIONS
+    UA_Server_processSampleBatch(server);
+# endif
     processDelayedCallbacks(server);
 #endif
 
@@ -18645,7 +20968,7 @@ UA_SecureChannelManager_open(UA_SecureChannelManager *cm, UA_Connection *conn,
     UA_SecureChannel_init(&entry->channel);
     entry->channel.securityToken.channelId = cm->lastChannelId++;
     entry->channel.securityToken.tokenId = cm->lastTokenId++;
-    entry->channel.securityToken.createdAt = UA_DateTime_now();
+    entry->channel.securityToken.createdAt = UA_Server_tickTime();
     entry->channel.securityToken.revisedLifetime =
         (request->requestedLifetime > cm->server->config.maxSecurityTokenLifetime) ?
         cm->server->config.maxSecurityTokenLifetime : request->requestedLifetime;
@@ -18659,7 +20982,7 @@ UA_SecureChannelManager_open(UA_SecureChannelManager *cm, UA_Connection *conn,
     /* Set the response */
     UA_ByteString_copy(&entry->channel.serverNonce, &response->serverNonce);
     UA_ChannelSecurityToken_copy(&entry->channel.securityToken, &response->securityToken);
-    response->responseHeader.timestamp = UA_DateTime_now();
+    response->responseHeader.timestamp = UA_Server_tickTime();
 
     /* Now overwrite the creation date with the internal monotonic clock */
     entry->channel.securityToken.createdAt = UA_DateTime_nowMonotonic();
@@ -18683,7 +21006,7 @@ UA_SecureChannelManager_renew(UA_SecureChannelManager *cm, UA_Connection *conn,
     if(channel->nextSecurityToken.tokenId == 0) {
         channel->nextSecurityToken.channelId = channel->securityToken.channelId;
         channel->nextSecurityToken.tokenId = cm->lastTokenId++;
-        channel->nextSecurityToken.createdAt = UA_DateTime_now();
+        channel->nextSecurityToken.createdAt = UA_Server_tickTime();
         channel->nextSecurityToken.revisedLifetime =
             (request->requestedLifetime > cm->server->config.maxSecurityTokenLifetime) ?
             cm->server->config.maxSecurityTokenLifetime : request->requestedLifetime;
@@ -18868,16 +21191,343 @@ UA_SessionManager_removeSession(UA_SessionManager *sm, const UA_NodeId *token) {
 *  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
 
+/**************/
+/* Node Texts */
+/**************/
+
+/* Nodes carry many copies of few locales (mostly "en_US"). The locales are
+ * interned in a process-wide arena and never freed. An entry in the arena is
+ * a length byte followed by the characters. When the arena is full, nodes
+ * keep their own copies. Servers in different threads intern into the same
+ * arena. So it is guarded by a spin lock in every build. Entries are never
+ * changed once written. */
+#define UA_NODE_LOCALES_SIZE 1024
+
+static UA_Byte nodeLocales[UA_NODE_LOCALES_SIZE];
+static size_t nodeLocalesUsed;
+static UA_SpinLock nodeLocalesLock = UA_SPINLOCK_INIT;
+
+UA_Boolean
+UA_Node_isInternedLocale(const UA_String *s) {
+    return (uintptr_t)s->data >= (uintptr_t)nodeLocales &&
+        (uintptr_t)s->data < (uintptr_t)&nodeLocales[UA_NODE_LOCALES_SIZE];
+}
+
+static UA_Byte *
+findLocale(const UA_String *s) {
+    size_t pos = 0;
+    while(pos < nodeLocalesUsed) {
+        size_t len = nodeLocales[pos];
+        if(len == s->length && memcmp(&nodeLocales[pos + 1], s->data, len) == 0)
+            return &nodeLocales[pos + 1];
+        pos += len + 1;
+    }
+    return NULL;
+}
+
+static void
+internLocale(UA_String *locale) {
+    if(locale->length == 0 || locale->length > UA_BYTE_MAX || UA_Node_isInternedLocale(locale))
+        return;
+    UA_SpinLock_lock(&nodeLocalesLock);
+    UA_Byte *interned = findLocale(locale);
+    if(!interned && nodeLocalesUsed + 1 + locale->length <= UA_NODE_LOCALES_SIZE) {
+        nodeLocales[nodeLocalesUsed] = (UA_Byte)locale->length;
+        interned = &nodeLocales[nodeLocalesUsed + 1];
+        memcpy(interned, locale->data, locale->length);
+        nodeLocalesUsed += 1 + locale->length;
+    }
+    UA_SpinLock_unlock(&nodeLocalesLock);
+    if(!interned)
+        return;
+    UA_free(locale->data);
+    locale->data = interned;
+}
+
+size_t
+UA_Node_internedLocalesSize(void) {
+    UA_SpinLock_lock(&nodeLocalesLock);
+    size_t used = nodeLocalesUsed;
+    UA_SpinLock_unlock(&nodeLocalesLock);
+    return used;
+}
+
+/* The displayName text is shared with the browseName if both are equal. This
+ * is the case for most nodes. */
+void
+UA_Node_internTexts(UA_Node *node) {
+    internLocale(&node->displayName.locale);
+    internLocale(&node->description.locale);
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE)
+        internLocale(&((UA_ReferenceTypeNode*)node)->inverseName.locale);
+    UA_String *text = &node->displayName.text;
+    const UA_String *name = &node->browseName.name;
+    if(text->length > 0 && text->data != name->data && UA_String_equal(text, name)) {
+        UA_free(text->data);
+        text->data = name->data;
+    }
+}
+
+/* The interned locale and a text shared with the name are not freed */
+static void
+deleteNodeText(UA_LocalizedText *text, const UA_String *name) {
+    if(UA_Node_isInternedLocale(&text->locale))
+        UA_String_init(&text->locale);
+    if(name && text->text.data == name->data)
+        UA_String_init(&text->text);
+    UA_LocalizedText_deleteMembers(text);
+}
+
+static UA_StatusCode
+copyNodeText(const UA_LocalizedText *src, UA_LocalizedText *dst,
+             const UA_String *srcName, const UA_String *dstName) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(UA_Node_isInternedLocale(&src->locale))
+        dst->locale = src->locale;
+    else
+        retval |= UA_String_copy(&src->locale, &dst->locale);
+    if(srcName && src->text.length > 0 && src->text.data == srcName->data)
+        dst->text = *dstName;
+    else
+        retval |= UA_String_copy(&src->text, &dst->text);
+    return retval;
+}
+
+UA_StatusCode
+UA_Node_setBrowseName(UA_Node *node, const UA_QualifiedName *name) {
+    UA_QualifiedName copy;
+    UA_StatusCode retval = UA_QualifiedName_copy(name, &copy);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    /* The displayName takes over a shared buffer */
+    if(node->displayName.text.data == node->browseName.name.data)
+        UA_String_init(&node->browseName.name);
+    UA_QualifiedName_deleteMembers(&node->browseName);
+    node->browseName = copy;
+    UA_Node_internTexts(node);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Node_setText(UA_Node *node, UA_LocalizedText *text, const UA_LocalizedText *value) {
+    UA_LocalizedText copy;
+    UA_StatusCode retval = UA_LocalizedText_copy(value, &copy);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    deleteNodeText(text, (text == &node->displayName) ? &node->browseName.name : NULL);
+    *text = copy;
+    UA_Node_internTexts(node);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*******************/
+/* Node References */
+/*******************/
+
+const UA_NodeReferenceKind *
+UA_Node_findReferenceKind(const UA_Node *node, const UA_NodeId *referenceTypeId,
+                          UA_Boolean isInverse) {
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse == isInverse &&
+           UA_NodeId_equal(&rk->referenceTypeId, referenceTypeId))
+            return rk;
+    }
+    return NULL;
+}
+
+size_t
+UA_Node_referencesCount(const UA_Node *node) {
+    size_t count = 0;
+    for(size_t i = 0; i < node->referencesSize; ++i)
+        count += node->references[i].targetIdsSize +
+            node->references[i].remoteTargetIdsSize;
+    return count;
+}
+
+static UA_StatusCode
+addRemoteReferenceTarget(UA_NodeReferenceKind *rk, const UA_ExpandedNodeId *targetId) {
+    UA_ExpandedNodeId *targets =
+        UA_realloc(rk->remoteTargetIds,
+                   sizeof(UA_ExpandedNodeId) * (rk->remoteTargetIdsSize + 1));
+    if(!targets)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    rk->remoteTargetIds = targets;
+    UA_StatusCode retval = UA_ExpandedNodeId_copy(targetId, &targets[rk->remoteTargetIdsSize]);
+    if(retval == UA_STATUSCODE_GOOD)
+        ++rk->remoteTargetIdsSize;
+    return retval;
+}
+
+/* Doubles the capacity of the target array when it is full. Most kinds hold a
+ * single target, so the array starts with room for one. */
+static UA_StatusCode
+addReferenceTarget(UA_NodeReferenceKind *rk, const UA_ExpandedNodeId *targetId) {
+    if(targetId->serverIndex != 0 || targetId->namespaceUri.length > 0)
+        return addRemoteReferenceTarget(rk, targetId);
+    if(rk->targetIdsSize >= rk->targetIdsCapacity) {
+        size_t capacity = rk->targetIdsCapacity * 2;
+        if(capacity == 0)
+            capacity = 1;
+        UA_NodeId *targets = UA_realloc(rk->targetIds, sizeof(UA_NodeId) * capacity);
+        if(!targets)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        rk->targetIds = targets;
+        rk->targetIdsCapacity = capacity;
+    }
+    UA_StatusCode retval = UA_NodeId_copy(&targetId->nodeId, &rk->targetIds[rk->targetIdsSize]);
+    if(retval == UA_STATUSCODE_GOOD)
+        ++rk->targetIdsSize;
+    return retval;
+}
+
+static UA_StatusCode
+addReferenceKind(UA_Node *node, const UA_NodeId *referenceTypeId,
+                 UA_Boolean isInverse, const UA_ExpandedNodeId *targetId) {
+    UA_NodeReferenceKind *refs =
+        UA_realloc(node->references, sizeof(UA_NodeReferenceKind) * (node->referencesSize + 1));
+    if(!refs)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    node->references = refs;
+    UA_NodeReferenceKind *rk = &refs[node->referencesSize];
+    memset(rk, 0, sizeof(UA_NodeReferenceKind));
+    rk->isInverse = isInverse;
+    UA_StatusCode retval = UA_NodeId_copy(referenceTypeId, &rk->referenceTypeId);
+    retval |= addReferenceTarget(rk, targetId);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeId_deleteMembers(&rk->referenceTypeId);
+        UA_free(rk->targetIds);
+        UA_free(rk->remoteTargetIds);
+        return retval;
+    }
+    ++node->referencesSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Node_addReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                     UA_Boolean isInverse, const UA_ExpandedNodeId *targetId) {
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse == isInverse &&
+           UA_NodeId_equal(&rk->referenceTypeId, referenceTypeId))
+            return addReferenceTarget(rk, targetId);
+    }
+    return addReferenceKind(node, referenceTypeId, isInverse, targetId);
+}
+
+UA_StatusCode
+UA_Node_deleteReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                        UA_Boolean isInverse, const UA_NodeId *targetId) {
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse != isInverse ||
+           !UA_NodeId_equal(&rk->referenceTypeId, referenceTypeId))
+            continue;
+        /* Keep the order of the remaining targets */
+        UA_Boolean found = false;
+        for(size_t j = 0; j < rk->targetIdsSize; ++j) {
+            if(!UA_NodeId_equal(&rk->targetIds[j], targetId))
+                continue;
+            UA_NodeId_deleteMembers(&rk->targetIds[j]);
+            --rk->targetIdsSize;
+            memmove(&rk->targetIds[j], &rk->targetIds[j+1],
+                    sizeof(UA_NodeId) * (rk->targetIdsSize - j));
+            found = true;
+            break;
+        }
+        for(size_t j = 0; !found && j < rk->remoteTargetIdsSize; ++j) {
+            if(!UA_NodeId_equal(&rk->remoteTargetIds[j].nodeId, targetId))
+                continue;
+            UA_ExpandedNodeId_deleteMembers(&rk->remoteTargetIds[j]);
+            --rk->remoteTargetIdsSize;
+            memmove(&rk->remoteTargetIds[j], &rk->remoteTargetIds[j+1],
+                    sizeof(UA_ExpandedNodeId) * (rk->remoteTargetIdsSize - j));
+            found = true;
+        }
+        if(!found)
+            break;
+        if(rk->targetIdsSize > 0 || rk->remoteTargetIdsSize > 0)
+            return UA_STATUSCODE_GOOD;
+
+        /* The kind is empty */
+        UA_free(rk->targetIds);
+        UA_free(rk->remoteTargetIds);
+        UA_NodeId_deleteMembers(&rk->referenceTypeId);
+        --node->referencesSize;
+        memmove(rk, rk + 1, sizeof(UA_NodeReferenceKind) * (node->referencesSize - i));
+        if(node->referencesSize == 0) {
+            UA_free(node->references);
+            node->references = NULL;
+        }
+        return UA_STATUSCODE_GOOD;
+    }
+    return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
+}
+
+void
+UA_Node_deleteReferences(UA_Node *node) {
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        UA_Array_delete(rk->targetIds, rk->targetIdsSize, &UA_TYPES[UA_TYPES_NODEID]);
+        UA_Array_delete(rk->remoteTargetIds, rk->remoteTargetIdsSize,
+                        &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+        UA_NodeId_deleteMembers(&rk->referenceTypeId);
+    }
+    UA_free(node->references);
+    node->references = NULL;
+    node->referencesSize = 0;
+}
+
+UA_StatusCode
+UA_Node_copyReferences(const UA_Node *src, UA_Node *dst) {
+    if(src->referencesSize == 0)
+        return UA_STATUSCODE_GOOD;
+    dst->references = UA_calloc(src->referencesSize, sizeof(UA_NodeReferenceKind));
+    if(!dst->references)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    dst->referencesSize = src->referencesSize;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < src->referencesSize; ++i) {
+        const UA_NodeReferenceKind *srefs = &src->references[i];
+        UA_NodeReferenceKind *drefs = &dst->references[i];
+        drefs->isInverse = srefs->isInverse;
+        retval |= UA_NodeId_copy(&srefs->referenceTypeId, &drefs->referenceTypeId);
+        /* Empty arrays stay NULL (and not the sentinel) to be realloced */
+        if(retval == UA_STATUSCODE_GOOD && srefs->targetIdsSize > 0) {
+            retval = UA_Array_copy(srefs->targetIds, srefs->targetIdsSize,
+                                   (void**)&drefs->targetIds, &UA_TYPES[UA_TYPES_NODEID]);
+            if(retval == UA_STATUSCODE_GOOD) {
+                drefs->targetIdsSize = srefs->targetIdsSize;
+                drefs->targetIdsCapacity = srefs->targetIdsSize;
+            }
+        }
+        if(retval == UA_STATUSCODE_GOOD && srefs->remoteTargetIdsSize > 0) {
+            retval = UA_Array_copy(srefs->remoteTargetIds, srefs->remoteTargetIdsSize,
+                                   (void**)&drefs->remoteTargetIds,
+                                   &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+            if(retval == UA_STATUSCODE_GOOD)
+                drefs->remoteTargetIdsSize = srefs->remoteTargetIdsSize;
+        }
+        if(retval != UA_STATUSCODE_GOOD)
+            break;
+    }
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_Node_deleteReferences(dst);
+    return retval;
+}
+
+/******************/
+/* Node Lifecycle */
+/******************/
+
 void UA_Node_deleteMembersAnyNodeClass(UA_Node *node) {
     /* delete standard content */
     UA_NodeId_deleteMembers(&node->nodeId);
+    deleteNodeText(&node->displayName, &node->browseName.name);
+    deleteNodeText(&node->description, NULL);
     UA_QualifiedName_deleteMembers(&node->browseName);
-    UA_LocalizedText_deleteMembers(&node->displayName);
-    UA_LocalizedText_deleteMembers(&node->description);
-    UA_Array_delete(node->references, node->referencesSize,
-                    &UA_TYPES[UA_TYPES_REFERENCENODE]);
-    node->references = NULL;
-    node->referencesSize = 0;
+    UA_Node_deleteReferences(node);
 
     /* delete unique content of the nodeclass */
     switch(node->nodeClass) {
@@ -18895,13 +21545,19 @@ void UA_Node_deleteMembersAnyNodeClass(UA_Node *node) {
                         &UA_TYPES[UA_TYPES_INT32]);
         p->arrayDimensions = NULL;
         p->arrayDimensionsSize = 0;
-        if(p->valueSource == UA_VALUESOURCE_DATA)
+        if(p->valueSource == UA_VALUESOURCE_DATA) {
             UA_DataValue_deleteMembers(&p->value.data.value);
+#ifdef UA_ENABLE_MULTITHREADING
+            if(p->value.data.slot)
+                UA_ValueSlot_release(p->value.data.slot);
+            p->value.data.slot = NULL;
+#endif
+        }
         break;
     }
     case UA_NODECLASS_REFERENCETYPE: {
         UA_ReferenceTypeNode *p = (UA_ReferenceTypeNode*)node;
-        UA_LocalizedText_deleteMembers(&p->inverseName);
+        deleteNodeText(&p->inverseName, NULL);
         break;
     }
     case UA_NODECLASS_DATATYPE:
@@ -18933,14 +21589,38 @@ UA_CommonVariableNode_copy(const UA_VariableNode *src, UA_VariableNode *dst) {
     dst->valueRank = src->valueRank;
     dst->valueSource = src->valueSource;
     if(src->valueSource == UA_VALUESOURCE_DATA) {
-        retval |= UA_DataValue_copy(&src->value.data.value,
-                                    &dst->value.data.value);
+        retval |= UA_DataValue_copyShared(&src->value.data.value,
+                                          &dst->value.data.value);
         dst->value.data.callback = src->value.data.callback;
+#ifdef UA_ENABLE_MULTITHREADING
+        /* All versions of the node share the value slot */
+        dst->value.data.slot = src->value.data.slot;
+        if(dst->value.data.slot)
+            UA_atomic_add(&dst->value.data.slot->refCount, 1);
+#endif
     } else
         dst->value.dataSource = src->value.dataSource;
     return retval;
 }
 
+#ifdef UA_ENABLE_MULTITHREADING
+void
+UA_PublishedValue_delete(UA_PublishedValue *pv) {
+    UA_DataValue_deleteMembers(&pv->value);
+    UA_free(pv);
+}
+
+/* The last node version is deleted after the RCU grace period. So the current
+ * value is no longer in use. */
+void
+UA_ValueSlot_release(UA_ValueSlot *slot) {
+    if(UA_atomic_add(&slot->refCount, (uint32_t)-1) > 0)
+        return;
+    UA_PublishedValue_delete(slot->current);
+    UA_free(slot);
+}
+#endif
+
 static UA_StatusCode
 UA_VariableNode_copy(const UA_VariableNode *src, UA_VariableNode *dst) {
     UA_StatusCode retval = UA_CommonVariableNode_copy(src, dst);
@@ -18979,8 +21659,8 @@ UA_ObjectTypeNode_copy(const UA_ObjectTypeNode *src, UA_ObjectTypeNode *dst) {
 static UA_StatusCode
 UA_ReferenceTypeNode_copy(const UA_ReferenceTypeNode *src,
                           UA_ReferenceTypeNode *dst) {
-    UA_StatusCode retval = UA_LocalizedText_copy(&src->inverseName,
-                                                 &dst->inverseName);
+    UA_StatusCode retval = copyNodeText(&src->inverseName, &dst->inverseName,
+                                        NULL, NULL);
     dst->isAbstract = src->isAbstract;
     dst->symmetric = src->symmetric;
     return retval;
@@ -19007,22 +21687,20 @@ UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst) {
     UA_StatusCode retval = UA_NodeId_copy(&src->nodeId, &dst->nodeId);
     dst->nodeClass = src->nodeClass;
     retval |= UA_QualifiedName_copy(&src->browseName, &dst->browseName);
-    retval |= UA_LocalizedText_copy(&src->displayName, &dst->displayName);
-    retval |= UA_LocalizedText_copy(&src->description, &dst->description);
+    retval |= copyNodeText(&src->displayName, &dst->displayName,
+                           &src->browseName.name, &dst->browseName.name);
+    retval |= copyNodeText(&src->description, &dst->description, NULL, NULL);
     dst->writeMask = src->writeMask;
     dst->userWriteMask = src->userWriteMask;
     if(retval != UA_STATUSCODE_GOOD) {
         UA_Node_deleteMembersAnyNodeClass(dst);
         return retval;
     }
-    retval |= UA_Array_copy(src->references, src->referencesSize,
-                            (void**)&dst->references,
-                            &UA_TYPES[UA_TYPES_REFERENCENODE]);
+    retval = UA_Node_copyReferences(src, dst);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_Node_deleteMembersAnyNodeClass(dst);
         return retval;
     }
-    dst->referencesSize = src->referencesSize;
 
     /* copy unique content of the nodeclass */
     switch(src->nodeClass) {
@@ -19080,16 +21758,53 @@ UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst) {
 
 typedef struct UA_NodeStoreEntry {
     struct UA_NodeStoreEntry *orig; // the version this is a copy from (or NULL)
+    UA_UInt32 hash; // cached hash of the nodeid
+    const UA_InternedNodeId *interned; // the handle the node was looked up with (or NULL)
+    UA_Boolean shared; // the node is shared read-only with other nodestores
     UA_Node node;
 } UA_NodeStoreEntry;
 
 #define UA_NODESTORE_TOMBSTONE ((UA_NodeStoreEntry*)0x01)
 
-struct UA_NodeStore {
+/* The slots keep the hash and a compact key of the NodeId next to the entry
+ * pointer. Most mismatches during probing are rejected without dereferencing
+ * the entry. Numeric NodeIds are matched entirely from the slot. */
+typedef struct {
+    UA_NodeStoreEntry *entry; /* NULL (empty), tombstone or the entry */
+    UA_UInt32 hash;
+    UA_UInt32 numeric;        /* numeric identifier or 0 */
+    UA_UInt16 namespaceIndex;
+    UA_Byte identifierType;
+} UA_NodeStoreSlot;
+
+/* Dense numeric NodeIds of a namespace are stored in an array indexed by the
+ * identifier. The range is either reserved or grows automatically while at
+ * least a quarter of it is used. Numeric NodeIds outside the range are kept in
+ * the hash table. */
+#define UA_NODESTORE_DENSE_MINSIZE 64
+
+typedef struct {
     UA_NodeStoreEntry **entries;
+    UA_UInt32 first; /* numeric identifier of entries[0] */
+    UA_UInt32 size;
+    UA_UInt32 count;
+} UA_NodeStoreDense;
+
+struct UA_NodeStore {
+    UA_NodeStoreSlot *slots;
     UA_UInt32 size;
     UA_UInt32 count;
+    UA_UInt32 tombstones;
     UA_UInt32 sizePrimeIndex;
+
+    /* The previous table during a resize (or NULL) */
+    UA_NodeStoreSlot *oldSlots;
+    UA_UInt32 oldSize;
+    UA_UInt32 oldCount;
+    UA_UInt32 migrated; /* the slots before were moved to the new table */
+
+    UA_NodeStoreDense *dense; /* indexed by the namespace */
+    size_t denseSize;
 };
 
 /* The size of the hash-map is always a prime number. They are chosen to be
@@ -19119,37 +21834,37 @@ higher_prime_index(UA_UInt32 n) {
     return low;
 }
 
-static UA_NodeStoreEntry *
-instantiateEntry(UA_NodeClass nodeClass) {
+/* Size of the entry for a node of the nodeclass or zero for an unknown class */
+static size_t
+entrySize(UA_NodeClass nodeClass) {
     size_t size = sizeof(UA_NodeStoreEntry) - sizeof(UA_Node);
     switch(nodeClass) {
     case UA_NODECLASS_OBJECT:
-        size += sizeof(UA_ObjectNode);
-        break;
+        return size + sizeof(UA_ObjectNode);
     case UA_NODECLASS_VARIABLE:
-        size += sizeof(UA_VariableNode);
-        break;
+        return size + sizeof(UA_VariableNode);
     case UA_NODECLASS_METHOD:
-        size += sizeof(UA_MethodNode);
-        break;
+        return size + sizeof(UA_MethodNode);
     case UA_NODECLASS_OBJECTTYPE:
-        size += sizeof(UA_ObjectTypeNode);
-        break;
+        return size + sizeof(UA_ObjectTypeNode);
     case UA_NODECLASS_VARIABLETYPE:
-        size += sizeof(UA_VariableTypeNode);
-        break;
+        return size + sizeof(UA_VariableTypeNode);
     case UA_NODECLASS_REFERENCETYPE:
-        size += sizeof(UA_ReferenceTypeNode);
-        break;
+        return size + sizeof(UA_ReferenceTypeNode);
     case UA_NODECLASS_DATATYPE:
-        size += sizeof(UA_DataTypeNode);
-        break;
+        return size + sizeof(UA_DataTypeNode);
     case UA_NODECLASS_VIEW:
-        size += sizeof(UA_ViewNode);
-        break;
+        return size + sizeof(UA_ViewNode);
     default:
-        return NULL;
+        return 0;
     }
+}
+
+static UA_NodeStoreEntry *
+instantiateEntry(UA_NodeClass nodeClass) {
+    size_t size = entrySize(nodeClass);
+    if(size == 0)
+        return NULL;
     UA_NodeStoreEntry *entry = UA_calloc(1, size);
     if(!entry)
         return NULL;
@@ -19163,21 +21878,51 @@ deleteEntry(UA_NodeStoreEntry *entry) {
     UA_free(entry);
 }
 
-/* returns slot of a valid node or null */
-static UA_NodeStoreEntry **
-findNode(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_UInt32 h = UA_NodeId_hash(nodeid);
-    UA_UInt32 size = ns->size;
+/* Shared entries are freed with UA_NodeStore_deleteShared */
+static void
+releaseEntry(UA_NodeStoreEntry *entry) {
+    if(!entry->shared)
+        deleteEntry(entry);
+}
+
+static void
+setSlot(UA_NodeStoreSlot *slot, UA_NodeStoreEntry *entry) {
+    const UA_NodeId *id = &entry->node.nodeId;
+    slot->entry = entry;
+    slot->hash = entry->hash;
+    slot->namespaceIndex = id->namespaceIndex;
+    slot->identifierType = (UA_Byte)id->identifierType;
+    slot->numeric = 0;
+    if(id->identifierType == UA_NODEIDTYPE_NUMERIC)
+        slot->numeric = id->identifier.numeric;
+}
+
+/* Compare with the slot. The entry is only dereferenced if the hash and the
+ * compact key match for a non-numeric NodeId. */
+static UA_Boolean
+slotMatches(const UA_NodeStoreSlot *slot, const UA_NodeId *nodeid, UA_UInt32 h) {
+    if(slot->entry <= UA_NODESTORE_TOMBSTONE || slot->hash != h ||
+       slot->namespaceIndex != nodeid->namespaceIndex ||
+       slot->identifierType != nodeid->identifierType)
+        return false;
+    if(nodeid->identifierType == UA_NODEIDTYPE_NUMERIC)
+        return slot->numeric == nodeid->identifier.numeric;
+    return UA_NodeId_equal(&slot->entry->node.nodeId, nodeid);
+}
+
+/* returns slot of a valid node in the table or null */
+static UA_NodeStoreSlot *
+findInTable(UA_NodeStoreSlot *slots, UA_UInt32 size,
+            const UA_NodeId *nodeid, UA_UInt32 h) {
     UA_UInt32 idx = mod(h, size);
     UA_UInt32 hash2 = mod2(h, size);
 
     while(true) {
-        UA_NodeStoreEntry *e = ns->entries[idx];
-        if(!e)
+        UA_NodeStoreSlot *slot = &slots[idx];
+        if(!slot->entry)
             return NULL;
-        if(e > UA_NODESTORE_TOMBSTONE &&
-           UA_NodeId_equal(&e->node.nodeId, nodeid))
-            return &ns->entries[idx];
+        if(slotMatches(slot, nodeid, h))
+            return slot;
         idx += hash2;
         if(idx >= size)
             idx -= size;
@@ -19187,21 +21932,98 @@ findNode(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
     return NULL;
 }
 
-/* returns an empty slot or null if the nodeid exists */
+/* returns slot of a valid node or null. During a resize, the entries not yet
+ * moved are found in the old table. */
+static UA_NodeStoreSlot *
+findNode(const UA_NodeStore *ns, const UA_NodeId *nodeid, UA_UInt32 h) {
+    UA_NodeStoreSlot *slot = findInTable(ns->slots, ns->size, nodeid, h);
+    if(!slot && ns->oldSlots)
+        slot = findInTable(ns->oldSlots, ns->oldSize, nodeid, h);
+    return slot;
+}
+
+/* Returns the position in the dense array or NULL if the NodeId is not numeric
+ * or outside of the dense range. The position may be empty. Then the NodeId
+ * might still be in the hash table (from before the range was extended). */
 static UA_NodeStoreEntry **
-findSlot(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_UInt32 h = UA_NodeId_hash(nodeid);
-    UA_UInt32 size = ns->size;
+findDense(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    if(nodeid->identifierType != UA_NODEIDTYPE_NUMERIC ||
+       nodeid->namespaceIndex >= ns->denseSize)
+        return NULL;
+    const UA_NodeStoreDense *d = &ns->dense[nodeid->namespaceIndex];
+    UA_UInt32 offset = nodeid->identifier.numeric - d->first; /* wraps around */
+    if(offset >= d->size)
+        return NULL;
+    return &d->entries[offset];
+}
+
+static UA_NodeStoreEntry *
+findEntry(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreEntry **pos = findDense(ns, nodeid);
+    if(pos && *pos)
+        return *pos;
+    UA_NodeStoreSlot *slot = findNode(ns, nodeid, UA_NodeId_hash(nodeid));
+    if(!slot)
+        return NULL;
+    return slot->entry;
+}
+
+/* Interned nodeids are compared by the pointer once the node was found */
+static UA_NodeStoreEntry *
+findInternedInTable(UA_NodeStoreSlot *slots, UA_UInt32 size,
+                    const UA_InternedNodeId *id) {
+    UA_UInt32 idx = mod(id->hash, size);
+    UA_UInt32 hash2 = mod2(id->hash, size);
+
+    while(true) {
+        UA_NodeStoreSlot *slot = &slots[idx];
+        UA_NodeStoreEntry *e = slot->entry;
+        if(!e)
+            return NULL;
+        if(e > UA_NODESTORE_TOMBSTONE && slot->hash == id->hash) {
+            if(e->interned == id)
+                return e;
+            if(UA_NodeId_equal(&e->node.nodeId, &id->nodeId)) {
+                if(!e->shared)
+                    e->interned = id;
+                return e;
+            }
+        }
+        idx += hash2;
+        if(idx >= size)
+            idx -= size;
+    }
+
+    /* NOTREACHED */
+    return NULL;
+}
+
+static UA_NodeStoreEntry *
+findInterned(const UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    if(id->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        UA_NodeStoreEntry **pos = findDense(ns, &id->nodeId);
+        if(pos && *pos)
+            return *pos;
+        UA_NodeStoreSlot *slot = findNode(ns, &id->nodeId, id->hash);
+        return slot ? slot->entry : NULL;
+    }
+    UA_NodeStoreEntry *e = findInternedInTable(ns->slots, ns->size, id);
+    if(!e && ns->oldSlots)
+        e = findInternedInTable(ns->oldSlots, ns->oldSize, id);
+    return e;
+}
+
+/* Returns the first empty slot or tombstone in the probe sequence. The
+ * NodeId must not be in the table. */
+static UA_NodeStoreSlot *
+findFreeSlot(UA_NodeStoreSlot *slots, UA_UInt32 size, UA_UInt32 h) {
     UA_UInt32 idx = mod(h, size);
     UA_UInt32 hash2 = mod2(h, size);
 
     while(true) {
-        UA_NodeStoreEntry *e = ns->entries[idx];
-        if(e > UA_NODESTORE_TOMBSTONE &&
-           UA_NodeId_equal(&e->node.nodeId, nodeid))
-            return NULL;
-        if(ns->entries[idx] <= UA_NODESTORE_TOMBSTONE)
-            return &ns->entries[idx];
+        UA_NodeStoreSlot *slot = &slots[idx];
+        if(slot->entry <= UA_NODESTORE_TOMBSTONE)
+            return slot;
         idx += hash2;
         if(idx >= size)
             idx -= size;
@@ -19211,45 +22033,226 @@ findSlot(const UA_NodeStore *ns, const UA_NodeId *nodeid) {
     return NULL;
 }
 
-/* The occupancy of the table after the call will be about 50% */
-static UA_StatusCode
-expand(UA_NodeStore *ns) {
-    UA_UInt32 osize = ns->size;
-    UA_UInt32 count = ns->count;
-    /* Resize only when table after removal of unused elements is either too
-       full or too empty */
-    if(count * 2 < osize && (count * 8 > osize || osize <= UA_NODESTORE_MINSIZE))
-        return UA_STATUSCODE_GOOD;
+/* Put an entry into the current table. The load factor is checked before. */
+static void
+placeEntry(UA_NodeStore *ns, UA_NodeStoreEntry *entry) {
+    UA_NodeStoreSlot *slot = findFreeSlot(ns->slots, ns->size, entry->hash);
+    if(slot->entry == UA_NODESTORE_TOMBSTONE)
+        --ns->tombstones;
+    setSlot(slot, entry);
+    ++ns->count;
+}
+
+/*************************/
+/* Incremental Resizing  */
+/*************************/
+
+/* A resize allocates the new table and moves the entries of the old table
+ * over the following inserts and removals, UA_NODESTORE_MIGRATESLOTS slots of
+ * the old table at a time. So no single operation rehashes all entries. The
+ * moved entries leave a tombstone behind. The probe sequences of the entries
+ * remaining in the old table are not interrupted. */
+#define UA_NODESTORE_MIGRATESLOTS 64
+
+static void
+migrateSlots(UA_NodeStore *ns, UA_UInt32 slots) {
+    if(!ns->oldSlots)
+        return;
+    UA_UInt32 end = ns->migrated + slots;
+    if(end > ns->oldSize || end < ns->migrated)
+        end = ns->oldSize;
+    for(; ns->migrated < end && ns->oldCount > 0; ++ns->migrated) {
+        UA_NodeStoreSlot *slot = &ns->oldSlots[ns->migrated];
+        if(slot->entry <= UA_NODESTORE_TOMBSTONE)
+            continue;
+        UA_NodeStoreSlot *nslot = findFreeSlot(ns->slots, ns->size, slot->hash);
+        if(nslot->entry == UA_NODESTORE_TOMBSTONE)
+            --ns->tombstones;
+        *nslot = *slot;
+        ++ns->count;
+        slot->entry = UA_NODESTORE_TOMBSTONE;
+        --ns->oldCount;
+    }
+    if(ns->oldCount > 0)
+        return;
+
+    /* All entries are moved */
+    UA_free(ns->oldSlots);
+    ns->oldSlots = NULL;
+    ns->oldSize = 0;
+    ns->migrated = 0;
+}
 
-    UA_NodeStoreEntry **oentries = ns->entries;
-    UA_UInt32 nindex = higher_prime_index(count * 2);
+/* Start moving the entries to a new table with the size primes[nindex]. A
+ * resize in progress is completed first. */
+static UA_StatusCode
+startResize(UA_NodeStore *ns, UA_UInt16 nindex) {
+    migrateSlots(ns, UA_UINT32_MAX);
     UA_UInt32 nsize = primes[nindex];
-    UA_NodeStoreEntry **nentries = UA_calloc(nsize, sizeof(UA_NodeStoreEntry*));
-    if(!nentries)
+    UA_NodeStoreSlot *nslots = UA_calloc(nsize, sizeof(UA_NodeStoreSlot));
+    if(!nslots)
         return UA_STATUSCODE_BADOUTOFMEMORY;
 
-    ns->entries = nentries;
+    ns->oldSlots = ns->slots;
+    ns->oldSize = ns->size;
+    ns->oldCount = ns->count;
+    ns->migrated = 0;
+    ns->slots = nslots;
     ns->size = nsize;
+    ns->count = 0;
+    ns->tombstones = 0;
     ns->sizePrimeIndex = nindex;
-
-    /* recompute the position of every entry and insert the pointer */
-    for(size_t i = 0, j = 0; i < osize && j < count; ++i) {
-        if(oentries[i] <= UA_NODESTORE_TOMBSTONE)
-            continue;
-        UA_NodeStoreEntry **e = findSlot(ns, &oentries[i]->node.nodeId);
-        UA_assert(e);
-        *e = oentries[i];
-        ++j;
+    if(ns->oldCount == 0) {
+        UA_free(ns->oldSlots);
+        ns->oldSlots = NULL;
+        ns->oldSize = 0;
     }
-
-    UA_free(oentries);
     return UA_STATUSCODE_GOOD;
 }
 
+/* The table is resized when the entries and tombstones (including the entries
+ * still to be moved from the old table) fill 3/4 of the slots. The new size
+ * gives an occupancy of about 50%. If the entries alone would not fill the
+ * table, the new table has the same size and only the tombstones are removed.
+ * A resize that has not completed is finished first. This happens only if the
+ * table fills up while the entries are moved. */
+static UA_StatusCode
+growIfFull(UA_NodeStore *ns) {
+    UA_UInt64 used = (UA_UInt64)ns->count + ns->oldCount + ns->tombstones + 1;
+    if(used * 4 < (UA_UInt64)ns->size * 3)
+        return UA_STATUSCODE_GOOD;
+    UA_UInt64 nodes = ((UA_UInt64)ns->count + ns->oldCount + 1) * 2;
+    if(nodes < UA_NODESTORE_MINSIZE)
+        nodes = UA_NODESTORE_MINSIZE;
+    if(nodes > primes[sizeof(primes) / sizeof(UA_UInt32) - 1])
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    return startResize(ns, higher_prime_index((UA_UInt32)nodes));
+}
+
+/* Shrink the table when less than 1/8 of the slots is used. Rebuild the
+ * table when a quarter of the slots are tombstones. They lengthen the probe
+ * sequences of lookups for missing NodeIds. Not during a resize. */
+static void
+cleanupAfterRemove(UA_NodeStore *ns) {
+    if(ns->oldSlots)
+        return;
+    if((ns->size <= UA_NODESTORE_MINSIZE || ns->count * 8 >= ns->size) &&
+       ns->tombstones * 4 < ns->size)
+        return;
+    UA_UInt32 nodes = ns->count * 2;
+    if(nodes < UA_NODESTORE_MINSIZE)
+        nodes = UA_NODESTORE_MINSIZE;
+    startResize(ns, higher_prime_index(nodes)); /* this can fail. we just continue
+                                                 * with the bigger table. */
+}
+
 /**********************/
 /* Exported functions */
 /**********************/
 
+/* Add an entry with a known hash to the hash table. The nodeid must not exist
+ * in the hash table already. */
+static UA_StatusCode
+hashEntry(UA_NodeStore *ns, UA_NodeStoreEntry *entry) {
+    if(growIfFull(ns) != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    placeEntry(ns, entry);
+    migrateSlots(ns, UA_NODESTORE_MIGRATESLOTS);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Move the dense array of a namespace to the range [first, first+size).
+ * Entries outside the new range are moved to the hash table. */
+static UA_StatusCode
+resizeDense(UA_NodeStore *ns, UA_UInt16 nsIndex, UA_UInt32 first, UA_UInt32 size) {
+    if(nsIndex >= ns->denseSize) {
+        UA_NodeStoreDense *dense = UA_realloc(ns->dense, sizeof(UA_NodeStoreDense) *
+                                              ((size_t)nsIndex + 1));
+        if(!dense)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        memset(&dense[ns->denseSize], 0, sizeof(UA_NodeStoreDense) *
+               ((size_t)nsIndex + 1 - ns->denseSize));
+        ns->dense = dense;
+        ns->denseSize = (size_t)nsIndex + 1;
+    }
+    UA_NodeStoreDense *d = &ns->dense[nsIndex];
+    UA_NodeStoreEntry **entries = UA_calloc(size, sizeof(UA_NodeStoreEntry*));
+    if(!entries)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_UInt32 count = 0;
+    for(UA_UInt32 i = 0; i < d->size; ++i) {
+        UA_NodeStoreEntry *entry = d->entries[i];
+        if(!entry)
+            continue;
+        UA_UInt32 offset = d->first + i - first; /* wraps around */
+        if(offset < size) {
+            entries[offset] = entry;
+            ++count;
+            continue;
+        }
+        /* The moved entries are removed right away. So the old array remains
+         * consistent if the hash table cannot grow. */
+        if(hashEntry(ns, entry) != UA_STATUSCODE_GOOD) {
+            UA_free(entries);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        d->entries[i] = NULL;
+        --d->count;
+    }
+    UA_free(d->entries);
+    d->entries = entries;
+    d->first = first;
+    d->size = size;
+    d->count = count;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns the dense position for a numeric NodeId. The dense range is created
+ * or extended if at least a quarter of the new range is used. A range that
+ * never became dense (e.g. it was started by a sparse NodeId) is restarted at
+ * the new NodeId. Returns NULL if the NodeId goes to the hash table. */
+static UA_NodeStoreEntry **
+placeDense(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    if(nodeid->identifierType != UA_NODEIDTYPE_NUMERIC)
+        return NULL;
+    UA_NodeStoreEntry **pos = findDense(ns, nodeid);
+    if(pos)
+        return pos;
+
+    /* Compute the required range */
+    const UA_UInt64 limit = ((UA_UInt64)UA_UINT32_MAX) + 1;
+    UA_UInt64 id = nodeid->identifier.numeric;
+    UA_UInt64 lo = id, hi = id + 1, size = 0;
+    if(nodeid->namespaceIndex < ns->denseSize) {
+        const UA_NodeStoreDense *d = &ns->dense[nodeid->namespaceIndex];
+        if(d->size > 0 && ((UA_UInt64)d->count + 1) * 4 >=
+           ((id < d->first) ? (UA_UInt64)d->first + d->size - id : id + 1 - d->first)) {
+            lo = (id < d->first) ? id : d->first;
+            hi = (id < d->first) ? (UA_UInt64)d->first + d->size : id + 1;
+            size = d->size;
+        } else if(d->count * 4 >= UA_NODESTORE_DENSE_MINSIZE) {
+            return NULL; /* too sparse */
+        }
+    }
+
+    /* Grow geometrically in the direction of the new NodeId */
+    UA_UInt64 nsize = size * 2;
+    if(nsize < UA_NODESTORE_DENSE_MINSIZE)
+        nsize = UA_NODESTORE_DENSE_MINSIZE;
+    if(nsize < hi - lo)
+        nsize = hi - lo;
+    if(size > 0 && id == lo)
+        lo = (hi > nsize) ? hi - nsize : 0;
+    if(lo + nsize > limit)
+        nsize = limit - lo;
+    if(nsize > UA_UINT32_MAX)
+        return NULL;
+    if(resizeDense(ns, nodeid->namespaceIndex, (UA_UInt32)lo,
+                   (UA_UInt32)nsize) != UA_STATUSCODE_GOOD)
+        return NULL; /* use the hash table instead */
+    return findDense(ns, nodeid);
+}
+
 UA_NodeStore *
 UA_NodeStore_new(void) {
     UA_NodeStore *ns = UA_malloc(sizeof(UA_NodeStore));
@@ -19258,8 +22261,15 @@ UA_NodeStore_new(void) {
     ns->sizePrimeIndex = higher_prime_index(UA_NODESTORE_MINSIZE);
     ns->size = primes[ns->sizePrimeIndex];
     ns->count = 0;
-    ns->entries = UA_calloc(ns->size, sizeof(UA_NodeStoreEntry*));
-    if(!ns->entries) {
+    ns->tombstones = 0;
+    ns->oldSlots = NULL;
+    ns->oldSize = 0;
+    ns->oldCount = 0;
+    ns->migrated = 0;
+    ns->dense = NULL;
+    ns->denseSize = 0;
+    ns->slots = UA_calloc(ns->size, sizeof(UA_NodeStoreSlot));
+    if(!ns->slots) {
         UA_free(ns);
         return NULL;
     }
@@ -19268,13 +22278,23 @@ UA_NodeStore_new(void) {
 
 void
 UA_NodeStore_delete(UA_NodeStore *ns) {
+    migrateSlots(ns, UA_UINT32_MAX);
     UA_UInt32 size = ns->size;
-    UA_NodeStoreEntry **entries = ns->entries;
+    UA_NodeStoreSlot *slots = ns->slots;
     for(UA_UInt32 i = 0; i < size; ++i) {
-        if(entries[i] > UA_NODESTORE_TOMBSTONE)
-            deleteEntry(entries[i]);
+        if(slots[i].entry > UA_NODESTORE_TOMBSTONE)
+            releaseEntry(slots[i].entry);
+    }
+    UA_free(ns->slots);
+    for(size_t i = 0; i < ns->denseSize; ++i) {
+        UA_NodeStoreDense *d = &ns->dense[i];
+        for(UA_UInt32 j = 0; j < d->size; ++j) {
+            if(d->entries[j])
+                releaseEntry(d->entries[j]);
+        }
+        UA_free(d->entries);
     }
-    UA_free(ns->entries);
+    UA_free(ns->dense);
     UA_free(ns);
 }
 
@@ -19295,105 +22315,311 @@ UA_NodeStore_deleteNode(UA_Node *node) {
 
 UA_StatusCode
 UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
-    if(ns->size * 3 <= ns->count * 4) {
-        if(expand(ns) != UA_STATUSCODE_GOOD)
-            return UA_STATUSCODE_BADINTERNALERROR;
-    }
+    UA_Node_internTexts(node);
 
     UA_NodeId tempNodeid;
     tempNodeid = node->nodeId;
     tempNodeid.namespaceIndex = 0;
-    UA_NodeStoreEntry **entry;
     if(UA_NodeId_isNull(&tempNodeid)) {
         /* create a random nodeid */
         if(node->nodeId.namespaceIndex == 0)
             node->nodeId.namespaceIndex = 1;
-        UA_UInt32 identifier = ns->count+1; // start value
-        UA_UInt32 size = ns->size;
-        UA_UInt32 increase = mod2(identifier, size);
+        /* Start above the dense range of the namespace. The dense nodes are
+         * not counted in the hash table. The search covers the full
+         * identifier range and skips the identifier 0. */
+        UA_UInt64 start = (UA_UInt64)ns->count + ns->oldCount + 1;
+        if(node->nodeId.namespaceIndex < ns->denseSize) {
+            const UA_NodeStoreDense *d = &ns->dense[node->nodeId.namespaceIndex];
+            if(d->size > 0 && start < (UA_UInt64)d->first + d->size)
+                start = (UA_UInt64)d->first + d->size;
+        }
+        UA_UInt32 identifier = (start > UA_UINT32_MAX) ? 1 : (UA_UInt32)start;
         while(true) {
             node->nodeId.identifier.numeric = identifier;
-            entry = findSlot(ns, &node->nodeId);
-            if(entry)
+            if(!findEntry(ns, &node->nodeId))
                 break;
-            identifier += increase;
-            if(identifier >= size)
-                identifier -= size;
-        }
-    } else {
-        entry = findSlot(ns, &node->nodeId);
-        if(!entry) {
-            UA_NodeStore_deleteNode(node);
-            return UA_STATUSCODE_BADNODEIDEXISTS;
+            if(++identifier == 0)
+                identifier = 1;
         }
+    } else if(findEntry(ns, &node->nodeId)) {
+        UA_NodeStore_deleteNode(node);
+        return UA_STATUSCODE_BADNODEIDEXISTS;
     }
 
-    *entry = container_of(node, UA_NodeStoreEntry, node);
-    ++ns->count;
-    UA_assert(&(*entry)->node == node);
-    return UA_STATUSCODE_GOOD;
+    UA_NodeStoreEntry *entry = container_of(node, UA_NodeStoreEntry, node);
+    entry->hash = UA_NodeId_hash(&node->nodeId);
+
+    /* Dense numeric NodeIds are not added to the hash table */
+    UA_NodeStoreEntry **pos = placeDense(ns, &node->nodeId);
+    if(pos) {
+        *pos = entry;
+        ++ns->dense[node->nodeId.namespaceIndex].count;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_StatusCode retval = hashEntry(ns, entry);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_NodeStore_deleteNode(node);
+    return retval;
 }
 
 UA_StatusCode
 UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node) {
-    UA_NodeStoreEntry **entry = findNode(ns, &node->nodeId);
-    if(!entry)
-        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    /* The hash was taken over from the original in getCopy */
     UA_NodeStoreEntry *newEntry = container_of(node, UA_NodeStoreEntry, node);
-    if(*entry != newEntry->orig) {
+    UA_NodeStoreEntry **pos = findDense(ns, &node->nodeId);
+    if(!pos || !*pos) {
+        UA_NodeStoreSlot *slot = findNode(ns, &node->nodeId, newEntry->hash);
+        if(!slot)
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+        pos = &slot->entry;
+    }
+    if(*pos != newEntry->orig) {
         // the node was replaced since the copy was made
         deleteEntry(newEntry);
         return UA_STATUSCODE_BADINTERNALERROR;
     }
-    deleteEntry(*entry);
-    *entry = newEntry;
+    /* The handle may have been released since the copy was made */
+    newEntry->interned = (*pos)->interned;
+    releaseEntry(*pos);
+    *pos = newEntry;
     return UA_STATUSCODE_GOOD;
 }
 
 const UA_Node *
 UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_NodeStoreEntry **entry = findNode(ns, nodeid);
+    UA_NodeStoreEntry *entry = findEntry(ns, nodeid);
+    if(!entry)
+        return NULL;
+    return (const UA_Node*)&entry->node;
+}
+
+const UA_Node *
+UA_NodeStore_getInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    UA_NodeStoreEntry *entry = findInterned(ns, id);
+    if(!entry)
+        return NULL;
+    return (const UA_Node*)&entry->node;
+}
+
+static UA_Node *
+copyEntry(UA_NodeStoreEntry *entry) {
     if(!entry)
         return NULL;
-    return (const UA_Node*)&(*entry)->node;
+    UA_NodeStoreEntry *new = instantiateEntry(entry->node.nodeClass);
+    if(!new)
+        return NULL;
+    if(UA_Node_copyAnyNodeClass(&entry->node, &new->node) != UA_STATUSCODE_GOOD) {
+        deleteEntry(new);
+        return NULL;
+    }
+    new->orig = entry; // store the pointer to the original
+    new->hash = entry->hash;
+    new->interned = entry->interned;
+    return &new->node;
+}
+
+UA_Node *
+UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    return copyEntry(findEntry(ns, nodeid));
+}
+
+UA_Node *
+UA_NodeStore_getCopyInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    return copyEntry(findInterned(ns, id));
+}
+
+void
+UA_NodeStore_releaseInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    UA_NodeStoreEntry *entry = findInterned(ns, id);
+    if(entry && entry->interned == id)
+        entry->interned = NULL;
+}
+
+UA_StatusCode
+UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreEntry **pos = findDense(ns, nodeid);
+    if(pos && *pos) {
+        releaseEntry(*pos);
+        *pos = NULL;
+        --ns->dense[nodeid->namespaceIndex].count;
+        return UA_STATUSCODE_GOOD;
+    }
+    UA_NodeStoreSlot *slot = findNode(ns, nodeid, UA_NodeId_hash(nodeid));
+    if(!slot)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    releaseEntry(slot->entry);
+    slot->entry = UA_NODESTORE_TOMBSTONE;
+    if(slot >= ns->slots && slot < &ns->slots[ns->size]) {
+        --ns->count;
+        ++ns->tombstones;
+    } else {
+        --ns->oldCount;
+    }
+    migrateSlots(ns, UA_NODESTORE_MIGRATESLOTS);
+    cleanupAfterRemove(ns);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_NodeStore_reserveDense(UA_NodeStore *ns, UA_UInt16 nsIndex,
+                          UA_UInt32 first, UA_UInt32 count) {
+    if(count == 0 || (UA_UInt64)first + count > ((UA_UInt64)UA_UINT32_MAX) + 1)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if(nsIndex < ns->denseSize && ns->dense[nsIndex].first == first &&
+       ns->dense[nsIndex].size == count)
+        return UA_STATUSCODE_GOOD;
+    return resizeDense(ns, nsIndex, first, count);
+}
+
+UA_StatusCode
+UA_NodeStore_reserve(UA_NodeStore *ns, size_t count) {
+    /* Same occupancy as after a resize. So no resize is triggered while the
+     * reserved nodes are inserted. The entries are moved right away. */
+    UA_UInt64 total = ((UA_UInt64)ns->count + ns->oldCount + count) * 2;
+    if(total > primes[sizeof(primes) / sizeof(UA_UInt32) - 1])
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_UInt16 nindex = higher_prime_index((UA_UInt32)total);
+    if(primes[nindex] <= ns->size)
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode retval = startResize(ns, nindex);
+    migrateSlots(ns, UA_UINT32_MAX);
+    return retval;
+}
+
+static void
+shareNode(void *context, const UA_Node *node) {
+    UA_Node ***pos = (UA_Node***)context;
+    UA_NodeStoreEntry *entry = container_of(node, UA_NodeStoreEntry, node);
+    entry->shared = true;
+    entry->interned = NULL; /* interned NodeIds belong to one server */
+    **pos = &entry->node;
+    ++*pos;
+}
+
+UA_StatusCode
+UA_NodeStore_share(UA_NodeStore *ns, UA_Node ***nodes, size_t *nodesSize) {
+    size_t count = (size_t)ns->count + ns->oldCount;
+    for(size_t i = 0; i < ns->denseSize; ++i)
+        count += ns->dense[i].count;
+    *nodes = UA_malloc(sizeof(UA_Node*) * count);
+    if(!*nodes && count > 0)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_Node **pos = *nodes;
+    UA_NodeStore_iterate(ns, shareNode, &pos);
+    *nodesSize = count;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_NodeStore_insertShared(UA_NodeStore *ns, const UA_Node *node) {
+    UA_NodeStoreEntry *entry = container_of(node, UA_NodeStoreEntry, node);
+    UA_assert(entry->shared);
+    if(findEntry(ns, &node->nodeId))
+        return UA_STATUSCODE_BADNODEIDEXISTS;
+    UA_NodeStoreEntry **pos = placeDense(ns, &node->nodeId);
+    if(pos) {
+        *pos = entry;
+        ++ns->dense[node->nodeId.namespaceIndex].count;
+        return UA_STATUSCODE_GOOD;
+    }
+    return hashEntry(ns, entry);
+}
+
+UA_Boolean
+UA_NodeStore_isShared(const UA_Node *node) {
+    const UA_NodeStoreEntry *entry = container_of(node, UA_NodeStoreEntry, node);
+    return entry->shared;
+}
+
+void
+UA_NodeStore_deleteShared(UA_Node **nodes, size_t nodesSize) {
+    for(size_t i = 0; i < nodesSize; ++i)
+        deleteEntry(container_of(nodes[i], UA_NodeStoreEntry, node));
+    UA_free(nodes);
+}
+
+size_t
+UA_NodeStore_memoryUsage(UA_NodeStore *ns) {
+    size_t size = sizeof(UA_NodeStore) +
+        ((size_t)ns->size + ns->oldSize) * sizeof(UA_NodeStoreSlot) +
+        ns->denseSize * sizeof(UA_NodeStoreDense);
+    for(size_t i = 0; i < ns->denseSize; ++i)
+        size += ns->dense[i].size * sizeof(UA_NodeStoreEntry*);
+    return size;
+}
+
+size_t
+UA_NodeStore_nodeMemoryUsage(const UA_Node *node) {
+    return entrySize(node->nodeClass);
+}
+
+/* Number of slots visited from the start of the probe sequence of the entry
+ * until its slot */
+static size_t
+probeLength(const UA_NodeStoreSlot *slots, UA_UInt32 size, UA_UInt32 pos) {
+    UA_UInt32 h = slots[pos].hash;
+    UA_UInt32 idx = mod(h, size);
+    UA_UInt32 hash2 = mod2(h, size);
+    size_t length = 1;
+    while(idx != pos) {
+        idx += hash2;
+        if(idx >= size)
+            idx -= size;
+        ++length;
+    }
+    return length;
 }
 
-UA_Node *
-UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_NodeStoreEntry **slot = findNode(ns, nodeid);
-    if(!slot)
-        return NULL;
-    UA_NodeStoreEntry *entry = *slot;
-    UA_NodeStoreEntry *new = instantiateEntry(entry->node.nodeClass);
-    if(!new)
-        return NULL;
-    if(UA_Node_copyAnyNodeClass(&entry->node, &new->node) != UA_STATUSCODE_GOOD) {
-        deleteEntry(new);
-        return NULL;
+static size_t
+tableProbeLengths(const UA_NodeStoreSlot *slots, UA_UInt32 size,
+                  UA_NodeStoreStatistics *stats) {
+    size_t probes = 0;
+    for(UA_UInt32 i = 0; i < size; ++i) {
+        if(slots[i].entry <= UA_NODESTORE_TOMBSTONE)
+            continue;
+        size_t length = probeLength(slots, size, i);
+        probes += length;
+        if(length > stats->maxProbeLength)
+            stats->maxProbeLength = length;
     }
-    new->orig = entry; // store the pointer to the original
-    return &new->node;
+    return probes;
 }
 
 UA_StatusCode
-UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_NodeStoreEntry **slot = findNode(ns, nodeid);
-    if(!slot)
-        return UA_STATUSCODE_BADNODEIDUNKNOWN;
-    deleteEntry(*slot);
-    *slot = UA_NODESTORE_TOMBSTONE;
-    --ns->count;
-    /* Downsize the hashmap if it is very empty */
-    if(ns->count * 8 < ns->size && ns->size > 32)
-        expand(ns); // this can fail. we just continue with the bigger hashmap.
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeStoreStatistics *stats) {
+    memset(stats, 0, sizeof(UA_NodeStoreStatistics));
+    stats->hashedNodes = (size_t)ns->count + ns->oldCount;
+    stats->slots = ns->size;
+    stats->tombstones = ns->tombstones;
+    stats->movingNodes = ns->oldCount;
+    for(size_t i = 0; i < ns->denseSize; ++i)
+        stats->denseNodes += ns->dense[i].count;
+    size_t probes = tableProbeLengths(ns->slots, ns->size, stats);
+    if(ns->oldSlots)
+        probes += tableProbeLengths(ns->oldSlots, ns->oldSize, stats);
+    if(stats->hashedNodes > 0)
+        stats->averageProbeLength = (UA_Double)probes / (UA_Double)stats->hashedNodes;
     return UA_STATUSCODE_GOOD;
 }
 
 void
-UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor) {
+UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor,
+                     void *context) {
     for(UA_UInt32 i = 0; i < ns->size; ++i) {
-        if(ns->entries[i] > UA_NODESTORE_TOMBSTONE)
-            visitor((UA_Node*)&ns->entries[i]->node);
+        if(ns->slots[i].entry > UA_NODESTORE_TOMBSTONE)
+            visitor(context, (UA_Node*)&ns->slots[i].entry->node);
+    }
+    for(UA_UInt32 i = ns->migrated; i < ns->oldSize; ++i) {
+        if(ns->oldSlots[i].entry > UA_NODESTORE_TOMBSTONE)
+            visitor(context, (UA_Node*)&ns->oldSlots[i].entry->node);
+    }
+    for(size_t i = 0; i < ns->denseSize; ++i) {
+        const UA_NodeStoreDense *d = &ns->dense[i];
+        for(UA_UInt32 j = 0; j < d->size; ++j) {
+            if(d->entries[j])
+                visitor(context, (UA_Node*)&d->entries[j]->node);
+        }
     }
 }
 
@@ -19416,36 +22642,36 @@ struct nodeEntry {
     UA_Node node; ///< Might be cast from any _bigger_ UA_Node* type. Allocate enough memory!
 };
 
-static struct nodeEntry * instantiateEntry(UA_NodeClass class) {
+/* Size of the entry for a node of the nodeclass or zero for an unknown class */
+static size_t
+entrySize(UA_NodeClass nodeClass) {
     size_t size = sizeof(struct nodeEntry) - sizeof(UA_Node);
-    switch(class) {
+    switch(nodeClass) {
     case UA_NODECLASS_OBJECT:
-        size += sizeof(UA_ObjectNode);
-        break;
+        return size + sizeof(UA_ObjectNode);
     case UA_NODECLASS_VARIABLE:
-        size += sizeof(UA_VariableNode);
-        break;
+        return size + sizeof(UA_VariableNode);
     case UA_NODECLASS_METHOD:
-        size += sizeof(UA_MethodNode);
-        break;
+        return size + sizeof(UA_MethodNode);
     case UA_NODECLASS_OBJECTTYPE:
-        size += sizeof(UA_ObjectTypeNode);
-        break;
+        return size + sizeof(UA_ObjectTypeNode);
     case UA_NODECLASS_VARIABLETYPE:
-        size += sizeof(UA_VariableTypeNode);
-        break;
+        return size + sizeof(UA_VariableTypeNode);
     case UA_NODECLASS_REFERENCETYPE:
-        size += sizeof(UA_ReferenceTypeNode);
-        break;
+        return size + sizeof(UA_ReferenceTypeNode);
     case UA_NODECLASS_DATATYPE:
-        size += sizeof(UA_DataTypeNode);
-        break;
+        return size + sizeof(UA_DataTypeNode);
     case UA_NODECLASS_VIEW:
-        size += sizeof(UA_ViewNode);
-        break;
+        return size + sizeof(UA_ViewNode);
     default:
-        return NULL;
+        return 0;
     }
+}
+
+static struct nodeEntry * instantiateEntry(UA_NodeClass class) {
+    size_t size = entrySize(class);
+    if(size == 0)
+        return NULL;
     struct nodeEntry *entry = UA_calloc(1, size);
     if(!entry)
         return NULL;
@@ -19507,6 +22733,7 @@ UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
     UA_ASSERT_RCU_LOCKED();
     struct nodeEntry *entry = container_of(node, struct nodeEntry, node);
     struct cds_lfht *ht = (struct cds_lfht*)ns;
+    UA_Node_internTexts(node);
     cds_lfht_node_init(&entry->htn);
     struct cds_lfht_node *result;
     //namespace index is assumed to be valid
@@ -19588,51 +22815,603 @@ UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     return UA_STATUSCODE_GOOD;
 }
 
-const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_ASSERT_RCU_LOCKED();
-    struct cds_lfht *ht = (struct cds_lfht*)ns;
-    UA_UInt32 h = UA_NodeId_hash(nodeid);
-    struct cds_lfht_iter iter;
-    cds_lfht_lookup(ht, h, compare, nodeid, &iter);
-    struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
-    if(!found_entry)
-        return NULL;
-    return &found_entry->node;
+const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_ASSERT_RCU_LOCKED();
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    UA_UInt32 h = UA_NodeId_hash(nodeid);
+    struct cds_lfht_iter iter;
+    cds_lfht_lookup(ht, h, compare, nodeid, &iter);
+    struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
+    if(!found_entry)
+        return NULL;
+    return &found_entry->node;
+}
+
+const UA_Node * UA_NodeStore_getInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    UA_ASSERT_RCU_LOCKED();
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    struct cds_lfht_iter iter;
+    cds_lfht_lookup(ht, id->hash, compare, &id->nodeId, &iter);
+    struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
+    if(!found_entry)
+        return NULL;
+    return &found_entry->node;
+}
+
+static UA_Node * copyEntry(struct nodeEntry *entry) {
+    if(!entry)
+        return NULL;
+    struct nodeEntry *new = instantiateEntry(entry->node.nodeClass);
+    if(!new)
+        return NULL;
+    if(UA_Node_copyAnyNodeClass(&entry->node, &new->node) != UA_STATUSCODE_GOOD) {
+        deleteEntry(&new->rcu_head);
+        return NULL;
+    }
+    new->orig = entry;
+    return &new->node;
+}
+
+UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_ASSERT_RCU_LOCKED();
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    UA_UInt32 h = UA_NodeId_hash(nodeid);
+    struct cds_lfht_iter iter;
+    cds_lfht_lookup(ht, h, compare, nodeid, &iter);
+    return copyEntry((struct nodeEntry*)iter.node);
+}
+
+UA_Node * UA_NodeStore_getCopyInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+    UA_ASSERT_RCU_LOCKED();
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    struct cds_lfht_iter iter;
+    cds_lfht_lookup(ht, id->hash, compare, &id->nodeId, &iter);
+    return copyEntry((struct nodeEntry*)iter.node);
+}
+
+/* The nodes do not remember the handles */
+void UA_NodeStore_releaseInterned(UA_NodeStore *ns, const UA_InternedNodeId *id) {
+}
+
+/* The lock-free hash table has no dense index. The reservation is ignored. */
+UA_StatusCode
+UA_NodeStore_reserveDense(UA_NodeStore *ns, UA_UInt16 nsIndex,
+                          UA_UInt32 first, UA_UInt32 count) {
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The lock-free hash table resizes automatically */
+UA_StatusCode
+UA_NodeStore_reserve(UA_NodeStore *ns, size_t count) {
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Nodes are freed by call_rcu when they are removed from the lock-free hash
+ * table. So they cannot be shared with other nodestores. */
+UA_StatusCode
+UA_NodeStore_share(UA_NodeStore *ns, UA_Node ***nodes, size_t *nodesSize) {
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+}
+
+UA_StatusCode
+UA_NodeStore_insertShared(UA_NodeStore *ns, const UA_Node *node) {
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+}
+
+UA_Boolean
+UA_NodeStore_isShared(const UA_Node *node) {
+    return false;
+}
+
+void
+UA_NodeStore_deleteShared(UA_Node **nodes, size_t nodesSize) {
+}
+
+/* The lock-free hash table does not expose its allocations */
+size_t
+UA_NodeStore_memoryUsage(UA_NodeStore *ns) {
+    return 0;
+}
+
+size_t
+UA_NodeStore_nodeMemoryUsage(const UA_Node *node) {
+    return entrySize(node->nodeClass);
+}
+
+UA_StatusCode
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeStoreStatistics *stats) {
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+}
+
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor,
+                          void *context) {
+    UA_ASSERT_RCU_LOCKED();
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    struct cds_lfht_iter iter;
+    cds_lfht_first(ht, &iter);
+    while(iter.node != NULL) {
+        struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
+        visitor(context, &found_entry->node);
+        cds_lfht_next(ht, &iter);
+    }
+}
+
+#endif /* UA_ENABLE_MULTITHREADING */
+
+/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/server/ua_nodestore_snapshot.c" ***********************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+*  License, v. 2.0. If a copy of the MPL was not distributed with this 
+*  file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+
+/* A snapshot image contains the nodes in the binary encoding. There are no
+ * pointers in the image. So it can be loaded from any address, for example
+ * from a memory-mapped file.
+ *
+ * - Header: UInt32 magic, UInt32 version, String[] namespaces, UInt32 nodes
+ * - Node: NodeClass, base attributes, references, attributes of the nodeclass
+ * - References: Int32 kinds, per kind the NodeId referenceTypeId, Boolean
+ *   isInverse, NodeId[] targetIds and ExpandedNodeId[] remoteTargetIds
+ *
+ * Callbacks and handles (DataSources, methods, lifecycle management) are not
+ * contained in the image. */
+
+#define UA_SNAPSHOT_MAGIC 0x534e4155 /* "UANS" */
+#define UA_SNAPSHOT_VERSION 3
+#define UA_SNAPSHOT_MINSIZE 4096
+
+typedef struct {
+    size_t offset; /* of the member in the node structure */
+    UA_UInt16 typeIndex;
+} UA_SnapshotField;
+
+#define UA_SNAPSHOT_FIELD(NODETYPE, MEMBER, TYPE) \
+    {offsetof(NODETYPE, MEMBER), UA_TYPES_##TYPE}
+
+static const UA_SnapshotField baseFields[] = {
+    UA_SNAPSHOT_FIELD(UA_Node, nodeId, NODEID),
+    UA_SNAPSHOT_FIELD(UA_Node, browseName, QUALIFIEDNAME),
+    UA_SNAPSHOT_FIELD(UA_Node, displayName, LOCALIZEDTEXT),
+    UA_SNAPSHOT_FIELD(UA_Node, description, LOCALIZEDTEXT),
+    UA_SNAPSHOT_FIELD(UA_Node, writeMask, UINT32),
+    UA_SNAPSHOT_FIELD(UA_Node, userWriteMask, UINT32)};
+
+static const UA_SnapshotField objectFields[] = {
+    UA_SNAPSHOT_FIELD(UA_ObjectNode, eventNotifier, BYTE)};
+
+/* The array dimensions and the value follow */
+static const UA_SnapshotField commonVariableFields[] = {
+    UA_SNAPSHOT_FIELD(UA_VariableNode, dataType, NODEID),
+    UA_SNAPSHOT_FIELD(UA_VariableNode, valueRank, INT32)};
+
+static const UA_SnapshotField variableFields[] = {
+    UA_SNAPSHOT_FIELD(UA_VariableNode, accessLevel, BYTE),
+    UA_SNAPSHOT_FIELD(UA_VariableNode, userAccessLevel, BYTE),
+    UA_SNAPSHOT_FIELD(UA_VariableNode, minimumSamplingInterval, DOUBLE),
+    UA_SNAPSHOT_FIELD(UA_VariableNode, historizing, BOOLEAN)};
+
+static const UA_SnapshotField variableTypeFields[] = {
+    UA_SNAPSHOT_FIELD(UA_VariableTypeNode, isAbstract, BOOLEAN)};
+
+static const UA_SnapshotField methodFields[] = {
+    UA_SNAPSHOT_FIELD(UA_MethodNode, executable, BOOLEAN),
+    UA_SNAPSHOT_FIELD(UA_MethodNode, userExecutable, BOOLEAN)};
+
+static const UA_SnapshotField objectTypeFields[] = {
+    UA_SNAPSHOT_FIELD(UA_ObjectTypeNode, isAbstract, BOOLEAN)};
+
+static const UA_SnapshotField referenceTypeFields[] = {
+    UA_SNAPSHOT_FIELD(UA_ReferenceTypeNode, isAbstract, BOOLEAN),
+    UA_SNAPSHOT_FIELD(UA_ReferenceTypeNode, symmetric, BOOLEAN),
+    UA_SNAPSHOT_FIELD(UA_ReferenceTypeNode, inverseName, LOCALIZEDTEXT)};
+
+static const UA_SnapshotField dataTypeFields[] = {
+    UA_SNAPSHOT_FIELD(UA_DataTypeNode, isAbstract, BOOLEAN)};
+
+static const UA_SnapshotField viewFields[] = {
+    UA_SNAPSHOT_FIELD(UA_ViewNode, eventNotifier, BYTE),
+    UA_SNAPSHOT_FIELD(UA_ViewNode, containsNoLoops, BOOLEAN)};
+
+#define UA_SNAPSHOT_FIELDS(FIELDS) \
+    do { *fieldsSize = sizeof(FIELDS) / sizeof(UA_SnapshotField); return FIELDS; } while(0)
+
+/* The fields after the base attributes and references */
+static const UA_SnapshotField *
+nodeClassFields(UA_NodeClass nodeClass, size_t *fieldsSize) {
+    switch(nodeClass) {
+    case UA_NODECLASS_OBJECT: UA_SNAPSHOT_FIELDS(objectFields);
+    case UA_NODECLASS_VARIABLE: UA_SNAPSHOT_FIELDS(variableFields);
+    case UA_NODECLASS_VARIABLETYPE: UA_SNAPSHOT_FIELDS(variableTypeFields);
+    case UA_NODECLASS_METHOD: UA_SNAPSHOT_FIELDS(methodFields);
+    case UA_NODECLASS_OBJECTTYPE: UA_SNAPSHOT_FIELDS(objectTypeFields);
+    case UA_NODECLASS_REFERENCETYPE: UA_SNAPSHOT_FIELDS(referenceTypeFields);
+    case UA_NODECLASS_DATATYPE: UA_SNAPSHOT_FIELDS(dataTypeFields);
+    case UA_NODECLASS_VIEW: UA_SNAPSHOT_FIELDS(viewFields);
+    default:
+        *fieldsSize = 0;
+        return NULL;
+    }
+}
+
+/**********/
+/* Saving */
+/**********/
+
+typedef struct {
+    UA_ByteString image; /* the allocated buffer */
+    size_t offset; /* the used length */
+    UA_UInt32 nodesCount;
+    UA_StatusCode retval;
+} UA_SnapshotWriter;
+
+static UA_StatusCode
+writeField(UA_SnapshotWriter *w, const void *src, const UA_DataType *type) {
+    size_t size = UA_calcSizeBinary((void*)(uintptr_t)src, type);
+    if(w->offset + size > w->image.length) {
+        size_t length = w->image.length * 2;
+        if(length < w->offset + size)
+            length = w->offset + size;
+        if(length < UA_SNAPSHOT_MINSIZE)
+            length = UA_SNAPSHOT_MINSIZE;
+        UA_Byte *data = UA_realloc(w->image.data, length);
+        if(!data)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        w->image.data = data;
+        w->image.length = length;
+    }
+    return UA_encodeBinary(src, type, NULL, NULL, &w->image, &w->offset);
+}
+
+static UA_StatusCode
+writeArray(UA_SnapshotWriter *w, const void *array, size_t size,
+           const UA_DataType *type) {
+    if(size > UA_INT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    UA_Int32 length = (UA_Int32)size;
+    UA_StatusCode retval = writeField(w, &length, &UA_TYPES[UA_TYPES_INT32]);
+    uintptr_t ptr = (uintptr_t)array;
+    for(size_t i = 0; i < size && retval == UA_STATUSCODE_GOOD; ++i) {
+        retval = writeField(w, (const void*)ptr, type);
+        ptr += type->memSize;
+    }
+    return retval;
+}
+
+static UA_StatusCode
+writeReferences(UA_SnapshotWriter *w, const UA_Node *node) {
+    if(node->referencesSize > UA_INT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    UA_Int32 length = (UA_Int32)node->referencesSize;
+    UA_StatusCode retval = writeField(w, &length, &UA_TYPES[UA_TYPES_INT32]);
+    for(size_t i = 0; i < node->referencesSize && retval == UA_STATUSCODE_GOOD; ++i) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        retval = writeField(w, &rk->referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = writeField(w, &rk->isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = writeArray(w, rk->targetIds, rk->targetIdsSize,
+                                &UA_TYPES[UA_TYPES_NODEID]);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = writeArray(w, rk->remoteTargetIds, rk->remoteTargetIdsSize,
+                                &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    }
+    return retval;
+}
+
+static UA_StatusCode
+writeFields(UA_SnapshotWriter *w, const UA_Node *node,
+            const UA_SnapshotField *fields, size_t fieldsSize) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < fieldsSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = writeField(w, (const void*)((uintptr_t)node + fields[i].offset),
+                            &UA_TYPES[fields[i].typeIndex]);
+    return retval;
+}
+
+/* The value of DataSource variables is not stored */
+static UA_StatusCode
+writeVariableValue(UA_SnapshotWriter *w, const UA_VariableNode *node) {
+    UA_StatusCode retval = writeFields(w, (const UA_Node*)node, commonVariableFields,
+                                       sizeof(commonVariableFields) / sizeof(UA_SnapshotField));
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = writeArray(w, node->arrayDimensions, node->arrayDimensionsSize,
+                        &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Boolean hasValue = (node->valueSource == UA_VALUESOURCE_DATA);
+    retval = writeField(w, &hasValue, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    if(retval != UA_STATUSCODE_GOOD || !hasValue)
+        return retval;
+    return writeField(w, getVariableValue(node), &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+static UA_StatusCode
+writeNode(UA_SnapshotWriter *w, const UA_Node *node) {
+    UA_StatusCode retval = writeField(w, &node->nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = writeFields(w, node, baseFields,
+                             sizeof(baseFields) / sizeof(UA_SnapshotField));
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = writeReferences(w, node);
+    if(retval == UA_STATUSCODE_GOOD &&
+       (node->nodeClass == UA_NODECLASS_VARIABLE ||
+        node->nodeClass == UA_NODECLASS_VARIABLETYPE))
+        retval = writeVariableValue(w, (const UA_VariableNode*)node);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t fieldsSize;
+    const UA_SnapshotField *fields = nodeClassFields(node->nodeClass, &fieldsSize);
+    return writeFields(w, node, fields, fieldsSize);
+}
+
+static void
+saveNode(void *context, const UA_Node *node) {
+    UA_SnapshotWriter *w = (UA_SnapshotWriter*)context;
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return;
+    w->retval = writeNode(w, node);
+    ++w->nodesCount;
+}
+
+UA_StatusCode
+UA_Server_saveNodestoreSnapshot(UA_Server *server, UA_ByteString *image) {
+    UA_SnapshotWriter w;
+    memset(&w, 0, sizeof(UA_SnapshotWriter));
+
+    /* Header. The number of nodes is written at the end. */
+    UA_UInt32 magic = UA_SNAPSHOT_MAGIC;
+    UA_UInt32 version = UA_SNAPSHOT_VERSION;
+    w.retval = writeField(&w, &magic, &UA_TYPES[UA_TYPES_UINT32]);
+    if(w.retval == UA_STATUSCODE_GOOD)
+        w.retval = writeField(&w, &version, &UA_TYPES[UA_TYPES_UINT32]);
+    if(w.retval == UA_STATUSCODE_GOOD)
+        w.retval = writeArray(&w, server->namespaces, server->namespacesSize,
+                              &UA_TYPES[UA_TYPES_STRING]);
+    size_t nodesCountOffset = w.offset;
+    if(w.retval == UA_STATUSCODE_GOOD)
+        w.retval = writeField(&w, &w.nodesCount, &UA_TYPES[UA_TYPES_UINT32]);
+
+    /* Nodes */
+    UA_RCU_LOCK();
+    UA_NodeStore_iterate(server->nodestore, saveNode, &w);
+    UA_RCU_UNLOCK();
+    if(w.retval == UA_STATUSCODE_GOOD)
+        w.retval = UA_encodeBinary(&w.nodesCount, &UA_TYPES[UA_TYPES_UINT32],
+                                   NULL, NULL, &w.image, &nodesCountOffset);
+    if(w.retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_deleteMembers(&w.image);
+        return w.retval;
+    }
+    image->data = w.image.data;
+    image->length = w.offset;
+    return UA_STATUSCODE_GOOD;
+}
+
+/***********/
+/* Loading */
+/***********/
+
+static UA_StatusCode
+readArray(const UA_ByteString *image, size_t *offset, void **array,
+          size_t *arraySize, const UA_DataType *type) {
+    UA_Int32 length;
+    UA_StatusCode retval = UA_decodeBinary(image, offset, &length, &UA_TYPES[UA_TYPES_INT32]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    *array = NULL;
+    *arraySize = 0;
+    if(length <= 0)
+        return UA_STATUSCODE_GOOD;
+    /* Every element takes at least one byte */
+    if((size_t)length > image->length - *offset)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    void *a = UA_Array_new((size_t)length, type);
+    if(!a)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    uintptr_t ptr = (uintptr_t)a;
+    for(UA_Int32 i = 0; i < length; ++i) {
+        retval = UA_decodeBinary(image, offset, (void*)ptr, type);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(a, (size_t)length, type);
+            return retval;
+        }
+        ptr += type->memSize;
+    }
+    *array = a;
+    *arraySize = (size_t)length;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Kinds without targets are not valid */
+static UA_StatusCode
+readReferences(const UA_ByteString *image, size_t *offset, UA_Node *node) {
+    UA_Int32 length;
+    UA_StatusCode retval = UA_decodeBinary(image, offset, &length, &UA_TYPES[UA_TYPES_INT32]);
+    if(retval != UA_STATUSCODE_GOOD || length <= 0)
+        return retval;
+    if((size_t)length > image->length - *offset)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    node->references = UA_calloc((size_t)length, sizeof(UA_NodeReferenceKind));
+    if(!node->references)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    node->referencesSize = (size_t)length;
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        retval = UA_decodeBinary(image, offset, &rk->referenceTypeId,
+                                 &UA_TYPES[UA_TYPES_NODEID]);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = UA_decodeBinary(image, offset, &rk->isInverse,
+                                     &UA_TYPES[UA_TYPES_BOOLEAN]);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = readArray(image, offset, (void**)&rk->targetIds, &rk->targetIdsSize,
+                               &UA_TYPES[UA_TYPES_NODEID]);
+        rk->targetIdsCapacity = rk->targetIdsSize;
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = readArray(image, offset, (void**)&rk->remoteTargetIds,
+                               &rk->remoteTargetIdsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+        if(retval == UA_STATUSCODE_GOOD && rk->targetIdsSize == 0 &&
+           rk->remoteTargetIdsSize == 0)
+            retval = UA_STATUSCODE_BADDECODINGERROR;
+        if(retval != UA_STATUSCODE_GOOD)
+            break;
+    }
+    return retval;
+}
+
+static UA_StatusCode
+readFields(const UA_ByteString *image, size_t *offset, UA_Node *node,
+           const UA_SnapshotField *fields, size_t fieldsSize) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < fieldsSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = UA_decodeBinary(image, offset, (void*)((uintptr_t)node + fields[i].offset),
+                                 &UA_TYPES[fields[i].typeIndex]);
+    return retval;
+}
+
+/* DataSource variables are loaded without a value. The DataSource is taken
+ * over from an existing node. */
+static UA_StatusCode
+readVariableValue(const UA_ByteString *image, size_t *offset, UA_VariableNode *node) {
+    UA_StatusCode retval =
+        readFields(image, offset, (UA_Node*)node, commonVariableFields,
+                   sizeof(commonVariableFields) / sizeof(UA_SnapshotField));
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = readArray(image, offset, (void**)&node->arrayDimensions,
+                       &node->arrayDimensionsSize, &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Boolean hasValue;
+    retval = UA_decodeBinary(image, offset, &hasValue, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    node->valueSource = UA_VALUESOURCE_DATA;
+    if(retval != UA_STATUSCODE_GOOD || !hasValue)
+        return retval;
+    return UA_decodeBinary(image, offset, &node->value.data.value,
+                           &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+static UA_StatusCode
+readNode(const UA_ByteString *image, size_t *offset, UA_Node **node) {
+    UA_NodeClass nodeClass;
+    UA_StatusCode retval = UA_decodeBinary(image, offset, &nodeClass,
+                                           &UA_TYPES[UA_TYPES_NODECLASS]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t fieldsSize;
+    const UA_SnapshotField *fields = nodeClassFields(nodeClass, &fieldsSize);
+    if(!fields)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    UA_Node *n = UA_NodeStore_newNode(nodeClass);
+    if(!n)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    retval = readFields(image, offset, n, baseFields,
+                        sizeof(baseFields) / sizeof(UA_SnapshotField));
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = readReferences(image, offset, n);
+    if(retval == UA_STATUSCODE_GOOD &&
+       (nodeClass == UA_NODECLASS_VARIABLE || nodeClass == UA_NODECLASS_VARIABLETYPE))
+        retval = readVariableValue(image, offset, (UA_VariableNode*)n);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = readFields(image, offset, n, fields, fieldsSize);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeStore_deleteNode(n);
+        return retval;
+    }
+    *node = n;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Take over the callbacks and handles from the node that is replaced */
+static void
+takeRuntimeMembers(UA_Node *node, const UA_Node *old) {
+    switch(node->nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        ((UA_ObjectNode*)node)->instanceHandle = ((const UA_ObjectNode*)old)->instanceHandle;
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        ((UA_ObjectTypeNode*)node)->lifecycleManagement =
+            ((const UA_ObjectTypeNode*)old)->lifecycleManagement;
+        break;
+    case UA_NODECLASS_METHOD:
+        ((UA_MethodNode*)node)->methodHandle = ((const UA_MethodNode*)old)->methodHandle;
+        ((UA_MethodNode*)node)->attachedMethod = ((const UA_MethodNode*)old)->attachedMethod;
+        break;
+    case UA_NODECLASS_VARIABLE:
+    case UA_NODECLASS_VARIABLETYPE: {
+        UA_VariableNode *vn = (UA_VariableNode*)node;
+        const UA_VariableNode *ovn = (const UA_VariableNode*)old;
+        if(ovn->valueSource == UA_VALUESOURCE_DATASOURCE) {
+            UA_DataValue_deleteMembers(&vn->value.data.value);
+            vn->valueSource = UA_VALUESOURCE_DATASOURCE;
+            vn->value.dataSource = ovn->value.dataSource;
+        } else {
+            vn->value.data.callback = ovn->value.data.callback;
+        }
+        break;
+    }
+    default:
+        break;
+    }
 }
 
-UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
-    UA_ASSERT_RCU_LOCKED();
-    struct cds_lfht *ht = (struct cds_lfht*)ns;
-    UA_UInt32 h = UA_NodeId_hash(nodeid);
-    struct cds_lfht_iter iter;
-    cds_lfht_lookup(ht, h, compare, nodeid, &iter);
-    struct nodeEntry *entry = (struct nodeEntry*)iter.node;
-    if(!entry)
-        return NULL;
-    struct nodeEntry *new = instantiateEntry(entry->node.nodeClass);
-    if(!new)
-        return NULL;
-    if(UA_Node_copyAnyNodeClass(&entry->node, &new->node) != UA_STATUSCODE_GOOD) {
-        deleteEntry(&new->rcu_head);
-        return NULL;
+static UA_StatusCode
+loadNode(UA_Server *server, UA_Node *node) {
+    const UA_Node *old = UA_NodeStore_get(server->nodestore, &node->nodeId);
+    if(old) {
+        if(old->nodeClass == node->nodeClass)
+            takeRuntimeMembers(node, old);
+        UA_NodeStore_remove(server->nodestore, &node->nodeId);
     }
-    new->orig = entry;
-    return &new->node;
+    return UA_NodeStore_insert(server->nodestore, node);
 }
 
-void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor) {
-    UA_ASSERT_RCU_LOCKED();
-    struct cds_lfht *ht = (struct cds_lfht*)ns;
-    struct cds_lfht_iter iter;
-    cds_lfht_first(ht, &iter);
-    while(iter.node != NULL) {
-        struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
-        visitor(&found_entry->node);
-        cds_lfht_next(ht, &iter);
+/* The namespace indices of the image must be valid in the server */
+static UA_StatusCode
+loadNamespaces(UA_Server *server, const UA_ByteString *image, size_t *offset) {
+    UA_String *namespaces;
+    size_t namespacesSize;
+    UA_StatusCode retval = readArray(image, offset, (void**)&namespaces,
+                                     &namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    for(size_t i = 0; i < namespacesSize; ++i) {
+        if(addNamespace(server, namespaces[i]) != i) {
+            retval = UA_STATUSCODE_BADINVALIDARGUMENT;
+            break;
+        }
     }
+    UA_Array_delete(namespaces, namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
+    return retval;
 }
 
-#endif /* UA_ENABLE_MULTITHREADING */
+UA_StatusCode
+UA_Server_loadNodestoreSnapshot(UA_Server *server, const UA_ByteString *image) {
+    size_t offset = 0;
+    UA_UInt32 magic = 0, version = 0, nodesCount = 0;
+    UA_StatusCode retval = UA_decodeBinary(image, &offset, &magic, &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_decodeBinary(image, &offset, &version, &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval != UA_STATUSCODE_GOOD || magic != UA_SNAPSHOT_MAGIC ||
+       version != UA_SNAPSHOT_VERSION)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    retval = loadNamespaces(server, image, &offset);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_decodeBinary(image, &offset, &nodesCount, &UA_TYPES[UA_TYPES_UINT32]);
+
+    UA_RCU_LOCK();
+    for(UA_UInt32 i = 0; i < nodesCount && retval == UA_STATUSCODE_GOOD; ++i) {
+        UA_Node *node;
+        retval = readNode(image, &offset, &node);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = loadNode(server, node);
+    }
+    UA_RCU_UNLOCK();
+    UA_Server_invalidateTypeClosures(server);
+    return retval;
+}
 
 /*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/server/ua_services_discovery.c" ***********************************/
 
@@ -20124,8 +23903,13 @@ typeCheckValue(UA_Server *server, const UA_NodeId *targetDataTypeId,
         goto check_array;
 
     /* Has the value a subtype of the required type? */
-    const UA_NodeId subtypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
-    if(isNodeInTree(server->nodestore, &value->type->typeId, targetDataTypeId, &subtypeId, 1))
+    if(isSubtypeOf(server, &value->type->typeId, targetDataTypeId))
+        goto check_array;
+
+    /* Lazily decoded ExtensionObjects are checked with the type of the encoded
+     * body. So they can be stored without unpacking. */
+    const UA_DataType *bodyType = UA_Variant_encodedBodyType(value);
+    if(bodyType && isSubtypeOf(server, &bodyType->typeId, targetDataTypeId))
         goto check_array;
 
     /* Try to convert to a matching value if this is wanted */
@@ -20330,9 +24114,7 @@ writeDataTypeAttribute(UA_Server *server, UA_VariableNode *node,
         return UA_STATUSCODE_BADINTERNALERROR;
 
     /* Does the new type match the constraints of the variabletype? */
-    UA_NodeId subtypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
-    if(!isNodeInTree(server->nodestore, dataType,
-                     constraintDataType, &subtypeId, 1))
+    if(!isSubtypeOf(server, dataType, constraintDataType))
         return UA_STATUSCODE_BADTYPEMISMATCH;
 
     /* Check if the current value would match the new type */
@@ -20364,56 +24146,303 @@ writeDataTypeAttribute(UA_Server *server, UA_VariableNode *node,
     return UA_STATUSCODE_GOOD;
 }
 
+/***************/
+/* Value Cache */
+/***************/
+
+#define UA_VALUECACHE_MINSIZE 64
+
+#ifdef UA_ENABLE_MULTITHREADING
+# define UA_VALUECACHE_LOCK(server) pthread_mutex_lock(&(server)->valueCache_mutex)
+# define UA_VALUECACHE_UNLOCK(server) pthread_mutex_unlock(&(server)->valueCache_mutex)
+#else
+# define UA_VALUECACHE_LOCK(server)
+# define UA_VALUECACHE_UNLOCK(server)
+#endif
+
+static UA_CachedValue **
+findCachedSlot(UA_CachedValue **entries, size_t size,
+               const UA_NodeId *nodeId, UA_UInt32 hash) {
+    size_t idx = hash & (size - 1);
+    while(entries[idx]) {
+        if(entries[idx]->hash == hash &&
+           UA_NodeId_equal(&entries[idx]->nodeId, nodeId))
+            break;
+        idx = (idx + 1) & (size - 1);
+    }
+    return &entries[idx];
+}
+
+static UA_CachedValue *
+findCachedValue(const UA_ValueCache *vc, const UA_NodeId *nodeId) {
+    if(vc->entriesCount == 0)
+        return NULL;
+    return *findCachedSlot(vc->entries, vc->entriesSize, nodeId, UA_NodeId_hash(nodeId));
+}
+
+static void
+deleteCachedValue(UA_CachedValue *cv) {
+    UA_NodeId_deleteMembers(&cv->nodeId);
+    UA_DataValue_deleteMembers(&cv->value);
+    UA_free(cv);
+}
+
+/* The following entries of the probe sequence are moved back into the gap if
+ * the gap lies between their home slot and their current slot */
+static void
+removeCachedValue(UA_ValueCache *vc, UA_CachedValue **slot) {
+    UA_CachedValue *cv = *slot;
+    TAILQ_REMOVE(&vc->lru, cv, lru);
+    vc->memory -= cv->memory;
+    --vc->entriesCount;
+    deleteCachedValue(cv);
+
+    size_t mask = vc->entriesSize - 1;
+    size_t gap = (size_t)(slot - vc->entries);
+    size_t idx = (gap + 1) & mask;
+    while(vc->entries[idx]) {
+        size_t home = vc->entries[idx]->hash & mask;
+        if(((idx - home) & mask) >= ((idx - gap) & mask)) {
+            vc->entries[gap] = vc->entries[idx];
+            gap = idx;
+        }
+        idx = (idx + 1) & mask;
+    }
+    vc->entries[gap] = NULL;
+}
+
+static void
+clearValueCache(UA_ValueCache *vc) {
+    UA_CachedValue *cv, *cv_tmp;
+    TAILQ_FOREACH_SAFE(cv, &vc->lru, lru, cv_tmp)
+        deleteCachedValue(cv);
+    TAILQ_INIT(&vc->lru);
+    UA_free(vc->entries);
+    vc->entries = NULL;
+    vc->entriesSize = 0;
+    vc->entriesCount = 0;
+    vc->memory = 0;
+}
+
+/* Keep the occupancy below 50% */
+static UA_StatusCode
+growValueCache(UA_ValueCache *vc) {
+    size_t nsize = vc->entriesSize * 2;
+    if(nsize < UA_VALUECACHE_MINSIZE)
+        nsize = UA_VALUECACHE_MINSIZE;
+    UA_CachedValue **nentries = UA_calloc(nsize, sizeof(UA_CachedValue*));
+    if(!nentries)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_CachedValue *cv;
+    TAILQ_FOREACH(cv, &vc->lru, lru)
+        *findCachedSlot(nentries, nsize, &cv->nodeId, cv->hash) = cv;
+    UA_free(vc->entries);
+    vc->entries = nentries;
+    vc->entriesSize = nsize;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Copies the cached value into v if it is younger than maxAge (in ms) */
+static UA_Boolean
+readCachedValue(UA_Server *server, const UA_NodeId *nodeId, UA_Double maxAge,
+                UA_TimestampsToReturn timestamps, UA_DataValue *v) {
+    UA_ValueCache *vc = &server->valueCache;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    UA_Boolean hit = false;
+    UA_VALUECACHE_LOCK(server);
+    UA_CachedValue *cv = findCachedValue(vc, nodeId);
+    if(cv && (UA_Double)(now - cv->readTime) <= maxAge * UA_MSEC_TO_DATETIME &&
+       UA_DataValue_copyShared(&cv->value, v) == UA_STATUSCODE_GOOD) {
+        TAILQ_REMOVE(&vc->lru, cv, lru);
+        TAILQ_INSERT_TAIL(&vc->lru, cv, lru);
+        hit = true;
+        ++vc->hits;
+    } else {
+        ++vc->misses;
+    }
+    UA_VALUECACHE_UNLOCK(server);
+
+    /* Return the time when the value was read from the source */
+    if(hit && timestamps != UA_TIMESTAMPSTORETURN_SERVER &&
+       timestamps != UA_TIMESTAMPSTORETURN_BOTH)
+        v->hasServerTimestamp = false;
+    return hit;
+}
+
+/* The value is copied outside of the lock. Then it replaces the previous value
+ * of the node. The least recently used values are evicted to stay within the
+ * memory budget. */
+static void
+cacheValue(UA_Server *server, const UA_NodeId *nodeId, const UA_DataValue *value) {
+    UA_CachedValue *cv = UA_malloc(sizeof(UA_CachedValue));
+    if(!cv)
+        return;
+    if(UA_DataValue_copyShared(value, &cv->value) != UA_STATUSCODE_GOOD) {
+        UA_free(cv);
+        return;
+    }
+    if(UA_NodeId_copy(nodeId, &cv->nodeId) != UA_STATUSCODE_GOOD) {
+        UA_DataValue_deleteMembers(&cv->value);
+        UA_free(cv);
+        return;
+    }
+    if(!cv->value.hasServerTimestamp) {
+        cv->value.serverTimestamp = UA_DateTime_now();
+        cv->value.hasServerTimestamp = true;
+    }
+    cv->hash = UA_NodeId_hash(nodeId);
+    cv->readTime = UA_DateTime_nowMonotonic();
+    cv->memory = sizeof(UA_CachedValue) + UA_calcSizeFlat(nodeId, &UA_TYPES[UA_TYPES_NODEID]) +
+        UA_calcSizeFlat(&value->value, &UA_TYPES[UA_TYPES_VARIANT]);
+
+    UA_ValueCache *vc = &server->valueCache;
+    UA_VALUECACHE_LOCK(server);
+    size_t budget = server->config.valueCacheSize;
+    if(cv->memory > budget ||
+       ((vc->entriesCount + 1) * 2 > vc->entriesSize &&
+        growValueCache(vc) != UA_STATUSCODE_GOOD)) {
+        UA_VALUECACHE_UNLOCK(server);
+        deleteCachedValue(cv);
+        return;
+    }
+
+    UA_CachedValue **slot = findCachedSlot(vc->entries, vc->entriesSize, nodeId, cv->hash);
+    if(*slot) {
+        UA_CachedValue *old = *slot;
+        TAILQ_REMOVE(&vc->lru, old, lru);
+        vc->memory -= old->memory;
+        deleteCachedValue(old);
+    } else {
+        ++vc->entriesCount;
+    }
+    *slot = cv;
+    TAILQ_INSERT_TAIL(&vc->lru, cv, lru);
+    vc->memory += cv->memory;
+
+    while(vc->memory > budget) {
+        UA_CachedValue *lru = TAILQ_FIRST(&vc->lru);
+        removeCachedValue(vc, findCachedSlot(vc->entries, vc->entriesSize,
+                                             &lru->nodeId, lru->hash));
+        ++vc->evictions;
+    }
+    UA_VALUECACHE_UNLOCK(server);
+}
+
+void
+UA_Server_invalidateCachedValue(UA_Server *server, const UA_NodeId *nodeId) {
+    UA_ValueCache *vc = &server->valueCache;
+    UA_VALUECACHE_LOCK(server);
+    if(!nodeId) {
+        clearValueCache(vc);
+    } else if(vc->entriesCount > 0) {
+        UA_CachedValue **slot = findCachedSlot(vc->entries, vc->entriesSize,
+                                               nodeId, UA_NodeId_hash(nodeId));
+        if(*slot)
+            removeCachedValue(vc, slot);
+    }
+    UA_VALUECACHE_UNLOCK(server);
+}
+
+UA_StatusCode
+UA_Server_getValueCacheStatistics(UA_Server *server, UA_ValueCacheStatistics *stats) {
+    const UA_ValueCache *vc = &server->valueCache;
+    UA_VALUECACHE_LOCK(server);
+    stats->values = vc->entriesCount;
+    stats->bytes = vc->memory;
+    stats->hits = vc->hits;
+    stats->misses = vc->misses;
+    stats->evictions = vc->evictions;
+    UA_VALUECACHE_UNLOCK(server);
+    return UA_STATUSCODE_GOOD;
+}
+
 /*******************/
 /* Value Attribute */
 /*******************/
 
 static UA_StatusCode
 readValueAttributeFromNode(UA_Server *server, const UA_VariableNode *vn, UA_DataValue *v,
-                           UA_NumericRange *rangeptr) {
+                           const UA_NumericRange *rangeptr) {
     if(vn->value.data.callback.onRead) {
         UA_RCU_UNLOCK();
         vn->value.data.callback.onRead(vn->value.data.callback.handle,
-                                       vn->nodeId, &vn->value.data.value.value, rangeptr);
+                                       vn->nodeId, &getVariableValue(vn)->value, rangeptr);
         UA_RCU_LOCK();
 #ifdef UA_ENABLE_MULTITHREADING
         /* Reopen the node to see the changes (multithreading only) */
         vn = (const UA_VariableNode*)UA_NodeStore_get(server->nodestore, &vn->nodeId);
+        if(!vn)
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
 #endif
     }
-    if(rangeptr)
-        return UA_Variant_copyRange(&vn->value.data.value.value, &v->value, *rangeptr);
-    *v = vn->value.data.value;
+    const UA_DataValue *value = getVariableValue(vn);
+    if(rangeptr) {
+        /* Contiguous ranges are returned as a view into the node, just like
+         * the entire value below. Everything else is copied. */
+        if(UA_Variant_viewRange(&value->value, &v->value,
+                                *rangeptr) == UA_STATUSCODE_GOOD)
+            return UA_STATUSCODE_GOOD;
+        return UA_Variant_copyRange(&value->value, &v->value, *rangeptr);
+    }
+    /* Shared values are returned as a new reference. Otherwise, the value is
+     * a view into the node. */
+    if(value->value.storageType == UA_VARIANT_DATA_SHARED)
+        return UA_DataValue_copyShared(value, v);
+    *v = *value;
     v->value.storageType = UA_VARIANT_DATA_NODELETE;
     return UA_STATUSCODE_GOOD;
 }
 
+/* Asynchronous DataSources are only used if the caller can wait for the
+ * completion (async is set). Entire values are served from the cache if they
+ * are younger than maxAge (in ms). */
 static UA_StatusCode
-readValueAttributeFromDataSource(const UA_VariableNode *vn, UA_DataValue *v,
-                                 UA_TimestampsToReturn timestamps,
-                                 UA_NumericRange *rangeptr) {
-    if(!vn->value.dataSource.read)
+readValueAttributeFromDataSource(UA_Server *server, const UA_VariableNode *vn,
+                                 UA_DataValue *v, UA_TimestampsToReturn timestamps,
+                                 const UA_NumericRange *rangeptr, UA_Double maxAge,
+                                 const UA_AsyncOperationId *async) {
+    /* Only reads with a maxAge use the cache. The others (including the
+     * sampling of MonitoredItems) read the source directly. */
+    UA_Boolean cache = (maxAge > 0.0 && server->config.valueCacheSize > 0 && !rangeptr);
+    if(cache && readCachedValue(server, &vn->nodeId, maxAge, timestamps, v))
+        return UA_STATUSCODE_GOOD;
+
+    UA_Boolean useAsync = (async && vn->value.dataSource.readAsync);
+    if(!useAsync && !vn->value.dataSource.source.read)
         return UA_STATUSCODE_BADINTERNALERROR;
-    UA_Boolean sourceTimeStamp = (timestamps == UA_TIMESTAMPSTORETURN_SOURCE ||
+
+    /* Cached values have the source timestamp for all later reads */
+    UA_Boolean sourceTimeStamp = (cache || timestamps == UA_TIMESTAMPSTORETURN_SOURCE ||
                                   timestamps == UA_TIMESTAMPSTORETURN_BOTH);
 
     UA_RCU_UNLOCK();
-    UA_StatusCode retval =
-        vn->value.dataSource.read(vn->value.dataSource.handle, vn->nodeId,
-                                  sourceTimeStamp, rangeptr, v);
+    UA_StatusCode retval;
+    if(useAsync)
+        retval = vn->value.dataSource.readAsync(vn->value.dataSource.source.handle,
+                                                vn->nodeId, sourceTimeStamp, rangeptr,
+                                                *async, v);
+    else
+        retval = vn->value.dataSource.source.read(vn->value.dataSource.source.handle,
+                                                  vn->nodeId, sourceTimeStamp, rangeptr, v);
     UA_RCU_LOCK();
+
+    /* Asynchronous reads are not cached when they complete */
+    if(cache && retval == UA_STATUSCODE_GOOD)
+        cacheValue(server, &vn->nodeId, v);
     return retval;
 }
 
+/* The index range is either pre-parsed or parsed from the string */
 static UA_StatusCode
 readValueAttributeComplete(UA_Server *server, const UA_VariableNode *vn,
                            UA_TimestampsToReturn timestamps, const UA_String *indexRange,
-                           UA_DataValue *v) {
+                           const UA_NumericRange *parsedRange, UA_Double maxAge,
+                           const UA_AsyncOperationId *async, UA_DataValue *v) {
     /* Compute the index range */
     UA_NumericRange range;
-    UA_NumericRange *rangeptr = NULL;
+    const UA_NumericRange *rangeptr = parsedRange;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    if(indexRange && indexRange->length > 0) {
+    if(!rangeptr && indexRange && indexRange->length > 0) {
         retval = parse_numericrange(indexRange, &range);
         if(retval != UA_STATUSCODE_GOOD)
             return retval;
@@ -20424,36 +24453,38 @@ readValueAttributeComplete(UA_Server *server, const UA_VariableNode *vn,
     if(vn->valueSource == UA_VALUESOURCE_DATA)
         retval = readValueAttributeFromNode(server, vn, v, rangeptr);
     else
-        retval = readValueAttributeFromDataSource(vn, v, timestamps, rangeptr);
+        retval = readValueAttributeFromDataSource(server, vn, v, timestamps,
+                                                  rangeptr, maxAge, async);
 
     /* Clean up */
-    if(rangeptr)
+    if(rangeptr && rangeptr != parsedRange)
         UA_free(range.dimensions);
     return retval;
 }
 
 UA_StatusCode
 readValueAttribute(UA_Server *server, const UA_VariableNode *vn, UA_DataValue *v) {
-    return readValueAttributeComplete(server, vn, UA_TIMESTAMPSTORETURN_NEITHER, NULL, v);
+    return readValueAttributeComplete(server, vn, UA_TIMESTAMPSTORETURN_NEITHER,
+                                      NULL, NULL, 0.0, NULL, v);
 }
 
 static UA_StatusCode
-writeValueAttributeWithoutRange(UA_VariableNode *node, const UA_DataValue *value) {
-    UA_DataValue old_value = node->value.data.value; /* keep the pointers for restoring */
-    UA_StatusCode retval = UA_DataValue_copy(value, &node->value.data.value);
+writeDataValueWithoutRange(UA_DataValue *target, const UA_DataValue *value) {
+    UA_DataValue old_value = *target; /* keep the pointers for restoring */
+    UA_StatusCode retval = UA_DataValue_copyShared(value, target);
     if(retval == UA_STATUSCODE_GOOD)
         UA_DataValue_deleteMembers(&old_value);
     else
-        node->value.data.value = old_value;
+        *target = old_value;
     return retval;
 }
 
 static UA_StatusCode
-writeValueAttributeWithRange(UA_VariableNode *node, const UA_DataValue *value,
-                             const UA_NumericRange *rangeptr) {
+writeDataValueWithRange(UA_DataValue *target, const UA_DataValue *value,
+                        const UA_NumericRange *rangeptr) {
     /* Value on both sides? */
-    if(value->status != node->value.data.value.status ||
-       !value->hasValue || !node->value.data.value.hasValue)
+    if(value->status != target->status ||
+       !value->hasValue || !target->hasValue)
         return UA_STATUSCODE_BADINDEXRANGEINVALID;
 
     /* Make scalar a one-entry array for range matching */
@@ -20466,54 +24497,259 @@ writeValueAttributeWithRange(UA_VariableNode *node, const UA_DataValue *value,
     }
 
     /* Write the value */
-    UA_StatusCode retval = UA_Variant_setRangeCopy(&node->value.data.value.value,
+    UA_StatusCode retval = UA_Variant_setRangeCopy(&target->value,
                                                    v->data, v->arrayLength, *rangeptr);
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
 
     /* Write the status and timestamps */
-    node->value.data.value.hasStatus = value->hasStatus;
-    node->value.data.value.status = value->status;
-    node->value.data.value.hasSourceTimestamp = value->hasSourceTimestamp;
-    node->value.data.value.sourceTimestamp = value->sourceTimestamp;
-    node->value.data.value.hasSourcePicoseconds = value->hasSourcePicoseconds;
-    node->value.data.value.sourcePicoseconds = value->sourcePicoseconds;
+    target->hasStatus = value->hasStatus;
+    target->status = value->status;
+    target->hasSourceTimestamp = value->hasSourceTimestamp;
+    target->sourceTimestamp = value->sourceTimestamp;
+    target->hasSourcePicoseconds = value->hasSourcePicoseconds;
+    target->sourcePicoseconds = value->sourcePicoseconds;
     return UA_STATUSCODE_GOOD;
 }
 
-UA_StatusCode
-writeValueAttribute(UA_Server *server, UA_VariableNode *node,
-                    const UA_DataValue *value, const UA_String *indexRange) {
-    /* Parse the range */
+#ifndef UA_ENABLE_MULTITHREADING
+
+static UA_StatusCode
+writeValueAttributeWithoutRange(UA_VariableNode *node, const UA_DataValue *value) {
+    return writeDataValueWithoutRange(&node->value.data.value, value);
+}
+
+static UA_StatusCode
+writeValueAttributeWithRange(UA_VariableNode *node, const UA_DataValue *value,
+                             const UA_NumericRange *rangeptr) {
+    return writeDataValueWithRange(&node->value.data.value, value, rangeptr);
+}
+
+#else
+
+static void
+freePublishedValue(struct rcu_head *head) {
+    UA_PublishedValue_delete(container_of(head, UA_PublishedValue, rcu_head));
+}
+
+/* Move the value of the node into a new slot. This changes the node and is
+ * done on the copy from UA_Server_editNode. */
+static UA_StatusCode
+createValueSlot(UA_VariableNode *node) {
+    UA_ValueSlot *slot = UA_malloc(sizeof(UA_ValueSlot));
+    if(!slot)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    slot->current = UA_malloc(sizeof(UA_PublishedValue));
+    if(!slot->current) {
+        UA_free(slot);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    slot->current->value = node->value.data.value;
+    slot->refCount = 1;
+    UA_DataValue_init(&node->value.data.value);
+    node->value.data.slot = slot;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Publish a copy of the value in the slot. The node is not involved, so this
+ * is safe on the live node. Concurrent writers of a range retry until their
+ * update is based on the current value. */
+static UA_StatusCode
+publishValue(UA_ValueSlot *slot, const UA_DataValue *value,
+             const UA_NumericRange *rangeptr) {
+    while(true) {
+        UA_PublishedValue *pv = UA_malloc(sizeof(UA_PublishedValue));
+        if(!pv)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        UA_PublishedValue *old = rcu_dereference(slot->current);
+        UA_StatusCode retval;
+        if(!rangeptr) {
+            retval = UA_DataValue_copyShared(value, &pv->value);
+        } else {
+            retval = UA_DataValue_copyShared(&old->value, &pv->value);
+            if(retval == UA_STATUSCODE_GOOD)
+                retval = writeDataValueWithRange(&pv->value, value, rangeptr);
+        }
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_PublishedValue_delete(pv);
+            return retval;
+        }
+        if(!rangeptr) {
+            old = rcu_xchg_pointer(&slot->current, pv);
+        } else if(rcu_cmpxchg_pointer(&slot->current, old, pv) != old) {
+            UA_PublishedValue_delete(pv);
+            continue;
+        }
+        call_rcu(&old->rcu_head, freePublishedValue);
+        return UA_STATUSCODE_GOOD;
+    }
+}
+
+static UA_StatusCode
+writeValueAttributeWithoutRange(UA_VariableNode *node, const UA_DataValue *value) {
+    if(!node->value.data.slot) {
+        UA_StatusCode retval = createValueSlot(node);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    return publishValue(node->value.data.slot, value, NULL);
+}
+
+static UA_StatusCode
+writeValueAttributeWithRange(UA_VariableNode *node, const UA_DataValue *value,
+                             const UA_NumericRange *rangeptr) {
+    if(!node->value.data.slot) {
+        UA_StatusCode retval = createValueSlot(node);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    return publishValue(node->value.data.slot, value, rangeptr);
+}
+
+#endif
+
+/* A value that is unpacked, type checked and ready to be written. The index
+ * range is parsed (rangeptr is NULL without a range). The struct must not be
+ * moved, as rangeptr points into it. */
+typedef struct {
+    UA_DataValue value; /* does not own the data */
+    UA_Variant unpacked;
     UA_NumericRange range;
-    UA_NumericRange *rangeptr = NULL;
+    UA_NumericRange *rangeptr;
+} PreparedWrite;
+
+static void
+PreparedWrite_deleteMembers(PreparedWrite *pw) {
+    UA_Variant_deleteMembers(&pw->unpacked);
+    if(pw->rangeptr)
+        UA_free(pw->range.dimensions);
+    pw->rangeptr = NULL;
+}
+
+static UA_StatusCode
+prepareValueWrite(UA_Server *server, const UA_VariableNode *node,
+                  const UA_DataValue *value, const UA_String *indexRange,
+                  PreparedWrite *pw) {
+    UA_Variant_init(&pw->unpacked);
+    pw->rangeptr = NULL;
+
+    /* Parse the range */
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     if(indexRange && indexRange->length > 0) {
-        retval = parse_numericrange(indexRange, &range);
+        retval = parse_numericrange(indexRange, &pw->range);
         if(retval != UA_STATUSCODE_GOOD)
             return retval;
-        rangeptr = &range;
+        pw->rangeptr = &pw->range;
     }
 
     /* Copy the value into an editable "container" where e.g. the datatype can
      * be adjusted. The data itself is not written into. */
-    UA_DataValue editableValue = *value;
-    editableValue.value.storageType = UA_VARIANT_DATA_NODELETE;
+    UA_DataValue *editableValue = &pw->value;
+    *editableValue = *value;
+    editableValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+
+    /* Lazily decoded values remain encoded when they are stored in the node.
+     * Unpack them if they are handed to user code or merged into a range. */
+    if(value->hasValue && UA_Variant_encodedBodyType(&value->value) &&
+       (pw->rangeptr || node->valueSource == UA_VALUESOURCE_DATASOURCE ||
+        node->value.data.callback.onWrite)) {
+        retval = UA_Variant_copy(&value->value, &pw->unpacked);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = UA_Variant_decodeBody(&pw->unpacked);
+        if(retval != UA_STATUSCODE_GOOD)
+            goto cleanup;
+        editableValue->value = pw->unpacked;
+        editableValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+    }
 
     /* Type checking. May change the type of editableValue */
     if(value->hasValue) {
         retval = typeCheckValue(server, &node->dataType, node->valueRank,
                                 node->arrayDimensionsSize, node->arrayDimensions,
-                                &value->value, rangeptr, &editableValue.value);
+                                &editableValue->value, pw->rangeptr, &editableValue->value);
         if(retval != UA_STATUSCODE_GOOD)
             goto cleanup;
     }
 
+    /* A shared value that was not adjusted is shared with the node */
+    if(value->value.storageType == UA_VARIANT_DATA_SHARED &&
+       editableValue->value.data == value->value.data &&
+       editableValue->value.arrayDimensions == value->value.arrayDimensions)
+        editableValue->value.storageType = UA_VARIANT_DATA_SHARED;
+
     /* Set the source timestamp if there is none */
-    if(!editableValue.hasSourceTimestamp) {
-        editableValue.sourceTimestamp = UA_DateTime_now();
-        editableValue.hasSourceTimestamp = true;
+    if(!editableValue->hasSourceTimestamp) {
+        editableValue->sourceTimestamp = UA_DateTime_now();
+        editableValue->hasSourceTimestamp = true;
+    }
+    return UA_STATUSCODE_GOOD;
+
+ cleanup:
+    PreparedWrite_deleteMembers(pw);
+    return retval;
+}
+
+/* The node is written in-situ (singlethreaded) or the value was published in
+ * the slot that all versions of the node share (multithreaded) */
+static void
+callOnWrite(const UA_VariableNode *node, const UA_NumericRange *rangeptr) {
+    if(node->valueSource != UA_VALUESOURCE_DATA || !node->value.data.callback.onWrite)
+        return;
+#ifdef UA_ENABLE_MULTITHREADING
+    /* The callback runs outside the RCU read lock. Then the value slot and the
+     * node may be reclaimed. Hold a reference on the value and a copy of the
+     * NodeId instead. */
+    UA_ValueCallback callback = node->value.data.callback;
+    UA_Variant written;
+    UA_NodeId nodeId;
+    if(UA_Variant_copyShared(&getVariableValue(node)->value, &written) != UA_STATUSCODE_GOOD)
+        return;
+    if(UA_NodeId_copy(&node->nodeId, &nodeId) != UA_STATUSCODE_GOOD) {
+        UA_Variant_deleteMembers(&written);
+        return;
     }
+    UA_RCU_UNLOCK();
+    callback.onWrite(callback.handle, nodeId, &written, rangeptr);
+    UA_RCU_LOCK();
+    UA_Variant_deleteMembers(&written);
+    UA_NodeId_deleteMembers(&nodeId);
+#else
+    node->value.data.callback.onWrite(node->value.data.callback.handle,
+                                      node->nodeId, &getVariableValue(node)->value,
+                                      rangeptr);
+#endif
+}
+
+/* The DataSource is called outside the RCU read lock. With multithreading,
+ * the node may be reclaimed meanwhile. So the NodeId is copied first. */
+static UA_StatusCode
+writeDataSourceValue(UA_Server *server, const UA_VariableNode *node,
+                     const UA_DataValue *value, const UA_NumericRange *rangeptr) {
+    UA_DataSource source = node->value.dataSource.source;
+    if(!source.write)
+        return UA_STATUSCODE_BADWRITENOTSUPPORTED;
+    UA_NodeId nodeId;
+    UA_StatusCode retval = UA_NodeId_copy(&node->nodeId, &nodeId);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_RCU_UNLOCK();
+    retval = source.write(source.handle, nodeId, &value->value, rangeptr);
+    UA_RCU_LOCK();
+    UA_Server_invalidateCachedValue(server, &nodeId);
+    UA_NodeId_deleteMembers(&nodeId);
+    return retval;
+}
+
+/* Without callback, calling the onWrite callback is left to the caller */
+static UA_StatusCode
+writeValue(UA_Server *server, UA_VariableNode *node, const UA_DataValue *value,
+           const UA_String *indexRange, UA_Boolean callback) {
+    PreparedWrite pw;
+    UA_StatusCode retval = prepareValueWrite(server, node, value, indexRange, &pw);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_DataValue editableValue = pw.value;
+    UA_NumericRange *rangeptr = pw.rangeptr;
 
     /* Ok, do it */
     if(node->valueSource == UA_VALUESOURCE_DATA) {
@@ -20521,40 +24757,44 @@ writeValueAttribute(UA_Server *server, UA_VariableNode *node,
             retval = writeValueAttributeWithoutRange(node, &editableValue);
         else
             retval = writeValueAttributeWithRange(node, &editableValue, rangeptr);
+        if(retval == UA_STATUSCODE_GOOD && callback)
+            callOnWrite(node, rangeptr);
+    } else {
+        retval = writeDataSourceValue(server, node, &editableValue, rangeptr);
+    }
+
+    PreparedWrite_deleteMembers(&pw);
+    return retval;
+}
 
-        /* Callback after writing */
-        if(retval == UA_STATUSCODE_GOOD && node->value.data.callback.onWrite) {
-            const UA_VariableNode *writtenNode;
 #ifdef UA_ENABLE_MULTITHREADING
-            /* Reopen the node to see the changes (multithreading only) */
-            writtenNode = (const UA_VariableNode*)UA_NodeStore_get(server->nodestore, &node->nodeId);
-#else
-            writtenNode = node; /* The node is written in-situ (TODO: this might
-                                   change with the nodestore plugin approach) */
-#endif
-            UA_RCU_UNLOCK();
-            writtenNode->value.data.callback.onWrite(writtenNode->value.data.callback.handle,
-                                                     writtenNode->nodeId,
-                                                     &writtenNode->value.data.value.value, rangeptr);
-            UA_RCU_LOCK();
-        }
+/* Write the value of the live node in the nodestore. The node has a value slot
+ * or a DataSource and is never changed. Other threads read it concurrently. */
+static UA_StatusCode
+writeValueShared(UA_Server *server, const UA_VariableNode *node,
+                 const UA_DataValue *value, const UA_String *indexRange,
+                 UA_Boolean callback) {
+    PreparedWrite pw;
+    UA_StatusCode retval = prepareValueWrite(server, node, value, indexRange, &pw);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if(node->valueSource == UA_VALUESOURCE_DATA) {
+        retval = publishValue(node->value.data.slot, &pw.value, pw.rangeptr);
+        if(retval == UA_STATUSCODE_GOOD && callback)
+            callOnWrite(node, pw.rangeptr);
     } else {
-        if(node->value.dataSource.write) {
-            UA_RCU_UNLOCK();
-            retval = node->value.dataSource.write(node->value.dataSource.handle,
-                                                  node->nodeId, &editableValue.value, rangeptr);
-            UA_RCU_LOCK();
-        } else {
-            retval = UA_STATUSCODE_BADWRITENOTSUPPORTED;
-        }
+        retval = writeDataSourceValue(server, node, &pw.value, pw.rangeptr);
     }
-
-    /* Clean up */
- cleanup:
-    if(rangeptr)
-        UA_free(range.dimensions);
+    PreparedWrite_deleteMembers(&pw);
     return retval;
 }
+#endif
+
+UA_StatusCode
+writeValueAttribute(UA_Server *server, UA_VariableNode *node,
+                    const UA_DataValue *value, const UA_String *indexRange) {
+    return writeValue(server, node, value, indexRange, true);
+}
 
 /************************/
 /* IsAbstract Attribute */
@@ -20620,6 +24860,42 @@ static const UA_String binEncoding = {sizeof("Default Binary")-1, (UA_Byte*)"Def
 void Service_Read_single(UA_Server *server, UA_Session *session,
                          const UA_TimestampsToReturn timestamps,
                          const UA_ReadValueId *id, UA_DataValue *v) {
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, &id->nodeId);
+    Service_Read_node(server, session, timestamps, node, id, NULL, 0.0, NULL, v);
+}
+
+static void
+setReadTimestamps(UA_DataValue *v, const UA_TimestampsToReturn timestamps,
+                  UA_Boolean isValueAttribute) {
+    /* Both timestamps are taken from the same precise clock value. So the
+     * server timestamp is never earlier than the source timestamp. Cached
+     * values keep the time they were read. */
+    UA_DateTime now = 0;
+    if((timestamps == UA_TIMESTAMPSTORETURN_SERVER ||
+        timestamps == UA_TIMESTAMPSTORETURN_BOTH) && !v->hasServerTimestamp) {
+        now = UA_DateTime_now();
+        v->serverTimestamp = now;
+        v->hasServerTimestamp = true;
+    }
+
+    /* Handle source time stamp */
+    if(isValueAttribute) {
+        if (timestamps == UA_TIMESTAMPSTORETURN_SERVER ||
+            timestamps == UA_TIMESTAMPSTORETURN_NEITHER) {
+            v->hasSourceTimestamp = false;
+            v->hasSourcePicoseconds = false;
+        } else if(!v->hasSourceTimestamp) {
+            v->sourceTimestamp = (now != 0) ? now : UA_DateTime_now();
+            v->hasSourceTimestamp = true;
+        }
+    }
+}
+
+void Service_Read_node(UA_Server *server, UA_Session *session,
+                       const UA_TimestampsToReturn timestamps, const UA_Node *node,
+                       const UA_ReadValueId *id, const UA_NumericRange *range,
+                       UA_Double maxAge, const UA_AsyncOperationId *async,
+                       UA_DataValue *v) {
     UA_LOG_DEBUG_SESSION(server->config.logger, session,
                          "Read the attribute %i", id->attributeId);
 
@@ -20632,151 +24908,653 @@ void Service_Read_single(UA_Server *server, UA_Session *session,
     }
 
     /* Index range for an attribute other than value */
-    if(id->indexRange.length > 0 && id->attributeId != UA_ATTRIBUTEID_VALUE) {
+    if((id->indexRange.length > 0 || range) && id->attributeId != UA_ATTRIBUTEID_VALUE) {
         v->hasStatus = true;
         v->status = UA_STATUSCODE_BADINDEXRANGENODATA;
         return;
     }
 
-    /* Get the node */
-    const UA_Node *node = UA_NodeStore_get(server->nodestore, &id->nodeId);
-    if(!node) {
-        v->hasStatus = true;
-        v->status = UA_STATUSCODE_BADNODEIDUNKNOWN;
+    /* The node was not found */
+    if(!node) {
+        v->hasStatus = true;
+        v->status = UA_STATUSCODE_BADNODEIDUNKNOWN;
+        return;
+    }
+
+    /* Read the attribute */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    switch(id->attributeId) {
+    case UA_ATTRIBUTEID_NODEID:
+        forceVariantSetScalar(&v->value, &node->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+        break;
+    case UA_ATTRIBUTEID_NODECLASS:
+        forceVariantSetScalar(&v->value, &node->nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
+        break;
+    case UA_ATTRIBUTEID_BROWSENAME:
+        forceVariantSetScalar(&v->value, &node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+        break;
+    case UA_ATTRIBUTEID_DISPLAYNAME:
+        forceVariantSetScalar(&v->value, &node->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    case UA_ATTRIBUTEID_DESCRIPTION:
+        forceVariantSetScalar(&v->value, &node->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    case UA_ATTRIBUTEID_WRITEMASK:
+        forceVariantSetScalar(&v->value, &node->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+        break;
+    case UA_ATTRIBUTEID_USERWRITEMASK:
+        forceVariantSetScalar(&v->value, &node->userWriteMask, &UA_TYPES[UA_TYPES_UINT32]);
+        break;
+    case UA_ATTRIBUTEID_ISABSTRACT:
+        retval = readIsAbstractAttribute(node, &v->value);
+        break;
+    case UA_ATTRIBUTEID_SYMMETRIC:
+        CHECK_NODECLASS(UA_NODECLASS_REFERENCETYPE);
+        forceVariantSetScalar(&v->value, &((const UA_ReferenceTypeNode*)node)->symmetric,
+                              &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_ATTRIBUTEID_INVERSENAME:
+        CHECK_NODECLASS(UA_NODECLASS_REFERENCETYPE);
+        forceVariantSetScalar(&v->value, &((const UA_ReferenceTypeNode*)node)->inverseName,
+                              &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    case UA_ATTRIBUTEID_CONTAINSNOLOOPS:
+        CHECK_NODECLASS(UA_NODECLASS_VIEW);
+        forceVariantSetScalar(&v->value, &((const UA_ViewNode*)node)->containsNoLoops,
+                              &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_ATTRIBUTEID_EVENTNOTIFIER:
+        CHECK_NODECLASS(UA_NODECLASS_VIEW | UA_NODECLASS_OBJECT);
+        forceVariantSetScalar(&v->value, &((const UA_ViewNode*)node)->eventNotifier,
+                              &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_ATTRIBUTEID_VALUE:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
+        retval = readValueAttributeComplete(server, (const UA_VariableNode*)node, timestamps,
+                                            &id->indexRange, range, maxAge, async, v);
+        break;
+    case UA_ATTRIBUTEID_DATATYPE:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableTypeNode*)node)->dataType,
+                              &UA_TYPES[UA_TYPES_NODEID]);
+        break;
+    case UA_ATTRIBUTEID_VALUERANK:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableTypeNode*)node)->valueRank,
+                              &UA_TYPES[UA_TYPES_INT32]);
+        break;
+    case UA_ATTRIBUTEID_ARRAYDIMENSIONS:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
+        retval = readArrayDimensionsAttribute((const UA_VariableNode*)node, v);
+        break;
+    case UA_ATTRIBUTEID_ACCESSLEVEL:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->accessLevel,
+                              &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_ATTRIBUTEID_USERACCESSLEVEL:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->userAccessLevel,
+                              &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_ATTRIBUTEID_MINIMUMSAMPLINGINTERVAL:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->minimumSamplingInterval,
+                              &UA_TYPES[UA_TYPES_DOUBLE]);
+        break;
+    case UA_ATTRIBUTEID_HISTORIZING:
+        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
+        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->historizing,
+                              &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_ATTRIBUTEID_EXECUTABLE:
+        CHECK_NODECLASS(UA_NODECLASS_METHOD);
+        forceVariantSetScalar(&v->value, &((const UA_MethodNode*)node)->executable,
+                              &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_ATTRIBUTEID_USEREXECUTABLE:
+        CHECK_NODECLASS(UA_NODECLASS_METHOD);
+        forceVariantSetScalar(&v->value, &((const UA_MethodNode*)node)->userExecutable,
+                              &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    default:
+        retval = UA_STATUSCODE_BADATTRIBUTEIDINVALID;
+    }
+
+    /* Return error code when reading has failed */
+    if(retval != UA_STATUSCODE_GOOD) {
+        v->hasStatus = true;
+        v->status = retval;
+        return;
+    }
+
+    v->hasValue = true;
+    setReadTimestamps(v, timestamps, id->attributeId == UA_ATTRIBUTEID_VALUE);
+}
+
+/*******************/
+/* Batch Providers */
+/*******************/
+
+/* Returns the provider if the value of the node is read (or written) in
+ * batches */
+static const UA_DataSourceProvider *
+batchProvider(const UA_Node *node, UA_UInt32 attributeId, UA_Boolean write) {
+    if(!node || node->nodeClass != UA_NODECLASS_VARIABLE ||
+       attributeId != UA_ATTRIBUTEID_VALUE)
+        return NULL;
+    const UA_VariableNode *vn = (const UA_VariableNode*)node;
+    if(vn->valueSource != UA_VALUESOURCE_DATASOURCE)
+        return NULL;
+    const UA_DataSourceProvider *provider = vn->value.dataSource.provider;
+    if(!provider || (write && !provider->writeMany) || (!write && !provider->readMany))
+        return NULL;
+    return provider;
+}
+
+/* An operation collected for a batch. The operations are reordered to group
+ * them by provider. */
+typedef struct {
+    const UA_DataSourceProvider *provider;
+    UA_DataSourceOperation operation; /* without the range */
+    UA_NumericRange range; /* parsed by the batch (dimensionsSize == 0 if none) */
+    const UA_NumericRange *parsedRange; /* parsed by the caller (or NULL) */
+    size_t index; /* position of the result */
+    UA_TimestampsToReturn timestamps; /* read */
+    UA_Boolean cacheResult; /* read with a maxAge */
+    const UA_Variant *value; /* write */
+    UA_StatusCode status; /* write */
+} BatchOperation;
+
+static UA_StatusCode
+initBatchOperation(BatchOperation *op, const UA_VariableNode *vn, size_t index,
+                   const UA_String *indexRange, const UA_NumericRange *parsedRange) {
+    memset(op, 0, sizeof(BatchOperation));
+    op->provider = vn->value.dataSource.provider;
+    op->operation.nodeId = vn->nodeId;
+    op->operation.handle = vn->value.dataSource.source.handle;
+    op->parsedRange = parsedRange;
+    op->index = index;
+    if(parsedRange || !indexRange || indexRange->length == 0)
+        return UA_STATUSCODE_GOOD;
+    return parse_numericrange(indexRange, &op->range);
+}
+
+static void
+deleteBatchOperations(BatchOperation *ops, size_t opsSize) {
+    for(size_t i = 0; i < opsSize; ++i)
+        UA_free(ops[i].range.dimensions);
+    UA_free(ops);
+}
+
+/* Moves the operations with the provider of ops[0] to the front. Returns the
+ * size of the group. */
+static size_t
+groupBatchOperations(BatchOperation *ops, size_t opsSize) {
+    size_t groupSize = 1;
+    for(size_t i = 1; i < opsSize; ++i) {
+        if(ops[i].provider != ops[0].provider)
+            continue;
+        if(i != groupSize) {
+            BatchOperation tmp = ops[groupSize];
+            ops[groupSize] = ops[i];
+            ops[i] = tmp;
+        }
+        ++groupSize;
+    }
+    return groupSize;
+}
+
+/* Sets up the operations handed to the provider */
+static void
+prepareBatchCalls(BatchOperation *ops, size_t groupSize, UA_DataSourceOperation *calls) {
+    for(size_t i = 0; i < groupSize; ++i) {
+        calls[i] = ops[i].operation;
+        if(ops[i].parsedRange)
+            calls[i].range = ops[i].parsedRange;
+        else if(ops[i].range.dimensionsSize > 0)
+            calls[i].range = &ops[i].range;
+        else
+            calls[i].range = NULL;
+    }
+}
+
+/* Reads the values with one call per provider. values[i] is the result of
+ * ops[i] after the operations were grouped. */
+static void
+readBatch(UA_Server *server, BatchOperation *ops, size_t opsSize, UA_DataValue *values) {
+    UA_DataSourceOperation *calls = UA_malloc(sizeof(UA_DataSourceOperation) * opsSize);
+    if(!calls) {
+        for(size_t i = 0; i < opsSize; ++i) {
+            values[i].hasStatus = true;
+            values[i].status = UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        return;
+    }
+
+    for(size_t start = 0; start < opsSize;) {
+        BatchOperation *group = &ops[start];
+        size_t groupSize = groupBatchOperations(group, opsSize - start);
+        prepareBatchCalls(group, groupSize, calls);
+        UA_Boolean sourceTimeStamp = false;
+        for(size_t i = 0; i < groupSize; ++i) {
+            if(group[i].cacheResult ||
+               group[i].timestamps == UA_TIMESTAMPSTORETURN_SOURCE ||
+               group[i].timestamps == UA_TIMESTAMPSTORETURN_BOTH)
+                sourceTimeStamp = true;
+        }
+
+        const UA_DataSourceProvider *provider = group->provider;
+        UA_RCU_UNLOCK();
+        UA_StatusCode retval = provider->readMany(provider->context, groupSize, calls,
+                                                  sourceTimeStamp, &values[start]);
+        UA_RCU_LOCK();
+
+        /* Post-process as in Service_Read_node */
+        for(size_t i = 0; i < groupSize; ++i) {
+            UA_DataValue *v = &values[start + i];
+            if(retval != UA_STATUSCODE_GOOD) {
+                v->hasStatus = true;
+                v->status = retval;
+                continue;
+            }
+            if(group[i].cacheResult && !calls[i].range)
+                cacheValue(server, &group[i].operation.nodeId, v);
+            v->hasValue = true;
+            setReadTimestamps(v, group[i].timestamps, true);
+        }
+        start += groupSize;
+    }
+    UA_free(calls);
+}
+
+/* Writes the values with one call per provider. The results are set in the
+ * status of the operations. */
+static void
+writeBatch(UA_Server *server, BatchOperation *ops, size_t opsSize) {
+    UA_DataSourceOperation *calls = UA_malloc(sizeof(UA_DataSourceOperation) * opsSize);
+    UA_Variant *values = UA_malloc(sizeof(UA_Variant) * opsSize);
+    UA_StatusCode *results = UA_malloc(sizeof(UA_StatusCode) * opsSize);
+    if(!calls || !values || !results) {
+        for(size_t i = 0; i < opsSize; ++i)
+            ops[i].status = UA_STATUSCODE_BADOUTOFMEMORY;
+        goto cleanup;
+    }
+
+    for(size_t start = 0; start < opsSize;) {
+        BatchOperation *group = &ops[start];
+        size_t groupSize = groupBatchOperations(group, opsSize - start);
+        prepareBatchCalls(group, groupSize, calls);
+        for(size_t i = 0; i < groupSize; ++i) {
+            values[i] = *group[i].value; /* shallow copy */
+            results[i] = UA_STATUSCODE_GOOD;
+        }
+
+        const UA_DataSourceProvider *provider = group->provider;
+        UA_RCU_UNLOCK();
+        UA_StatusCode retval = provider->writeMany(provider->context, groupSize, calls,
+                                                   values, results);
+        UA_RCU_LOCK();
+
+        for(size_t i = 0; i < groupSize; ++i) {
+            group[i].status = (retval != UA_STATUSCODE_GOOD) ? retval : results[i];
+            UA_Server_invalidateCachedValue(server, &group[i].operation.nodeId);
+        }
+        start += groupSize;
+    }
+
+ cleanup:
+    UA_free(calls);
+    UA_free(values);
+    UA_free(results);
+}
+
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+UA_Boolean
+MonitoredItem_sampleBatched(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                            const UA_Node *node) {
+    if(!batchProvider(node, monitoredItem->attributeID, false))
+        return false;
+    if(!monitoredItem->inSampleBatch) {
+        LIST_INSERT_HEAD(&server->sampleBatch, monitoredItem, sampleBatchEntry);
+        monitoredItem->inSampleBatch = true;
+    }
+    return true;
+}
+
+void
+UA_Server_processSampleBatch(UA_Server *server) {
+    size_t size = 0;
+    UA_MonitoredItem *mon, *mon_tmp;
+    LIST_FOREACH(mon, &server->sampleBatch, sampleBatchEntry)
+        ++size;
+    if(size == 0)
+        return;
+
+    /* Retried in the next iteration if the memory is missing */
+    BatchOperation *ops = UA_malloc(sizeof(BatchOperation) * size);
+    UA_MonitoredItem **mons = UA_malloc(sizeof(UA_MonitoredItem*) * size);
+    UA_DataValue *values = UA_Array_new(size, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if(!ops || !mons || !values) {
+        UA_free(ops);
+        UA_free(mons);
+        UA_Array_delete(values, size, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        return;
+    }
+
+    /* Collect the operations */
+    size_t opsSize = 0;
+    LIST_FOREACH_SAFE(mon, &server->sampleBatch, sampleBatchEntry, mon_tmp) {
+        LIST_REMOVE(mon, sampleBatchEntry);
+        mon->inSampleBatch = false;
+        const UA_Node *node;
+        if(mon->monitoredNode)
+            node = UA_NodeStore_getInterned(server->nodestore, mon->monitoredNode);
+        else
+            node = UA_NodeStore_get(server->nodestore, &mon->monitoredNodeId);
+        if(!batchProvider(node, mon->attributeID, false)) {
+            /* The data source has changed in the meantime */
+            UA_MoniteredItem_SampleCallback(server, mon);
+            continue;
+        }
+        const UA_NumericRange *range = NULL;
+        if(mon->range.dimensionsSize > 0)
+            range = &mon->range;
+        BatchOperation *op = &ops[opsSize];
+        initBatchOperation(op, (const UA_VariableNode*)node, opsSize, NULL, range);
+        op->timestamps = mon->timestampsToReturn;
+        mons[opsSize] = mon;
+        ++opsSize;
+    }
+
+    /* Read and process the samples */
+    readBatch(server, ops, opsSize, values);
+    for(size_t i = 0; i < opsSize; ++i)
+        MonitoredItem_processSample(server, mons[ops[i].index], &values[i]);
+
+    deleteBatchOperations(ops, opsSize);
+    UA_free(mons);
+    UA_Array_delete(values, size, &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+#endif
+
+/**********************/
+/* Asynchronous Reads */
+/**********************/
+
+#ifdef UA_ENABLE_MULTITHREADING
+# define UA_ASYNCREADS_LOCK(server) pthread_mutex_lock(&(server)->asyncReads_mutex)
+# define UA_ASYNCREADS_UNLOCK(server) pthread_mutex_unlock(&(server)->asyncReads_mutex)
+#else
+# define UA_ASYNCREADS_LOCK(server)
+# define UA_ASYNCREADS_UNLOCK(server)
+#endif
+
+static UA_Boolean
+isAsyncDataSource(const UA_Node *node, UA_UInt32 attributeId) {
+    if(!node || node->nodeClass != UA_NODECLASS_VARIABLE ||
+       attributeId != UA_ATTRIBUTEID_VALUE)
+        return false;
+    const UA_VariableNode *vn = (const UA_VariableNode*)node;
+    return (vn->valueSource == UA_VALUESOURCE_DATASOURCE &&
+            vn->value.dataSource.readAsync != NULL);
+}
+
+static UA_Boolean
+isPendingResult(const UA_DataValue *v) {
+    return (v->hasStatus && v->status == UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY);
+}
+
+/* Allocates a new asynchronous read with resultsSize results and registers it
+ * in the server. The pending count starts at 1 until all operations are
+ * started. */
+static UA_AsyncRead *
+newAsyncRead(UA_Server *server, size_t resultsSize,
+             UA_TimestampsToReturn timestamps) {
+    UA_AsyncRead *ar = UA_calloc(1, sizeof(UA_AsyncRead));
+    if(!ar)
+        return NULL;
+    UA_ReadResponse_init(&ar->response);
+    ar->response.results = UA_Array_new(resultsSize, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if(!ar->response.results) {
+        UA_free(ar);
+        return NULL;
+    }
+    ar->response.resultsSize = resultsSize;
+    ar->timestamps = timestamps;
+    ar->pending = 1;
+    ar->timeout = UA_INT64_MAX; /* armed when all operations are started */
+    UA_ASYNCREADS_LOCK(server);
+    if(++server->lastAsyncReadId == 0)
+        server->lastAsyncReadId = 1;
+    ar->id = server->lastAsyncReadId;
+    LIST_INSERT_HEAD(&server->asyncReads, ar, pointers);
+    UA_ASYNCREADS_UNLOCK(server);
+    return ar;
+}
+
+/* Call with the lock held */
+static void
+removeAsyncRead(UA_AsyncRead *ar) {
+    LIST_REMOVE(ar, pointers);
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    if(ar->mon)
+        ar->mon->asyncSample = NULL;
+#endif
+}
+
+/* Sends the response (or processes the sample) and frees the read. The read
+ * must be removed from the server before. */
+static void
+finishAsyncRead(UA_Server *server, UA_AsyncRead *ar) {
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    if(ar->isSample) {
+        if(ar->mon)
+            MonitoredItem_processSample(server, ar->mon, &ar->response.results[0]);
+        UA_ReadResponse_deleteMembers(&ar->response);
+        UA_free(ar);
         return;
     }
+#endif
 
-    /* Read the attribute */
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    switch(id->attributeId) {
-    case UA_ATTRIBUTEID_NODEID:
-        forceVariantSetScalar(&v->value, &node->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
-        break;
-    case UA_ATTRIBUTEID_NODECLASS:
-        forceVariantSetScalar(&v->value, &node->nodeClass, &UA_TYPES[UA_TYPES_NODECLASS]);
-        break;
-    case UA_ATTRIBUTEID_BROWSENAME:
-        forceVariantSetScalar(&v->value, &node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
-        break;
-    case UA_ATTRIBUTEID_DISPLAYNAME:
-        forceVariantSetScalar(&v->value, &node->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-        break;
-    case UA_ATTRIBUTEID_DESCRIPTION:
-        forceVariantSetScalar(&v->value, &node->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-        break;
-    case UA_ATTRIBUTEID_WRITEMASK:
-        forceVariantSetScalar(&v->value, &node->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
-        break;
-    case UA_ATTRIBUTEID_USERWRITEMASK:
-        forceVariantSetScalar(&v->value, &node->userWriteMask, &UA_TYPES[UA_TYPES_UINT32]);
-        break;
-    case UA_ATTRIBUTEID_ISABSTRACT:
-        retval = readIsAbstractAttribute(node, &v->value);
-        break;
-    case UA_ATTRIBUTEID_SYMMETRIC:
-        CHECK_NODECLASS(UA_NODECLASS_REFERENCETYPE);
-        forceVariantSetScalar(&v->value, &((const UA_ReferenceTypeNode*)node)->symmetric,
-                              &UA_TYPES[UA_TYPES_BOOLEAN]);
-        break;
-    case UA_ATTRIBUTEID_INVERSENAME:
-        CHECK_NODECLASS(UA_NODECLASS_REFERENCETYPE);
-        forceVariantSetScalar(&v->value, &((const UA_ReferenceTypeNode*)node)->inverseName,
-                              &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
-        break;
-    case UA_ATTRIBUTEID_CONTAINSNOLOOPS:
-        CHECK_NODECLASS(UA_NODECLASS_VIEW);
-        forceVariantSetScalar(&v->value, &((const UA_ViewNode*)node)->containsNoLoops,
-                              &UA_TYPES[UA_TYPES_BOOLEAN]);
-        break;
-    case UA_ATTRIBUTEID_EVENTNOTIFIER:
-        CHECK_NODECLASS(UA_NODECLASS_VIEW | UA_NODECLASS_OBJECT);
-        forceVariantSetScalar(&v->value, &((const UA_ViewNode*)node)->eventNotifier,
-                              &UA_TYPES[UA_TYPES_BYTE]);
-        break;
-    case UA_ATTRIBUTEID_VALUE:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
-        retval = readValueAttributeComplete(server, (const UA_VariableNode*)node,
-                                            timestamps, &id->indexRange, v);
-        break;
-    case UA_ATTRIBUTEID_DATATYPE:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableTypeNode*)node)->dataType,
-                              &UA_TYPES[UA_TYPES_NODEID]);
-        break;
-    case UA_ATTRIBUTEID_VALUERANK:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableTypeNode*)node)->valueRank,
-                              &UA_TYPES[UA_TYPES_INT32]);
-        break;
-    case UA_ATTRIBUTEID_ARRAYDIMENSIONS:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE | UA_NODECLASS_VARIABLETYPE);
-        retval = readArrayDimensionsAttribute((const UA_VariableNode*)node, v);
-        break;
-    case UA_ATTRIBUTEID_ACCESSLEVEL:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->accessLevel,
-                              &UA_TYPES[UA_TYPES_BYTE]);
-        break;
-    case UA_ATTRIBUTEID_USERACCESSLEVEL:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->userAccessLevel,
-                              &UA_TYPES[UA_TYPES_BYTE]);
-        break;
-    case UA_ATTRIBUTEID_MINIMUMSAMPLINGINTERVAL:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->minimumSamplingInterval,
-                              &UA_TYPES[UA_TYPES_DOUBLE]);
-        break;
-    case UA_ATTRIBUTEID_HISTORIZING:
-        CHECK_NODECLASS(UA_NODECLASS_VARIABLE);
-        forceVariantSetScalar(&v->value, &((const UA_VariableNode*)node)->historizing,
-                              &UA_TYPES[UA_TYPES_BOOLEAN]);
-        break;
-    case UA_ATTRIBUTEID_EXECUTABLE:
-        CHECK_NODECLASS(UA_NODECLASS_METHOD);
-        forceVariantSetScalar(&v->value, &((const UA_MethodNode*)node)->executable,
-                              &UA_TYPES[UA_TYPES_BOOLEAN]);
-        break;
-    case UA_ATTRIBUTEID_USEREXECUTABLE:
-        CHECK_NODECLASS(UA_NODECLASS_METHOD);
-        forceVariantSetScalar(&v->value, &((const UA_MethodNode*)node)->userExecutable,
-                              &UA_TYPES[UA_TYPES_BOOLEAN]);
-        break;
-    default:
-        retval = UA_STATUSCODE_BADATTRIBUTEIDINVALID;
+    /* The channel may have been closed in the meantime */
+    UA_SecureChannel *channel =
+        UA_SecureChannelManager_get(&server->secureChannelManager, ar->channelId);
+    if(channel) {
+        ar->response.responseHeader.timestamp = UA_Server_tickTime();
+        UA_StatusCode retval =
+            UA_SecureChannel_sendBinaryMessage(channel, ar->requestId, &ar->response,
+                                               &UA_TYPES[UA_TYPES_READRESPONSE]);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_LOG_INFO_CHANNEL(server->config.logger, channel,
+                                "Could not send the message over the SecureChannel "
+                                "with StatusCode %s", UA_StatusCode_name(retval));
     }
+    UA_ReadResponse_deleteMembers(&ar->response);
+    UA_free(ar);
+}
 
-    /* Return error code when reading has failed */
-    if(retval != UA_STATUSCODE_GOOD) {
-        v->hasStatus = true;
-        v->status = retval;
+/* Starts the read of an asynchronous DataSource into the index-th result. The
+ * result is marked as pending before the data source is called, since the data
+ * source may complete the operation right away. */
+static void
+readAsyncOperation(UA_Server *server, UA_Session *session, UA_AsyncRead *ar,
+                   size_t index, const UA_Node *node, const UA_ReadValueId *id,
+                   const UA_NumericRange *range, UA_Double maxAge) {
+    UA_DataValue *result = &ar->response.results[index];
+    UA_ASYNCREADS_LOCK(server);
+    result->hasStatus = true;
+    result->status = UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY;
+    ++ar->pending;
+    UA_ASYNCREADS_UNLOCK(server);
+
+    UA_AsyncOperationId operation;
+    operation.id = ar->id;
+    operation.index = (UA_UInt32)index;
+    UA_DataValue v;
+    UA_DataValue_init(&v);
+    Service_Read_node(server, session, ar->timestamps, node, id, range, maxAge, &operation, &v);
+    if(isPendingResult(&v))
         return;
+
+    /* Completed synchronously */
+    UA_ASYNCREADS_LOCK(server);
+    if(isPendingResult(result)) {
+        *result = v;
+        --ar->pending;
+    } else {
+        UA_DataValue_deleteMembers(&v);
     }
+    UA_ASYNCREADS_UNLOCK(server);
+}
 
-    v->hasValue = true;
+/* Drops the reference held while the operations are started. Returns true if
+ * operations are outstanding. Then the timeout is armed and the read must no
+ * longer be accessed. Otherwise, the read is removed from the server. */
+static UA_Boolean
+releaseAsyncRead(UA_Server *server, UA_AsyncRead *ar, UA_UInt32 timeoutMs) {
+    UA_ASYNCREADS_LOCK(server);
+    UA_Boolean outstanding = (--ar->pending > 0);
+    if(outstanding)
+        ar->timeout = UA_DateTime_nowMonotonic() +
+            (UA_DateTime)timeoutMs * UA_MSEC_TO_DATETIME;
+    else
+        removeAsyncRead(ar);
+    UA_ASYNCREADS_UNLOCK(server);
+    return outstanding;
+}
 
-    /* Create server timestamp */
-    if(timestamps == UA_TIMESTAMPSTORETURN_SERVER ||
-       timestamps == UA_TIMESTAMPSTORETURN_BOTH) {
-        v->serverTimestamp = UA_DateTime_now();
-        v->hasServerTimestamp = true;
+UA_StatusCode
+UA_Server_completeAsyncRead(UA_Server *server, UA_AsyncOperationId operation,
+                            UA_DataValue *value) {
+    UA_ASYNCREADS_LOCK(server);
+    UA_AsyncRead *ar;
+    LIST_FOREACH(ar, &server->asyncReads, pointers) {
+        if(ar->id == operation.id)
+            break;
     }
+    if(!ar || operation.index >= ar->response.resultsSize ||
+       !isPendingResult(&ar->response.results[operation.index])) {
+        UA_ASYNCREADS_UNLOCK(server);
+        UA_DataValue_deleteMembers(value);
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+
+    /* Move the value into the result */
+    UA_DataValue *result = &ar->response.results[operation.index];
+    *result = *value;
+    UA_DataValue_init(value);
+    if(!result->hasStatus || result->status == UA_STATUSCODE_GOOD) {
+        result->hasValue = true;
+        setReadTimestamps(result, ar->timestamps, true);
+    }
+
+    /* The last operation finishes the read */
+    UA_Boolean done = (--ar->pending == 0);
+    if(done)
+        removeAsyncRead(ar);
+    UA_ASYNCREADS_UNLOCK(server);
+    if(done)
+        finishAsyncRead(server, ar);
+    return UA_STATUSCODE_GOOD;
+}
 
-    /* Handle source time stamp */
-    if(id->attributeId == UA_ATTRIBUTEID_VALUE) {
-        if (timestamps == UA_TIMESTAMPSTORETURN_SERVER ||
-            timestamps == UA_TIMESTAMPSTORETURN_NEITHER) {
-            v->hasSourceTimestamp = false;
-            v->hasSourcePicoseconds = false;
-        } else if(!v->hasSourceTimestamp) {
-            v->sourceTimestamp = UA_DateTime_now();
-            v->hasSourceTimestamp = true;
+UA_DateTime
+UA_Server_processAsyncReads(UA_Server *server, UA_DateTime nowMonotonic,
+                            UA_DateTime next) {
+    if(LIST_EMPTY(&server->asyncReads))
+        return next;
+
+    /* Collect the timed-out reads */
+    LIST_HEAD(, UA_AsyncRead) timedOut = LIST_HEAD_INITIALIZER(timedOut);
+    UA_AsyncRead *ar, *ar_tmp;
+    UA_ASYNCREADS_LOCK(server);
+    LIST_FOREACH_SAFE(ar, &server->asyncReads, pointers, ar_tmp) {
+        if(ar->timeout > nowMonotonic) {
+            if(ar->timeout < next)
+                next = ar->timeout;
+            continue;
         }
+        for(size_t i = 0; i < ar->response.resultsSize; ++i) {
+            if(isPendingResult(&ar->response.results[i]))
+                ar->response.results[i].status = UA_STATUSCODE_BADTIMEOUT;
+        }
+        removeAsyncRead(ar);
+        LIST_INSERT_HEAD(&timedOut, ar, pointers);
+    }
+    UA_ASYNCREADS_UNLOCK(server);
+
+    /* Answer them outside the lock */
+    LIST_FOREACH_SAFE(ar, &timedOut, pointers, ar_tmp) {
+        LIST_REMOVE(ar, pointers);
+        finishAsyncRead(server, ar);
     }
+    return next;
 }
 
-void Service_Read(UA_Server *server, UA_Session *session,
-                  const UA_ReadRequest *request, UA_ReadResponse *response) {
+void
+UA_Server_deleteAsyncReads(UA_Server *server) {
+    UA_AsyncRead *ar, *ar_tmp;
+    UA_ASYNCREADS_LOCK(server);
+    LIST_FOREACH_SAFE(ar, &server->asyncReads, pointers, ar_tmp) {
+        removeAsyncRead(ar);
+        UA_ReadResponse_deleteMembers(&ar->response);
+        UA_free(ar);
+    }
+    UA_ASYNCREADS_UNLOCK(server);
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+UA_Boolean
+MonitoredItem_sampleAsync(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                          const UA_Node *node, const UA_ReadValueId *rvid,
+                          const UA_NumericRange *range) {
+    if(!isAsyncDataSource(node, rvid->attributeId))
+        return false;
+
+    /* Skip the sample while the last one is outstanding */
+    if(monitoredItem->asyncSample)
+        return true;
+
+    UA_AsyncRead *ar = newAsyncRead(server, 1, monitoredItem->timestampsToReturn);
+    if(!ar)
+        return false; /* sample synchronously */
+    ar->isSample = true;
+    ar->mon = monitoredItem;
+    monitoredItem->asyncSample = ar;
+    readAsyncOperation(server, monitoredItem->subscription->session, ar, 0,
+                       node, rvid, range, 0.0);
+    if(!releaseAsyncRead(server, ar, server->config.asyncReadTimeout))
+        finishAsyncRead(server, ar);
+    return true;
+}
+#endif
+
+/****************/
+/* Read Service */
+/****************/
+
+typedef struct {
+    UA_Session *session;
+    const UA_ReadRequest *request;
+    UA_ReadResponse *response;
+    const size_t *indices;
+} ParallelRead;
+
+static void
+readParallel(UA_Server *server, ParallelRead *pr, size_t index) {
+    size_t i = pr->indices[index];
+    const UA_ReadValueId *id = &pr->request->nodesToRead[i];
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, &id->nodeId);
+    Service_Read_node(server, pr->session, pr->request->timestampsToReturn,
+                      node, id, NULL, pr->request->maxAge, NULL, &pr->response->results[i]);
+}
+
+/* With ar set, the results are read into the response of the asynchronous
+ * read */
+static void
+readRequest(UA_Server *server, UA_Session *session, const UA_ReadRequest *request,
+            UA_ReadResponse *response, UA_AsyncRead *ar) {
     UA_LOG_DEBUG_SESSION(server->config.logger, session, "Processing ReadRequest");
     if(request->nodesToReadSize <= 0) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOTHINGTODO;
@@ -20790,12 +25568,14 @@ void Service_Read(UA_Server *server, UA_Session *session,
     }
 
     size_t size = request->nodesToReadSize;
-    response->results = UA_Array_new(size, &UA_TYPES[UA_TYPES_DATAVALUE]);
-    if(!response->results) {
-        response->responseHeader.serviceResult = UA_STATUSCODE_BADOUTOFMEMORY;
-        return;
+    if(!ar) {
+        response->results = UA_Array_new(size, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        if(!response->results) {
+            response->responseHeader.serviceResult = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        response->resultsSize = size;
     }
-    response->resultsSize = size;
 
     if(request->maxAge < 0) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADMAXAGEINVALID;
@@ -20824,13 +25604,95 @@ void Service_Read(UA_Server *server, UA_Session *session,
     }
 #endif
 
+    /* Values from batch providers are collected and read afterwards */
+    BatchOperation *batch = NULL;
+    size_t batchSize = 0;
+    UA_Boolean batchFailed = false;
+
+    /* Large requests are read in parallel after the loop */
+    size_t *parallel = NULL;
+    size_t parallelSize = 0;
+    if(UA_Server_isParallel(server, size))
+        parallel = UA_malloc(sizeof(size_t) * size);
+
     for(size_t i = 0;i < size;++i) {
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
-        if(!isExternal[i])
+        if(isExternal[i])
+            continue;
 #endif
-            Service_Read_single(server, session, request->timestampsToReturn,
-                                &request->nodesToRead[i], &response->results[i]);
+        const UA_ReadValueId *id = &request->nodesToRead[i];
+        const UA_Node *node = UA_NodeStore_get(server->nodestore, &id->nodeId);
+        if(ar && isAsyncDataSource(node, id->attributeId)) {
+            readAsyncOperation(server, session, ar, i, node, id, NULL, request->maxAge);
+            continue;
+        }
+
+        /* Only the binary encoding can be batched. The others are rejected in
+         * Service_Read_node. */
+        if(!batchFailed && id->dataEncoding.name.length == 0 &&
+           batchProvider(node, id->attributeId, false)) {
+            /* Recent values do not need a batch */
+            UA_DataValue *result = &response->results[i];
+            UA_Boolean cache = (request->maxAge > 0.0 && server->config.valueCacheSize > 0 &&
+                                id->indexRange.length == 0);
+            if(cache && readCachedValue(server, &node->nodeId, request->maxAge,
+                                        request->timestampsToReturn, result)) {
+                result->hasValue = true;
+                setReadTimestamps(result, request->timestampsToReturn, true);
+                continue;
+            }
+            if(!batch) {
+                batch = UA_malloc(sizeof(BatchOperation) * size);
+                batchFailed = (batch == NULL);
+            }
+            if(batch) {
+                UA_StatusCode retval =
+                    initBatchOperation(&batch[batchSize], (const UA_VariableNode*)node,
+                                       i, &id->indexRange, NULL);
+                if(retval != UA_STATUSCODE_GOOD) {
+                    response->results[i].hasStatus = true;
+                    response->results[i].status = retval;
+                    continue;
+                }
+                batch[batchSize].timestamps = request->timestampsToReturn;
+                batch[batchSize].cacheResult = cache;
+                ++batchSize;
+                continue;
+            }
+        }
+
+        if(parallel) {
+            parallel[parallelSize] = i;
+            ++parallelSize;
+            continue;
+        }
+        Service_Read_node(server, session, request->timestampsToReturn,
+                          node, id, NULL, request->maxAge, NULL, &response->results[i]);
+    }
+
+    if(parallel) {
+        ParallelRead pr = {session, request, response, parallel};
+        UA_Server_parallelFor(server, parallelSize,
+                              (UA_ParallelForCallback)readParallel, &pr);
+        UA_free(parallel);
+    }
+
+    if(batchSize > 0) {
+        UA_DataValue *values = UA_Array_new(batchSize, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        if(values) {
+            readBatch(server, batch, batchSize, values);
+            for(size_t i = 0; i < batchSize; ++i)
+                response->results[batch[i].index] = values[i];
+            UA_free(values);
+        } else {
+            for(size_t i = 0; i < batchSize; ++i) {
+                response->results[batch[i].index].hasStatus = true;
+                response->results[batch[i].index].status = UA_STATUSCODE_BADOUTOFMEMORY;
+            }
+        }
     }
+    if(batch)
+        deleteBatchOperations(batch, batchSize);
 
 #ifdef UA_ENABLE_NONSTANDARD_STATELESS
     /* Add an expiry header for caching */
@@ -20852,7 +25714,7 @@ void Service_Read(UA_Server *server, UA_Session *session,
 
         /* expires in 20 seconds */
         for(UA_UInt32 i = 0;i < response->resultsSize;++i) {
-            expireArray[i] = UA_DateTime_now() + 20 * 100 * 1000 * 1000;
+            expireArray[i] = UA_Server_tickTime() + 20 * 100 * 1000 * 1000;
         }
         UA_Variant_setArray(&variant, expireArray, request->nodesToReadSize,
                             &UA_TYPES[UA_TYPES_DATETIME]);
@@ -20874,18 +25736,99 @@ void Service_Read(UA_Server *server, UA_Session *session,
 #endif
 }
 
+void Service_Read(UA_Server *server, UA_Session *session,
+                  const UA_ReadRequest *request, UA_ReadResponse *response) {
+    readRequest(server, session, request, response, NULL);
+}
+
+UA_Boolean
+Service_Read_async(UA_Server *server, UA_Session *session,
+                   UA_SecureChannel *channel, UA_UInt32 requestId,
+                   const UA_ReadRequest *request, UA_ReadResponse *response) {
+    if(request->nodesToReadSize == 0) {
+        Service_Read(server, session, request, response);
+        return false;
+    }
+    UA_AsyncRead *ar = newAsyncRead(server, request->nodesToReadSize,
+                                    request->timestampsToReturn);
+    if(!ar) {
+        Service_Read(server, session, request, response);
+        return false;
+    }
+    ar->channelId = channel->securityToken.channelId;
+    ar->requestId = requestId;
+    ar->response.responseHeader.requestHandle = request->requestHeader.requestHandle;
+    readRequest(server, session, request, &ar->response, ar);
+
+    /* Wait for the outstanding operations */
+    UA_UInt32 timeout = request->requestHeader.timeoutHint;
+    if(timeout == 0)
+        timeout = server->config.asyncReadTimeout;
+    if(releaseAsyncRead(server, ar, timeout)) {
+        UA_ReadResponse_init(response);
+        return true;
+    }
+
+    /* Everything was read synchronously */
+    *response = ar->response;
+    UA_free(ar);
+    return false;
+}
+
+/* The value may reference the buffer of the node (shared or flat) or its
+ * memory (views). Copy it to a value owned by the caller. Views are only valid
+ * inside the RCU read lock and are always copied. */
+static void
+makeReadValueOwned(UA_DataValue *dv, UA_Boolean keepShared) {
+    if(!dv->hasValue || dv->value.storageType == UA_VARIANT_DATA)
+        return;
+    if(keepShared && dv->value.storageType != UA_VARIANT_DATA_NODELETE)
+        return;
+    UA_Variant copy;
+    UA_StatusCode retval = UA_Variant_copy(&dv->value, &copy);
+    UA_Variant_deleteMembers(&dv->value);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_Variant_init(&dv->value);
+        dv->hasValue = false;
+        dv->hasStatus = true;
+        dv->status = retval;
+        return;
+    }
+    dv->value = copy;
+}
+
 /* Exposes the Read service to local users */
-UA_DataValue
-UA_Server_read(UA_Server *server, const UA_ReadValueId *item,
-               UA_TimestampsToReturn timestamps) {
+static UA_DataValue
+readLocal(UA_Server *server, const UA_ReadValueId *item, const UA_NumericRange *range,
+          UA_TimestampsToReturn timestamps, UA_Boolean keepShared) {
     UA_DataValue dv;
     UA_DataValue_init(&dv);
     UA_RCU_LOCK();
-    Service_Read_single(server, &adminSession, timestamps, item, &dv);
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, &item->nodeId);
+    Service_Read_node(server, &adminSession, timestamps, node, item, range, 0.0, NULL, &dv);
+    makeReadValueOwned(&dv, keepShared);
     UA_RCU_UNLOCK();
     return dv;
 }
 
+UA_DataValue
+UA_Server_readShared(UA_Server *server, const UA_ReadValueId *item,
+                     UA_TimestampsToReturn timestamps) {
+    return readLocal(server, item, NULL, timestamps, true);
+}
+
+UA_DataValue
+UA_Server_read(UA_Server *server, const UA_ReadValueId *item,
+               UA_TimestampsToReturn timestamps) {
+    return readLocal(server, item, NULL, timestamps, false);
+}
+
+UA_DataValue
+UA_Server_readRange(UA_Server *server, const UA_ReadValueId *item,
+                    const UA_NumericRange *range, UA_TimestampsToReturn timestamps) {
+    return readLocal(server, item, range, timestamps, false);
+}
+
 /* Used in inline functions exposing the Read service with more syntactic sugar
  * for individual attributes */
 UA_StatusCode
@@ -20901,7 +25844,7 @@ __UA_Server_read(UA_Server *server, const UA_NodeId *nodeId,
     /* Check the return value */
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     if(dv.hasStatus)
-        retval = dv.hasStatus;
+        retval = dv.status;
     else if(!dv.hasValue)
         retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
     if(retval != UA_STATUSCODE_GOOD) {
@@ -20909,28 +25852,17 @@ __UA_Server_read(UA_Server *server, const UA_NodeId *nodeId,
         return retval;
     }
 
-    /* Prepare the result */
+    /* Prepare the result. UA_Server_read returns a value with the storageType
+     * UA_VARIANT_DATA that is owned by the caller. */
     if(attributeId == UA_ATTRIBUTEID_VALUE ||
        attributeId == UA_ATTRIBUTEID_ARRAYDIMENSIONS) {
-        /* Return the entire variant */
-        if(dv.value.storageType == UA_VARIANT_DATA_NODELETE) {
-            retval = UA_Variant_copy(&dv.value, v);
-        } else {
-            /* storageType is UA_VARIANT_DATA. Copy the entire variant
-             * (including pointers and all) */
-            memcpy(v, &dv.value, sizeof(UA_Variant));
-        }
+        /* Return the entire variant (including pointers and all) */
+        memcpy(v, &dv.value, sizeof(UA_Variant));
     } else {
-        /* Return the variant content only */
-        if(dv.value.storageType == UA_VARIANT_DATA_NODELETE) {
-            retval = UA_copy(dv.value.data, v, dv.value.type);
-        } else {
-            /* storageType is UA_VARIANT_DATA. Copy the content of the type
-             * (including pointers and all) */
-            memcpy(v, dv.value.data, dv.value.type->memSize);
-            /* Delete the "carrier" in the variant */
-            UA_free(dv.value.data);
-        }
+        /* Return the content of the type (including pointers and all) */
+        memcpy(v, dv.value.data, dv.value.type->memSize);
+        /* Delete the "carrier" in the variant */
+        UA_free(dv.value.data);
     }
     return retval;
 }
@@ -20975,18 +25907,15 @@ CopyAttributeIntoNode(UA_Server *server, UA_Session *session,
         break;
     case UA_ATTRIBUTEID_BROWSENAME:
         CHECK_DATATYPE_SCALAR(QUALIFIEDNAME);
-        UA_QualifiedName_deleteMembers(&node->browseName);
-        UA_QualifiedName_copy(value, &node->browseName);
+        retval = UA_Node_setBrowseName(node, value);
         break;
     case UA_ATTRIBUTEID_DISPLAYNAME:
         CHECK_DATATYPE_SCALAR(LOCALIZEDTEXT);
-        UA_LocalizedText_deleteMembers(&node->displayName);
-        UA_LocalizedText_copy(value, &node->displayName);
+        retval = UA_Node_setText(node, &node->displayName, value);
         break;
     case UA_ATTRIBUTEID_DESCRIPTION:
         CHECK_DATATYPE_SCALAR(LOCALIZEDTEXT);
-        UA_LocalizedText_deleteMembers(&node->description);
-        UA_LocalizedText_copy(value, &node->description);
+        retval = UA_Node_setText(node, &node->description, value);
         break;
     case UA_ATTRIBUTEID_WRITEMASK:
         CHECK_DATATYPE_SCALAR(UINT32);
@@ -21008,8 +25937,7 @@ CopyAttributeIntoNode(UA_Server *server, UA_Session *session,
     case UA_ATTRIBUTEID_INVERSENAME:
         CHECK_NODECLASS_WRITE(UA_NODECLASS_REFERENCETYPE);
         CHECK_DATATYPE_SCALAR(LOCALIZEDTEXT);
-        UA_LocalizedText_deleteMembers(&((UA_ReferenceTypeNode*)node)->inverseName);
-        UA_LocalizedText_copy(value, &((UA_ReferenceTypeNode*)node)->inverseName);
+        retval = UA_Node_setText(node, &((UA_ReferenceTypeNode*)node)->inverseName, value);
         break;
     case UA_ATTRIBUTEID_CONTAINSNOLOOPS:
         CHECK_NODECLASS_WRITE(UA_NODECLASS_VIEW);
@@ -21084,6 +26012,189 @@ CopyAttributeIntoNode(UA_Server *server, UA_Session *session,
     return retval;
 }
 
+/* Without multithreading, the node is always edited in-situ. With
+ * multithreading, the value of a variable that has a value slot or a data
+ * source is written without changing the node (see writeValueShared). Then the
+ * node is not copied. All other writes copy and replace the node. */
+static UA_StatusCode
+writeAttribute(UA_Server *server, UA_Session *session,
+               const UA_InternedNodeId *interned, const UA_WriteValue *wvalue) {
+#ifdef UA_ENABLE_MULTITHREADING
+    if(wvalue->attributeId == UA_ATTRIBUTEID_VALUE) {
+        const UA_Node *node;
+        if(interned)
+            node = UA_NodeStore_getInterned(server->nodestore, interned);
+        else
+            node = UA_NodeStore_get(server->nodestore, &wvalue->nodeId);
+        if(!node)
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+        if(node->nodeClass == UA_NODECLASS_VARIABLE ||
+           node->nodeClass == UA_NODECLASS_VARIABLETYPE) {
+            const UA_VariableNode *vn = (const UA_VariableNode*)node;
+            if(vn->valueSource == UA_VALUESOURCE_DATASOURCE || vn->value.data.slot) {
+                UA_StatusCode retval = writeValueShared(server, vn, &wvalue->value,
+                                                        &wvalue->indexRange, true);
+                if(retval != UA_STATUSCODE_GOOD)
+                    UA_LOG_INFO_SESSION(server->config.logger, session,
+                                        "WriteRequest returned status code %s",
+                                        UA_StatusCode_name(retval));
+                return retval;
+            }
+        }
+    }
+#endif
+    UA_StatusCode retval;
+    if(interned)
+        retval = UA_Server_editNodeInterned(server, session, interned,
+                                            (UA_EditNodeCallback)CopyAttributeIntoNode,
+                                            wvalue);
+    else
+        retval = UA_Server_editNode(server, session, &wvalue->nodeId,
+                                    (UA_EditNodeCallback)CopyAttributeIntoNode, wvalue);
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    if(retval == UA_STATUSCODE_GOOD && wvalue->attributeId == UA_ATTRIBUTEID_VALUE)
+        MonitoredItem_sampleWatchers(server, &wvalue->nodeId, interned);
+#endif
+    return retval;
+}
+
+typedef struct {
+    UA_UInt32 hash; /* of the NodeId */
+    size_t index; /* in the request */
+} ParallelWriteKey;
+
+static int
+compareParallelWriteKeys(const void *a, const void *b) {
+    const ParallelWriteKey *ka = (const ParallelWriteKey*)a;
+    const ParallelWriteKey *kb = (const ParallelWriteKey*)b;
+    if(ka->hash != kb->hash)
+        return ka->hash < kb->hash ? -1 : 1;
+    if(ka->index != kb->index)
+        return ka->index < kb->index ? -1 : 1;
+    return 0;
+}
+
+typedef struct {
+    UA_Session *session;
+    const UA_WriteRequest *request;
+    UA_StatusCode *results;
+    const ParallelWriteKey *keys; /* sorted by hash and index */
+    const size_t *groups; /* start of every group in keys, plus the end */
+} ParallelWrite;
+
+/* All writes to a node are in one group (with the writes to other nodes of
+ * the same hash) and are done in the order of the request. So the onWrite
+ * callback of a node is never called concurrently. */
+static void
+writeParallel(UA_Server *server, ParallelWrite *pw, size_t group) {
+    for(size_t k = pw->groups[group]; k < pw->groups[group + 1]; ++k) {
+        size_t i = pw->keys[k].index;
+        pw->results[i] = writeAttribute(server, pw->session, NULL,
+                                        &pw->request->nodesToWrite[i]);
+    }
+}
+
+static void
+writeNodesParallel(UA_Server *server, UA_Session *session, const UA_WriteRequest *request,
+                   UA_StatusCode *results, ParallelWriteKey *keys, size_t keysSize) {
+    qsort(keys, keysSize, sizeof(ParallelWriteKey), compareParallelWriteKeys);
+    size_t *groups = UA_malloc(sizeof(size_t) * (keysSize + 1));
+    if(!groups) {
+        for(size_t k = 0; k < keysSize; ++k)
+            results[keys[k].index] = writeAttribute(server, session, NULL,
+                                                    &request->nodesToWrite[keys[k].index]);
+        return;
+    }
+    size_t groupsSize = 0;
+    for(size_t k = 0; k < keysSize; ++k) {
+        if(k == 0 || keys[k].hash != keys[k - 1].hash) {
+            groups[groupsSize] = k;
+            ++groupsSize;
+        }
+    }
+    groups[groupsSize] = keysSize;
+    ParallelWrite pw = {session, request, results, keys, groups};
+    UA_Server_parallelFor(server, groupsSize,
+                          (UA_ParallelForCallback)writeParallel, &pw);
+    UA_free(groups);
+}
+
+/* Values of batch providers are written together after the other
+ * operations. Large requests are written in parallel. */
+static void
+writeNodes(UA_Server *server, UA_Session *session, const UA_WriteRequest *request,
+           UA_StatusCode *results, const UA_Boolean *isExternal) {
+    size_t size = request->nodesToWriteSize;
+    BatchOperation *batch = NULL;
+    PreparedWrite *prepared = NULL;
+    size_t batchSize = 0;
+    UA_Boolean batchFailed = false;
+
+    ParallelWriteKey *parallel = NULL;
+    size_t parallelSize = 0;
+    if(UA_Server_isParallel(server, size))
+        parallel = UA_malloc(sizeof(ParallelWriteKey) * size);
+
+    for(size_t i = 0; i < size; ++i) {
+        if(isExternal && isExternal[i])
+            continue;
+        const UA_WriteValue *wvalue = &request->nodesToWrite[i];
+        const UA_Node *node = NULL;
+        if(!batchFailed && wvalue->attributeId == UA_ATTRIBUTEID_VALUE)
+            node = UA_NodeStore_get(server->nodestore, &wvalue->nodeId);
+        if(!batchProvider(node, wvalue->attributeId, true)) {
+            if(parallel) {
+                parallel[parallelSize].hash = UA_NodeId_hash(&wvalue->nodeId);
+                parallel[parallelSize].index = i;
+                ++parallelSize;
+                continue;
+            }
+            results[i] = writeAttribute(server, session, NULL, wvalue);
+            continue;
+        }
+
+        if(!batch) {
+            batch = UA_malloc(sizeof(BatchOperation) * size);
+            prepared = UA_malloc(sizeof(PreparedWrite) * size);
+            if(!batch || !prepared) {
+                UA_free(batch);
+                UA_free(prepared);
+                batch = NULL;
+                prepared = NULL;
+                batchFailed = true;
+                results[i] = writeAttribute(server, session, NULL, wvalue);
+                continue;
+            }
+        }
+
+        /* The prepared writes are not moved. The operations point into them. */
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        PreparedWrite *pw = &prepared[batchSize];
+        results[i] = prepareValueWrite(server, vn, &wvalue->value, &wvalue->indexRange, pw);
+        if(results[i] != UA_STATUSCODE_GOOD)
+            continue;
+        initBatchOperation(&batch[batchSize], vn, i, NULL, pw->rangeptr);
+        batch[batchSize].value = &pw->value.value;
+        ++batchSize;
+    }
+
+    if(parallel) {
+        writeNodesParallel(server, session, request, results, parallel, parallelSize);
+        UA_free(parallel);
+    }
+
+    if(batchSize > 0) {
+        writeBatch(server, batch, batchSize);
+        for(size_t i = 0; i < batchSize; ++i) {
+            results[batch[i].index] = batch[i].status;
+            PreparedWrite_deleteMembers(&prepared[i]);
+        }
+    }
+    if(batch)
+        deleteBatchOperations(batch, batchSize);
+    UA_free(prepared);
+}
+
 void
 Service_Write(UA_Server *server, UA_Session *session,
               const UA_WriteRequest *request, UA_WriteResponse *response) {
@@ -21101,11 +26212,7 @@ Service_Write(UA_Server *server, UA_Session *session,
     response->resultsSize = request->nodesToWriteSize;
 
 #ifndef UA_ENABLE_EXTERNAL_NAMESPACES
-    for(size_t i = 0;i < request->nodesToWriteSize;++i) {
-        response->results[i] = UA_Server_editNode(server, session, &request->nodesToWrite[i].nodeId,
-                                                  (UA_EditNodeCallback)CopyAttributeIntoNode,
-                                                  &request->nodesToWrite[i]);
-    }
+    writeNodes(server, session, request, response->results, NULL);
 #else
     UA_Boolean isExternal[request->nodesToWriteSize];
     UA_UInt32 indices[request->nodesToWriteSize];
@@ -21126,22 +26233,25 @@ Service_Write(UA_Server *server, UA_Session *session,
         ens->writeNodes(ens->ensHandle, &request->requestHeader, request->nodesToWrite,
                         indices, indexSize, response->results, response->diagnosticInfos);
     }
-    for(size_t i = 0;i < request->nodesToWriteSize;++i) {
-        if(isExternal[i])
-            continue;
-        response->results[i] = UA_Server_editNode(server, session, &request->nodesToWrite[i].nodeId,
-                                                  (UA_EditNodeCallback)CopyAttributeIntoNode,
-                                                  &request->nodesToWrite[i]);
-    }
+    writeNodes(server, session, request, response->results, isExternal);
 #endif
 }
 
 UA_StatusCode
 UA_Server_write(UA_Server *server, const UA_WriteValue *value) {
     UA_RCU_LOCK();
-    UA_StatusCode retval =
-        UA_Server_editNode(server, &adminSession, &value->nodeId,
-                           (UA_EditNodeCallback)CopyAttributeIntoNode, value);
+    UA_StatusCode retval = writeAttribute(server, &adminSession, NULL, value);
+    UA_RCU_UNLOCK();
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_writeInterned(UA_Server *server, const UA_InternedNodeId *nodeId,
+                        const UA_WriteValue *value) {
+    UA_WriteValue wvalue = *value; /* shallow copy with the interned nodeid */
+    wvalue.nodeId = nodeId->nodeId;
+    UA_RCU_LOCK();
+    UA_StatusCode retval = writeAttribute(server, &adminSession, nodeId, &wvalue);
     UA_RCU_UNLOCK();
     return retval;
 }
@@ -21166,6 +26276,229 @@ __UA_Server_write(UA_Server *server, const UA_NodeId *nodeId,
     return UA_Server_write(server, &wvalue);
 }
 
+/* The writes to one node in the order of the array */
+typedef struct {
+    const UA_WriteValue *values;
+    const size_t *indices;
+    size_t indicesSize;
+    UA_StatusCode *results;
+    UA_Boolean *applied; /* the results are set (NULL if not needed) */
+} NodeWrites;
+
+/* The onWrite callback is called once after all values were written. Returns
+ * the first error if no write succeeded. Then the edit of the node is
+ * abandoned. */
+static UA_StatusCode
+writeNodeAttributes(UA_Server *server, UA_Session *session, UA_Node *node,
+                    const NodeWrites *nw) {
+    UA_Boolean valueWritten = false;
+    UA_StatusCode firstError = UA_STATUSCODE_GOOD;
+    size_t succeeded = 0;
+    if(nw->applied)
+        *nw->applied = true;
+    for(size_t i = 0; i < nw->indicesSize; ++i) {
+        const UA_WriteValue *wvalue = &nw->values[nw->indices[i]];
+        UA_StatusCode retval;
+        if(wvalue->attributeId == UA_ATTRIBUTEID_VALUE &&
+           (node->nodeClass == UA_NODECLASS_VARIABLE ||
+            node->nodeClass == UA_NODECLASS_VARIABLETYPE)) {
+            retval = writeValue(server, (UA_VariableNode*)node, &wvalue->value,
+                                &wvalue->indexRange, false);
+            valueWritten |= (retval == UA_STATUSCODE_GOOD);
+        } else {
+            retval = CopyAttributeIntoNode(server, session, node, wvalue);
+        }
+        nw->results[nw->indices[i]] = retval;
+        if(retval == UA_STATUSCODE_GOOD)
+            ++succeeded;
+        else if(firstError == UA_STATUSCODE_GOOD)
+            firstError = retval;
+    }
+    if(succeeded == 0)
+        return firstError;
+    if(valueWritten)
+        callOnWrite((const UA_VariableNode*)node, NULL);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* One edit of the node for all writes. See writeAttribute for the writes
+ * without copying the node. */
+static void
+writeNodeGroup(UA_Server *server, const UA_NodeId *nodeId, const NodeWrites *group) {
+    /* Track whether the writes were applied. Then their results are set. */
+    UA_Boolean applied = false;
+    NodeWrites writes = *group;
+    writes.applied = &applied;
+    const NodeWrites *nw = &writes;
+    UA_StatusCode retval;
+#ifdef UA_ENABLE_MULTITHREADING
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, nodeId);
+    if(!node) {
+        retval = UA_STATUSCODE_BADNODEIDUNKNOWN;
+        goto error;
+    }
+    UA_Boolean onlyValues = (node->nodeClass == UA_NODECLASS_VARIABLE ||
+                             node->nodeClass == UA_NODECLASS_VARIABLETYPE);
+    for(size_t i = 0; i < nw->indicesSize && onlyValues; ++i)
+        onlyValues = (nw->values[nw->indices[i]].attributeId == UA_ATTRIBUTEID_VALUE);
+    if(onlyValues) {
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        if(vn->valueSource == UA_VALUESOURCE_DATASOURCE) {
+            /* The RCU read lock is released for every write to the DataSource.
+             * So the node is looked up again each time. */
+            for(size_t i = 0; i < nw->indicesSize; ++i) {
+                size_t j = nw->indices[i];
+                nw->results[j] = writeAttribute(server, &adminSession, NULL, &nw->values[j]);
+            }
+            return;
+        }
+        if(vn->value.data.slot) {
+            UA_Boolean valueWritten = false;
+            for(size_t i = 0; i < nw->indicesSize; ++i) {
+                const UA_WriteValue *wvalue = &nw->values[nw->indices[i]];
+                retval = writeValueShared(server, vn, &wvalue->value,
+                                          &wvalue->indexRange, false);
+                nw->results[nw->indices[i]] = retval;
+                valueWritten |= (retval == UA_STATUSCODE_GOOD);
+            }
+            if(valueWritten)
+                callOnWrite(vn, NULL);
+            return;
+        }
+    }
+#endif
+    retval = UA_Server_editNode(server, &adminSession, nodeId,
+                                (UA_EditNodeCallback)writeNodeAttributes, nw);
+    if(retval == UA_STATUSCODE_GOOD) {
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+        /* Sample the watchers once for all writes of the value */
+        for(size_t i = 0; i < nw->indicesSize; ++i) {
+            size_t j = nw->indices[i];
+            if(nw->values[j].attributeId == UA_ATTRIBUTEID_VALUE &&
+               nw->results[j] == UA_STATUSCODE_GOOD) {
+                MonitoredItem_sampleWatchers(server, nodeId, NULL);
+                break;
+            }
+        }
+#endif
+        return;
+    }
+    /* No write succeeded (the results are set) or the node was not edited */
+    if(applied)
+        return;
+#ifdef UA_ENABLE_MULTITHREADING
+ error:
+#endif
+    for(size_t i = 0; i < nw->indicesSize; ++i)
+        nw->results[nw->indices[i]] = retval;
+}
+
+typedef struct {
+    UA_UInt32 hash;
+    size_t index;
+} WriteOrder;
+
+static int
+compareWriteOrder(const void *a, const void *b) {
+    const WriteOrder *wa = (const WriteOrder*)a;
+    const WriteOrder *wb = (const WriteOrder*)b;
+    if(wa->hash != wb->hash)
+        return (wa->hash < wb->hash) ? -1 : 1;
+    if(wa->index != wb->index)
+        return (wa->index < wb->index) ? -1 : 1;
+    return 0;
+}
+
+#define UA_WRITEORDER_DONE ((size_t)-1)
+
+/* The writes are sorted by the hash of the NodeId (and the position in the
+ * array). Different NodeIds with the same hash are split into separate
+ * groups. */
+static UA_StatusCode
+writeMany(UA_Server *server, size_t valuesSize, const UA_WriteValue *values,
+          UA_StatusCode *results) {
+    WriteOrder *order = UA_malloc(sizeof(WriteOrder) * valuesSize);
+    size_t *indices = UA_malloc(sizeof(size_t) * valuesSize);
+    if(!order || !indices) {
+        UA_free(order);
+        UA_free(indices);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    for(size_t i = 0; i < valuesSize; ++i) {
+        order[i].hash = UA_NodeId_hash(&values[i].nodeId);
+        order[i].index = i;
+    }
+    qsort(order, valuesSize, sizeof(WriteOrder), compareWriteOrder);
+
+    NodeWrites nw = {values, indices, 0, results, NULL};
+    for(size_t start = 0; start < valuesSize;) {
+        size_t end = start + 1;
+        while(end < valuesSize && order[end].hash == order[start].hash)
+            ++end;
+        for(size_t i = start; i < end; ++i) {
+            if(order[i].index == UA_WRITEORDER_DONE)
+                continue;
+            const UA_NodeId *nodeId = &values[order[i].index].nodeId;
+            nw.indicesSize = 0;
+            for(size_t j = i; j < end; ++j) {
+                if(order[j].index == UA_WRITEORDER_DONE ||
+                   !UA_NodeId_equal(&values[order[j].index].nodeId, nodeId))
+                    continue;
+                indices[nw.indicesSize] = order[j].index;
+                ++nw.indicesSize;
+                order[j].index = UA_WRITEORDER_DONE;
+            }
+            writeNodeGroup(server, nodeId, &nw);
+        }
+        start = end;
+    }
+    UA_free(order);
+    UA_free(indices);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_writeMany(UA_Server *server, size_t valuesSize, const UA_WriteValue *values,
+                    UA_StatusCode *results) {
+    if(valuesSize == 0)
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode *res = results;
+    if(!res) {
+        res = UA_malloc(sizeof(UA_StatusCode) * valuesSize);
+        if(!res)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    UA_RCU_LOCK();
+    UA_StatusCode retval = writeMany(server, valuesSize, values, res);
+    UA_RCU_UNLOCK();
+    for(size_t i = 0; i < valuesSize && retval == UA_STATUSCODE_GOOD; ++i)
+        retval = res[i];
+    if(res != results)
+        UA_free(res);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_writeValues(UA_Server *server, size_t valuesSize, const UA_NodeId *nodeIds,
+                      const UA_Variant *values, UA_StatusCode *results) {
+    if(valuesSize == 0)
+        return UA_STATUSCODE_GOOD;
+    UA_WriteValue *wvalues = UA_malloc(sizeof(UA_WriteValue) * valuesSize);
+    if(!wvalues)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < valuesSize; ++i) {
+        UA_WriteValue_init(&wvalues[i]);
+        wvalues[i].nodeId = nodeIds[i];
+        wvalues[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        wvalues[i].value.value = values[i];
+        wvalues[i].value.hasValue = true;
+    }
+    UA_StatusCode retval = UA_Server_writeMany(server, valuesSize, wvalues, results);
+    UA_free(wvalues); /* shallow copies */
+    return retval;
+}
+
 /*********************************** amalgamated original file "/home/travis/build/open62541/open62541/src/server/ua_services_nodemanagement.c" ***********************************/
 
 /* This Source Code Form is subject to the terms of the Mozilla Public
@@ -21261,8 +26594,7 @@ checkParentReference(UA_Server *server, UA_Session *session, UA_NodeClass nodeCl
     /* Test if the referencetype is hierarchical */
     const UA_NodeId hierarchicalReference =
         UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
-    if(!isNodeInTree(server->nodestore, referenceTypeId,
-                     &hierarchicalReference, &subtypeId, 1)) {
+    if(!isSubtypeOf(server, referenceTypeId, &hierarchicalReference)) {
         UA_LOG_INFO_SESSION(server->config.logger, session,
                             "AddNodes: Reference type is not hierarchical");
         return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
@@ -21271,6 +26603,177 @@ checkParentReference(UA_Server *server, UA_Session *session, UA_NodeClass nodeCl
     return UA_STATUSCODE_GOOD;
 }
 
+/****************/
+/* Bulk Loading */
+/****************/
+
+#define UA_BULKLOAD_MINNODES 64
+
+#ifdef UA_ENABLE_MULTITHREADING
+# define UA_BULKLOAD_LOCK(server) pthread_mutex_lock(&(server)->bulkLoad_mutex)
+# define UA_BULKLOAD_UNLOCK(server) pthread_mutex_unlock(&(server)->bulkLoad_mutex)
+#else
+# define UA_BULKLOAD_LOCK(server)
+# define UA_BULKLOAD_UNLOCK(server)
+#endif
+
+static UA_Boolean
+isBulkLoading(UA_Server *server) {
+    UA_BULKLOAD_LOCK(server);
+    UA_Boolean bulkLoad = server->bulkLoad;
+    UA_BULKLOAD_UNLOCK(server);
+    return bulkLoad;
+}
+
+static UA_StatusCode
+reserveBulkLoadNodes(UA_Server *server, size_t capacity) {
+    if(capacity <= server->bulkLoadNodesCapacity)
+        return UA_STATUSCODE_GOOD;
+    UA_BulkLoadNode *nodes =
+        UA_realloc(server->bulkLoadNodes, sizeof(UA_BulkLoadNode) * capacity);
+    if(!nodes)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    server->bulkLoadNodes = nodes;
+    server->bulkLoadNodesCapacity = capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Remember the node for the validation at the commit. Returns
+ * UA_STATUSCODE_BADINVALIDSTATE if the bulk load has ended in the meantime. */
+static UA_StatusCode
+addBulkLoadNode(UA_Server *server, const UA_NodeId *nodeId,
+                const UA_NodeId *parentNodeId, const UA_NodeId *referenceTypeId) {
+    UA_StatusCode retval = UA_STATUSCODE_BADINVALIDSTATE;
+    UA_BULKLOAD_LOCK(server);
+    if(!server->bulkLoad)
+        goto out;
+
+    /* Grow geometrically */
+    if(server->bulkLoadNodesSize >= server->bulkLoadNodesCapacity) {
+        size_t capacity = server->bulkLoadNodesCapacity * 2;
+        if(capacity < UA_BULKLOAD_MINNODES)
+            capacity = UA_BULKLOAD_MINNODES;
+        retval = reserveBulkLoadNodes(server, capacity);
+        if(retval != UA_STATUSCODE_GOOD)
+            goto out;
+    }
+
+    UA_BulkLoadNode *bn = &server->bulkLoadNodes[server->bulkLoadNodesSize];
+    retval = UA_NodeId_copy(nodeId, &bn->nodeId);
+    retval |= UA_NodeId_copy(parentNodeId, &bn->parentNodeId);
+    retval |= UA_NodeId_copy(referenceTypeId, &bn->referenceTypeId);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeId_deleteMembers(&bn->nodeId);
+        UA_NodeId_deleteMembers(&bn->parentNodeId);
+        UA_NodeId_deleteMembers(&bn->referenceTypeId);
+        goto out;
+    }
+    ++server->bulkLoadNodesSize;
+ out:
+    UA_BULKLOAD_UNLOCK(server);
+    return retval;
+}
+
+static void
+deleteBulkLoadNodes(UA_BulkLoadNode *nodes, size_t nodesSize) {
+    for(size_t i = 0; i < nodesSize; ++i) {
+        UA_NodeId_deleteMembers(&nodes[i].nodeId);
+        UA_NodeId_deleteMembers(&nodes[i].parentNodeId);
+        UA_NodeId_deleteMembers(&nodes[i].referenceTypeId);
+    }
+    UA_free(nodes);
+}
+
+UA_StatusCode
+UA_Server_beginBulkLoad(UA_Server *server, size_t expectedNodes) {
+    UA_BULKLOAD_LOCK(server);
+    if(server->bulkLoad) {
+        UA_BULKLOAD_UNLOCK(server);
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+    UA_StatusCode retval = reserveBulkLoadNodes(server, expectedNodes);
+    if(retval == UA_STATUSCODE_GOOD) {
+        UA_RCU_LOCK();
+        retval = UA_NodeStore_reserve(server->nodestore, expectedNodes);
+        UA_RCU_UNLOCK();
+    }
+    if(retval == UA_STATUSCODE_GOOD)
+        server->bulkLoad = true;
+    UA_BULKLOAD_UNLOCK(server);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_commitBulkLoad(UA_Server *server, size_t *errorsSize,
+                         UA_AddNodesResult **errors) {
+    *errorsSize = 0;
+    *errors = NULL;
+
+    /* Take the nodes and end the bulk load. Nodes added from now on are
+     * checked right away. */
+    UA_BULKLOAD_LOCK(server);
+    if(!server->bulkLoad) {
+        UA_BULKLOAD_UNLOCK(server);
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+    UA_BulkLoadNode *nodes = server->bulkLoadNodes;
+    size_t nodesSize = server->bulkLoadNodesSize;
+    server->bulkLoad = false;
+    server->bulkLoadNodes = NULL;
+    server->bulkLoadNodesSize = 0;
+    server->bulkLoadNodesCapacity = 0;
+    UA_BULKLOAD_UNLOCK(server);
+
+    /* Validate in the order the nodes were added. The parents come before
+     * their children. So the children of a removed node are removed as well,
+     * as their parent is no longer found. */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_RCU_LOCK();
+    for(size_t i = 0; i < nodesSize; ++i) {
+        UA_BulkLoadNode *bn = &nodes[i];
+        const UA_Node *node = UA_NodeStore_get(server->nodestore, &bn->nodeId);
+        if(!node)
+            continue; /* deleted in the meantime */
+        UA_StatusCode res = checkParentReference(server, &adminSession, node->nodeClass,
+                                                 &bn->parentNodeId, &bn->referenceTypeId);
+        if(res == UA_STATUSCODE_GOOD)
+            continue;
+        deleteNode(server, &adminSession, &bn->nodeId, true);
+
+        /* At most the remaining nodes can fail */
+        if(!*errors && retval == UA_STATUSCODE_GOOD) {
+            *errors = (UA_AddNodesResult*)
+                UA_Array_new(nodesSize - i, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+            if(!*errors)
+                retval = UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        if(!*errors)
+            continue;
+        UA_AddNodesResult *err = &(*errors)[*errorsSize];
+        err->statusCode = res;
+        err->addedNodeId = bn->nodeId;
+        UA_NodeId_init(&bn->nodeId);
+        ++*errorsSize;
+    }
+    UA_RCU_UNLOCK();
+
+    deleteBulkLoadNodes(nodes, nodesSize);
+    if(*errors && *errorsSize == 0) {
+        UA_Array_delete(*errors, 0, &UA_TYPES[UA_TYPES_ADDNODESRESULT]);
+        *errors = NULL;
+    }
+    return retval;
+}
+
+void
+UA_Server_deleteBulkLoad(UA_Server *server) {
+    deleteBulkLoadNodes(server->bulkLoadNodes, server->bulkLoadNodesSize);
+    server->bulkLoad = false;
+    server->bulkLoadNodes = NULL;
+    server->bulkLoadNodesSize = 0;
+    server->bulkLoadNodesCapacity = 0;
+}
+
 /************/
 /* Add Node */
 /************/
@@ -21355,8 +26858,7 @@ copyExistingVariable(UA_Server *server, UA_Session *session, const UA_NodeId *va
 
     UA_NodeId_deleteMembers(&res.addedNodeId);
  cleanup:
-    if(value.hasValue && value.value.storageType == UA_VARIANT_DATA)
-        UA_Variant_deleteMembers(&value.value);
+    UA_DataValue_deleteMembers(&value);
     return retval;
 }
 
@@ -21527,15 +27029,11 @@ mandatoryChild(UA_Server *server, UA_Session *session, const UA_NodeId *childNod
         return false;
 
     /* Look for the reference making the child mandatory */
-    for(size_t i = 0; i < child->referencesSize; ++i) {
-        UA_ReferenceNode *ref = &child->references[i];
-        if(!UA_NodeId_equal(&hasModellingRuleId, &ref->referenceTypeId))
-            continue;
-        if(!UA_NodeId_equal(&mandatoryId, &ref->targetId.nodeId))
-            continue;
-        if(ref->isInverse)
-            continue;
-        return true;
+    const UA_NodeReferenceKind *rk =
+        UA_Node_findReferenceKind(child, &hasModellingRuleId, false);
+    for(size_t i = 0; rk && i < rk->targetIdsSize; ++i) {
+        if(UA_NodeId_equal(&mandatoryId, &rk->targetIds[i]))
+            return true;
     }
     return false;
 }
@@ -21646,9 +27144,13 @@ Service_AddNodes_existing(UA_Server *server, UA_Session *session, UA_Node *node,
         return UA_STATUSCODE_BADNODEIDINVALID;
     }
 
-    /* Check the reference to the parent */
-    UA_StatusCode retval = checkParentReference(server, session, node->nodeClass,
-                                                parentNodeId, referenceTypeId);
+    /* Check the reference to the parent. During a bulk load, the check is
+     * deferred to the commit. */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_Boolean deferred = isBulkLoading(server);
+    if(!deferred)
+        retval = checkParentReference(server, session, node->nodeClass,
+                                      parentNodeId, referenceTypeId);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_INFO_SESSION(server->config.logger, session,
                             "AddNodes: Checking the reference to the parent returned "
@@ -21676,6 +27178,16 @@ Service_AddNodes_existing(UA_Server *server, UA_Session *session, UA_Node *node,
         }
     }
 
+    /* Remember the node for the validation at the commit */
+    if(deferred) {
+        retval = addBulkLoadNode(server, &node->nodeId, parentNodeId, referenceTypeId);
+        if(retval == UA_STATUSCODE_BADINVALIDSTATE) /* committed in the meantime */
+            retval = checkParentReference(server, session, node->nodeClass,
+                                          parentNodeId, referenceTypeId);
+        if(retval != UA_STATUSCODE_GOOD)
+            goto remove_node;
+    }
+
     /* Hierarchical reference back to the parent */
     if(!UA_NodeId_isNull(parentNodeId)) {
         UA_AddReferencesItem item;
@@ -22110,8 +27622,14 @@ UA_Server_addDataSourceVariableNode(UA_Server *server, const UA_NodeId requested
     retval |= copyStandardAttributes((UA_Node*)node, &item, (const UA_NodeAttributes*)&editAttr);
     retval |= copyVariableNodeAttributes(server, node, &item, &editAttr);
     UA_DataValue_deleteMembers(&node->value.data.value);
+#ifdef UA_ENABLE_MULTITHREADING
+    if(node->value.data.slot)
+        UA_ValueSlot_release(node->value.data.slot);
+#endif
     node->valueSource = UA_VALUESOURCE_DATASOURCE;
-    node->value.dataSource = dataSource;
+    node->value.dataSource.source = dataSource;
+    node->value.dataSource.readAsync = NULL;
+    node->value.dataSource.provider = NULL;
     UA_DataValue_deleteMembers(&value);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_NodeStore_deleteNode((UA_Node*)node);
@@ -22243,20 +27761,12 @@ deleteOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node,
 static UA_StatusCode
 addOneWayReference(UA_Server *server, UA_Session *session,
                    UA_Node *node, const UA_AddReferencesItem *item) {
-    size_t i = node->referencesSize;
-    size_t refssize = (i+1) | 3; // so the realloc is not necessary every time
-    UA_ReferenceNode *new_refs = UA_realloc(node->references, sizeof(UA_ReferenceNode) * refssize);
-    if(!new_refs)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
-    node->references = new_refs;
-    UA_ReferenceNode_init(&new_refs[i]);
-    UA_StatusCode retval = UA_NodeId_copy(&item->referenceTypeId, &new_refs[i].referenceTypeId);
-    retval |= UA_ExpandedNodeId_copy(&item->targetNodeId, &new_refs[i].targetId);
-    new_refs[i].isInverse = !item->isForward;
-    if(retval == UA_STATUSCODE_GOOD)
-        node->referencesSize = i+1;
-    else
-        UA_ReferenceNode_deleteMembers(&new_refs[i]);
+    UA_StatusCode retval = UA_Node_addReference(node, &item->referenceTypeId,
+                                                !item->isForward, &item->targetNodeId);
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_equal(&item->referenceTypeId, &hasSubtype))
+        UA_Server_addSubtypeReference(server, node, &item->targetNodeId.nodeId,
+                                      item->isForward);
     return retval;
 }
 
@@ -22418,10 +27928,13 @@ removeReferences(UA_Server *server, UA_Session *session, const UA_Node *node) {
     UA_DeleteReferencesItem_init(&item);
     item.targetNodeId.nodeId = node->nodeId;
     for(size_t i = 0; i < node->referencesSize; ++i) {
-        item.isForward = node->references[i].isInverse;
-        item.sourceNodeId = node->references[i].targetId.nodeId;
-        item.referenceTypeId = node->references[i].referenceTypeId;
-        deleteReference(server, session, &item);
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        item.isForward = rk->isInverse;
+        item.referenceTypeId = rk->referenceTypeId;
+        for(size_t j = 0; j < rk->targetIdsSize; ++j) {
+            item.sourceNodeId = rk->targetIds[j];
+            deleteReference(server, session, &item);
+        }
     }
 }
 
@@ -22448,6 +27961,16 @@ deleteNode(UA_Server *server, UA_Session *session,
     if(deleteReferences)
         removeReferences(server, session, node);
 
+    /* The closures may contain the removed type */
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE ||
+       node->nodeClass == UA_NODECLASS_DATATYPE ||
+       node->nodeClass == UA_NODECLASS_OBJECTTYPE ||
+       node->nodeClass == UA_NODECLASS_VARIABLETYPE)
+        UA_Server_invalidateTypeClosures(server);
+
+    if(node->nodeClass == UA_NODECLASS_VARIABLE)
+        UA_Server_invalidateCachedValue(server, nodeId);
+
     return UA_NodeStore_remove(server->nodestore, nodeId);
 }
 
@@ -22493,30 +28016,12 @@ UA_Server_deleteNode(UA_Server *server, const UA_NodeId nodeId,
 static UA_StatusCode
 deleteOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node,
                       const UA_DeleteReferencesItem *item) {
-    UA_Boolean edited = false;
-    for(size_t i = node->referencesSize; i > 0; --i) {
-        UA_ReferenceNode *ref = &node->references[i-1];
-        if(!UA_NodeId_equal(&item->targetNodeId.nodeId, &ref->targetId.nodeId))
-            continue;
-        if(!UA_NodeId_equal(&item->referenceTypeId, &ref->referenceTypeId))
-            continue;
-        if(item->isForward == ref->isInverse)
-            continue;
-        UA_ReferenceNode_deleteMembers(ref);
-        /* move the last entry to override the current position */
-        node->references[i-1] = node->references[node->referencesSize-1];
-        --node->referencesSize;
-        edited = true;
-        break;
-    }
-    if(!edited)
-        return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
-    /* we removed the last reference */
-    if(node->referencesSize == 0 && node->references) {
-        UA_free(node->references);
-        node->references = NULL;
-    }
-    return UA_STATUSCODE_GOOD;;
+    UA_StatusCode retval = UA_Node_deleteReference(node, &item->referenceTypeId,
+                                                   !item->isForward, &item->targetNodeId.nodeId);
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_equal(&item->referenceTypeId, &hasSubtype))
+        UA_Server_invalidateTypeClosures(server);
+    return retval;
 }
 
 static UA_StatusCode
@@ -22578,51 +28083,112 @@ UA_Server_deleteReference(UA_Server *server, const UA_NodeId sourceNodeId,
     return retval;
 }
 
-/**********************/
-/* Set Value Callback */
-/**********************/
-
+/**********************/
+/* Set Value Callback */
+/**********************/
+
+static UA_StatusCode
+setValueCallback(UA_Server *server, UA_Session *session,
+                 UA_VariableNode *node, UA_ValueCallback *callback) {
+    if(node->nodeClass != UA_NODECLASS_VARIABLE)
+        return UA_STATUSCODE_BADNODECLASSINVALID;
+    node->value.data.callback = *callback;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_setVariableNode_valueCallback(UA_Server *server, const UA_NodeId nodeId,
+                                        const UA_ValueCallback callback) {
+    UA_RCU_LOCK();
+    UA_StatusCode retval = UA_Server_editNode(server, &adminSession, &nodeId,
+                                              (UA_EditNodeCallback)setValueCallback, &callback);
+    UA_RCU_UNLOCK();
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    /* Writes no longer see every change of the value */
+    if(retval == UA_STATUSCODE_GOOD && callback.onRead)
+        MonitoredItem_pollWatchers(server, &nodeId);
+#endif
+    return retval;
+}
+
+/******************/
+/* Set DataSource */
+/******************/
+
+static UA_StatusCode
+setDataSource(UA_Server *server, UA_Session *session,
+              UA_VariableNode* node, UA_DataSource *dataSource) {
+    if(node->nodeClass != UA_NODECLASS_VARIABLE)
+        return UA_STATUSCODE_BADNODECLASSINVALID;
+    if(node->valueSource == UA_VALUESOURCE_DATA) {
+        UA_DataValue_deleteMembers(&node->value.data.value);
+#ifdef UA_ENABLE_MULTITHREADING
+        if(node->value.data.slot)
+            UA_ValueSlot_release(node->value.data.slot);
+#endif
+    }
+    node->value.dataSource.source = *dataSource;
+    node->value.dataSource.readAsync = NULL;
+    node->value.dataSource.provider = NULL;
+    node->valueSource = UA_VALUESOURCE_DATASOURCE;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_setVariableNode_dataSource(UA_Server *server, const UA_NodeId nodeId,
+                                     const UA_DataSource dataSource) {
+    UA_RCU_LOCK();
+    UA_StatusCode retval = UA_Server_editNode(server, &adminSession, &nodeId,
+                                              (UA_EditNodeCallback)setDataSource, &dataSource);
+    UA_RCU_UNLOCK();
+    UA_Server_invalidateCachedValue(server, &nodeId);
+#if defined(UA_ENABLE_SUBSCRIPTIONS) && !defined(UA_ENABLE_MULTITHREADING)
+    if(retval == UA_STATUSCODE_GOOD)
+        MonitoredItem_pollWatchers(server, &nodeId);
+#endif
+    return retval;
+}
+
 static UA_StatusCode
-setValueCallback(UA_Server *server, UA_Session *session,
-                 UA_VariableNode *node, UA_ValueCallback *callback) {
+setAsyncDataSource(UA_Server *server, UA_Session *session,
+                   UA_VariableNode* node, UA_DataSourceReadAsync *readAsync) {
     if(node->nodeClass != UA_NODECLASS_VARIABLE)
         return UA_STATUSCODE_BADNODECLASSINVALID;
-    node->value.data.callback = *callback;
+    if(node->valueSource != UA_VALUESOURCE_DATASOURCE)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    node->value.dataSource.readAsync = *readAsync;
     return UA_STATUSCODE_GOOD;
 }
 
 UA_StatusCode
-UA_Server_setVariableNode_valueCallback(UA_Server *server, const UA_NodeId nodeId,
-                                        const UA_ValueCallback callback) {
+UA_Server_setVariableNode_asyncDataSource(UA_Server *server, const UA_NodeId nodeId,
+                                          UA_DataSourceReadAsync readAsync) {
     UA_RCU_LOCK();
     UA_StatusCode retval = UA_Server_editNode(server, &adminSession, &nodeId,
-                                              (UA_EditNodeCallback)setValueCallback, &callback);
+                                              (UA_EditNodeCallback)setAsyncDataSource,
+                                              &readAsync);
     UA_RCU_UNLOCK();
     return retval;
 }
 
-/******************/
-/* Set DataSource */
-/******************/
-
 static UA_StatusCode
-setDataSource(UA_Server *server, UA_Session *session,
-              UA_VariableNode* node, UA_DataSource *dataSource) {
+setDataSourceProvider(UA_Server *server, UA_Session *session, UA_VariableNode* node,
+                      const UA_DataSourceProvider *provider) {
     if(node->nodeClass != UA_NODECLASS_VARIABLE)
         return UA_STATUSCODE_BADNODECLASSINVALID;
-    if(node->valueSource == UA_VALUESOURCE_DATA)
-        UA_DataValue_deleteMembers(&node->value.data.value);
-    node->value.dataSource = *dataSource;
-    node->valueSource = UA_VALUESOURCE_DATASOURCE;
+    if(node->valueSource != UA_VALUESOURCE_DATASOURCE)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    node->value.dataSource.provider = provider;
     return UA_STATUSCODE_GOOD;
 }
 
 UA_StatusCode
-UA_Server_setVariableNode_dataSource(UA_Server *server, const UA_NodeId nodeId,
-                                     const UA_DataSource dataSource) {
+UA_Server_setVariableNode_dataSourceProvider(UA_Server *server, const UA_NodeId nodeId,
+                                             const UA_DataSourceProvider *provider) {
     UA_RCU_LOCK();
     UA_StatusCode retval = UA_Server_editNode(server, &adminSession, &nodeId,
-                                              (UA_EditNodeCallback)setDataSource, &dataSource);
+                                              (UA_EditNodeCallback)setDataSourceProvider,
+                                              provider);
     UA_RCU_UNLOCK();
     return retval;
 }
@@ -22694,14 +28260,15 @@ UA_Server_setMethodNode_callback(UA_Server *server, const UA_NodeId methodNodeId
 
 
 static UA_StatusCode
-fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode *ref,
-                         UA_UInt32 mask, UA_ReferenceDescription *descr) {
+fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr,
+                         const UA_NodeReferenceKind *rk, UA_UInt32 mask,
+                         UA_ReferenceDescription *descr) {
     UA_ReferenceDescription_init(descr);
     UA_StatusCode retval = UA_NodeId_copy(&curr->nodeId, &descr->nodeId.nodeId);
     if(mask & UA_BROWSERESULTMASK_REFERENCETYPEID)
-        retval |= UA_NodeId_copy(&ref->referenceTypeId, &descr->referenceTypeId);
+        retval |= UA_NodeId_copy(&rk->referenceTypeId, &descr->referenceTypeId);
     if(mask & UA_BROWSERESULTMASK_ISFORWARD)
-        descr->isForward = !ref->isInverse;
+        descr->isForward = !rk->isInverse;
     if(mask & UA_BROWSERESULTMASK_NODECLASS)
         retval |= UA_NodeClass_copy(&curr->nodeClass, &descr->nodeClass);
     if(mask & UA_BROWSERESULTMASK_BROWSENAME)
@@ -22710,13 +28277,12 @@ fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode
         retval |= UA_LocalizedText_copy(&curr->displayName, &descr->displayName);
     if(mask & UA_BROWSERESULTMASK_TYPEDEFINITION){
         if(curr->nodeClass == UA_NODECLASS_OBJECT || curr->nodeClass == UA_NODECLASS_VARIABLE) {
-            for(size_t i = 0; i < curr->referencesSize; ++i) {
-                UA_ReferenceNode *refnode = &curr->references[i];
-                if(refnode->referenceTypeId.identifier.numeric == UA_NS0ID_HASTYPEDEFINITION) {
-                    retval |= UA_ExpandedNodeId_copy(&refnode->targetId, &descr->typeDefinition);
-                    break;
-                }
-            }
+            const UA_NodeId hasTypeDefinition = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+            const UA_NodeReferenceKind *typeRef =
+                UA_Node_findReferenceKind(curr, &hasTypeDefinition, false);
+            if(typeRef && typeRef->targetIdsSize > 0)
+                retval |= UA_NodeId_copy(&typeRef->targetIds[0],
+                                         &descr->typeDefinition.nodeId);
         }
     }
     return retval;
@@ -22725,7 +28291,7 @@ fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
 static const UA_Node *
 returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription *descr,
-                           const UA_ReferenceNode *reference) {
+                           const UA_NodeId *targetId) {
     /* prepare a read request in the external nodestore */
     UA_ReadValueId *readValueIds = UA_Array_new(5,&UA_TYPES[UA_TYPES_READVALUEID]);
     UA_UInt32 *indices = UA_Array_new(5,&UA_TYPES[UA_TYPES_UINT32]);
@@ -22733,7 +28299,7 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
     UA_DataValue *readNodesResults = UA_Array_new(5,&UA_TYPES[UA_TYPES_DATAVALUE]);
     UA_DiagnosticInfo *diagnosticInfos = UA_Array_new(5,&UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
     for(UA_UInt32 i = 0; i < 5; ++i) {
-        readValueIds[i].nodeId = reference->targetId.nodeId;
+        readValueIds[i].nodeId = *targetId;
         indices[i] = i;
     }
     readValueIds[0].attributeId = UA_ATTRIBUTEID_NODECLASS;
@@ -22747,7 +28313,7 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
 
     /* create and fill a dummy nodeStructure */
     UA_Node *node = (UA_Node*) UA_NodeStore_newObjectNode();
-    UA_NodeId_copy(&(reference->targetId.nodeId), &(node->nodeId));
+    UA_NodeId_copy(targetId, &(node->nodeId));
     if(readNodesResults[0].status == UA_STATUSCODE_GOOD)
         UA_NodeClass_copy((UA_NodeClass*)readNodesResults[0].value.data, &(node->nodeClass));
     if(readNodesResults[1].status == UA_STATUSCODE_GOOD)
@@ -22759,10 +28325,14 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
     if(readNodesResults[4].status == UA_STATUSCODE_GOOD)
         UA_UInt32_copy((UA_UInt32*)readNodesResults[4].value.data, &(node->writeMask));
 
-    UA_ReferenceNode **references = &node->references;
-    UA_UInt32 *referencesSize = (UA_UInt32*)&node->referencesSize;
-    
-    ens->getOneWayReferences (ens->ensHandle, &node->nodeId, referencesSize, references);
+    /* the external nodestore returns a flat array of references */
+    UA_ReferenceNode *references = NULL;
+    UA_UInt32 referencesSize = 0;
+    ens->getOneWayReferences (ens->ensHandle, &node->nodeId, &referencesSize, &references);
+    for(UA_UInt32 i = 0; i < referencesSize; ++i)
+        UA_Node_addReference(node, &references[i].referenceTypeId,
+                             references[i].isInverse, &references[i].targetId);
+    UA_Array_delete(references, referencesSize, &UA_TYPES[UA_TYPES_REFERENCENODE]);
 
     UA_Array_delete(readValueIds,5, &UA_TYPES[UA_TYPES_READVALUEID]);
     UA_Array_delete(indices,5, &UA_TYPES[UA_TYPES_UINT32]);
@@ -22776,44 +28346,44 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
 }
 #endif
 
-/* Tests if the node is relevant to the browse request and shall be returned. If
-   so, it is retrieved from the Nodestore. If not, null is returned. */
-static const UA_Node *
-returnRelevantNode(UA_Server *server, const UA_BrowseDescription *descr, UA_Boolean return_all,
-                   const UA_ReferenceNode *reference, const UA_NodeId *relevant, size_t relevant_count,
-                   UA_Boolean *isExternal) {
+/* Tests if the references of a kind are relevant to the browse request. The
+   test is done once for all targets of the kind. */
+static UA_Boolean
+relevantReferenceKind(UA_Server *server, const UA_BrowseDescription *descr,
+                      UA_Boolean return_all, const UA_NodeReferenceKind *rk) {
     /* reference in the right direction? */
-    if(reference->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_FORWARD)
-        return NULL;
-    if(!reference->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_INVERSE)
-        return NULL;
+    if(rk->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_FORWARD)
+        return false;
+    if(!rk->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_INVERSE)
+        return false;
 
     /* is the reference part of the hierarchy of references we look for? */
-    if(!return_all) {
-        UA_Boolean is_relevant = false;
-        for(size_t i = 0; i < relevant_count; ++i) {
-            if(UA_NodeId_equal(&reference->referenceTypeId, &relevant[i])) {
-                is_relevant = true;
-                break;
-            }
-        }
-        if(!is_relevant)
-            return NULL;
-    }
+    if(return_all)
+        return true;
+    if(descr->includeSubtypes)
+        return isSubtypeOf(server, &rk->referenceTypeId, &descr->referenceTypeId);
+    return UA_NodeId_equal(&rk->referenceTypeId, &descr->referenceTypeId);
+}
 
+/* Tests if the target node is relevant to the browse request and shall be
+   returned. If so, it is retrieved from the Nodestore. If not, null is
+   returned. */
+static const UA_Node *
+returnRelevantNode(UA_Server *server, const UA_BrowseDescription *descr,
+                   const UA_NodeId *targetId, UA_Boolean *isExternal) {
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
     /* return the node from an external namespace*/
     for(size_t nsIndex = 0; nsIndex < server->externalNamespacesSize; ++nsIndex) {
-        if(reference->targetId.nodeId.namespaceIndex != server->externalNamespaces[nsIndex].index)
+        if(targetId->namespaceIndex != server->externalNamespaces[nsIndex].index)
             continue;
         *isExternal = true;
         return returnRelevantNodeExternal(&server->externalNamespaces[nsIndex].externalNodeStore,
-                                          descr, reference);
+                                          descr, targetId);
     }
 #endif
 
     /* return from the internal nodestore */
-    const UA_Node *node = UA_NodeStore_get(server->nodestore, &reference->targetId.nodeId);
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, targetId);
     if(node && descr->nodeClassMask != 0 && (node->nodeClass & descr->nodeClassMask) == 0)
         return NULL;
     *isExternal = false;
@@ -22824,10 +28394,47 @@ static void removeCp(struct ContinuationPointEntry *cp, UA_Session* session) {
     LIST_REMOVE(cp, pointers);
     UA_ByteString_deleteMembers(&cp->identifier);
     UA_BrowseDescription_deleteMembers(&cp->browseDescription);
+    UA_NodeId_deleteMembers(&cp->referenceTypeId);
+    UA_NodeId_deleteMembers(&cp->targetId);
     UA_free(cp);
     ++session->availableContinuationPoints;
 }
 
+/* The target at a position of the kind. Local targets come first. */
+static const UA_NodeId *
+referenceTarget(const UA_NodeReferenceKind *rk, size_t index) {
+    if(index < rk->targetIdsSize)
+        return &rk->targetIds[index];
+    return &rk->remoteTargetIds[index - rk->targetIdsSize].nodeId;
+}
+
+/* Remember the next reference. References added or removed before the
+ * position of the cp are detected when the browsing continues. If a copy
+ * fails, the ids stay null and the cp is reported as invalid. */
+static void
+setCpPosition(struct ContinuationPointEntry *cp, const UA_Node *node,
+              size_t kindIndex, size_t targetIndex) {
+    const UA_NodeReferenceKind *rk = &node->references[kindIndex];
+    UA_NodeId_deleteMembers(&cp->referenceTypeId);
+    UA_NodeId_deleteMembers(&cp->targetId);
+    cp->referenceKindIndex = kindIndex;
+    cp->targetIndex = targetIndex;
+    cp->isInverse = rk->isInverse;
+    UA_NodeId_copy(&rk->referenceTypeId, &cp->referenceTypeId);
+    UA_NodeId_copy(referenceTarget(rk, targetIndex), &cp->targetId);
+}
+
+static UA_Boolean
+isCpPositionValid(const struct ContinuationPointEntry *cp, const UA_Node *node) {
+    if(cp->referenceKindIndex >= node->referencesSize)
+        return false;
+    const UA_NodeReferenceKind *rk = &node->references[cp->referenceKindIndex];
+    return rk->isInverse == cp->isInverse &&
+        cp->targetIndex < rk->targetIdsSize + rk->remoteTargetIdsSize &&
+        UA_NodeId_equal(&rk->referenceTypeId, &cp->referenceTypeId) &&
+        UA_NodeId_equal(referenceTarget(rk, cp->targetIndex), &cp->targetId);
+}
+
 /* Results for a single browsedescription. This is the inner loop for both
  * Browse and BrowseNext
  *
@@ -22844,13 +28451,15 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
                       struct ContinuationPointEntry *cp, const UA_BrowseDescription *descr,
                       UA_UInt32 maxrefs, UA_BrowseResult *result) { 
     size_t referencesCount = 0;
-    size_t referencesIndex = 0;
-    /* set the browsedescription if a cp is given */
-    UA_UInt32 continuationIndex = 0;
+    /* set the browsedescription if a cp is given. Continue at the position
+     * (reference kind and target) stored in the cp. */
+    size_t kindIndex = 0;
+    size_t targetIndex = 0;
     if(cp) {
         descr = &cp->browseDescription;
         maxrefs = cp->maxReferences;
-        continuationIndex = cp->continuationIndex;
+        kindIndex = cp->referenceKindIndex;
+        targetIndex = cp->targetIndex;
     }
 
     /* is the browsedirection valid? */
@@ -22861,9 +28470,8 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
         return;
     }
     
-    /* get the references that match the browsedescription */
-    size_t relevant_refs_size = 0;
-    UA_NodeId *relevant_refs = NULL;
+    /* is the referencetype valid? subtypes are looked up in the cached
+     * closure of the referencetype. */
     UA_Boolean all_refs = UA_NodeId_isNull(&descr->referenceTypeId);
     if(!all_refs) {
         const UA_Node *rootRef = UA_NodeStore_get(server->nodestore, &descr->referenceTypeId);
@@ -22871,67 +28479,73 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
             result->statusCode = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
             return;
         }
-        if(descr->includeSubtypes) {
-            result->statusCode = getTypeHierarchy(server->nodestore, rootRef, false,
-                                                  &relevant_refs, &relevant_refs_size);
-            if(result->statusCode != UA_STATUSCODE_GOOD)
-                return;
-        } else {
-            relevant_refs = (UA_NodeId*)(uintptr_t)&descr->referenceTypeId;
-            relevant_refs_size = 1;
-        }
     }
 
     /* get the node */
     const UA_Node *node = UA_NodeStore_get(server->nodestore, &descr->nodeId);
     if(!node) {
         result->statusCode = UA_STATUSCODE_BADNODEIDUNKNOWN;
-        if(!all_refs && descr->includeSubtypes)
-            UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
+        return;
+    }
+
+    /* the positions in the cp are void if the references of the node changed */
+    if(cp && !isCpPositionValid(cp, node)) {
+        result->statusCode = UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        removeCp(cp, session);
         return;
     }
 
     /* if the node has no references, just return */
     if(node->referencesSize == 0) {
         result->referencesSize = 0;
-        if(!all_refs && descr->includeSubtypes)
-            UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
         return;
     }
 
-    /* how many references can we return at most? */
-    size_t real_maxrefs = maxrefs;
-    if(real_maxrefs == 0)
-        real_maxrefs = node->referencesSize;
-    else if(real_maxrefs > node->referencesSize)
-        real_maxrefs = node->referencesSize;
-    result->references = UA_Array_new(real_maxrefs, &UA_TYPES[UA_TYPES_REFERENCEDESCRIPTION]);
-    if(!result->references) {
-        result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
-        goto cleanup;
+    /* how many references can we return at most? Only the targets of the
+     * relevant kinds are counted. (Type nodes have an inverse HasTypeDefinition
+     * reference to each of their instances.) */
+    size_t real_maxrefs = 0;
+    for(size_t i = kindIndex; i < node->referencesSize; ++i) {
+        if(relevantReferenceKind(server, descr, all_refs, &node->references[i]))
+            real_maxrefs += node->references[i].targetIdsSize +
+                node->references[i].remoteTargetIdsSize;
+    }
+    if(maxrefs != 0 && real_maxrefs > maxrefs)
+        real_maxrefs = maxrefs;
+    if(real_maxrefs > 0) {
+        result->references =
+            UA_Array_new(real_maxrefs, &UA_TYPES[UA_TYPES_REFERENCEDESCRIPTION]);
+        if(!result->references) {
+            result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+            goto cleanup;
+        }
     }
 
-    /* loop over the node's references */
-    size_t skipped = 0;
+    /* loop over the relevant reference kinds and their targets. stop at the
+     * next relevant target if the result is full. */
     UA_Boolean isExternal = false;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    for(; referencesIndex < node->referencesSize && referencesCount < real_maxrefs; ++referencesIndex) {
+    while(kindIndex < node->referencesSize) {
+        const UA_NodeReferenceKind *rk = &node->references[kindIndex];
+        if(targetIndex >= rk->targetIdsSize + rk->remoteTargetIdsSize ||
+           !relevantReferenceKind(server, descr, all_refs, rk)) {
+            ++kindIndex;
+            targetIndex = 0;
+            continue;
+        }
+        if(referencesCount >= real_maxrefs)
+            break;
+
         isExternal = false;
         const UA_Node *current =
-            returnRelevantNode(server, descr, all_refs, &node->references[referencesIndex],
-                               relevant_refs, relevant_refs_size, &isExternal);
+            returnRelevantNode(server, descr, referenceTarget(rk, targetIndex), &isExternal);
+        ++targetIndex;
         if(!current)
             continue;
-
-        if(skipped < continuationIndex) {
-            ++skipped;
-        } else {
-            retval |= fillReferenceDescription(server->nodestore, current,
-                                               &node->references[referencesIndex],
-                                               descr->resultMask,
-                                               &result->references[referencesCount]);
-            ++referencesCount;
-        }
+        retval |= fillReferenceDescription(server->nodestore, current, rk,
+                                           descr->resultMask,
+                                           &result->references[referencesCount]);
+        ++referencesCount;
     }
     result->referencesSize = referencesCount;
 
@@ -22950,22 +28564,20 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
     }
 
  cleanup:
-    if(!all_refs && descr->includeSubtypes)
-        UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
     if(result->statusCode != UA_STATUSCODE_GOOD)
         return;
 
     /* create, update, delete continuation points */
     if(cp) {
-        if(referencesIndex == node->referencesSize) {
+        if(kindIndex >= node->referencesSize) {
             /* all done, remove a finished continuationPoint */
             removeCp(cp, session);
         } else {
             /* update the cp and return the cp identifier */
-            cp->continuationIndex += (UA_UInt32)referencesCount;
+            setCpPosition(cp, node, kindIndex, targetIndex);
             UA_ByteString_copy(&cp->identifier, &result->continuationPoint);
         }
-    } else if(maxrefs != 0 && referencesCount >= maxrefs) {
+    } else if(maxrefs != 0 && kindIndex < node->referencesSize) {
         /* create a cp */
         if(session->availableContinuationPoints <= 0 ||
            !(cp = UA_malloc(sizeof(struct ContinuationPointEntry)))) {
@@ -22974,7 +28586,9 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
         }
         UA_BrowseDescription_copy(descr, &cp->browseDescription);
         cp->maxReferences = maxrefs;
-        cp->continuationIndex = (UA_UInt32)referencesCount;
+        UA_NodeId_init(&cp->referenceTypeId);
+        UA_NodeId_init(&cp->targetId);
+        setCpPosition(cp, node, kindIndex, targetIndex);
         UA_Guid *ident = UA_Guid_new();
         *ident = UA_Guid_random();
         cp->identifier.data = (UA_Byte*)ident;
@@ -22987,6 +28601,21 @@ Service_Browse_single(UA_Server *server, UA_Session *session,
     }
 }
 
+typedef struct {
+    UA_Session *session;
+    const UA_BrowseRequest *request;
+    UA_BrowseResponse *response;
+    const UA_Boolean *isExternal;
+} ParallelBrowse;
+
+static void
+browseParallel(UA_Server *server, ParallelBrowse *pb, size_t i) {
+    if(pb->isExternal && pb->isExternal[i])
+        return;
+    Service_Browse_single(server, pb->session, NULL, &pb->request->nodesToBrowse[i],
+                          0, &pb->response->results[i]);
+}
+
 void Service_Browse(UA_Server *server, UA_Session *session, const UA_BrowseRequest *request,
                     UA_BrowseResponse *response) {
     UA_LOG_DEBUG_SESSION(server->config.logger, session, "Processing BrowseRequest");
@@ -23035,6 +28664,17 @@ void Service_Browse(UA_Server *server, UA_Session *session, const UA_BrowseReque
     }
 #endif
 
+    /* Continuation points are added to the session. So only requests without
+     * them are browsed in parallel. */
+    if(request->requestedMaxReferencesPerNode == 0 && UA_Server_isParallel(server, size)) {
+        ParallelBrowse pb = {session, request, response, NULL};
+#ifdef UA_ENABLE_EXTERNAL_NAMESPACES
+        pb.isExternal = isExternal;
+#endif
+        UA_Server_parallelFor(server, size, (UA_ParallelForCallback)browseParallel, &pb);
+        return;
+    }
+
     for(size_t i = 0; i < size; ++i) {
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
         if(!isExternal[i])
@@ -23107,43 +28747,40 @@ UA_Server_browseNext(UA_Server *server, UA_Boolean releaseContinuationPoint,
 /* TranslateBrowsePath */
 /***********************/
 
+/* Does the reference kind match the direction and the reference types? */
+static UA_Boolean
+walkBrowsePathElementReferenceKind(UA_Server *server, const UA_NodeReferenceKind *rk,
+                                   const UA_RelativePathElement *elem, UA_Boolean all_refs) {
+    if(rk->isInverse != elem->isInverse)
+        return false;
+    if(all_refs)
+        return true;
+    if(elem->includeSubtypes)
+        return isSubtypeOf(server, &rk->referenceTypeId, &elem->referenceTypeId);
+    return UA_NodeId_equal(&rk->referenceTypeId, &elem->referenceTypeId);
+}
+
 static void
 walkBrowsePathElementNodeReference(UA_BrowsePathResult *result, size_t *targetsSize,
                                    UA_NodeId **next, size_t *nextSize, size_t *nextCount,
-                                   UA_UInt32 elemDepth, UA_Boolean inverse, UA_Boolean all_refs,
-                                   const UA_NodeId *reftypes, size_t reftypes_count,
-                                   const UA_ReferenceNode *reference) {
-    /* Does the direction of the reference match? */
-    if(reference->isInverse != inverse)
-        return;
-
-    /* Is the node relevant? */
-    if(!all_refs) {
-        UA_Boolean match = false;
-        for(size_t j = 0; j < reftypes_count; ++j) {
-            if(UA_NodeId_equal(&reference->referenceTypeId, &reftypes[j])) {
-                match = true;
-                break;
-            }
-        }
-        if(!match)
-            return;
-    }
-
+                                   UA_UInt32 elemDepth, const UA_ExpandedNodeId *targetId) {
     /* Does the reference point to an external server? Then add to the
      * targets with the right path "depth" */
-    if(reference->targetId.serverIndex != 0) {
-        UA_BrowsePathTarget *tempTargets =
-            UA_realloc(result->targets, sizeof(UA_BrowsePathTarget) * (*targetsSize) * 2);
-        if(!tempTargets) {
-            result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
-            return;
+    if(targetId->serverIndex != 0) {
+        if(*targetsSize <= result->targetsSize) {
+            UA_BrowsePathTarget *tempTargets =
+                UA_realloc(result->targets, sizeof(UA_BrowsePathTarget) * (*targetsSize) * 2);
+            if(!tempTargets) {
+                result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+                return;
+            }
+            result->targets = tempTargets;
+            (*targetsSize) *= 2;
         }
-        result->targets = tempTargets;
-        (*targetsSize) *= 2;
-        result->statusCode = UA_ExpandedNodeId_copy(&reference->targetId,
+        result->statusCode = UA_ExpandedNodeId_copy(targetId,
                                                     &result->targets[result->targetsSize].targetId);
         result->targets[result->targetsSize].remainingPathIndex = elemDepth;
+        ++result->targetsSize;
         return;
     }
 
@@ -23157,8 +28794,7 @@ walkBrowsePathElementNodeReference(UA_BrowsePathResult *result, size_t *targetsS
         *next = tempNext;
         (*nextSize) *= 2;
     }
-    result->statusCode = UA_NodeId_copy(&reference->targetId.nodeId,
-                                        &(*next)[*nextCount]);
+    result->statusCode = UA_NodeId_copy(&targetId->nodeId, &(*next)[*nextCount]);
     ++(*nextCount);
 }
 
@@ -23169,22 +28805,12 @@ walkBrowsePathElement(UA_Server *server, UA_Session *session,
                       const UA_QualifiedName *targetName,
                       const UA_NodeId *current, const size_t currentCount,
                       UA_NodeId **next, size_t *nextSize, size_t *nextCount) {
-    /* Get the full list of relevant referencetypes for this path element */
-    UA_NodeId *reftypes = NULL;
-    size_t reftypes_count = 1; // all_refs or no subtypes => 1
-    UA_Boolean all_refs = false;
-    if(UA_NodeId_isNull(&elem->referenceTypeId)) {
-        all_refs = true;
-    } else if(!elem->includeSubtypes) {
-        reftypes = (UA_NodeId*)(uintptr_t)&elem->referenceTypeId; // ptr magic due to const cast
-    } else {
+    /* The subtypes of the referencetype are looked up in the cached closure */
+    UA_Boolean all_refs = UA_NodeId_isNull(&elem->referenceTypeId);
+    if(!all_refs && elem->includeSubtypes) {
         const UA_Node *rootRef = UA_NodeStore_get(server->nodestore, &elem->referenceTypeId);
         if(!rootRef || rootRef->nodeClass != UA_NODECLASS_REFERENCETYPE)
             return;
-        UA_StatusCode retval =
-            getTypeHierarchy(server->nodestore, rootRef, false, &reftypes, &reftypes_count);
-        if(retval != UA_STATUSCODE_GOOD)
-            return;
     }
 
     /* Iterate over all nodes at the current depth-level */
@@ -23204,19 +28830,27 @@ walkBrowsePathElement(UA_Server *server, UA_Session *session,
                           !UA_String_equal(&targetName->name, &node->browseName.name)))
             continue;
 
-        /* Walk over the references in the node */
-        /* Loop over the nodes references */
+        /* Walk over the targets of the matching reference kinds */
         for(size_t r = 0; r < node->referencesSize &&
                 result->statusCode == UA_STATUSCODE_GOOD; ++r) {
-            UA_ReferenceNode *reference = &node->references[r];
-            walkBrowsePathElementNodeReference(result, targetsSize, next, nextSize, nextCount,
-                                               elemDepth, elem->isInverse, all_refs,
-                                               reftypes, reftypes_count, reference);
+            const UA_NodeReferenceKind *rk = &node->references[r];
+            if(!walkBrowsePathElementReferenceKind(server, rk, elem, all_refs))
+                continue;
+            for(size_t t = 0; t < rk->targetIdsSize &&
+                    result->statusCode == UA_STATUSCODE_GOOD; ++t) {
+                UA_ExpandedNodeId targetId;
+                UA_ExpandedNodeId_init(&targetId);
+                targetId.nodeId = rk->targetIds[t];
+                walkBrowsePathElementNodeReference(result, targetsSize, next, nextSize,
+                                                   nextCount, elemDepth, &targetId);
+            }
+            for(size_t t = 0; t < rk->remoteTargetIdsSize &&
+                    result->statusCode == UA_STATUSCODE_GOOD; ++t)
+                walkBrowsePathElementNodeReference(result, targetsSize, next, nextSize,
+                                                   nextCount, elemDepth,
+                                                   &rk->remoteTargetIds[t]);
         }
     }
-
-    if(!all_refs && elem->includeSubtypes)
-        UA_Array_delete(reftypes, reftypes_count, &UA_TYPES[UA_TYPES_NODEID]);
 }
 
 /* This assumes that result->targets has enough room for all currentCount elements */
@@ -23463,7 +29097,7 @@ void Service_RegisterNodes(UA_Server *server, UA_Session *session, const UA_Regi
                            UA_RegisterNodesResponse *response) {
     UA_LOG_DEBUG_SESSION(server->config.logger, session, "Processing RegisterNodesRequest");
     //TODO: hang the nodeids to the session if really needed
-    response->responseHeader.timestamp = UA_DateTime_now();
+    response->responseHeader.timestamp = UA_Server_tickTime();
     if(request->nodesToRegisterSize <= 0)
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOTHINGTODO;
     else {
@@ -23479,7 +29113,7 @@ void Service_UnregisterNodes(UA_Server *server, UA_Session *session, const UA_Un
                              UA_UnregisterNodesResponse *response) {
     UA_LOG_DEBUG_SESSION(server->config.logger, session, "Processing UnRegisterNodesRequest");
     //TODO: remove the nodeids from the session if really needed
-    response->responseHeader.timestamp = UA_DateTime_now();
+    response->responseHeader.timestamp = UA_Server_tickTime();
     if(request->nodesToUnregisterSize==0)
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOTHINGTODO;
 }
@@ -23497,18 +29131,17 @@ static const UA_VariableNode *
 getArgumentsVariableNode(UA_Server *server, const UA_MethodNode *ofMethod,
                          UA_String withBrowseName) {
     UA_NodeId hasProperty = UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY);
-    for(size_t i = 0; i < ofMethod->referencesSize; ++i) {
-        if(ofMethod->references[i].isInverse == false &&
-            UA_NodeId_equal(&hasProperty, &ofMethod->references[i].referenceTypeId)) {
-            const UA_Node *refTarget =
-                UA_NodeStore_get(server->nodestore, &ofMethod->references[i].targetId.nodeId);
-            if(!refTarget)
-                continue;
-            if(refTarget->nodeClass == UA_NODECLASS_VARIABLE &&
-                refTarget->browseName.namespaceIndex == 0 &&
-                UA_String_equal(&withBrowseName, &refTarget->browseName.name)) {
-                return (const UA_VariableNode*) refTarget;
-            }
+    const UA_NodeReferenceKind *rk =
+        UA_Node_findReferenceKind((const UA_Node*)ofMethod, &hasProperty, false);
+    for(size_t i = 0; rk && i < rk->targetIdsSize; ++i) {
+        const UA_Node *refTarget =
+            UA_NodeStore_get(server->nodestore, &rk->targetIds[i]);
+        if(!refTarget)
+            continue;
+        if(refTarget->nodeClass == UA_NODECLASS_VARIABLE &&
+            refTarget->browseName.namespaceIndex == 0 &&
+            UA_String_equal(&withBrowseName, &refTarget->browseName.name)) {
+            return (const UA_VariableNode*) refTarget;
         }
     }
     return NULL;
@@ -23517,13 +29150,14 @@ getArgumentsVariableNode(UA_Server *server, const UA_MethodNode *ofMethod,
 static UA_StatusCode
 argumentsConformsToDefinition(UA_Server *server, const UA_VariableNode *argRequirements,
                               size_t argsSize, UA_Variant *args) {
-    if(argRequirements->value.data.value.value.type != &UA_TYPES[UA_TYPES_ARGUMENT])
-        return UA_STATUSCODE_BADINTERNALERROR;
-    UA_Argument *argReqs = (UA_Argument*)argRequirements->value.data.value.value.data;
-    size_t argReqsSize = argRequirements->value.data.value.value.arrayLength;
     if(argRequirements->valueSource != UA_VALUESOURCE_DATA)
         return UA_STATUSCODE_BADINTERNALERROR;
-    if(UA_Variant_isScalar(&argRequirements->value.data.value.value))
+    const UA_Variant *argValue = &getVariableValue(argRequirements)->value;
+    if(argValue->type != &UA_TYPES[UA_TYPES_ARGUMENT])
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_Argument *argReqs = (UA_Argument*)argValue->data;
+    size_t argReqsSize = argValue->arrayLength;
+    if(UA_Variant_isScalar(argValue))
         argReqsSize = 1;
     if(argReqsSize > argsSize)
         return UA_STATUSCODE_BADARGUMENTSMISSING;
@@ -23576,14 +29210,15 @@ Service_Call_single(UA_Server *server, UA_Session *session,
      * a hasComponent (or subtype) reference */
     UA_Boolean found = false;
     UA_NodeId hasComponentNodeId = UA_NODEID_NUMERIC(0,UA_NS0ID_HASCOMPONENT);
-    UA_NodeId hasSubTypeNodeId = UA_NODEID_NUMERIC(0,UA_NS0ID_HASSUBTYPE);
-    for(size_t i = 0; i < methodCalled->referencesSize; ++i) {
-        if(methodCalled->references[i].isInverse &&
-           UA_NodeId_equal(&methodCalled->references[i].targetId.nodeId, &withObject->nodeId)) {
-            found = isNodeInTree(server->nodestore, &methodCalled->references[i].referenceTypeId,
-                                 &hasComponentNodeId, &hasSubTypeNodeId, 1);
-            if(found)
-                break;
+    for(size_t i = 0; i < methodCalled->referencesSize && !found; ++i) {
+        const UA_NodeReferenceKind *rk = &methodCalled->references[i];
+        if(!rk->isInverse)
+            continue;
+        for(size_t j = 0; j < rk->targetIdsSize; ++j) {
+            if(!UA_NodeId_equal(&rk->targetIds[j], &withObject->nodeId))
+                continue;
+            found = isSubtypeOf(server, &rk->referenceTypeId, &hasComponentNodeId);
+            break;
         }
     }
     if(!found) {
@@ -23613,13 +29248,14 @@ Service_Call_single(UA_Server *server, UA_Session *session,
     const UA_VariableNode *outputArguments =
         getArgumentsVariableNode(server, methodCalled, UA_STRING("OutputArguments"));
     if(outputArguments) {
-        result->outputArguments = UA_Array_new(outputArguments->value.data.value.value.arrayLength,
+        size_t outputArgumentsSize = getVariableValue(outputArguments)->value.arrayLength;
+        result->outputArguments = UA_Array_new(outputArgumentsSize,
                                                &UA_TYPES[UA_TYPES_VARIANT]);
         if(!result->outputArguments) {
             result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
             return;
         }
-        result->outputArgumentsSize = outputArguments->value.data.value.value.arrayLength;
+        result->outputArgumentsSize = outputArgumentsSize;
     }
 
     /* Call the method */
@@ -23692,8 +29328,6 @@ void Service_Call(UA_Server *server, UA_Session *session,
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS /* conditional compilation */
 
-#define UA_VALUENCODING_MAXSTACK 512
-
 /*****************/
 /* MonitoredItem */
 /*****************/
@@ -23708,17 +29342,35 @@ UA_MonitoredItem * UA_MonitoredItem_new() {
     new->monitoredItemType = UA_MONITOREDITEMTYPE_CHANGENOTIFY; /* currently hardcoded */
     new->timestampsToReturn = UA_TIMESTAMPSTORETURN_SOURCE;
     UA_String_init(&new->indexRange);
+    new->range.dimensionsSize = 0;
+    new->range.dimensions = NULL;
     TAILQ_INIT(&new->queue);
     UA_NodeId_init(&new->monitoredNodeId);
-    new->lastSampledValue = UA_BYTESTRING_NULL;
+    new->monitoredNode = NULL;
+    memset(&new->lastSample, 0, sizeof(MonitoredItem_lastSample));
     memset(&new->sampleJobGuid, 0, sizeof(UA_Guid));
     new->sampleJobIsRegistered = false;
+    new->asyncSample = NULL;
+    new->inSampleBatch = false;
+    new->sampleOnWrite = false;
+    new->isWatcher = false;
     new->itemId = 0;
     return new;
 }
 
 void MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
     MonitoredItem_unregisterSampleJob(server, monitoredItem);
+    /* Detach from an outstanding asynchronous sample. Its result is dropped. */
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->asyncReads_mutex);
+#endif
+    if(monitoredItem->asyncSample)
+        monitoredItem->asyncSample->mon = NULL;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->asyncReads_mutex);
+#endif
+    if(monitoredItem->inSampleBatch)
+        LIST_REMOVE(monitoredItem, sampleBatchEntry);
     /* clear the queued samples */
     MonitoredItem_queuedValue *val, *val_tmp;
     TAILQ_FOREACH_SAFE(val, &monitoredItem->queue, listEntry, val_tmp) {
@@ -23729,8 +29381,9 @@ void MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
     monitoredItem->currentQueueSize = 0;
     LIST_REMOVE(monitoredItem, listEntry);
     UA_String_deleteMembers(&monitoredItem->indexRange);
-    UA_ByteString_deleteMembers(&monitoredItem->lastSampledValue);
+    UA_free(monitoredItem->range.dimensions);
     UA_NodeId_deleteMembers(&monitoredItem->monitoredNodeId);
+    UA_Server_releaseInternedNodeId(server, monitoredItem->monitoredNode);
     UA_free(monitoredItem);
 }
 
@@ -23750,63 +29403,56 @@ ensureSpaceInMonitoredItemQueue(UA_MonitoredItem *mon) {
     --mon->currentQueueSize;
 }
 
-/* Has this sample changed from the last one? The method may allocate additional
- * space for the encoding buffer. Detect the change in encoding->data. */
-static UA_StatusCode
-detectValueChange(UA_MonitoredItem *mon, UA_DataValue *value,
-                  UA_ByteString *encoding, UA_Boolean *changed) {
-    /* Apply Filter */
-    UA_Boolean hasValue = value->hasValue;
-    if(mon->trigger == UA_DATACHANGETRIGGER_STATUS)
-        value->hasValue = false;
-
-    UA_Boolean hasServerTimestamp = value->hasServerTimestamp;
-    UA_Boolean hasServerPicoseconds = value->hasServerPicoseconds;
-    value->hasServerTimestamp = false;
-    value->hasServerPicoseconds = false;
-
-    UA_Boolean hasSourceTimestamp = value->hasSourceTimestamp;
-    UA_Boolean hasSourcePicoseconds = value->hasSourcePicoseconds;
-    if(mon->trigger < UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
-        value->hasSourceTimestamp = false;
-        value->hasSourcePicoseconds = false;
-    }
-
-    /* Encode the data for comparison */
-    UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    size_t binsize = UA_calcSizeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE]);
-    if(binsize == 0) {
-        retval = UA_STATUSCODE_BADINTERNALERROR;
-        goto cleanup;
+/* Keeps the parts of the value that are compared under the trigger. The
+ * server timestamp is never compared. */
+static void
+takeSample(const UA_MonitoredItem *mon, const UA_DataValue *value,
+           MonitoredItem_lastSample *sample) {
+    memset(sample, 0, sizeof(MonitoredItem_lastSample));
+    sample->valid = true;
+    if(value->hasStatus) {
+        sample->mask |= UA_SAMPLE_HASSTATUS;
+        sample->status = value->status;
+    }
+    if(mon->trigger >= UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
+        if(value->hasSourceTimestamp) {
+            sample->mask |= UA_SAMPLE_HASSOURCETIMESTAMP;
+            sample->sourceTimestamp = value->sourceTimestamp;
+        }
+        if(value->hasSourcePicoseconds) {
+            sample->mask |= UA_SAMPLE_HASSOURCEPICOSECONDS;
+            sample->sourcePicoseconds = value->sourcePicoseconds;
+        }
     }
+    if(!value->hasValue || mon->trigger == UA_DATACHANGETRIGGER_STATUS)
+        return;
 
-    /* Allocate buffer on the heap if necessary */
-    if(binsize > UA_VALUENCODING_MAXSTACK &&
-       UA_ByteString_allocBuffer(encoding, binsize) != UA_STATUSCODE_GOOD) {
-        retval = UA_STATUSCODE_BADOUTOFMEMORY;
-        goto cleanup;
+    sample->mask |= UA_SAMPLE_HASVALUE;
+    const UA_Variant *v = &value->value;
+    if(v->type && v->type->builtin && v->type->fixedSize &&
+       v->type->memSize <= sizeof(sample->value.scalar) && UA_Variant_isScalar(v)) {
+        sample->scalarType = v->type;
+        memcpy(sample->value.scalar, v->data, v->type->memSize);
+        return;
     }
+    sample->value.hash = UA_hash(v, &UA_TYPES[UA_TYPES_VARIANT]);
+}
 
-    /* Encode the value */
-    size_t encodingOffset = 0;
-    retval = UA_encodeBinary(value, &UA_TYPES[UA_TYPES_DATAVALUE],
-                             NULL, NULL, encoding, &encodingOffset);
-    if(retval != UA_STATUSCODE_GOOD)
-        goto cleanup;
-
-    /* The value has changed */
-    encoding->length = encodingOffset;
-    if(!mon->lastSampledValue.data || !UA_String_equal(encoding, &mon->lastSampledValue))
-        *changed = true;
-
- cleanup:
-    /* Reset the filter */
-    value->hasValue = hasValue;
-    value->hasServerTimestamp = hasServerTimestamp;
-    value->hasServerPicoseconds = hasServerPicoseconds;
-    value->hasSourceTimestamp = hasSourceTimestamp;
-    value->hasSourcePicoseconds = hasSourcePicoseconds;
-    return retval;
+/* Has this sample changed from the last one? */
+static UA_Boolean
+detectValueChange(const UA_MonitoredItem *mon, const MonitoredItem_lastSample *sample) {
+    const MonitoredItem_lastSample *last = &mon->lastSample;
+    if(!last->valid || last->mask != sample->mask || last->status != sample->status ||
+       last->sourceTimestamp != sample->sourceTimestamp ||
+       last->sourcePicoseconds != sample->sourcePicoseconds ||
+       last->scalarType != sample->scalarType)
+        return true;
+    if(!(sample->mask & UA_SAMPLE_HASVALUE))
+        return false;
+    if(sample->scalarType)
+        return memcmp(last->value.scalar, sample->value.scalar,
+                      sample->scalarType->memSize) != 0;
+    return last->value.hash != sample->value.hash;
 }
 
 void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem) {
@@ -23827,20 +29473,41 @@ void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monito
     rvid.indexRange = monitoredItem->indexRange;
     UA_DataValue value;
     UA_DataValue_init(&value);
-    Service_Read_single(server, sub->session, monitoredItem->timestampsToReturn,
-                        &rvid, &value);
+    const UA_Node *node;
+    if(monitoredItem->monitoredNode)
+        node = UA_NodeStore_getInterned(server->nodestore, monitoredItem->monitoredNode);
+    else
+        node = UA_NodeStore_get(server->nodestore, &monitoredItem->monitoredNodeId);
+    const UA_NumericRange *range = NULL;
+    if(monitoredItem->range.dimensionsSize > 0)
+        range = &monitoredItem->range;
 
-    /* Stack-allocate some memory for the value encoding */
-    UA_Byte *stackValueEncoding = UA_alloca(UA_VALUENCODING_MAXSTACK);
-    UA_ByteString valueEncoding;
-    valueEncoding.data = stackValueEncoding;
-    valueEncoding.length = UA_VALUENCODING_MAXSTACK;
+    /* Asynchronous DataSources process the sample when the value arrives */
+    if(MonitoredItem_sampleAsync(server, monitoredItem, node, &rvid, range))
+        return;
+
+#ifndef UA_ENABLE_MULTITHREADING
+    /* Samples from batch providers are read together */
+    if(MonitoredItem_sampleBatched(server, monitoredItem, node))
+        return;
+#endif
+
+    Service_Read_node(server, sub->session, monitoredItem->timestampsToReturn,
+                      node, &rvid, range, 0.0, NULL, &value);
+    MonitoredItem_processSample(server, monitoredItem, &value);
+}
+
+void
+MonitoredItem_processSample(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                            UA_DataValue *sample) {
+    UA_Subscription *sub = monitoredItem->subscription;
+    UA_DataValue value = *sample;
+    UA_DataValue_init(sample);
 
     /* Has the value changed? */
-    UA_Boolean changed = false;
-    UA_StatusCode retval = detectValueChange(monitoredItem, &value,
-                                             &valueEncoding, &changed);
-    if(!changed || retval != UA_STATUSCODE_GOOD)
+    MonitoredItem_lastSample lastSample;
+    takeSample(monitoredItem, &value, &lastSample);
+    if(!detectValueChange(monitoredItem, &lastSample))
         goto cleanup;
 
     /* Allocate the entry for the publish queue */
@@ -23853,23 +29520,9 @@ void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monito
         goto cleanup;
     }
 
-    /* Copy valueEncoding on the heap for the next comparison (if not already done) */
-    if(valueEncoding.data == stackValueEncoding) {
-        UA_ByteString cbs;
-        if(UA_ByteString_copy(&valueEncoding, &cbs) != UA_STATUSCODE_GOOD) {
-            UA_LOG_WARNING_SESSION(server->config.logger, sub->session,
-                                   "Subscription %u | MonitoredItem %i | "
-                                   "ByteString to compare values could not be created",
-                                   sub->subscriptionID, monitoredItem->itemId);
-            UA_free(newQueueItem);
-            goto cleanup;
-        }
-        valueEncoding = cbs;
-    }
-
     /* Prepare the newQueueItem */
     if(value.hasValue && value.value.storageType == UA_VARIANT_DATA_NODELETE) {
-        if(UA_DataValue_copy(&value, &newQueueItem->value) != UA_STATUSCODE_GOOD) {
+        if(UA_DataValue_copyFlat(&value, &newQueueItem->value) != UA_STATUSCODE_GOOD) {
             UA_LOG_WARNING_SESSION(server->config.logger, sub->session,
                                    "Subscription %u | MonitoredItem %i | "
                                    "Item for the publishing queue could not be prepared",
@@ -23888,9 +29541,8 @@ void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monito
                          "Subscription %u | MonitoredItem %u | Sampled a new value",
                          sub->subscriptionID, monitoredItem->itemId);
 
-    /* Replace the encoding for comparison */
-    UA_ByteString_deleteMembers(&monitoredItem->lastSampledValue);
-    monitoredItem->lastSampledValue = valueEncoding;
+    /* Keep the sample for the next comparison */
+    monitoredItem->lastSample = lastSample;
 
     /* Add the sample to the queue for publication */
     ensureSpaceInMonitoredItemQueue(monitoredItem);
@@ -23899,13 +29551,67 @@ void UA_MoniteredItem_SampleCallback(UA_Server *server, UA_MonitoredItem *monito
     return;
 
  cleanup:
-    if(valueEncoding.data != stackValueEncoding)
-        UA_ByteString_deleteMembers(&valueEncoding);
     UA_DataValue_deleteMembers(&value);
 }
 
+#ifndef UA_ENABLE_MULTITHREADING
+
+void
+MonitoredItem_sampleWatchers(UA_Server *server, const UA_NodeId *nodeId,
+                             const UA_InternedNodeId *interned) {
+    if(server->watchersCount == 0)
+        return;
+    if(!interned)
+        interned = UA_Server_findInternedNodeId(server, nodeId);
+    if(!interned)
+        return;
+    UA_InternedNode *entry = (UA_InternedNode*)(uintptr_t)interned;
+    UA_MonitoredItem *mon, *mon_tmp;
+    LIST_FOREACH_SAFE(mon, &entry->watchers, watcherEntry, mon_tmp)
+        UA_MoniteredItem_SampleCallback(server, mon);
+}
+
+void
+MonitoredItem_pollWatchers(UA_Server *server, const UA_NodeId *nodeId) {
+    if(server->watchersCount == 0)
+        return;
+    const UA_InternedNodeId *interned = UA_Server_findInternedNodeId(server, nodeId);
+    if(!interned)
+        return;
+    /* The requested samplingInterval was zero. Bound it as for a new item. */
+    const UA_VariableNode *vn = (const UA_VariableNode*)
+        UA_NodeStore_getInterned(server->nodestore, interned);
+    UA_Double samplingInterval = 0.0;
+    if(vn && vn->nodeClass == UA_NODECLASS_VARIABLE &&
+       samplingInterval < vn->minimumSamplingInterval)
+        samplingInterval = vn->minimumSamplingInterval;
+    if(samplingInterval < server->config.samplingIntervalLimits.min)
+        samplingInterval = server->config.samplingIntervalLimits.min;
+    if(samplingInterval > server->config.samplingIntervalLimits.max)
+        samplingInterval = server->config.samplingIntervalLimits.max;
+    UA_InternedNode *entry = (UA_InternedNode*)(uintptr_t)interned;
+    UA_MonitoredItem *mon, *mon_tmp;
+    LIST_FOREACH_SAFE(mon, &entry->watchers, watcherEntry, mon_tmp) {
+        MonitoredItem_unregisterSampleJob(server, mon);
+        mon->sampleOnWrite = false;
+        mon->samplingInterval = samplingInterval;
+        MonitoredItem_registerSampleJob(server, mon);
+    }
+}
+
+#endif
+
 UA_StatusCode
 MonitoredItem_registerSampleJob(UA_Server *server, UA_MonitoredItem *mon) {
+#ifndef UA_ENABLE_MULTITHREADING
+    if(mon->sampleOnWrite) {
+        UA_InternedNode *entry = (UA_InternedNode*)(uintptr_t)mon->monitoredNode;
+        LIST_INSERT_HEAD(&entry->watchers, mon, watcherEntry);
+        mon->isWatcher = true;
+        ++server->watchersCount;
+        return UA_STATUSCODE_GOOD;
+    }
+#endif
     UA_Job job;
     job.type = UA_JOBTYPE_METHODCALL;
     job.job.methodCall.method = (UA_ServerCallback)UA_MoniteredItem_SampleCallback;
@@ -23919,6 +29625,14 @@ MonitoredItem_registerSampleJob(UA_Server *server, UA_MonitoredItem *mon) {
 }
 
 UA_StatusCode MonitoredItem_unregisterSampleJob(UA_Server *server, UA_MonitoredItem *mon) {
+#ifndef UA_ENABLE_MULTITHREADING
+    if(mon->isWatcher) {
+        LIST_REMOVE(mon, watcherEntry);
+        mon->isWatcher = false;
+        --server->watchersCount;
+        return UA_STATUSCODE_GOOD;
+    }
+#endif
     if(!mon->sampleJobIsRegistered)
         return UA_STATUSCODE_GOOD;
     mon->sampleJobIsRegistered = false;
@@ -24171,7 +29885,7 @@ void UA_Subscription_publishCallback(UA_Server *server, UA_Subscription *sub) {
     SIMPLEQ_REMOVE_HEAD(&sub->session->responseQueue, listEntry);
 
     /* Set up the response */
-    response->responseHeader.timestamp = UA_DateTime_now();
+    response->responseHeader.timestamp = UA_Server_tickTime();
     response->subscriptionId = sub->subscriptionID;
     response->moreNotifications = moreNotifications;
     message->publishTime = response->responseHeader.timestamp;
@@ -24273,7 +29987,7 @@ UA_Subscription_answerPublishRequestsNoSubscription(UA_Server *server, UA_NodeId
         SIMPLEQ_REMOVE_HEAD(&session->responseQueue, listEntry);
         UA_PublishResponse *response = &pre->response;
         response->responseHeader.serviceResult = UA_STATUSCODE_BADNOSUBSCRIPTION;
-        response->responseHeader.timestamp = UA_DateTime_now();
+        response->responseHeader.timestamp = UA_Server_tickTime();
         UA_SecureChannel_sendBinaryMessage(session->channel, pre->requestId, response,
                                            &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
         UA_PublishResponse_deleteMembers(response);
@@ -24435,14 +30149,29 @@ setMonitoredItemSettings(UA_Server *server, UA_MonitoredItem *mon,
     /* ClientHandle */
     mon->clientHandle = params->clientHandle;
 
-    /* SamplingInterval */
+    /* SamplingInterval. Without multithreading, a samplingInterval of zero
+     * on a variable with the value stored in the node samples on every write
+     * of the value. DataSources and values updated in the onRead callback
+     * are polled. */
     UA_Double samplingInterval = params->samplingInterval;
+    UA_Boolean onWrite = false;
     if(mon->attributeID == UA_ATTRIBUTEID_VALUE) {
-        const UA_VariableNode *vn = (const UA_VariableNode*)
-            UA_NodeStore_get(server->nodestore, &mon->monitoredNodeId);
+        const UA_VariableNode *vn;
+        if(mon->monitoredNode)
+            vn = (const UA_VariableNode*)
+                UA_NodeStore_getInterned(server->nodestore, mon->monitoredNode);
+        else
+            vn = (const UA_VariableNode*)
+                UA_NodeStore_get(server->nodestore, &mon->monitoredNodeId);
         if(vn && vn->nodeClass == UA_NODECLASS_VARIABLE &&
            samplingInterval <  vn->minimumSamplingInterval)
             samplingInterval = vn->minimumSamplingInterval;
+#ifndef UA_ENABLE_MULTITHREADING
+        onWrite = (samplingInterval == 0.0 && mon->monitoredNode && vn &&
+                   vn->nodeClass == UA_NODECLASS_VARIABLE &&
+                   vn->valueSource == UA_VALUESOURCE_DATA &&
+                   !vn->value.data.callback.onRead);
+#endif
     } else if(mon->attributeID == UA_ATTRIBUTEID_EVENTNOTIFIER) {
         /* TODO: events should not need a samplinginterval */
         samplingInterval = 10000.0f; // 10 seconds to reduce the load
@@ -24452,6 +30181,9 @@ setMonitoredItemSettings(UA_Server *server, UA_MonitoredItem *mon,
         samplingInterval, mon->samplingInterval);
     if(samplingInterval != samplingInterval) /* Check for nan */
         mon->samplingInterval = server->config.samplingIntervalLimits.min;
+    mon->sampleOnWrite = onWrite;
+    if(onWrite)
+        mon->samplingInterval = 0.0;
 
     /* Filter */
     if(params->filter.encoding != UA_EXTENSIONOBJECT_DECODED ||
@@ -24528,6 +30260,22 @@ Service_CreateMonitoredItems_single(UA_Server *server, UA_Session *session,
         MonitoredItem_delete(server, newMon);
         return;
     }
+    /* The node exists (see the example read above). Interning failures only
+     * disable the faster lookup for sampling. */
+    newMon->monitoredNode = UA_Server_internNodeId(server, newMon->monitoredNodeId);
+
+    /* Parse the index range once instead of for every sample. The range was
+     * already validated by the example read above. */
+    if(request->itemToMonitor.indexRange.length > 0) {
+        retval = UA_String_copy(&request->itemToMonitor.indexRange, &newMon->indexRange);
+        if(retval == UA_STATUSCODE_GOOD)
+            retval = parse_numericrange(&newMon->indexRange, &newMon->range);
+        if(retval != UA_STATUSCODE_GOOD) {
+            result->statusCode = retval;
+            MonitoredItem_delete(server, newMon);
+            return;
+        }
+    }
     newMon->subscription = sub;
     newMon->attributeID = request->itemToMonitor.attributeId;
     newMon->itemId = ++(sub->lastMonitoredItemId);
@@ -24541,7 +30289,6 @@ Service_CreateMonitoredItems_single(UA_Server *server, UA_Session *session,
         UA_MoniteredItem_SampleCallback(server, newMon);
 
     /* Prepare the response */
-    UA_String_copy(&request->itemToMonitor.indexRange, &newMon->indexRange);
     result->revisedSamplingInterval = newMon->samplingInterval;
     result->revisedQueueSize = newMon->maxQueueSize;
     result->monitoredItemId = newMon->itemId;
@@ -24752,7 +30499,7 @@ Service_Publish(UA_Server *server, UA_Session *session,
  send_error:
     UA_PublishResponse_init(&err_response);
     err_response.responseHeader.requestHandle = request->requestHeader.requestHandle;
-    err_response.responseHeader.timestamp = UA_DateTime_now();
+    err_response.responseHeader.timestamp = UA_Server_tickTime();
     err_response.responseHeader.serviceResult = retval;
     UA_assert(err_response.responseHeader.requestHandle != 0);
     UA_SecureChannel_sendBinaryMessage(session->channel, requestId, &err_response,
@@ -27294,14 +33041,30 @@ UA_DateTime UA_DateTime_nowMonotonic(void) {
     clock_get_time(cclock, &mts);
     mach_port_deallocate(mach_task_self(), cclock);
     return (mts.tv_sec * UA_SEC_TO_DATETIME) + (mts.tv_nsec / 100);
-#elif !defined(CLOCK_MONOTONIC_RAW)
+#else
+    /* CLOCK_MONOTONIC_RAW is not served from the vDSO on many kernels and
+     * requires a syscall. CLOCK_MONOTONIC is slewed by NTP but never jumps. */
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (ts.tv_sec * UA_SEC_TO_DATETIME) + (ts.tv_nsec / 100);
-#else
+#endif
+}
+
+UA_DateTime UA_DateTime_nowCoarse(void) {
+#if defined(_WIN32)
+    /* The system time with the resolution of the timer interrupt */
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER ul;
+    ul.LowPart = ft.dwLowDateTime;
+    ul.HighPart = ft.dwHighDateTime;
+    return (UA_DateTime)ul.QuadPart;
+#elif defined(CLOCK_REALTIME_COARSE)
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    return (ts.tv_sec * UA_SEC_TO_DATETIME) + (ts.tv_nsec / 100);
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return (ts.tv_sec * UA_SEC_TO_DATETIME) + (ts.tv_nsec / 100) + UA_DATETIME_UNIX_EPOCH;
+#else
+    return UA_DateTime_now();
 #endif
 }
 
@@ -27330,18 +33093,18 @@ const char *LogCategoryNames[6] = {"network", "channel", "session", "server", "c
 void
 UA_Log_Stdout(UA_LogLevel level, UA_LogCategory category,
               const char *msg, va_list args) {
-    UA_String t = UA_DateTime_toString(UA_DateTime_now());
+    char t[UA_DATETIME_STRINGLENGTH + 1];
+    UA_DateTime_toBuffer(UA_DateTime_nowCoarse(), t, sizeof(t));
 #ifdef UA_ENABLE_MULTITHREADING
     pthread_mutex_lock(&printf_mutex);
 #endif
-    printf("[%.23s] %s/%s\t", t.data, LogLevelNames[level], LogCategoryNames[category]);
+    printf("[%.23s] %s/%s\t", t, LogLevelNames[level], LogCategoryNames[category]);
     vprintf(msg, args);
     printf("\n");
     fflush(stdout);
 #ifdef UA_ENABLE_MULTITHREADING
     pthread_mutex_unlock(&printf_mutex);
 #endif
-    UA_ByteString_deleteMembers(&t);
 }
 
 #if (defined(__GNUC__) && defined(__GNUC_MINOR__) && __GNUC__ >= 4 && __GNUC_MINOR__ >= 6) || \
@@ -27442,7 +33205,15 @@ const UA_EXPORT UA_ServerConfig UA_ServerConfig_standard = {
 
     /* Limits for MonitoredItems */
     .samplingIntervalLimits = { .min = 50.0, .max = 24.0 * 3600.0 * 1000.0 },
-    .queueSizeLimits = { .max = 100, .min = 1 }
+    .queueSizeLimits = { .max = 100, .min = 1 },
+
+    /* Asynchronous DataSources */
+    .asyncReadTimeout = 10 * 1000, /* 10s */
+    .valueCacheSize = 1024 * 1024, /* 1MB */
+    .parallelOperationsThreshold = 1000,
+
+    /* Decoding */
+    .lazyDecoding = false
 };
 
 /***************************/
@@ -27479,6 +33250,103 @@ const UA_SubscriptionSettings UA_SubscriptionSettings_standard = {
 
 #endif
 
+/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/plugins/ua_snapshot_file.c" ***********************************/
+
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information. */
+
+#include <stdio.h>
+#ifdef _WIN32
+# ifdef SLIST_ENTRY
+#  undef SLIST_ENTRY /* Fix redefinition of SLIST_ENTRY on mingw winnt.h */
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+UA_StatusCode
+UA_Server_saveNodestoreSnapshotFile(UA_Server *server, const char *path) {
+    UA_ByteString image;
+    UA_StatusCode retval = UA_Server_saveNodestoreSnapshot(server, &image);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    FILE *f = fopen(path, "wb");
+    if(!f) {
+        UA_ByteString_deleteMembers(&image);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if(fwrite(image.data, 1, image.length, f) != image.length)
+        retval = UA_STATUSCODE_BADINTERNALERROR;
+    if(fclose(f) != 0)
+        retval = UA_STATUSCODE_BADINTERNALERROR;
+    UA_ByteString_deleteMembers(&image);
+    return retval;
+}
+
+#ifdef _WIN32
+
+UA_StatusCode
+UA_Server_loadNodestoreSnapshotFile(UA_Server *server, const char *path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return UA_STATUSCODE_BADNOTFOUND;
+    UA_StatusCode retval = UA_STATUSCODE_BADINTERNALERROR;
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+       (unsigned long long)size.QuadPart > (size_t)-1) {
+        CloseHandle(file);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping) {
+        void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(data) {
+            UA_ByteString image;
+            image.data = (UA_Byte*)data;
+            image.length = (size_t)size.QuadPart;
+            retval = UA_Server_loadNodestoreSnapshot(server, &image);
+            UnmapViewOfFile(data);
+        }
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return retval;
+}
+
+#else
+
+UA_StatusCode
+UA_Server_loadNodestoreSnapshotFile(UA_Server *server, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return UA_STATUSCODE_BADNOTFOUND;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping remains valid */
+    if(data == MAP_FAILED)
+        return UA_STATUSCODE_BADINTERNALERROR;
+# ifdef MADV_SEQUENTIAL
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+# endif
+    UA_ByteString image;
+    image.data = (UA_Byte*)data;
+    image.length = (size_t)st.st_size;
+    UA_StatusCode retval = UA_Server_loadNodestoreSnapshot(server, &image);
+    munmap(data, (size_t)st.st_size);
+    return retval;
+}
+
+#endif
+
 /*********************************** amalgamated original file "/home/travis/build/open62541/open62541/deps/libc_time.c" ***********************************/
 
 /*
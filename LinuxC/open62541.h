@@ -1062,6 +1062,10 @@ UA_DateTime UA_EXPORT UA_DateTime_now(void);
  * current time */
 UA_DateTime UA_EXPORT UA_DateTime_nowMonotonic(void);
 
+/* The current time with the resolution of the system timer (typically 1-4ms).
+ * Cheaper than UA_DateTime_now where the platform has a coarse clock. */
+UA_DateTime UA_EXPORT UA_DateTime_nowCoarse(void);
+
 typedef struct UA_DateTimeStruct {
     UA_UInt16 nanoSec;
     UA_UInt16 microSec;
@@ -1078,6 +1082,14 @@ UA_DateTimeStruct UA_EXPORT UA_DateTime_toStruct(UA_DateTime t);
 
 UA_String UA_EXPORT UA_DateTime_toString(UA_DateTime t);
 
+/* Length of the string representation "MM/DD/YYYY hh:mm:ss.msc.usc.nsc" */
+#define UA_DATETIME_STRINGLENGTH 31
+
+/* Print the DateTime into a buffer without allocating. The buffer must have
+ * room for UA_DATETIME_STRINGLENGTH characters and the terminating zero. */
+UA_StatusCode UA_EXPORT
+UA_DateTime_toBuffer(UA_DateTime t, char *buf, size_t bufSize);
+
 /**
  * Guid
  * ^^^^
@@ -1326,6 +1338,19 @@ typedef struct  {
     UA_NumericRangeDimension *dimensions;
 } UA_NumericRange;
 
+/* Parse the string encoding of a NumericRange. Parse once and keep the result
+ * when the same range is applied repeatedly. The dimensions are allocated and
+ * need to be freed with UA_NumericRange_deleteMembers. */
+UA_StatusCode UA_EXPORT
+UA_NumericRange_parseFromString(UA_NumericRange *range, const UA_String *str);
+
+static UA_INLINE void
+UA_NumericRange_deleteMembers(UA_NumericRange *range) {
+    UA_free(range->dimensions);
+    range->dimensions = NULL;
+    range->dimensionsSize = 0;
+}
+
 /**
  * .. _variant:
  *
@@ -1372,6 +1397,12 @@ typedef enum {
     UA_VARIANT_DATA_NODELETE, /* The data is "borrowed" by the variant and
                                  shall not be deleted at the end of the
                                  variant's lifecycle. */
+    UA_VARIANT_DATA_FLAT,     /* The data and all of its content are placed in
+                                 a single block that is freed at once. See
+                                 UA_Variant_copyFlat. */
+    UA_VARIANT_DATA_SHARED    /* Like UA_VARIANT_DATA_FLAT, but the block is
+                                 reference-counted and shared between
+                                 variants. See UA_Variant_copyShared. */
 } UA_VariantStorageType;
 
 typedef struct {
@@ -1476,6 +1507,54 @@ UA_StatusCode UA_EXPORT
 UA_Variant_copyRange(const UA_Variant *src, UA_Variant *dst,
                      const UA_NumericRange range);
 
+/* Set dst to a read-only view of a range of src without copying. This is
+ * possible for one-dimensional arrays (without arrayDimensions) where the range
+ * selects a contiguous block. The view has the storage type
+ * UA_VARIANT_DATA_NODELETE and must not outlive src. Otherwise,
+ * UA_STATUSCODE_BADNOTSUPPORTED is returned and UA_Variant_copyRange can be
+ * used instead.
+ *
+ * @param src The source variant
+ * @param dst The target variant
+ * @param range The range of the viewed data
+ * @return Returns UA_STATUSCODE_GOOD or an error code */
+UA_StatusCode UA_EXPORT
+UA_Variant_viewRange(const UA_Variant *src, UA_Variant *dst,
+                     const UA_NumericRange range);
+
+/* Deep-copy a variant into a single allocation. The copy has the storage type
+ * UA_VARIANT_DATA_FLAT and UA_Variant_deleteMembers frees the block without
+ * walking the content. The copy is read-only: its content must not be replaced
+ * or decoded in-situ.
+ *
+ * @param src The source variant
+ * @param dst The target variant
+ * @return Returns UA_STATUSCODE_GOOD or an error code */
+UA_StatusCode UA_EXPORT
+UA_Variant_copyFlat(const UA_Variant *src, UA_Variant *dst);
+
+/* Copy a variant into an immutable buffer that is shared between all copies.
+ * If src is already shared, only the reference count is increased. Otherwise,
+ * a flat copy with the storage type UA_VARIANT_DATA_SHARED is created. Every
+ * copy releases its reference with UA_Variant_deleteMembers. The reference
+ * count is atomic when multithreading is enabled. Node values are stored this
+ * way, so that reads, samples and notifications share the buffer.
+ *
+ * @param src The source variant
+ * @param dst The target variant
+ * @return Returns UA_STATUSCODE_GOOD or an error code */
+UA_StatusCode UA_EXPORT
+UA_Variant_copyShared(const UA_Variant *src, UA_Variant *dst);
+
+/* Replace shared or flat content by a private deep copy that can be modified
+ * (copy-on-write). Does nothing for the other storage types. Writing a range
+ * with UA_Variant_setRange does this implicitly.
+ *
+ * @param v The variant
+ * @return Returns UA_STATUSCODE_GOOD or an error code */
+UA_StatusCode UA_EXPORT
+UA_Variant_makeWritable(UA_Variant *v);
+
 /* Insert a range of data into an existing variant. The data array can't be
  * reused afterwards if it contains types without a fixed size (e.g. strings)
  * since the members are moved into the variant and take on its lifecycle.
@@ -1536,6 +1615,27 @@ typedef struct {
     } content;
 } UA_ExtensionObject;
 
+/* Messages can be decoded in a lazy mode where the body of ExtensionObjects is
+ * kept in the UA_EXTENSIONOBJECT_ENCODED_BYTESTRING form, also when they are
+ * contained in a variant. The following functions unpack the content on
+ * demand. Unknown types are left untouched.
+ *
+ * @param eo The ExtensionObject that is decoded in-situ
+ * @return Returns UA_STATUSCODE_GOOD or an error code. A body with trailing
+ *         bytes is a UA_STATUSCODE_BADDECODINGERROR. */
+UA_StatusCode UA_EXPORT
+UA_ExtensionObject_decodeBody(UA_ExtensionObject *eo);
+
+/* Unwraps encoded ExtensionObjects in a variant (scalar or array of the same
+ * type) into the contained data type. The variant takes ownership of the
+ * decoded content.
+ *
+ * @param v The variant that is decoded in-situ
+ * @return Returns UA_STATUSCODE_GOOD or an error code. A body with trailing
+ *         bytes is a UA_STATUSCODE_BADDECODINGERROR. */
+UA_StatusCode UA_EXPORT
+UA_Variant_decodeBody(UA_Variant *v);
+
 /**
  * .. _datavalue:
  *
@@ -1682,6 +1782,39 @@ UA_init(void *p, const UA_DataType *type) {
 UA_StatusCode UA_EXPORT
 UA_copy(const void *src, void *dst, const UA_DataType *type);
 
+/* Copies a variable and all of its content into a single newly allocated block
+ * that is released with UA_free. Do not use UA_delete or UA_deleteMembers on
+ * the copy. Variants and ExtensionObjects within the copy don't own their
+ * content.
+ *
+ * @param src The memory location of the source variable
+ * @param dst Pointer to the location of the newly allocated copy
+ * @param type The datatype description
+ * @return Indicates whether the operation succeeded or returns an error code */
+UA_StatusCode UA_EXPORT
+UA_copyFlat(const void *src, void **dst, const UA_DataType *type);
+
+/* Returns the number of bytes of the dynamically allocated content of a
+ * variable (without the variable itself). Every allocation is rounded up to
+ * 8 bytes, as in the block of UA_copyFlat. */
+size_t UA_EXPORT
+UA_calcSizeFlat(const void *p, const UA_DataType *type);
+
+/* Returns a 64-bit hash of the content of a variable. Variables with equal
+ * content have the same hash. The hash depends on the byte order of the host
+ * and must not be persisted. */
+UA_UInt64 UA_EXPORT
+UA_hash(const void *p, const UA_DataType *type);
+
+/* Copies a DataValue with UA_Variant_copyFlat for the contained variant. The
+ * copy is deleted with UA_DataValue_deleteMembers as usual. */
+UA_StatusCode UA_EXPORT
+UA_DataValue_copyFlat(const UA_DataValue *src, UA_DataValue *dst);
+
+/* Copies a DataValue with UA_Variant_copyShared for the contained variant. */
+UA_StatusCode UA_EXPORT
+UA_DataValue_copyShared(const UA_DataValue *src, UA_DataValue *dst);
+
 /* Deletes the dynamically allocated content of a variable (e.g. resets all
  * arrays to undefined arrays). Afterwards, the variable can be safely deleted
  * without causing memory leaks. But the variable is not initialized and may
@@ -9800,9 +9933,32 @@ typedef struct {
     UA_UInt32 maxNotificationsPerPublish;
     UA_UInt32 maxRetransmissionQueueSize; /* 0 -> unlimited size */
 
-    /* Limits for MonitoredItems */
+    /* Limits for MonitoredItems. Without multithreading, a requested
+     * samplingInterval of zero is kept for the value of variables that are
+     * not DataSources and have no onRead callback. They are sampled every
+     * time the value is written. When a DataSource or an onRead callback is
+     * set later on, the samplingInterval falls back to the lower limit. */
     UA_DoubleRange samplingIntervalLimits;
     UA_UInt32Range queueSizeLimits; /* Negotiated with the client */
+
+    /* Asynchronous DataSources */
+    UA_UInt32 asyncReadTimeout; /* in ms, if the request has no timeoutHint */
+
+    /* Memory budget in bytes for the values cached from DataSources by reads
+     * with a maxAge. 0 disables the cache. */
+    size_t valueCacheSize;
+
+    /* Read, Write and Browse requests with at least this many operations are
+     * processed by several worker threads in parallel (only if
+     * multithreading is enabled). 0 disables. The callbacks of different
+     * nodes (and the read callbacks of one node) may then run concurrently.
+     * The writes to one node stay in one thread in the order of the request. */
+    UA_UInt32 parallelOperationsThreshold;
+
+    /* Decoding */
+    UA_Boolean lazyDecoding; /* Keep the body of ExtensionObjects in requests
+                              * encoded until it is needed. Unmodified values
+                              * are re-encoded by a raw copy. */
 } UA_ServerConfig;
 
 /* Add a new namespace to the server. Returns the index of the new namespace */
@@ -9895,10 +10051,27 @@ UA_Server_removeRepeatedJob(UA_Server *server, UA_Guid jobId);
  *             used for array ranges.
  * @param timestamps Which timestamps to return for the attribute.
  * @return Returns a DataValue that contains either an error code, or a variant
- *         with the attribute value and the timestamps. */
+ *         with the attribute value and the timestamps. The variant has the
+ *         storageType UA_VARIANT_DATA and is owned by the caller. */
 UA_DataValue UA_EXPORT
 UA_Server_read(UA_Server *server, const UA_ReadValueId *item,
                UA_TimestampsToReturn timestamps);
+
+/* Same as UA_Server_read, but a shared value is not copied. The variant may
+ * share the reference-counted buffer of the node (UA_VARIANT_DATA_SHARED) or
+ * be a copy. Its content is read-only. Release it with
+ * UA_DataValue_deleteMembers. Use UA_Variant_makeWritable before changing
+ * the content. */
+UA_DataValue UA_EXPORT
+UA_Server_readShared(UA_Server *server, const UA_ReadValueId *item,
+                     UA_TimestampsToReturn timestamps);
+
+/* Same as UA_Server_read, but with a pre-parsed index range (see
+ * UA_NumericRange_parseFromString) that replaces the indexRange string of the
+ * ReadValueId. Use this to read the same window of an array repeatedly. */
+UA_DataValue UA_EXPORT
+UA_Server_readRange(UA_Server *server, const UA_ReadValueId *item,
+                    const UA_NumericRange *range, UA_TimestampsToReturn timestamps);
     
 /* Don't use this function. There are typed versions for every supported
  * attribute. */
@@ -10068,6 +10241,26 @@ UA_Server_readExecutable(UA_Server *server, const UA_NodeId nodeId,
 UA_StatusCode UA_EXPORT
 UA_Server_write(UA_Server *server, const UA_WriteValue *value);
 
+/* Write several attributes in one pass. The writes are grouped by the node.
+ * Every node is looked up and edited once for all its writes. The writes to
+ * the same node are applied in the order of the array. The onWrite callback of
+ * a variable is called once after its values were written.
+ *
+ * @param server The server object.
+ * @param valuesSize The number of WriteValues.
+ * @param values The WriteValues as in UA_Server_write.
+ * @param results Receives the status code of every write. Can be NULL.
+ * @return Returns the first bad status code of the writes or an error that
+ *         applies to all writes. */
+UA_StatusCode UA_EXPORT
+UA_Server_writeMany(UA_Server *server, size_t valuesSize, const UA_WriteValue *values,
+                    UA_StatusCode *results);
+
+/* Write the value attribute of several nodes with UA_Server_writeMany */
+UA_StatusCode UA_EXPORT
+UA_Server_writeValues(UA_Server *server, size_t valuesSize, const UA_NodeId *nodeIds,
+                      const UA_Variant *values, UA_StatusCode *results);
+
 /* Don't use this function. There are typed versions with no additional
  * overhead. */
 UA_StatusCode UA_EXPORT
@@ -10174,6 +10367,175 @@ UA_Server_writeExecutable(UA_Server *server, const UA_NodeId nodeId,
     return __UA_Server_write(server, &nodeId, UA_ATTRIBUTEID_EXECUTABLE,
                              &UA_TYPES[UA_TYPES_BOOLEAN], &executable); }
 
+/**
+ * Interned NodeIds
+ * ^^^^^^^^^^^^^^^^
+ * Nodes that are written over and over (e.g. from a repeated job that polls a
+ * sensor) can be addressed with an interned NodeId. Interning returns a handle
+ * that is unique for the NodeId within the server and that carries the
+ * precomputed hash of the NodeId. So two handles denote the same NodeId exactly
+ * when the pointers are equal. Lookups with the handle neither rehash the
+ * NodeId nor compare identifier strings once the node was found before.
+ *
+ * The handles are reference counted. Every call of UA_Server_internNodeId is
+ * matched by a call of UA_Server_releaseInternedNodeId once the handle is no
+ * longer used. The handle is freed with the last release (or when the server
+ * is deleted). */
+typedef struct {
+    UA_NodeId nodeId;
+    UA_UInt32 hash;
+} UA_InternedNodeId;
+
+/* Returns the handle for the NodeId or NULL if no memory could be allocated.
+ * The NodeId is copied internally. The node does not need to exist yet. */
+const UA_InternedNodeId UA_EXPORT *
+UA_Server_internNodeId(UA_Server *server, const UA_NodeId nodeId);
+
+/* Releases a handle returned from UA_Server_internNodeId. NULL is ignored. */
+void UA_EXPORT
+UA_Server_releaseInternedNodeId(UA_Server *server, const UA_InternedNodeId *nodeId);
+
+/* Same as UA_Server_write. The NodeId of the WriteValue is ignored in favor of
+ * the interned NodeId. */
+UA_StatusCode UA_EXPORT
+UA_Server_writeInterned(UA_Server *server, const UA_InternedNodeId *nodeId,
+                        const UA_WriteValue *value);
+
+static UA_INLINE UA_StatusCode
+UA_Server_writeValueInterned(UA_Server *server, const UA_InternedNodeId *nodeId,
+                             const UA_Variant value) {
+    UA_WriteValue wvalue;
+    UA_WriteValue_init(&wvalue);
+    wvalue.attributeId = UA_ATTRIBUTEID_VALUE;
+    wvalue.value.value = value;
+    wvalue.value.hasValue = true;
+    return UA_Server_writeInterned(server, nodeId, &wvalue);
+}
+
+/**
+ * Dense Numeric NodeIds
+ * ^^^^^^^^^^^^^^^^^^^^^
+ * Numeric NodeIds that are allocated in a contiguous range (e.g. from a
+ * generated information model) are stored in an array indexed by the
+ * identifier. Lookups then require neither hashing nor probing. The range of a
+ * namespace is grown automatically as long as at least a quarter of it is
+ * used. Reserving the range upfront avoids the reallocations while the nodes
+ * are added. Nodes of the namespace outside the reserved range are looked up
+ * in the hash table. */
+UA_StatusCode UA_EXPORT
+UA_Server_reserveNumericNodeIds(UA_Server *server, UA_UInt16 namespaceIndex,
+                                UA_UInt32 first, UA_UInt32 count);
+
+/**
+ * Bulk Loading
+ * ^^^^^^^^^^^^
+ * Every added node is checked for a valid reference to its parent (the parent
+ * and the ReferenceType exist, the ReferenceType is hierarchical and not
+ * abstract, type nodes use HasSubtype). Between ``UA_Server_beginBulkLoad``
+ * and ``UA_Server_commitBulkLoad``, these checks are deferred to a single
+ * validation pass at the commit. The nodestore is sized upfront for the
+ * expected number of nodes. (The reference arrays of the nodes always grow
+ * geometrically, so that a folder with many children is filled in amortized
+ * constant time.)
+ *
+ * The commit removes the nodes that fail the validation and returns them in
+ * ``errors`` with the NodeId and the reason. The array is deleted with
+ * ``UA_Array_delete`` and ``UA_TYPES[UA_TYPES_ADDNODESRESULT]``. Errors that
+ * are found while a node is added (e.g. an incompatible value or a parent
+ * that does not exist) are returned right away by the add function.
+ *
+ * Only one bulk load can be active. UA_STATUSCODE_BADINVALIDSTATE is returned
+ * for a second begin or a commit without begin. */
+UA_StatusCode UA_EXPORT
+UA_Server_beginBulkLoad(UA_Server *server, size_t expectedNodes);
+
+UA_StatusCode UA_EXPORT
+UA_Server_commitBulkLoad(UA_Server *server, size_t *errorsSize,
+                         UA_AddNodesResult **errors);
+
+/**
+ * Nodestore Snapshots
+ * ^^^^^^^^^^^^^^^^^^^
+ * A snapshot is a binary image of all nodes with their references and values.
+ * Loading a snapshot is much faster than adding the nodes one by one with
+ * consistency checks. The image contains no pointers, so it can be loaded
+ * directly from a memory-mapped file (see the file functions below).
+ *
+ * Callbacks and handles (DataSources, value callbacks, methods, instance
+ * handles, lifecycle management) are not part of the image. Nodes that exist
+ * already in the server are replaced and keep their callbacks and handles. So
+ * the image is loaded after UA_Server_new and after the callbacks were
+ * attached, but before the server is started. DataSource variables without
+ * an existing node are loaded with an empty value.
+ *
+ * The namespaces of the image are added to the server. Loading fails if a
+ * namespace has a different index in the server. If loading fails, the nodes
+ * loaded up to the error remain in the server. */
+
+/* The image is allocated and needs to be freed with UA_ByteString_deleteMembers */
+UA_StatusCode UA_EXPORT
+UA_Server_saveNodestoreSnapshot(UA_Server *server, UA_ByteString *image);
+
+/* The image is not modified and not referenced after the call */
+UA_StatusCode UA_EXPORT
+UA_Server_loadNodestoreSnapshot(UA_Server *server, const UA_ByteString *image);
+
+/**
+ * Memory Statistics
+ * ^^^^^^^^^^^^^^^^^
+ * The memory used by the information model, broken down by the node class.
+ * The sizes are computed from the content of the nodes when the function is
+ * called. The overhead of the allocator is not included.
+ *
+ * The nodes store their texts compactly. The locales are interned once per
+ * process and the displayName shares the buffer with the browseName if both
+ * are equal. Shared buffers are not counted for the nodes. Values shared
+ * between nodes (copies of the same variant) and the nodes of ns0 shared
+ * between the servers of the process are counted for every node. */
+typedef struct {
+    size_t nodes;          /* number of nodes */
+    size_t nodeBytes;      /* node structures and NodeIds */
+    size_t textBytes;      /* browseName, displayName, description, inverseName */
+    size_t referenceBytes; /* reference arrays */
+    size_t valueBytes;     /* values, data types and array dimensions */
+} UA_NodeClassStatistics;
+
+typedef struct {
+    /* Indexed by the bit position of the node class: Object, Variable,
+     * Method, ObjectType, VariableType, ReferenceType, DataType, View */
+    UA_NodeClassStatistics nodeClasses[8];
+    UA_NodeClassStatistics total;
+    size_t nodestoreBytes; /* hash table and dense arrays of the nodestore */
+    size_t internedBytes;  /* interned NodeIds and locales */
+} UA_MemoryStatistics;
+
+UA_StatusCode UA_EXPORT
+UA_Server_getMemoryStatistics(UA_Server *server, UA_MemoryStatistics *stats);
+
+/**
+ * Nodestore Statistics
+ * ^^^^^^^^^^^^^^^^^^^^
+ * The state of the hash table of the nodestore for monitoring. The probe
+ * length of a node is the number of slots visited to find it. Tombstones are
+ * the slots of removed nodes. They lengthen the probe sequences until they
+ * are reused or dropped by the next resize. A resize does not rehash all
+ * nodes at once. The nodes are moved to the new table a few slots at a time
+ * with the following inserts and removals. The statistics are computed when
+ * the function is called. Returns UA_STATUSCODE_BADNOTSUPPORTED with
+ * multithreading. */
+typedef struct {
+    size_t hashedNodes;  /* nodes in the hash table */
+    size_t denseNodes;   /* nodes in the dense arrays (found without probing) */
+    size_t slots;        /* size of the hash table */
+    size_t tombstones;
+    size_t movingNodes;  /* nodes not yet moved to the resized table */
+    UA_Double averageProbeLength;
+    size_t maxProbeLength;
+} UA_NodeStoreStatistics;
+
+UA_StatusCode UA_EXPORT
+UA_Server_getNodeStoreStatistics(UA_Server *server, UA_NodeStoreStatistics *stats);
+
 /**
  * Browsing
  * -------- */
@@ -10241,7 +10603,58 @@ UA_Server_call(UA_Server *server, const UA_CallMethodRequest *request);
  * that contains the value content and additional timestamps.
  *
  * It is expected that the read callback is implemented. The write callback can
- * be set to a null-pointer. */
+ * be set to a null-pointer.
+ *
+ * Data sources that wait for a slow device or a remote system can additionally
+ * get an asynchronous read with ``UA_Server_setVariableNode_asyncDataSource``.
+ * It is used for the Read service and for the sampling of MonitoredItems.
+ * Instead of blocking, the data source returns
+ * ``UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY`` and later hands the value to
+ * ``UA_Server_completeAsyncRead``. The server keeps serving other requests in
+ * the meantime. The response to a Read request is sent when all of its
+ * operations have completed, or with ``UA_STATUSCODE_BADTIMEOUT`` for the
+ * operations that did not complete in time. Reads from within the server
+ * (e.g. ``UA_Server_read``) always use the synchronous read callback.
+ *
+ * Drivers that serve many variables, e.g. over a fieldbus with one transaction
+ * for many tags, can attach a batch provider to their data sources with
+ * ``UA_Server_setVariableNode_dataSourceProvider``. The Read and
+ * Write services and the sampling of MonitoredItems group the operations on
+ * data sources with the same provider and forward them with one call to
+ * readMany or writeMany. Single operations still use the read and write
+ * callbacks. */
+
+/* Identifies an outstanding asynchronous read operation */
+typedef struct {
+    UA_UInt32 id;    /* the request (or sample) the operation belongs to */
+    UA_UInt32 index; /* the operation within the request */
+} UA_AsyncOperationId;
+
+/* An operation in a batch for a provider */
+typedef struct {
+    UA_NodeId nodeId;
+    void *handle; /* the handle of the node's data source */
+    const UA_NumericRange *range; /* NULL if the full value is accessed */
+} UA_DataSourceOperation;
+
+typedef struct {
+    void *context;
+
+    /* Reads the values of all operations. Every value is set as in the read
+     * callback of the data source. A returned error applies to all values.
+     * Can be set to a null-pointer. */
+    UA_StatusCode (*readMany)(void *context, size_t operationsSize,
+                              const UA_DataSourceOperation *operations,
+                              UA_Boolean includeSourceTimeStamp, UA_DataValue *values);
+
+    /* Writes the values of all operations. The status of every write is set
+     * in results. A returned error applies to all operations. Can be set to a
+     * null-pointer. */
+    UA_StatusCode (*writeMany)(void *context, size_t operationsSize,
+                               const UA_DataSourceOperation *operations,
+                               const UA_Variant *values, UA_StatusCode *results);
+} UA_DataSourceProvider;
+
 typedef struct {
     void *handle; /* A custom pointer to reuse the same datasource functions for
                      multiple sources */
@@ -10285,6 +10698,71 @@ UA_StatusCode UA_EXPORT
 UA_Server_setVariableNode_dataSource(UA_Server *server, const UA_NodeId nodeId,
                                      const UA_DataSource dataSource);
 
+/* Starts an asynchronous read of a data source.
+ *
+ * @param handle The handle of the data source
+ * @param operation Identifies the operation in the call to
+ *        UA_Server_completeAsyncRead. The range pointer is only valid during
+ *        the call.
+ * @return UA_STATUSCODE_GOODCOMPLETESASYNCHRONOUSLY if the value is provided
+ *         later. Otherwise, the read completed synchronously with the same
+ *         semantics as the read callback of the data source. */
+typedef UA_StatusCode
+(*UA_DataSourceReadAsync)(void *handle, const UA_NodeId nodeid,
+                          UA_Boolean includeSourceTimeStamp,
+                          const UA_NumericRange *range,
+                          UA_AsyncOperationId operation, UA_DataValue *value);
+
+/* Adds an asynchronous read to the data source of a variable node. NULL
+ * removes it. Setting a new data source removes it as well.
+ *
+ * @return UA_STATUSCODE_BADINVALIDSTATE if the node has no data source. */
+UA_StatusCode UA_EXPORT
+UA_Server_setVariableNode_asyncDataSource(UA_Server *server, const UA_NodeId nodeId,
+                                          UA_DataSourceReadAsync readAsync);
+
+/* Attaches a batch provider to the data source of a variable node. The
+ * provider is shared by the data sources of a driver and must outlive them.
+ * NULL detaches it. Setting a new data source detaches it as well.
+ *
+ * @return UA_STATUSCODE_BADINVALIDSTATE if the node has no data source. */
+UA_StatusCode UA_EXPORT
+UA_Server_setVariableNode_dataSourceProvider(UA_Server *server, const UA_NodeId nodeId,
+                                             const UA_DataSourceProvider *provider);
+
+/* Completes an asynchronous read. The server takes over the content of the
+ * value (also if an error is returned). The data source sets the read data or
+ * a bad status in the value, as in the read callback. Without multithreading,
+ * call this from the thread running the server, e.g. from a repeated job.
+ *
+ * @return UA_STATUSCODE_BADNOTFOUND if the operation is unknown or has
+ *         already timed out. */
+UA_StatusCode UA_EXPORT
+UA_Server_completeAsyncRead(UA_Server *server, UA_AsyncOperationId operation,
+                            UA_DataValue *value);
+
+/* The last value that a read with a maxAge got from a DataSource is cached
+ * (within config.valueCacheSize). Reads without a maxAge neither use nor fill
+ * the cache. Reads with a maxAge are answered from the cache if the cached
+ * value is younger than the maxAge. The response then contains the
+ * source and server timestamp of the original read. Reads with an index range
+ * bypass the cache. Writes through the server invalidate the cached value. A
+ * DataSource invalidates the value if it changes in the source and clients
+ * shall not see the old value. NULL invalidates all cached values. */
+void UA_EXPORT
+UA_Server_invalidateCachedValue(UA_Server *server, const UA_NodeId *nodeId);
+
+typedef struct {
+    size_t values;       /* cached values */
+    size_t bytes;        /* memory of the cached values */
+    UA_UInt64 hits;      /* reads answered from the cache */
+    UA_UInt64 misses;    /* reads with a maxAge that called the DataSource */
+    UA_UInt64 evictions; /* values dropped to stay within the budget */
+} UA_ValueCacheStatistics;
+
+UA_StatusCode UA_EXPORT
+UA_Server_getValueCacheStatistics(UA_Server *server, UA_ValueCacheStatistics *stats);
+
 /**
  * .. _value-callback:
  *
@@ -11701,6 +12179,31 @@ extern UA_EXPORT const UA_ClientConfig UA_ClientConfig_standard;
 #endif
 
 
+/*********************************** amalgamated original file "/home/travis/build/open62541/open62541/plugins/ua_snapshot_file.h" ***********************************/
+
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information. */
+
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Write a nodestore snapshot of the server to a file */
+UA_StatusCode UA_EXPORT
+UA_Server_saveNodestoreSnapshotFile(UA_Server *server, const char *path);
+
+/* Load a nodestore snapshot from a file. The file is memory-mapped and the
+ * nodes are decoded from the mapping without reading the file first. */
+UA_StatusCode UA_EXPORT
+UA_Server_loadNodestoreSnapshotFile(UA_Server *server, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+
 #ifdef __cplusplus
 } // extern "C"
 #endif